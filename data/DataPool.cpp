@@ -47,31 +47,6 @@ DataPool::Stats loadStatsFromFile(const std::string& filePath) {
     return stats;
 }
 
-void saveStatsToFile(
-        const DataPool::Stats& stats, const std::string& filePath) {
-    Json::Value jStats;
-    for (unsigned int iStep = 0; iStep < stats.size(); ++iStep) {
-        const auto& step = stats[iStep];
-        Json::Value jStep;
-        for (auto pair : step) {
-            const auto& volume = pair.second;
-            Json::Value jVolume;
-            for (auto vPair : volume.means) {
-                const auto& key = vPair.first;
-                jVolume[key]["mean"] = volume.means.at(key);
-                jVolume[key]["meanRange"]["min"] = volume.meanRanges.at(key)[0];
-                jVolume[key]["meanRange"]["max"] = volume.meanRanges.at(key)[1];
-            }
-            jStep[pair.first] = jVolume;
-        }
-        jStats[iStep] = jStep;
-    }
-    std::ofstream fout(filePath.c_str());
-    assert(fout);
-    Json::StyledStreamWriter writer;
-    writer.write(fout, jStats);
-}
-
 } // unnamed namespace
 
 /**
@@ -112,33 +87,78 @@ void DataLoader::initialize(std::string dir, GridConfig gridConfig,
     _timeSteps = timeSteps;
     _pdfInTracerDir = pdfInTracerDir;
     _histConfigs = configs;
+    _derivedCache = std::make_shared<HistDerivedCache>(dir);
 }
 
 std::shared_ptr<HistFacadeVolume> DataLoader::load(
         const HistVolumeId &histVolumeId) {
     int stepId = histVolumeId.first;
-    std::string name = histVolumeId.second;
-    auto itr = std::find_if(_histConfigs.begin(), _histConfigs.end(),
-            [name](HistConfig histConfig){
-        return histConfig.name() == name;
-    });
-    if (_histConfigs.end() == itr)
+    std::string idcstr;
+    auto config = histConfig(histVolumeId.second, &idcstr);
+    if (!config)
         return nullptr;
-    int index = itr - _histConfigs.begin() + 1;
-    std::string idcstr = yy::sprintf("%03d", index);
     auto histVol = ([&]() {
         if (GridConfig::GridType_UniformGrid == _gridConfig.gridType()) {
             return std::make_shared<HistFacadeVolume>(stepDir(stepId), idcstr,
-                    std::vector<int>(_gridConfig.dimProcs()), itr->vars);
+                    std::vector<int>(_gridConfig.dimProcs()), config->vars);
         } else if (GridConfig::GridType_MultiBlock == _gridConfig.gridType()) {
             return std::make_shared<HistFacadeVolume>(stepDir(stepId), idcstr,
-                    _gridConfig.multiBlocks(), itr->vars);
+                    _gridConfig.multiBlocks(), config->vars);
         }
         assert(false);
     })();
+    histVol->setDerivedCache(_derivedCache, _timeSteps.asString(stepId));
     return histVol;
 }
 
+/**
+ * @brief DataLoader::stats parses the stats in one pass over the files of the
+ * volume and only builds the volume for the layouts it cannot parse.
+ * @param histVolumeId
+ * @return
+ */
+HistFacadeVolume::Stats DataLoader::stats(const HistVolumeId &histVolumeId) {
+    std::string idcstr;
+    auto config = histConfig(histVolumeId.second, &idcstr);
+    assert(config);
+    HistVolumeStats volumeStats;
+    if (HistVolumeStats::scan(stepDir(histVolumeId.first), idcstr,
+            config->vars, &volumeStats)) {
+        return HistFacadeVolume::Stats::create(config->vars,
+                volumeStats.means(), volumeStats.mins(), volumeStats.maxs());
+    }
+    return load(histVolumeId)->stats();
+}
+
+/**
+ * @brief DataLoader::convert writes the volume into the indexed container,
+ * which load() prefers from then on.
+ * @param histVolumeId
+ * @param compress delta-varint encode the bins
+ * @return
+ */
+bool DataLoader::convert(const HistVolumeId &histVolumeId, bool compress) {
+    auto histVol = load(histVolumeId);
+    if (!histVol)
+        return false;
+    if (histVol->isIndexed())
+        return true;
+    return histVol->writeIndexed(compress);
+}
+
+const HistConfig* DataLoader::histConfig(
+        const std::string& name, std::string* fileName) const {
+    auto itr = std::find_if(_histConfigs.begin(), _histConfigs.end(),
+            [name](HistConfig histConfig){
+        return histConfig.name() == name;
+    });
+    if (_histConfigs.end() == itr)
+        return nullptr;
+    int index = itr - _histConfigs.begin() + 1;
+    *fileName = yy::sprintf("%03d", index);
+    return &*itr;
+}
+
 void DataLoader::processQueue()
 {
     _isLoading = true;
@@ -296,22 +316,25 @@ void DataStep::applyQueryRules() {
         const std::vector<QueryRule>& rules = keyValue.second;
         auto histVolume = dumbVolume(histName);
         assert(histVolume);
+        // the rules as precisely as they are compared, to key the cache
+        std::ostringstream query;
+        query.precision(9);
+        for (const auto& rule : rules)
+            query << rule;
         // for each histogram in a histogram volume
-        for (int iHist = 0; iHist < nHist(); ++iHist) {
+        auto mask = histVolume->selectionMask(query.str(), [&](int iHist) {
             auto hist = histVolume->hist(iHist);
-            bool histSelected = m_histMask[iHist];
             // for each rule targettting this hist config
             for (auto rule : rules) {
                 // check if the histogram is selected
-                bool selected =
-                        hist->checkRange(rule.intervals, rule.threshold);
-                histSelected = histSelected && selected;
-                if (!histSelected)
-                    break;
+                if (!hist->checkRange(rule.intervals, rule.threshold))
+                    return false;
             }
-            // put it in the mask
-            m_histMask[iHist] = histSelected;
-        }
+            return true;
+        });
+        // put it in the mask
+        for (int iHist = 0; iHist < nHist(); ++iHist)
+            m_histMask[iHist] = m_histMask[iHist] && mask[iHist];
     }
     // set selected in the hist facades
     for (auto keyValue : m_data)
@@ -415,6 +438,23 @@ bool DataPool::setDir(const std::string& dir)
     return m_isOpen;
 }
 
+bool DataPool::convertToIndexed(bool compress) const {
+    assert(m_isOpen);
+    DataLoader loader;
+    loader.initialize(
+            m_dir, m_gridConfig, m_timeSteps, m_pdfInTracerDir, m_histConfigs);
+    for (int iStep = 0; iStep < m_timeSteps.nSteps(); ++iStep)
+    for (const auto& histConfig : m_histConfigs) {
+        std::cout << "converting " << m_timeSteps.asString(iStep) << " "
+                << histConfig.name() << std::endl;
+        if (!loader.convert({ iStep, histConfig.name() }, compress)) {
+            std::cout << "failed to convert " << stepDir(iStep) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 std::shared_ptr<DataStep> DataPool::step(int iStep)
 {
     if (iStep >= m_timeSteps.nSteps())
@@ -429,8 +469,10 @@ std::shared_ptr<DataStep> DataPool::step(int iStep)
     return m_data[iStep];
 }
 
-void DataPool::stats(std::function<void(Stats)> callback) const {
+void DataPool::stats(std::function<void(Stats)> callback,
+        const std::string& firstConfig) const {
     assert(m_isOpen);
+    // the stats of older datasets are kept as json
     std::string filePath = m_dir + "/datastats.json";
     std::cout << filePath << std::endl;
     if (fileExists(filePath)) {
@@ -440,13 +482,16 @@ void DataPool::stats(std::function<void(Stats)> callback) const {
         _statsThread = std::make_shared<StatsThread>();
         _statsThread->compute(
                 m_dir, m_gridConfig, m_timeSteps, m_pdfInTracerDir,
-                m_histConfigs, QThread::currentThread(), [=](Stats stats) {
-            saveStatsToFile(stats, filePath);
-            callback(stats);
-        });
+                m_histConfigs, firstConfig, QThread::currentThread(),
+                callback);
     }
 }
 
+void DataPool::prioritizeStats(const std::string& config) const {
+    if (_statsThread)
+        _statsThread->prioritize(config);
+}
+
 const HistConfig &DataPool::histConfig(const std::string &name) const
 {
     auto itr = std::find_if(m_histConfigs.begin(), m_histConfigs.end(),
@@ -501,6 +546,8 @@ void DataPool::loadHistVolume(DataLoader::HistVolumeId histVolumeId) {
     auto histVol = m_dataLoader->load(histVolumeId);
     assert(histVol);
     this->step(stepId)->setVolume(name, histVol);
+    // the volume normalization ranges are then ready when the view asks
+    QtConcurrent::run([histVol]() { histVol->prefetchRanges(); });
 
     QTimer::singleShot(0, this, [=]() {
         int bufferRadius = 40;
@@ -7,6 +7,7 @@
 #include <map>
 #include <functional>
 #include <QObject>
+#include <QThreadPool>
 #include <QtConcurrent/QtConcurrent>
 #include "histgrid.h"
 #include "histfacadegrid.h"
@@ -50,6 +51,8 @@ public:
 public slots:
     std::string stepDir(int iStep) const;
     std::shared_ptr<HistFacadeVolume> load(const HistVolumeId& histVolumeId);
+    bool convert(const HistVolumeId& histVolumeId, bool compress = false);
+    HistFacadeVolume::Stats stats(const HistVolumeId& histVolumeId);
     void processQueue();
 
 public:
@@ -61,6 +64,11 @@ public:
 signals:
     void histVolumeLoaded(HistVolumeId, std::shared_ptr<HistFacadeVolume>);
 
+private:
+    /// The config named name and the name of its files.
+    const HistConfig* histConfig(
+            const std::string& name, std::string* fileName) const;
+
 private:
     QMutex _queueMutex;
     HistVolumeIds _queue;
@@ -70,6 +78,7 @@ private:
     TimeSteps _timeSteps;
     bool _pdfInTracerDir;
     std::vector<HistConfig> _histConfigs;
+    std::shared_ptr<const HistDerivedCache> _derivedCache;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -131,10 +140,17 @@ public:
 
 public:
     typedef std::vector<DataStep::Stats> Stats;
-    void stats(std::function<void(Stats)> callback) const;
+    /// Delivers the stats of the volumes as they are computed, those of
+    /// firstConfig first.
+    void stats(std::function<void(Stats)> callback,
+            const std::string& firstConfig = std::string()) const;
+    /// Moves the volumes of config ahead in the stats computation.
+    void prioritizeStats(const std::string& config) const;
 
 public:
     bool setDir(const std::string& dir);
+    const std::string& dir() const { return m_dir; }
+    bool convertToIndexed(bool compress = false) const;
     std::shared_ptr<DataStep> step(int iStep);
     bool isOpen() { return m_isOpen; }
     bool setOpen( bool c ) { m_isOpen = c; return isOpen(); }
@@ -182,12 +198,18 @@ private:
 };
 
 /**
- * @brief The StatsThread class
+ * @brief The StatsThread class computes the stats of every volume of the
+ * dataset on the global thread pool, the volumes of the first config before
+ * the others. Each volume's stats are appended to the stats log of the
+ * dataset as they come, so a later run only computes the missing ones.
  */
 class StatsThread : public QThread {
     Q_OBJECT
 public:
-    StatsThread(QObject *parent = nullptr) : QThread(parent) {}
+    StatsThread(QObject *parent = nullptr) : QThread(parent) {
+        // half the cores, the global pool stays free for the volume loads
+        _pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    }
     virtual ~StatsThread() {
         std::cout << "begin StatsThread::~StatsThread(" << _dir << ")" << std::endl;
         _mutex.lock();
@@ -199,15 +221,20 @@ public:
     }
 
 public:
+    static std::string logPath(const std::string& dir) {
+        return dir + "/datastats.bin";
+    }
     void compute(std::string dir, GridConfig gridConfig, TimeSteps timeSteps,
             bool pdfInTracerDir, std::vector<HistConfig> histConfigs,
-            QObject* context, std::function<void(DataPool::Stats)> callback) {
+            std::string firstConfig, QObject* context,
+            std::function<void(DataPool::Stats)> callback) {
         QMutexLocker locker(&_mutex);
         _dir = dir;
         _gridConfig = gridConfig;
         _timeSteps = timeSteps;
         _pdfInTracerDir = pdfInTracerDir;
         _histConfigs = histConfigs;
+        _firstConfig = firstConfig;
         _context = context;
         _callback = callback;
         if (!isRunning()) {
@@ -217,32 +244,106 @@ public:
             _condition.wakeOne();
         }
     }
+    /// The remaining volumes of config are computed next.
+    void prioritize(std::string config) {
+        QMutexLocker locker(&_mutex);
+        _firstConfig = config;
+    }
 
 protected:
     virtual void run() override {
         forever {
+            _mutex.lock();
             std::shared_ptr<DataLoader> loader = std::make_shared<DataLoader>();
             loader->initialize(_dir, _gridConfig, _timeSteps, _pdfInTracerDir,
                     _histConfigs);
-            DataPool::Stats dataStats;
-            for (int iStep = 0; iStep < _timeSteps.nSteps(); ++iStep) {
-                if (_restart) break;
-                if (_abort) return;
-                DataStep::Stats stepStats;
-                for (int iConfig = 0; iConfig < _histConfigs.size();
-                        ++iConfig) {
-                    auto name = _histConfigs[iConfig].name();
-                    DataLoader::HistVolumeId histVolumeId = {iStep, name};
-                    auto histVolume = loader->load(histVolumeId);
-                    auto statsPerVolume = histVolume->stats();
-                    stepStats[name] = statsPerVolume;
+            HistStatsLog log(logPath(_dir));
+            auto histConfigs = _histConfigs;
+            auto context = _context;
+            auto callback = _callback;
+            _mutex.unlock();
+            // resume from the records of the log whose step directory is
+            // unchanged since
+            DataPool::Stats dataStats(_timeSteps.nSteps());
+            std::map<int, FileStamp> sources;
+            auto sourceOf = [&](int iStep) {
+                if (0 == sources.count(iStep)) {
+                    sources[iStep] =
+                            HistDerivedCache::sourceOf(loader->stepDir(iStep));
+                }
+                return sources[iStep];
+            };
+            for (const auto& record : log.records()) {
+                auto itr = std::find_if(histConfigs.begin(), histConfigs.end(),
+                        [&record](const HistConfig& config) {
+                    return config.name() == record.name;
+                });
+                if (0 <= record.step && record.step < int(dataStats.size())
+                        && itr != histConfigs.end()
+                        && itr->vars.size() == record.means.size()
+                        && sourceOf(record.step) == record.source) {
+                    dataStats[record.step][record.name] =
+                            HistFacadeVolume::Stats::create(itr->vars,
+                                record.means, record.mins, record.maxs);
                 }
-                dataStats.push_back(stepStats);
-                if (_restart) break;
-                if (_abort) return;
-                QTimer::singleShot(
-                        0, _context, std::bind(_callback, dataStats));
             }
+            std::vector<DataLoader::HistVolumeId> pending;
+            for (const auto& config : histConfigs)
+            for (int iStep = 0; iStep < int(dataStats.size()); ++iStep) {
+                if (0 == dataStats[iStep].count(config.name()))
+                    pending.push_back({ iStep, config.name() });
+            }
+            if (!log.records().empty())
+                QTimer::singleShot(0, context, std::bind(callback, dataStats));
+            // each worker takes the next volume until none is left
+            QMutex resultMutex;
+            auto work = [&]() {
+                forever {
+                    DataLoader::HistVolumeId histVolumeId;
+                    {
+                        QMutexLocker locker(&_mutex);
+                        if (_abort || _restart || pending.empty())
+                            return;
+                        auto itr = std::find_if(pending.begin(), pending.end(),
+                                [this](const DataLoader::HistVolumeId& id) {
+                            return id.second == _firstConfig;
+                        });
+                        if (pending.end() == itr)
+                            itr = pending.begin();
+                        histVolumeId = *itr;
+                        pending.erase(itr);
+                    }
+                    // stamped before, so a change while computing shows
+                    auto source = HistDerivedCache::sourceOf(
+                            loader->stepDir(histVolumeId.first));
+                    auto volumeStats = loader->stats(histVolumeId);
+                    const auto& vars = std::find_if(
+                            histConfigs.begin(), histConfigs.end(),
+                            [&](const HistConfig& config) {
+                        return config.name() == histVolumeId.second;
+                    })->vars;
+                    HistStatsLog::Record record = { histVolumeId.first,
+                            histVolumeId.second, source, {}, {}, {} };
+                    for (const auto& var : vars) {
+                        const auto& range = volumeStats.meanRanges.at(var);
+                        record.means.push_back(volumeStats.means.at(var));
+                        record.mins.push_back(range[0]);
+                        record.maxs.push_back(range[1]);
+                    }
+                    QMutexLocker locker(&resultMutex);
+                    log.append(record);
+                    dataStats[histVolumeId.first][histVolumeId.second] =
+                            volumeStats;
+                    QTimer::singleShot(
+                            0, context, std::bind(callback, dataStats));
+                }
+            };
+            std::vector<QFuture<void>> workers;
+            for (int iWorker = 0; iWorker < _pool.maxThreadCount(); ++iWorker)
+                workers.push_back(QtConcurrent::run(&_pool, work));
+            for (auto& worker : workers)
+                worker.waitForFinished();
+            if (_abort) return;
             // mutex for waking the thread
             _mutex.lock();
             if (!_restart) {
@@ -257,6 +358,7 @@ protected:
 private:
     QMutex _mutex;
     QWaitCondition _condition;
+    QThreadPool _pool;
     bool _restart = false;
     bool _abort = false;
     std::string _dir;
@@ -264,6 +366,7 @@ private:
     TimeSteps _timeSteps;
     bool _pdfInTracerDir;
     std::vector<HistConfig> _histConfigs;
+    std::string _firstConfig;
     QObject* _context;
     std::function<void(DataPool::Stats)> _callback;
 };
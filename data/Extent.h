@@ -6,7 +6,13 @@
 #include <array>
 #include <cstring>
 #include <cassert>
+#include <cstdint>
 
+/**
+ * @brief The Extent class
+ * Element counts and flat ids are 64-bit, as volumes of 2^31 voxels or bins
+ * overflow int, while the ids along each dimension stay int.
+ */
 class Extent
 {
 public:
@@ -22,9 +28,9 @@ public:
     std::vector<int>::const_iterator end() const { return dimension.end(); }
     int& operator[](int index)       { return dimension[index]; }
     int  operator[](int index) const { return dimension[index]; }
-    int nElement() const {
+    int64_t nElement() const {
         assert(!dimension.empty());
-        int prod = 1;
+        int64_t prod = 1;
         for (auto d : dimension) {
             prod *= d;
         }
@@ -33,11 +39,11 @@ public:
     int nDim() const { return dimension.size(); }
 
     template <std::size_t Size>
-    int idstoflat(const std::array<int, Size>& ids) const {
+    int64_t idstoflat(const std::array<int, Size>& ids) const {
         assert(dimension.size() == Size);
-        int sum = 0;
+        int64_t sum = 0;
         for (unsigned int iSum = 0; iSum < dimension.size(); ++iSum) {
-            int prod = ids[iSum];
+            int64_t prod = ids[iSum];
             for (unsigned int iProd = 0; iProd < iSum; ++iProd)
                 prod *= dimension[iProd];
             sum += prod;
@@ -45,10 +51,10 @@ public:
         return sum;
     }
 
-    int idstoflat(const std::vector<int>& ids) const {
-        int sum = 0;
+    int64_t idstoflat(const std::vector<int>& ids) const {
+        int64_t sum = 0;
         for (unsigned int iSum = 0; iSum < dimension.size(); ++iSum) {
-            int prod = ids[iSum];
+            int64_t prod = ids[iSum];
             for (unsigned int iProd = 0; iProd < iSum; ++iProd)
                 prod *= dimension[iProd];
             sum += prod;
@@ -57,14 +63,14 @@ public:
     }
 
     template<typename... Targs>
-    int idstoflat(int currId, Targs... ids) const {
+    int64_t idstoflat(int currId, Targs... ids) const {
         const int nDim = sizeof...(ids) + 1;
         return idstoflatinternal(nDim, currId, ids...);
     }
 
-    std::vector<int> flattoids(int flatId) const {
+    std::vector<int> flattoids(int64_t flatId) const {
         std::vector<int> ids(dimension.size());
-        int flat = flatId;
+        int64_t flat = flatId;
         for (unsigned int iId = 0; iId < dimension.size(); ++iId) {
             ids[iId] = flat % dimension[iId];
             flat = flat / dimension[iId];
@@ -73,27 +79,27 @@ public:
     }
 
     template<typename... Targs>
-    void flattoids(int flatId, Targs... ids) const {
+    void flattoids(int64_t flatId, Targs... ids) const {
         const int nDim = sizeof...(ids);
         flattoidsinternal(nDim, flatId, ids...);
     }
 
 private:
-    int idstoflatinternal(const int) const { return 0; }
+    int64_t idstoflatinternal(const int) const { return 0; }
     template<typename... Targs>
-    int idstoflatinternal(const int nDim, int currId, Targs... ids) const {
+    int64_t idstoflatinternal(const int nDim, int currId, Targs... ids) const {
         const int iSum = nDim - sizeof...(ids) - 1;
         assert(currId < dimension[iSum]);
-        int prod = currId;
+        int64_t prod = currId;
         for (int iProd = 0; iProd < iSum; ++iProd)
             prod *= dimension[iProd];
         return prod + idstoflatinternal(nDim, ids...);
     }
 
-    void flattoidsinternal(const int, int) const { return; }
+    void flattoidsinternal(const int, int64_t) const { return; }
     template<typename... Targs>
     void flattoidsinternal(
-            const int nDim, int flatId, int* currId, Targs... ids) const {
+            const int nDim, int64_t flatId, int* currId, Targs... ids) const {
         const int iId = nDim - sizeof...(ids) - 1;
         *currId = flatId % dimension[iId];
         flattoidsinternal(nDim, flatId / dimension[iId], ids...);
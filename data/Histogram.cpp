@@ -602,3 +602,42 @@ std::shared_ptr<const Hist> HistCollapser::collapseTo(
     }
     return nullptr;
 }
+
+std::shared_ptr<const Hist> HistRebinner::coarsenTo(int level) {
+    assert(level >= 0);
+    int nDim = m_hist->nDim();
+    std::vector<int> factors(nDim, 1), nBins(nDim);
+    bool isCoarsened = false;
+    for (int iDim = 0; iDim < nDim; ++iDim) {
+        int nBin = m_hist->dim()[iDim];
+        while (factors[iDim] < (1 << level) && 0 == nBin % (2 * factors[iDim]))
+            factors[iDim] *= 2;
+        nBins[iDim] = nBin / factors[iDim];
+        isCoarsened = isCoarsened || factors[iDim] > 1;
+    }
+    if (!isCoarsened) return m_hist;
+    Extent coarse(nBins);
+    std::vector<float> values(coarse.nElement(), 0.f);
+    std::vector<int> ids(nDim, 0);
+    for (int iBin = 0; iBin < m_hist->nBins(); ++iBin) {
+        int coarseId = 0, stride = 1;
+        for (int iDim = 0; iDim < nDim; ++iDim) {
+            coarseId += ids[iDim] / factors[iDim] * stride;
+            stride *= nBins[iDim];
+        }
+        values[coarseId] += m_hist->binFreq(iBin);
+        for (int iDim = 0; iDim < nDim; ++iDim) {
+            if (++ids[iDim] < m_hist->dim()[iDim])
+                break;
+            ids[iDim] = 0;
+        }
+    }
+    std::vector<double> mins(nDim), maxs(nDim), logBases(nDim);
+    for (int iDim = 0; iDim < nDim; ++iDim) {
+        mins[iDim] = m_hist->dimMin(iDim);
+        maxs[iDim] = m_hist->dimMax(iDim);
+        logBases[iDim] = m_hist->logBase(iDim);
+    }
+    return std::shared_ptr<const Hist>(Hist::fromDenseValues(
+            nDim, nBins, mins, maxs, logBases, m_hist->vars(), values));
+}
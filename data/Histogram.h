@@ -152,11 +152,15 @@ public:
         assert(iDim < m_dim.nDim()); return m_vars[iDim];
     }
     const std::vector<std::string>& vars() const { return m_vars; }
+    /// The fraction of the samples that fell in the ranges of the bins.
+    double percentInRange() const { return m_percentInRange; }
+    void setPercentInRange(double percent) { m_percentInRange = percent; }
 
 protected:
     Extent m_dim;
     std::vector<double> m_mins, m_maxs, m_logBases;
     std::vector<std::string> m_vars;
+    double m_percentInRange = 1.0;
 };
 std::ostream& operator<<(std::ostream& out, const Hist& hist);
 
@@ -397,4 +401,26 @@ private:
     std::shared_ptr<const Hist> m_hist;
 };
 
+
+
+
+
+/**
+ * @brief The HistRebinner class merges neighboring bins into power-of-two
+ * coarsened versions of a histogram, e.g., 32 -> 16 -> 8 bins per axis.
+ */
+class HistRebinner
+{
+public:
+    HistRebinner(std::shared_ptr<const Hist> hist) : m_hist(hist) {}
+
+public:
+    /// Merges 2^level bins along each dimension, or as many as the power of
+    /// two dividing the bin count of that dimension, so the ranges stay.
+    std::shared_ptr<const Hist> coarsenTo(int level);
+
+private:
+    std::shared_ptr<const Hist> m_hist;
+};
+
 #endif // _HISTOGRAM_H_
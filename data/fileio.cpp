@@ -0,0 +1,66 @@
+#include "fileio.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "directory.h"
+
+FileStamp FileStamp::of(const std::string &dir,
+        const std::function<bool(const std::string& name)>& accept) {
+    FileStamp stamp = { 0, 0 };
+    for (const auto& entry : entryNamesInDirectory(dir)) {
+        FileStamp file;
+        if (!accept(entry) || !ofFile(dir + "/" + entry, &file))
+            continue;
+        stamp.size += file.size;
+        stamp.mtime = std::max(stamp.mtime, file.mtime);
+    }
+    return stamp;
+}
+
+bool FileStamp::ofFile(const std::string &path, FileStamp *stamp) {
+    struct stat info;
+    if (0 != stat(path.c_str(), &info) || !S_ISREG(info.st_mode))
+        return false;
+    stamp->size = info.st_size;
+    stamp->mtime = info.st_mtime;
+    return true;
+}
+
+bool writeAside(const std::string &path,
+        const std::function<bool(const std::string& asidePath)>& write) {
+    static std::atomic<int> nWrites(0);
+    std::string asidePath = path + "." + std::to_string(getpid()) + "."
+            + std::to_string(nWrites++);
+    if (write(asidePath) && 0 == std::rename(asidePath.c_str(), path.c_str()))
+        return true;
+    std::remove(asidePath.c_str());
+    return false;
+}
+
+bool writeAt(int fd, const void *data, int64_t nBytes, int64_t offset) {
+    const char* bytes = static_cast<const char*>(data);
+    while (0 < nBytes) {
+        ssize_t written = pwrite(fd, bytes, nBytes, offset);
+        if (written <= 0)
+            return false;
+        bytes += written;
+        nBytes -= written;
+        offset += written;
+    }
+    return true;
+}
+
+bool readAt(int fd, void *data, int64_t nBytes, int64_t offset) {
+    char* bytes = static_cast<char*>(data);
+    while (0 < nBytes) {
+        ssize_t nRead = pread(fd, bytes, nBytes, offset);
+        if (nRead <= 0)
+            return false;
+        bytes += nRead;
+        nBytes -= nRead;
+        offset += nRead;
+    }
+    return true;
+}
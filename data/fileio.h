@@ -0,0 +1,41 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief The FileStamp struct is the total size and latest modification time
+ * of the files a derived file is written from. It is stored in the derived
+ * file, which is stale once the stamp of its sources has changed.
+ */
+struct FileStamp {
+    int64_t size;
+    int64_t mtime;
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && mtime == other.mtime;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    /// The stamp of the regular files in dir whose names accept holds for.
+    static FileStamp of(const std::string& dir,
+            const std::function<bool(const std::string& name)>& accept);
+    /// The stamp of the file at path, false without it.
+    static bool ofFile(const std::string& path, FileStamp* stamp);
+};
+
+/// Writes path through write(asidePath), into a file next to it that is
+/// unique to the writer, then renames it to path. A reader thus never sees a
+/// file cut short and concurrent writers of the same path do not mix. The
+/// aside file is removed when write() returns false or the rename fails.
+bool writeAside(const std::string& path,
+        const std::function<bool(const std::string& asidePath)>& write);
+/// Writes nBytes of data at offset of fd, through short writes, false when
+/// any of them fails.
+bool writeAt(int fd, const void* data, int64_t nBytes, int64_t offset);
+/// Reads nBytes at offset of fd into data, through short reads, false when
+/// any of them fails or the file ends first.
+bool readAt(int fd, void* data, int64_t nBytes, int64_t offset);
+
+#endif // FILEIO_H
@@ -4,77 +4,75 @@
 #include <vector>
 #include <string>
 #include <iostream>
-#include <fstream>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FORTRANREADER_SSSE3
+#include <tmmintrin.h>
+#endif
 
-#define YESSWAP
 class ByteOrder
 {
 public:
+    static bool isHostLittleEndian()
+    {
+        const uint16_t one = 1;
+        return 1 == *reinterpret_cast<const uint8_t*>(&one);
+    }
+
     template <typename T>
     static T swap(T value)
     {
-#ifndef YESSWAP
-        return value;
-#else
         T out;
         std::reverse_copy(reinterpret_cast<char*>(&value), reinterpret_cast<char*>(&value) + sizeof(T), reinterpret_cast<char*>(&out));
         return out;
-#endif
     }
-};
 
-//
-//
-//
-// Buffer
-//
-//
-//
-
-class Buffer
-{
-public:
-    Buffer() {}
-    Buffer(const std::vector<unsigned char>& array) { buffer = array; }
-    ~Buffer() {}
-
-public:
-    int32_t toInt32() const { return toSingle<int32_t>(); }
-    int64_t toInt64() const { return toSingle<int64_t>(); }
-    float toFloat() const { return toSingle<float>(); }
-    double toDouble() const { return toSingle<double>(); }
-    std::vector<char> toCharArray() const { return toArray<char>(); }
-    std::vector<int32_t> toInt32Array() const { return toArray<int32_t>(); }
-    std::vector<int64_t> toInt64Array() const { return toArray<int64_t>(); }
-    std::vector<float> toFloatArray() const { return toArray<float>(); }
-    std::vector<double> toDoubleArray() const { return toArray<double>(); }
-
-    template <class T>
-    T toSingle() const
-    {
-        assert(buffer.size() == sizeof(T));
-        T single;
-        std::memcpy(&single, buffer.data(), buffer.size());
-        return ByteOrder::swap(single);
-    }
-
-    template <class T>
-    std::vector<T> toArray() const
+    /// Reverses the bytes of each of the n elements in place, 16 bytes at a
+    /// time with SSSE3 shuffles where the processor has them.
+    template <typename T>
+    static void swapArray(T* data, int64_t n)
     {
-        std::vector<T> array(buffer.size() / sizeof(T));
-        std::memcpy(array.data(), buffer.data(), buffer.size());
-#ifdef YESSWAP
-        for (unsigned int i = 0; i < array.size(); ++i)
-            array[i] = ByteOrder::swap(array[i]);
+        if (1 == sizeof(T))
+            return;
+        char* bytes = reinterpret_cast<char*>(data);
+        int64_t done = 0;
+#ifdef FORTRANREADER_SSSE3
+        static const bool hasSSSE3 = __builtin_cpu_supports("ssse3");
+        if (hasSSSE3 && 16 % sizeof(T) == 0)
+            done = swapSSSE3(bytes, n * sizeof(T), sizeof(T));
 #endif
-        return array;
+        for (int64_t i = done / sizeof(T); i < n; ++i)
+            std::reverse(bytes + i * sizeof(T), bytes + (i + 1) * sizeof(T));
     }
 
 private:
-    std::vector<unsigned char> buffer;
+#ifdef FORTRANREADER_SSSE3
+    // returns how many bytes, a multiple of 16, were swapped
+    __attribute__((target("ssse3")))
+    static int64_t swapSSSE3(char* bytes, int64_t nBytes, int width)
+    {
+        char order[16];
+        for (int i = 0; i < 16; ++i)
+            order[i] = char(i - i % width + width - 1 - i % width);
+        const __m128i mask =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(order));
+        int64_t i = 0;
+        for (; i + 16 <= nBytes; i += 16) {
+            __m128i* block = reinterpret_cast<__m128i*>(bytes + i);
+            _mm_storeu_si128(block,
+                    _mm_shuffle_epi8(_mm_loadu_si128(block), mask));
+        }
+        return i;
+    }
+#endif
 };
 
 //
@@ -85,87 +83,200 @@ private:
 //
 //
 
+/**
+ * @brief The FortranReader class reads unformatted sequential files. Records
+ * over 2 GB are split by gfortran into subrecords of int32 lengths, whose
+ * leading marker is negative when another subrecord follows, so the positions
+ * and lengths here are 64-bit.
+ *
+ * The file is memory-mapped, so reading a record is a single copy out of the
+ * page cache followed by a bulk byte swap, and skipping is free. The byte
+ * order is taken from the markers of the first record, which only agree with
+ * their trailing copies in the order the file was written in.
+ */
 class FortranReader
 {
 public:
     FortranReader(const std::string& filename)
     {
-        fin.open(filename.c_str(), std::ios::in | std::ios::binary);
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (0 <= fd && 0 == fstat(fd, &info) && 0 < info.st_size) {
+            void* mapping =
+                    mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (MAP_FAILED != mapping) {
+                data = static_cast<const char*>(mapping);
+                size = info.st_size;
+                madvise(mapping, size, MADV_SEQUENTIAL);
+            }
+        }
+        if (0 <= fd)
+            close(fd);
+        isSwapped = detectSwap();
     }
-    ~FortranReader() {}
+    ~FortranReader()
+    {
+        if (data)
+            munmap(const_cast<char*>(data), size);
+    }
+    FortranReader(const FortranReader&) = delete;
+    FortranReader& operator=(const FortranReader&) = delete;
 
 public:
-    int currReadPos() {
-        return fin.tellg();
+    bool good() const { return data && pos <= size; }
+    /// Whether the file is in the other byte order than the host.
+    bool swapsBytes() const { return isSwapped; }
+    int64_t currReadPos() {
+        return pos;
     }
-    void setReadPosFromBeg(int readPos) {
-        fin.seekg(readPos, std::ios::beg);
+    void setReadPosFromBeg(int64_t readPos) {
+        pos = readPos;
     }
 
 public:
-    int32_t readInt32() { return readRecord().toInt32(); }
-    int64_t readInt64() { return readRecord().toInt64(); }
-    float readFloat() { return readRecord().toFloat(); }
-    double readDouble() { return readRecord().toDouble(); }
-    std::vector<char> readCharArray() { return readRecord().toCharArray(); }
-    std::vector<int32_t> readInt32Array() { return readRecord().toInt32Array(); }
-    std::vector<int64_t> readInt64Array() { return readRecord().toInt64Array(); }
-    std::vector<float> readFloatArray() { return readRecord().toFloatArray(); }
-    std::vector<double> readDoubleArray() { return readRecord().toDoubleArray(); }
+    int32_t readInt32() { return readSingle<int32_t>(); }
+    int64_t readInt64() { return readSingle<int64_t>(); }
+    float readFloat() { return readSingle<float>(); }
+    double readDouble() { return readSingle<double>(); }
+    std::vector<char> readCharArray() { return readArray<char>(); }
+    std::vector<int32_t> readInt32Array() { return readArray<int32_t>(); }
+    std::vector<int64_t> readInt64Array() { return readArray<int64_t>(); }
+    std::vector<float> readFloatArray() { return readArray<float>(); }
+    std::vector<double> readDoubleArray() { return readArray<double>(); }
+
+    template <class T>
+    std::vector<T> readArray()
+    {
+        std::vector<T> array;
+        readArray(array);
+        return array;
+    }
 
+    /// Reads the record into array, reusing its storage.
     template <class T>
-    std::vector<T> readArray() { return readRecord().toArray<T>(); }
+    void readArray(std::vector<T>& array)
+    {
+        array.resize(recordLength() / sizeof(T));
+        copyRecord(reinterpret_cast<char*>(array.data()), 0,
+                array.size() * sizeof(T));
+        if (isSwapped)
+            ByteOrder::swapArray(array.data(), array.size());
+    }
 
     template <typename T>
-    std::vector<T> readSubArray(int offset, int nElements) {
-        return readSubRecord(offset * sizeof(T), nElements * sizeof(T))
-                .toArray<T>();
+    std::vector<T> readSubArray(int64_t offset, int64_t nElements) {
+        std::vector<T> array(nElements);
+        int64_t length = copyRecord(reinterpret_cast<char*>(array.data()),
+                offset * sizeof(T), nElements * sizeof(T));
+        assert((offset + nElements) * int64_t(sizeof(T)) <= length);
+        if (isSwapped)
+            ByteOrder::swapArray(array.data(), array.size());
+        return array;
     }
 
     void ignoreRecord()
     {
-        int32_t length, endlen;
-        fin.read(reinterpret_cast<char*>(&length), sizeof(length));
-        length = ByteOrder::swap(length);
-        fin.seekg(length, fin.cur);
-        fin.read(reinterpret_cast<char*>(&endlen), sizeof(endlen));
-        endlen = ByteOrder::swap(endlen);
-        // std::cout << length << " : " << endlen << std::endl;
-        assert(length == endlen);
+        copyRecord(nullptr, 0, 0);
+    }
+
+    /// The length in bytes of the record at the read position, which is
+    /// left as it is.
+    int64_t recordLength()
+    {
+        int64_t begin = pos;
+        int64_t length = copyRecord(nullptr, 0, 0);
+        pos = begin;
+        return length;
     }
 
 protected:
-    Buffer readRecord()
+    template <typename T>
+    T readSingle()
+    {
+        T single;
+        int64_t length = copyRecord(reinterpret_cast<char*>(&single), 0,
+                sizeof(T));
+        assert(sizeof(T) == length);
+        return isSwapped ? ByteOrder::swap(single) : single;
+    }
+
+    // copies the bytes [offset, offset + nBytes) of the record at the read
+    // position to out, moves past the record and returns its length.
+    int64_t copyRecord(char* out, int64_t offset, int64_t nBytes)
+    {
+        // the record position where the current subrecord begins
+        int64_t begin = 0;
+        bool isContinued = true;
+        while (isContinued && good()) {
+            int64_t length = readLeadingMarker(&isContinued);
+            if (size < pos + length + 4) {
+                // truncated file
+                pos = size + 1;
+                break;
+            }
+            int64_t lower = std::max(offset, begin);
+            int64_t upper = std::min(offset + nBytes, begin + length);
+            if (out && lower < upper) {
+                std::memcpy(out + lower - offset, data + pos + lower - begin,
+                        upper - lower);
+            }
+            pos += length;
+            readTrailingMarker(length);
+            begin += length;
+        }
+        return begin;
+    }
+
+private:
+    int32_t readMarker()
     {
-        int32_t length, endlen;
-        fin.read(reinterpret_cast<char*>(&length), sizeof(length));
-        length = ByteOrder::swap(length);
-        std::vector<unsigned char> buffer(length);
-        fin.read(reinterpret_cast<char*>(buffer.data()), length);
-        fin.read(reinterpret_cast<char*>(&endlen), sizeof(endlen));
-        endlen = ByteOrder::swap(endlen);
+        int32_t marker = 0;
+        if (pos + int64_t(sizeof(marker)) <= size)
+            std::memcpy(&marker, data + pos, sizeof(marker));
+        pos += sizeof(marker);
+        return isSwapped ? ByteOrder::swap(marker) : marker;
+    }
+
+    int64_t readLeadingMarker(bool* isContinued) {
+        int32_t length = readMarker();
+        *isContinued = length < 0;
+        return std::abs(int64_t(length));
+    }
+
+    void readTrailingMarker(int64_t length) {
+        int32_t endlen = readMarker();
         // std::cout << length << " : " << endlen << std::endl;
-        assert(length == endlen);
-        return Buffer(buffer);
+        assert(length == std::abs(int64_t(endlen)));
     }
 
-    Buffer readSubRecord(int offset, int nBytes) {
-        int32_t length, endlen;
-        fin.read(reinterpret_cast<char*>(&length), sizeof(length));
-        length = ByteOrder::swap(length);
-        assert(offset + nBytes <= length);
-        std::vector<unsigned char> buffer(nBytes);
-        fin.seekg(offset, std::ios::cur);
-        fin.read(reinterpret_cast<char*>(buffer.data()), nBytes);
-        fin.seekg(length - offset - nBytes, std::ios::cur);
-        fin.read(reinterpret_cast<char*>(&endlen), sizeof(endlen));
-        endlen = ByteOrder::swap(endlen);
-        assert(length == endlen);
-        return Buffer(buffer);
+    // S3D writes big-endian files, which is also assumed when the first
+    // record does not tell.
+    bool detectSwap() const
+    {
+        int32_t leading, trailing;
+        if (size < int64_t(2 * sizeof(leading)))
+            return ByteOrder::isHostLittleEndian();
+        std::memcpy(&leading, data, sizeof(leading));
+        for (bool swap : { false, true }) {
+            int64_t length =
+                    std::abs(int64_t(swap ? ByteOrder::swap(leading) : leading));
+            if (size < length + 2 * int64_t(sizeof(leading)))
+                continue;
+            std::memcpy(&trailing, data + sizeof(leading) + length,
+                    sizeof(trailing));
+            if (swap)
+                trailing = ByteOrder::swap(trailing);
+            if (length == std::abs(int64_t(trailing)))
+                return swap;
+        }
+        return ByteOrder::isHostLittleEndian();
     }
 
 private:
-    std::ifstream fin;
+    const char* data = nullptr;
+    int64_t size = 0;
+    int64_t pos = 0;
+    bool isSwapped = true;
 };
 
 #endif // __FORTRANRADER_H__
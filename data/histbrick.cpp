@@ -0,0 +1,222 @@
+#include "histbrick.h"
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "histreader.h"
+
+namespace {
+
+const int brickMagic = 0x4b524248; // "HBRK"
+const int brickVersion = 1;
+const int emptyHistMarker = -1;
+
+template <typename T>
+void writeRaw(std::ostream& out, const T* data, int count) {
+    out.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void writeRaw(std::ostream& out, const T& value) {
+    writeRaw(out, &value, 1);
+}
+
+// the sparse record of HistReaderPacked, false when a count is not an int
+bool writePacked(std::ostream& out, const Hist& hist) {
+    if (0 == hist.nDim()) {
+        writeRaw(out, emptyHistMarker);
+        return true;
+    }
+    std::vector<double> mins(hist.nDim()), maxs(hist.nDim());
+    std::vector<int> nbins(hist.dim().begin(), hist.dim().end());
+    for (int iDim = 0; iDim < hist.nDim(); ++iDim) {
+        mins[iDim] = hist.dimMin(iDim);
+        maxs[iDim] = hist.dimMax(iDim);
+    }
+    std::vector<int> buffer;
+    for (int iBin = 0; iBin < hist.nBins(); ++iBin) {
+        float freq = hist.binFreq(iBin);
+        if (freq != std::floor(freq) || freq > float(INT_MAX))
+            return false;
+        if (freq <= 0.f)
+            continue;
+        buffer.push_back(iBin);
+        buffer.push_back(int(freq));
+    }
+    int isSparse = 1;
+    int nNonEmptyBins = buffer.size() / 2;
+    double percentInRange = hist.percentInRange();
+    writeRaw(out, isSparse);
+    writeRaw(out, mins.data(), hist.nDim());
+    writeRaw(out, maxs.data(), hist.nDim());
+    writeRaw(out, nbins.data(), hist.nDim());
+    writeRaw(out, percentInRange);
+    writeRaw(out, nNonEmptyBins);
+    writeRaw(out, buffer.data(), buffer.size());
+    return true;
+}
+
+} // anonymous namespace
+
+/**
+ * @brief HistBrickWriter::write
+ * @param path the output file
+ * @param getHist returns the histogram at a flat id of the volume
+ * @return false when the file cannot be written or a histogram has a
+ * fractional count, which the int records of the bricks cannot hold
+ */
+bool HistBrickWriter::write(
+        const std::string& path, HistGetter getHist) const {
+    assert(0 < _brickSize);
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout)
+        return false;
+    Extent dimHists = _helper.dimHists();
+    Extent dimBricks((dimHists[0] + _brickSize - 1) / _brickSize,
+            (dimHists[1] + _brickSize - 1) / _brickSize,
+            (dimHists[2] + _brickSize - 1) / _brickSize);
+    // the header takes the bin dimension and log bases of the first histogram
+    std::shared_ptr<const Hist> first;
+    for (int iHist = 0; iHist < dimHists.nElement() && !first; ++iHist) {
+        auto hist = getHist(iHist);
+        if (hist && 0 < hist->nDim())
+            first = hist;
+    }
+    int nDim = first ? first->nDim() : 0;
+    std::vector<double> logBases(nDim);
+    for (int iDim = 0; iDim < nDim; ++iDim)
+        logBases[iDim] = first->logBase(iDim);
+    int header[] = { brickMagic, brickVersion, nDim,
+            _helper.n_vx, _helper.n_vy, _helper.n_vz,
+            _helper.nh_x, _helper.nh_y, _helper.nh_z, _brickSize };
+    writeRaw(fout, header, sizeof(header) / sizeof(int));
+    writeRaw(fout, logBases.data(), nDim);
+    // reserve the index and fill it after the bricks are written
+    int nBricks = dimBricks.nElement();
+    std::vector<int64_t> index(2 * nBricks, 0);
+    int64_t indexOffset = fout.tellp();
+    writeRaw(fout, index.data(), index.size());
+    HistNull nullHist;
+    for (int iBrick = 0; iBrick < nBricks; ++iBrick) {
+        auto brickIds = dimBricks.flattoids(iBrick);
+        int64_t begin = fout.tellp();
+        int x0 = brickIds[0] * _brickSize;
+        int y0 = brickIds[1] * _brickSize;
+        int z0 = brickIds[2] * _brickSize;
+        int x1 = std::min(x0 + _brickSize, dimHists[0]);
+        int y1 = std::min(y0 + _brickSize, dimHists[1]);
+        int z1 = std::min(z0 + _brickSize, dimHists[2]);
+        for (int z = z0; z < z1; ++z)
+        for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) {
+            auto hist = getHist(dimHists.idstoflat(x, y, z));
+            if (!writePacked(fout, hist ? *hist : nullHist)) {
+                fout.close();
+                std::remove(path.c_str());
+                return false;
+            }
+        }
+        index[2 * iBrick + 0] = begin;
+        index[2 * iBrick + 1] = int64_t(fout.tellp()) - begin;
+    }
+    fout.seekp(indexOffset);
+    writeRaw(fout, index.data(), index.size());
+    return bool(fout);
+}
+
+/**
+ * @brief HistBrickReader::HistBrickReader
+ * @param path
+ * @param vars
+ */
+HistBrickReader::HistBrickReader(
+        const std::string& path, const std::vector<std::string>& vars)
+  : _path(path), _vars(vars) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return;
+    int header[10];
+    fin.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!fin || brickMagic != header[0] || brickVersion != header[1])
+        return;
+    _nDim = header[2];
+    _helper.n_vx = header[3];
+    _helper.n_vy = header[4];
+    _helper.n_vz = header[5];
+    _helper.nh_x = header[6];
+    _helper.nh_y = header[7];
+    _helper.nh_z = header[8];
+    _helper.N_HIST = _helper.nh_x * _helper.nh_y * _helper.nh_z;
+    _brickSize = header[9];
+    _logBases.resize(_nDim);
+    fin.read(reinterpret_cast<char*>(_logBases.data()),
+            sizeof(double) * _nDim);
+    _dimBricks = Extent((_helper.nh_x + _brickSize - 1) / _brickSize,
+            (_helper.nh_y + _brickSize - 1) / _brickSize,
+            (_helper.nh_z + _brickSize - 1) / _brickSize);
+    int nBricks = _dimBricks.nElement();
+    std::vector<int64_t> index(2 * nBricks);
+    fin.read(reinterpret_cast<char*>(index.data()),
+            sizeof(int64_t) * index.size());
+    if (!fin)
+        return;
+    _offsets.resize(nBricks);
+    _nBytes.resize(nBricks);
+    for (int iBrick = 0; iBrick < nBricks; ++iBrick) {
+        _offsets[iBrick] = index[2 * iBrick + 0];
+        _nBytes[iBrick] = index[2 * iBrick + 1];
+    }
+    _good = true;
+}
+
+Extent HistBrickReader::dimBrickHists(int brickId) const {
+    auto brickIds = _dimBricks.flattoids(brickId);
+    int nHists[3] = { _helper.nh_x, _helper.nh_y, _helper.nh_z };
+    Extent dim(0, 0, 0);
+    for (int i = 0; i < 3; ++i) {
+        int lower = brickIds[i] * _brickSize;
+        dim[i] = std::min(lower + _brickSize, nHists[i]) - lower;
+    }
+    return dim;
+}
+
+std::vector<int> HistBrickReader::sliceBrickIds(
+        SliceDirection direction, int sliceId) const {
+    int sliceBrick = sliceId / _brickSize;
+    std::vector<int> brickIds;
+    for (int z = 0; z < _dimBricks[2]; ++z)
+    for (int y = 0; y < _dimBricks[1]; ++y)
+    for (int x = 0; x < _dimBricks[0]; ++x) {
+        int ids[3] = { x, y, z };
+        if (sliceBrick == ids[direction])
+            brickIds.push_back(_dimBricks.idstoflat(x, y, z));
+    }
+    return brickIds;
+}
+
+std::vector<std::shared_ptr<Hist>> HistBrickReader::readBrick(
+        int brickId) const {
+    assert(_good);
+    std::ifstream fin(_path, std::ios::binary);
+    assert(fin);
+    std::string bytes(_nBytes[brickId], '\0');
+    fin.seekg(_offsets[brickId]);
+    fin.read(&bytes[0], bytes.size());
+    std::istringstream sin(bytes);
+    std::vector<std::shared_ptr<Hist>> hists(dimBrickHists(brickId).nElement());
+    for (auto& hist : hists) {
+        int isSparse;
+        sin.read(reinterpret_cast<char*>(&isSparse), sizeof(int));
+        if (emptyHistMarker == isSparse) {
+            hist = std::make_shared<HistNull>();
+            continue;
+        }
+        sin.seekg(-int(sizeof(int)), std::ios::cur);
+        HistReaderPacked histReader;
+        histReader.readFrom(sin, _nDim, _logBases, _vars);
+        hist = histReader.hist;
+    }
+    return hists;
+}
@@ -0,0 +1,80 @@
+#ifndef HISTBRICK_H
+#define HISTBRICK_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "Histogram.h"
+#include "histgrid.h"
+
+/**
+ * The bricked layout, pdfs-brick-<name>, stores a volume of histograms as
+ * k*k*k blocks of histograms (bricks) that are contiguous on disk:
+ *
+ *   header:  int magic, version, ndim, ngridx, ngridy, ngridz,
+ *            nhistx, nhisty, nhistz, bricksize; double logbases[ndim]
+ *   index:   per brick, x fastest, int64 offset and int64 byte count
+ *   bricks:  per histogram in the brick, x fastest, the packed record of the
+ *            pdfs-* files, or a single int -1 for an empty histogram
+ *
+ * so a slice in any direction reads only the bricks that it intersects. The
+ * records hold int counts, so volumes with fractional counts are refused.
+ */
+class HistBrickWriter {
+public:
+    typedef std::function<std::shared_ptr<const Hist>(int flatId)> HistGetter;
+    HistBrickWriter(const HistHelper& helper, int brickSize)
+      : _helper(helper), _brickSize(brickSize) {}
+
+public:
+    bool write(const std::string& path, HistGetter getHist) const;
+
+private:
+    HistHelper _helper;
+    int _brickSize;
+};
+
+/**
+ * @brief The HistBrickReader class reads the header and the brick index on
+ * construction and then single bricks on demand.
+ */
+class HistBrickReader {
+public:
+    enum SliceDirection : int {YZ = 0, XZ = 1, XY = 2};
+    static std::string filename(
+            const std::string& dir, const std::string& name) {
+        return dir + "/pdfs-brick-" + name;
+    }
+    HistBrickReader(
+            const std::string& path, const std::vector<std::string>& vars);
+
+public:
+    bool good() const { return _good; }
+    const HistHelper& helper() const { return _helper; }
+    int brickSize() const { return _brickSize; }
+    const Extent& dimBricks() const { return _dimBricks; }
+    /// The brick containing the histogram at (x, y, z).
+    int brickId(int x, int y, int z) const {
+        return _dimBricks.idstoflat(
+                x / _brickSize, y / _brickSize, z / _brickSize);
+    }
+    /// The histogram counts of a brick, smaller than k*k*k at the far edges.
+    Extent dimBrickHists(int brickId) const;
+    /// The bricks that intersect a slice of histograms.
+    std::vector<int> sliceBrickIds(SliceDirection direction, int sliceId) const;
+    /// The histograms of a brick, x fastest.
+    std::vector<std::shared_ptr<Hist>> readBrick(int brickId) const;
+
+private:
+    std::string _path;
+    std::vector<std::string> _vars;
+    bool _good = false;
+    HistHelper _helper;
+    int _nDim = 0;
+    std::vector<double> _logBases;
+    int _brickSize = 1;
+    Extent _dimBricks;
+    std::vector<int64_t> _offsets, _nBytes;
+};
+
+#endif // HISTBRICK_H
@@ -0,0 +1,132 @@
+#include "histcolumnindex.h"
+#include <fstream>
+#include "fileio.h"
+#include "histreader.h"
+
+namespace {
+
+const int columnIndexMagic = 0x58444959; // "YIDX"
+const int columnIndexVersion = 2;
+
+template <typename T>
+void writeRaw(std::ostream& out, const T* data, int64_t count) {
+    out.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+} // anonymous namespace
+
+/**
+ * @brief HistColumnIndex::open
+ * @param path the y-column or multiblock file
+ * @return
+ */
+std::shared_ptr<const HistColumnIndex> HistColumnIndex::open(
+        const std::string& path) {
+    FileStamp stamp;
+    if (!FileStamp::ofFile(path, &stamp))
+        return nullptr;
+    auto index = read(filename(path), stamp.size, stamp.mtime);
+    if (index)
+        return index;
+    index = scan(path);
+    // a read-only data directory only costs the scan on the next open
+    if (index)
+        index->write(filename(path));
+    return index;
+}
+
+std::shared_ptr<HistColumnIndex> HistColumnIndex::scan(
+        const std::string& path) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return nullptr;
+    auto index = std::make_shared<HistColumnIndex>();
+    HistMetaReader meta;
+    int64_t offset = fin.tellg();
+    while (meta.readFrom(fin)) {
+        HistHelper helper = meta.helper();
+        index->_domainOffsets.push_back(offset);
+        index->_domainHelpers.push_back(helper);
+        index->_firstHists.push_back(index->_histOffsets.size());
+        for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+            index->_histOffsets.push_back(fin.tellg());
+            HistReaderPacked::skipFrom(fin, meta.ndim);
+        }
+        offset = fin.tellg();
+    }
+    FileStamp stamp = { 0, 0 };
+    FileStamp::ofFile(path, &stamp);
+    index->_fileSize = stamp.size;
+    index->_fileMtime = stamp.mtime;
+    return index;
+}
+
+std::shared_ptr<HistColumnIndex> HistColumnIndex::read(
+        const std::string& idxPath, int64_t fileSize, int64_t fileMtime) {
+    std::ifstream fin(idxPath, std::ios::binary);
+    if (!fin)
+        return nullptr;
+    int header[2];
+    int64_t indexedStamp[2];
+    int counts[2];
+    readRaw(fin, header, 2);
+    readRaw(fin, indexedStamp, 2);
+    readRaw(fin, counts, 2);
+    if (!fin || columnIndexMagic != header[0]
+            || columnIndexVersion != header[1]
+            || fileSize != indexedStamp[0] || fileMtime != indexedStamp[1])
+        return nullptr;
+    auto index = std::make_shared<HistColumnIndex>();
+    index->_fileSize = fileSize;
+    index->_fileMtime = fileMtime;
+    int nDomains = counts[0];
+    index->_domainOffsets.resize(nDomains);
+    index->_domainHelpers.resize(nDomains);
+    index->_firstHists.resize(nDomains);
+    for (int iDomain = 0; iDomain < nDomains; ++iDomain) {
+        int values[7];
+        readRaw(fin, &index->_domainOffsets[iDomain], 1);
+        readRaw(fin, values, 7);
+        auto& helper = index->_domainHelpers[iDomain];
+        index->_firstHists[iDomain] = values[0];
+        helper.n_vx = values[1];
+        helper.n_vy = values[2];
+        helper.n_vz = values[3];
+        helper.nh_x = values[4];
+        helper.nh_y = values[5];
+        helper.nh_z = values[6];
+        helper.N_HIST = helper.nh_x * helper.nh_y * helper.nh_z;
+    }
+    index->_histOffsets.resize(counts[1]);
+    readRaw(fin, index->_histOffsets.data(), counts[1]);
+    if (!fin)
+        return nullptr;
+    return index;
+}
+
+bool HistColumnIndex::write(const std::string& idxPath) const {
+    std::ofstream fout(idxPath, std::ios::binary);
+    if (!fout)
+        return false;
+    int header[2] = { columnIndexMagic, columnIndexVersion };
+    int counts[2] = { nDomains(), int(_histOffsets.size()) };
+    writeRaw(fout, header, 2);
+    int64_t stamp[2] = { _fileSize, _fileMtime };
+    writeRaw(fout, stamp, 2);
+    writeRaw(fout, counts, 2);
+    for (int iDomain = 0; iDomain < nDomains(); ++iDomain) {
+        const auto& helper = _domainHelpers[iDomain];
+        int values[7] = { _firstHists[iDomain],
+                helper.n_vx, helper.n_vy, helper.n_vz,
+                helper.nh_x, helper.nh_y, helper.nh_z };
+        writeRaw(fout, &_domainOffsets[iDomain], 1);
+        writeRaw(fout, values, 7);
+    }
+    writeRaw(fout, _histOffsets.data(), _histOffsets.size());
+    return bool(fout);
+}
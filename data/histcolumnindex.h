@@ -0,0 +1,62 @@
+#ifndef HISTCOLUMNINDEX_H
+#define HISTCOLUMNINDEX_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "histgrid.h"
+
+/**
+ * The sidecar index, <file>.idx, of a y-column or multiblock file, which
+ * stores its domains back to back as a meta header followed by the packed
+ * histograms:
+ *
+ *   header:  int magic, version; int64 size, modification time of the
+ *            indexed file; int ndomains, nhists
+ *   domains: per domain int64 meta offset, int first histogram,
+ *            int ngridx, ngridy, ngridz, nhistx, nhisty, nhistz
+ *   hists:   int64 offset of every packed histogram
+ *
+ * A sidecar whose recorded size or modification time does not match the
+ * file is stale and is rebuilt by scanning the file, which only reads the
+ * record headers.
+ */
+class HistColumnIndex {
+public:
+    static std::string filename(const std::string& path) {
+        return path + ".idx";
+    }
+    /// The index from the sidecar of path, or scanned from path and written
+    /// to the sidecar when that is missing or stale. nullptr without the file.
+    static std::shared_ptr<const HistColumnIndex> open(
+            const std::string& path);
+    /// The index scanned from path, nullptr without the file.
+    static std::shared_ptr<HistColumnIndex> scan(const std::string& path);
+
+public:
+    bool write(const std::string& idxPath) const;
+    int64_t fileSize() const { return _fileSize; }
+    int64_t fileMtime() const { return _fileMtime; }
+    int nDomains() const { return int(_domainOffsets.size()); }
+    const HistHelper& domainHelper(int iDomain) const {
+        return _domainHelpers[iDomain];
+    }
+    int64_t domainOffset(int iDomain) const { return _domainOffsets[iDomain]; }
+    int64_t histOffset(int iDomain, int iHist) const {
+        return _histOffsets[_firstHists[iDomain] + iHist];
+    }
+
+private:
+    static std::shared_ptr<HistColumnIndex> read(
+            const std::string& idxPath, int64_t fileSize, int64_t fileMtime);
+
+private:
+    int64_t _fileSize = 0;
+    int64_t _fileMtime = 0;
+    std::vector<int64_t> _domainOffsets;
+    std::vector<HistHelper> _domainHelpers;
+    std::vector<int> _firstHists;
+    std::vector<int64_t> _histOffsets;
+};
+
+#endif // HISTCOLUMNINDEX_H
@@ -0,0 +1,358 @@
+#include "histcontainer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "parallel.h"
+#include "varintcodec.h"
+
+namespace {
+
+const int containerMagic = 0x58444948; // "HIDX"
+const int containerVersion = 3;
+const int headerInts = 11;
+const int histsPerBlock = 64;
+
+template <typename T>
+void appendRaw(std::string& bytes, const T* data, int count) {
+    bytes.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void appendRaw(std::string& bytes, const T& value) {
+    appendRaw(bytes, &value, 1);
+}
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+std::string readBytes(std::istream& in, int64_t offset, int64_t nBytes) {
+    std::string bytes(nBytes, '\0');
+    in.seekg(offset);
+    in.read(&bytes[0], nBytes);
+    return bytes;
+}
+
+bool isEncodable(const std::vector<float>& counts) {
+    for (auto count : counts) {
+        if (count != std::floor(count) || count > 4294967295.f)
+            return false;
+    }
+    return true;
+}
+
+std::shared_ptr<Hist> createSparse(const std::vector<int>& nbins,
+        const std::vector<double>& mins, const std::vector<double>& maxs,
+        const std::vector<double>& logBases,
+        const std::vector<std::string>& vars,
+        const std::vector<int>& binIds, const std::vector<float>& values) {
+    if (3 == nbins.size()) {
+        return std::make_shared<Hist3DSparse>(nbins[0], nbins[1], nbins[2],
+                mins, maxs, logBases, vars, binIds, values);
+    }
+    if (2 == nbins.size()) {
+        return std::make_shared<Hist2D>(nbins[0], nbins[1], mins, maxs,
+                logBases, vars, binIds, values);
+    }
+    assert(1 == nbins.size());
+    return std::make_shared<Hist1D>(nbins[0], mins[0], maxs[0], logBases[0],
+            vars[0], binIds, values);
+}
+
+} // anonymous namespace
+
+/**
+ * @brief HistContainerWriter::write
+ * @param path the output file
+ * @param getHist returns the histogram at a flat id of the volume
+ * @return false when the file cannot be written
+ */
+bool HistContainerWriter::write(
+        const std::string& path, HistGetter getHist) const {
+    int nHist = _helper.N_HIST;
+    // the header takes the bin dimension and log bases of the first histogram
+    std::shared_ptr<const Hist> first;
+    for (int iHist = 0; iHist < nHist && !first; ++iHist) {
+        auto hist = getHist(iHist);
+        if (hist && 0 < hist->nDim())
+            first = hist;
+    }
+    int nDim = first ? first->nDim() : 0;
+    std::vector<double> logBases(nDim);
+    for (int iDim = 0; iDim < nDim; ++iDim)
+        logBases[iDim] = first->logBase(iDim);
+    // gather the sections
+    std::vector<int64_t> binOffsets(nHist + 1, 0);
+    std::vector<int> binIds;
+    std::vector<float> counts;
+    std::string meta, footer;
+    for (int iHist = 0; iHist < nHist; ++iHist) {
+        auto hist = getHist(iHist);
+        bool isEmpty = !hist || 0 == hist->nDim();
+        assert(isEmpty || nDim == hist->nDim());
+        std::vector<int> nbins(nDim, 0);
+        std::vector<double> mins(nDim, 0.0), maxs(nDim, 0.0);
+        double percentInRange = 1.0;
+        std::vector<float> means(nDim, NAN);
+        double total = -1.0;
+        int nNonEmptyBins = 0;
+        if (!isEmpty) {
+            for (int iDim = 0; iDim < nDim; ++iDim) {
+                nbins[iDim] = hist->dim()[iDim];
+                mins[iDim] = hist->dimMin(iDim);
+                maxs[iDim] = hist->dimMax(iDim);
+            }
+            percentInRange = hist->percentInRange();
+            total = 0.0;
+            for (int iBin = 0; iBin < hist->nBins(); ++iBin) {
+                float freq = hist->binFreq(iBin);
+                if (freq <= 0.f)
+                    continue;
+                binIds.push_back(iBin);
+                counts.push_back(freq);
+                total += freq;
+                ++nNonEmptyBins;
+            }
+            means = hist->means();
+        }
+        binOffsets[iHist + 1] = binOffsets[iHist] + nNonEmptyBins;
+        appendRaw(meta, nbins.data(), nDim);
+        appendRaw(meta, mins.data(), nDim);
+        appendRaw(meta, maxs.data(), nDim);
+        appendRaw(meta, percentInRange);
+        appendRaw(footer, total);
+        appendRaw(footer, nNonEmptyBins);
+        appendRaw(footer, means.data(), nDim);
+    }
+    // the two bin sections, raw columns or encoded blocks
+    std::string binSections[2];
+    bool encode = _compress && isEncodable(counts);
+    if (encode) {
+        int nBlocks = (nHist + histsPerBlock - 1) / histsPerBlock;
+        std::vector<int64_t> blockOffsets(nBlocks + 1, 0);
+        for (int iBlock = 0; iBlock < nBlocks; ++iBlock) {
+            int end = std::min(nHist, (iBlock + 1) * histsPerBlock);
+            for (int iHist = iBlock * histsPerBlock; iHist < end; ++iHist) {
+                int64_t begin = binOffsets[iHist];
+                VarintCodec::encode(binSections[1],
+                        binIds.data() + begin, counts.data() + begin,
+                        binOffsets[iHist + 1] - begin);
+            }
+            blockOffsets[iBlock + 1] = binSections[1].size();
+        }
+        appendRaw(binSections[0], blockOffsets.data(), blockOffsets.size());
+    } else {
+        appendRaw(binSections[0], binIds.data(), binIds.size());
+        appendRaw(binSections[1], counts.data(), counts.size());
+    }
+    // lay them out behind the header and the offset table
+    int64_t headerBytes = headerInts * sizeof(int) + nDim * sizeof(double)
+            + 4 * sizeof(int64_t);
+    int64_t metaOffset = headerBytes + binOffsets.size() * sizeof(int64_t);
+    int64_t binIdsOffset = metaOffset + meta.size();
+    int64_t countsOffset = binIdsOffset + binSections[0].size();
+    int64_t footerOffset = countsOffset + binSections[1].size();
+    std::string header;
+    int headerValues[headerInts] = { containerMagic, containerVersion, nDim,
+            _helper.n_vx, _helper.n_vy, _helper.n_vz,
+            _helper.nh_x, _helper.nh_y, _helper.nh_z,
+            encode ? 1 : 0, encode ? histsPerBlock : 0 };
+    int64_t sectionOffsets[4] = {
+            metaOffset, binIdsOffset, countsOffset, footerOffset };
+    appendRaw(header, headerValues, headerInts);
+    appendRaw(header, logBases.data(), nDim);
+    appendRaw(header, sectionOffsets, 4);
+    assert(int64_t(header.size()) == headerBytes);
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout)
+        return false;
+    fout.write(header.data(), header.size());
+    fout.write(reinterpret_cast<const char*>(binOffsets.data()),
+            binOffsets.size() * sizeof(int64_t));
+    fout.write(meta.data(), meta.size());
+    fout.write(binSections[0].data(), binSections[0].size());
+    fout.write(binSections[1].data(), binSections[1].size());
+    fout.write(footer.data(), footer.size());
+    return bool(fout);
+}
+
+/**
+ * @brief HistContainerReader::HistContainerReader
+ * @param path
+ * @param vars
+ */
+HistContainerReader::HistContainerReader(
+        const std::string& path, const std::vector<std::string>& vars)
+  : _path(path), _vars(vars) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return;
+    int header[headerInts];
+    readRaw(fin, header, headerInts);
+    if (!fin || containerMagic != header[0] || containerVersion != header[1])
+        return;
+    _nDim = header[2];
+    _helper.n_vx = header[3];
+    _helper.n_vy = header[4];
+    _helper.n_vz = header[5];
+    _helper.nh_x = header[6];
+    _helper.nh_y = header[7];
+    _helper.nh_z = header[8];
+    _helper.N_HIST = _helper.nh_x * _helper.nh_y * _helper.nh_z;
+    _encoding = header[9];
+    _blockSize = header[10];
+    _logBases.resize(_nDim);
+    readRaw(fin, _logBases.data(), _nDim);
+    int64_t sectionOffsets[4];
+    readRaw(fin, sectionOffsets, 4);
+    _metaOffset = sectionOffsets[0];
+    _binIdsOffset = sectionOffsets[1];
+    _countsOffset = sectionOffsets[2];
+    _footerOffset = sectionOffsets[3];
+    _binOffsets.resize(_helper.N_HIST + 1);
+    readRaw(fin, _binOffsets.data(), _binOffsets.size());
+    if (isCompressed()) {
+        int nBlocks = (_helper.N_HIST + _blockSize - 1) / _blockSize;
+        _blockOffsets.resize(nBlocks + 1);
+        fin.seekg(_binIdsOffset);
+        readRaw(fin, _blockOffsets.data(), _blockOffsets.size());
+    }
+    _good = bool(fin);
+}
+
+std::shared_ptr<Hist> HistContainerReader::hist(int flatId) const {
+    assert(_good);
+    std::ifstream fin(_path, std::ios::binary);
+    assert(fin);
+    auto meta = readBytes(
+            fin, _metaOffset + int64_t(flatId) * metaBytes(), metaBytes());
+    int64_t begin = _binOffsets[flatId];
+    int count = _binOffsets[flatId + 1] - begin;
+    std::vector<int> binIds(count);
+    std::vector<float> values(count);
+    if (isCompressed()) {
+        // decode the block up to the histogram
+        int iBlock = flatId / _blockSize;
+        auto block = readBytes(fin, _countsOffset + _blockOffsets[iBlock],
+                _blockOffsets[iBlock + 1] - _blockOffsets[iBlock]);
+        const char* in = block.data();
+        std::vector<int> skippedIds;
+        std::vector<float> skippedValues;
+        for (int iHist = iBlock * _blockSize; iHist < flatId; ++iHist) {
+            int nSkipped = _binOffsets[iHist + 1] - _binOffsets[iHist];
+            skippedIds.resize(nSkipped);
+            skippedValues.resize(nSkipped);
+            in = VarintCodec::decode(
+                    in, skippedIds.data(), skippedValues.data(), nSkipped);
+        }
+        VarintCodec::decode(in, binIds.data(), values.data(), count);
+    } else {
+        fin.seekg(_binIdsOffset + begin * sizeof(int));
+        readRaw(fin, binIds.data(), count);
+        fin.seekg(_countsOffset + begin * sizeof(float));
+        readRaw(fin, values.data(), count);
+    }
+    return createHist(meta.data(), binIds.data(), values.data(), count);
+}
+
+std::vector<std::shared_ptr<Hist>> HistContainerReader::hists(
+        int nThreads) const {
+    assert(_good);
+    std::ifstream fin(_path, std::ios::binary);
+    assert(fin);
+    int nHist = _helper.N_HIST;
+    auto meta = readBytes(fin, _metaOffset, int64_t(nHist) * metaBytes());
+    auto bins = readBytes(fin, _binIdsOffset, _footerOffset - _binIdsOffset);
+    std::vector<std::shared_ptr<Hist>> hists(nHist);
+    if (isCompressed()) {
+        const char* blocks = bins.data() + (_countsOffset - _binIdsOffset);
+        int nBlocks = _blockOffsets.size() - 1;
+        parallelFor(nBlocks, nThreads, [&](int iBlock) {
+            std::vector<int> binIds;
+            std::vector<float> values;
+            const char* in = blocks + _blockOffsets[iBlock];
+            int end = std::min(nHist, (iBlock + 1) * _blockSize);
+            for (int iHist = iBlock * _blockSize; iHist < end; ++iHist) {
+                int count = _binOffsets[iHist + 1] - _binOffsets[iHist];
+                binIds.resize(count);
+                values.resize(count);
+                in = VarintCodec::decode(
+                        in, binIds.data(), values.data(), count);
+                hists[iHist] = createHist(
+                        meta.data() + int64_t(iHist) * metaBytes(),
+                        binIds.data(), values.data(), count);
+            }
+        });
+        return hists;
+    }
+    auto binIds = reinterpret_cast<const int*>(bins.data());
+    auto values = reinterpret_cast<const float*>(
+            bins.data() + (_countsOffset - _binIdsOffset));
+    parallelFor(nHist, nThreads, [&](int iHist) {
+        int64_t offset = _binOffsets[iHist];
+        hists[iHist] = createHist(
+                meta.data() + int64_t(iHist) * metaBytes(),
+                binIds + offset, values + offset,
+                _binOffsets[iHist + 1] - offset);
+    });
+    return hists;
+}
+
+HistContainerReader::Summary HistContainerReader::summary(int flatId) const {
+    assert(_good);
+    std::ifstream fin(_path, std::ios::binary);
+    assert(fin);
+    fin.seekg(_footerOffset + int64_t(flatId) * footerBytes());
+    return readSummary(fin);
+}
+
+std::vector<HistContainerReader::Summary>
+        HistContainerReader::summaries() const {
+    assert(_good);
+    std::ifstream fin(_path, std::ios::binary);
+    assert(fin);
+    std::istringstream sin(readBytes(fin, _footerOffset,
+            int64_t(_helper.N_HIST) * footerBytes()));
+    std::vector<Summary> summaries(_helper.N_HIST);
+    for (auto& summary : summaries) {
+        summary = readSummary(sin);
+    }
+    return summaries;
+}
+
+HistContainerReader::Summary HistContainerReader::readSummary(
+        std::istream& in) const {
+    Summary summary;
+    readRaw(in, &summary.total, 1);
+    readRaw(in, &summary.nNonEmptyBins, 1);
+    summary.means.resize(_nDim);
+    readRaw(in, summary.means.data(), _nDim);
+    if (summary.total < 0.0)
+        summary.means.clear();
+    return summary;
+}
+
+std::shared_ptr<Hist> HistContainerReader::createHist(const char* meta,
+        const int* binIds, const float* values, int count) const {
+    std::vector<int> nbins(_nDim);
+    std::vector<double> mins(_nDim), maxs(_nDim);
+    std::memcpy(nbins.data(), meta, sizeof(int) * _nDim);
+    meta += sizeof(int) * _nDim;
+    std::memcpy(mins.data(), meta, sizeof(double) * _nDim);
+    meta += sizeof(double) * _nDim;
+    std::memcpy(maxs.data(), meta, sizeof(double) * _nDim);
+    meta += sizeof(double) * _nDim;
+    double percentInRange = 1.0;
+    std::memcpy(&percentInRange, meta, sizeof(double));
+    if (0 == _nDim || 0 == nbins[0])
+        return std::make_shared<HistNull>();
+    auto hist = createSparse(nbins, mins, maxs, _logBases, _vars,
+            std::vector<int>(binIds, binIds + count),
+            std::vector<float>(values, values + count));
+    hist->setPercentInRange(percentInRange);
+    return hist;
+}
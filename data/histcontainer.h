@@ -0,0 +1,109 @@
+#ifndef HISTCONTAINER_H
+#define HISTCONTAINER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "Histogram.h"
+#include "histgrid.h"
+
+/**
+ * The indexed container, pdfs-indexed-<name>, holds a whole volume of sparse
+ * histograms in one self-describing file:
+ *
+ *   header:  int magic, version, ndim, ngridx, ngridy, ngridz,
+ *            nhistx, nhisty, nhistz, encoding, blocksize;
+ *            double logbases[ndim];
+ *            int64 offsets of the meta, bin id, count and footer sections
+ *   offsets: int64[nhist + 1], where the non-empty bins of every histogram
+ *            start in the bin id and count columns
+ *   meta:    per histogram int nbins[ndim], double mins[ndim], maxs[ndim],
+ *            double percentinrange, with all nbins 0 for an empty histogram
+ *   bin ids: int32 column of the non-empty bin ids of all histograms
+ *   counts:  float32 column of the matching counts
+ *   footer:  per histogram double total (-1 when empty), int nonempty bins,
+ *            float means[ndim]
+ *
+ * Any histogram is found with O(1) seeks and the summaries can be read
+ * without touching the bin data.
+ *
+ * With the delta-varint encoding, the bin id and count sections are replaced
+ * by an int64[nblocks + 1] table of offsets into the blocks section and the
+ * blocks themselves.
+ * A block holds blocksize consecutive histograms, each as its VarintCodec
+ * encoded bins, so blocks decode independently of each other.
+ */
+class HistContainerWriter {
+public:
+    typedef std::function<std::shared_ptr<const Hist>(int flatId)> HistGetter;
+    /// Compression falls back to the raw columns when a count is fractional.
+    HistContainerWriter(const HistHelper& helper, bool compress = false)
+      : _helper(helper), _compress(compress) {}
+
+public:
+    bool write(const std::string& path, HistGetter getHist) const;
+
+private:
+    HistHelper _helper;
+    bool _compress;
+};
+
+/**
+ * @brief The HistContainerReader class reads the header and the offset table
+ * on construction and then single histograms or summaries on demand.
+ */
+class HistContainerReader {
+public:
+    struct Summary {
+        double total;
+        int nNonEmptyBins;
+        /// Empty for an empty histogram.
+        std::vector<float> means;
+    };
+    static std::string filename(
+            const std::string& dir, const std::string& name) {
+        return dir + "/pdfs-indexed-" + name;
+    }
+    HistContainerReader(
+            const std::string& path, const std::vector<std::string>& vars);
+
+public:
+    bool good() const { return _good; }
+    const HistHelper& helper() const { return _helper; }
+    bool isCompressed() const { return Encoding_DeltaVarint == _encoding; }
+    std::shared_ptr<Hist> hist(int flatId) const;
+    /// All histograms, reading every section at once and decoding the blocks
+    /// on nThreads threads, one per core when 0.
+    std::vector<std::shared_ptr<Hist>> hists(int nThreads = 0) const;
+    Summary summary(int flatId) const;
+    std::vector<Summary> summaries() const;
+
+private:
+    enum Encoding : int { Encoding_Raw = 0, Encoding_DeltaVarint = 1 };
+    int metaBytes() const {
+        return _nDim * (sizeof(int) + 2 * sizeof(double)) + sizeof(double);
+    }
+    int footerBytes() const {
+        return sizeof(double) + sizeof(int) + _nDim * sizeof(float);
+    }
+    Summary readSummary(std::istream& in) const;
+    std::shared_ptr<Hist> createHist(const char* meta,
+            const int* binIds, const float* values, int count) const;
+
+private:
+    std::string _path;
+    std::vector<std::string> _vars;
+    bool _good = false;
+    HistHelper _helper;
+    int _nDim = 0;
+    int _encoding = Encoding_Raw;
+    int _blockSize = 0;
+    std::vector<double> _logBases;
+    int64_t _metaOffset = 0, _binIdsOffset = 0, _countsOffset = 0;
+    int64_t _footerOffset = 0;
+    std::vector<int64_t> _binOffsets;
+    /// Relative to the blocks section, encoded containers only.
+    std::vector<int64_t> _blockOffsets;
+};
+
+#endif // HISTCONTAINER_H
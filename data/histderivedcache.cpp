@@ -0,0 +1,200 @@
+#include "histderivedcache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const int derivedCacheMagic = 0x43445648; // "HVDC"
+const int derivedCacheVersion = 1;
+const int64_t headerSize = 2 * sizeof(int) + 3 * sizeof(int64_t);
+
+template <typename T>
+void appendRaw(std::string& out, const T* data, int64_t count) {
+    out.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+const T* takeRaw(const char*& in, int64_t count) {
+    const T* data = reinterpret_cast<const T*>(in);
+    in += sizeof(T) * count;
+    return data;
+}
+
+// copied out, as the doubles of the histograms are not aligned
+template <typename T>
+std::vector<T> takeVector(const char*& in, int64_t count) {
+    std::vector<T> values(count);
+    std::memcpy(values.data(), in, sizeof(T) * count);
+    in += sizeof(T) * count;
+    return values;
+}
+
+} // anonymous namespace
+
+HistDerivedCache::Entry::~Entry() {
+    munmap(_mapping, _mappingSize);
+}
+
+HistDerivedCache::Source HistDerivedCache::sourceOf(const std::string& dir) {
+    return FileStamp::of(dir, [](const std::string& name) {
+        return name.size() < 4 || ".idx" != name.substr(name.size() - 4);
+    });
+}
+
+std::string HistDerivedCache::dirname(const std::string& datasetDir) {
+    return datasetDir + "/.histcache/v" + std::to_string(derivedCacheVersion);
+}
+
+std::string HistDerivedCache::key(const std::string& step,
+        const std::string& config, const std::string& product,
+        const std::vector<int>& dims) {
+    std::string key = step + "-" + config + "-" + product;
+    for (auto dim : dims)
+        key += "-" + std::to_string(dim);
+    return key;
+}
+
+// 64-bit FNV-1a
+uint64_t HistDerivedCache::hash(const std::string& description) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : description) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+HistDerivedCache::HistDerivedCache(const std::string& datasetDir)
+  : _dir(dirname(datasetDir)) {
+    // a read-only dataset simply misses on every get()
+    mkdir((datasetDir + "/.histcache").c_str(), 0755);
+    mkdir(_dir.c_str(), 0755);
+}
+
+std::shared_ptr<const HistDerivedCache::Entry> HistDerivedCache::get(
+        const std::string& key, const Source& source) const {
+    int fd = open(filename(key).c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (0 == fstat(fd, &info) && headerSize <= info.st_size) {
+        mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // the mapping stays valid after closing
+    close(fd);
+    if (MAP_FAILED == mapping)
+        return nullptr;
+    auto entry = std::make_shared<Entry>(mapping, info.st_size, headerSize);
+    const char* in = static_cast<const char*>(mapping);
+    const int* header = takeRaw<int>(in, 2);
+    const int64_t* stamps = takeRaw<int64_t>(in, 3);
+    if (derivedCacheMagic != header[0] || derivedCacheVersion != header[1]
+            || source.size != stamps[0] || source.mtime != stamps[1]
+            || entry->size() != stamps[2])
+        return nullptr;
+    return entry;
+}
+
+bool HistDerivedCache::put(const std::string& key, const Source& source,
+        const char* data, int64_t nBytes) const {
+    // written aside, so a reader never maps half an entry, even as threads
+    // compute the same product at once
+    return writeAside(filename(key), [&](const std::string& asidePath) {
+        std::ofstream fout(asidePath, std::ios::binary);
+        int header[2] = { derivedCacheMagic, derivedCacheVersion };
+        int64_t stamps[3] = { source.size, source.mtime, nBytes };
+        fout.write(reinterpret_cast<const char*>(header), sizeof(header));
+        fout.write(reinterpret_cast<const char*>(stamps), sizeof(stamps));
+        fout.write(data, nBytes);
+        fout.close();
+        return bool(fout);
+    });
+}
+
+/**
+ * @brief HistDerivedCache::putHists
+ * Every histogram is written as int ndim, int nbins[ndim],
+ * double mins[ndim], maxs[ndim], logbases[ndim], int nnonempty,
+ * int binids[nnonempty], float values[nnonempty], with ndim 0 for an empty
+ * histogram.
+ */
+bool HistDerivedCache::putHists(const std::string& key, const Source& source,
+        const std::vector<std::shared_ptr<const Hist>>& hists) const {
+    std::string payload;
+    int nHist = hists.size();
+    appendRaw(payload, &nHist, 1);
+    for (const auto& hist : hists) {
+        int nDim = hist ? hist->nDim() : 0;
+        assert(nDim <= 2);
+        appendRaw(payload, &nDim, 1);
+        if (0 == nDim)
+            continue;
+        std::vector<double> bounds;
+        for (int iDim = 0; iDim < nDim; ++iDim)
+            bounds.push_back(hist->dimMin(iDim));
+        for (int iDim = 0; iDim < nDim; ++iDim)
+            bounds.push_back(hist->dimMax(iDim));
+        for (int iDim = 0; iDim < nDim; ++iDim)
+            bounds.push_back(hist->logBase(iDim));
+        std::vector<int> nBins(hist->dim().begin(), hist->dim().end());
+        appendRaw(payload, nBins.data(), nDim);
+        appendRaw(payload, bounds.data(), bounds.size());
+        std::vector<int> binIds;
+        std::vector<float> values;
+        for (int iBin = 0; iBin < hist->nBins(); ++iBin) {
+            float freq = hist->binFreq(iBin);
+            if (0.f == freq)
+                continue;
+            binIds.push_back(iBin);
+            values.push_back(freq);
+        }
+        int nNonEmpty = binIds.size();
+        appendRaw(payload, &nNonEmpty, 1);
+        appendRaw(payload, binIds.data(), nNonEmpty);
+        appendRaw(payload, values.data(), nNonEmpty);
+    }
+    return put(key, source, payload.data(), payload.size());
+}
+
+std::vector<std::shared_ptr<const Hist>> HistDerivedCache::getHists(
+        const std::string& key, const Source& source,
+        const std::vector<std::string>& vars) const {
+    std::vector<std::shared_ptr<const Hist>> hists;
+    auto entry = get(key, source);
+    if (!entry)
+        return hists;
+    const char* in = entry->data();
+    int nHist = *takeRaw<int>(in, 1);
+    hists.reserve(nHist);
+    for (int iHist = 0; iHist < nHist; ++iHist) {
+        int nDim = *takeRaw<int>(in, 1);
+        if (0 == nDim) {
+            hists.push_back(std::make_shared<HistNull>());
+            continue;
+        }
+        assert(nDim == int(vars.size()));
+        auto nBins = takeVector<int>(in, nDim);
+        auto mins = takeVector<double>(in, nDim);
+        auto maxs = takeVector<double>(in, nDim);
+        auto logBases = takeVector<double>(in, nDim);
+        int nNonEmpty = *takeRaw<int>(in, 1);
+        auto binIds = takeVector<int>(in, nNonEmpty);
+        auto values = takeVector<float>(in, nNonEmpty);
+        if (1 == nDim) {
+            hists.push_back(std::make_shared<Hist1D>(nBins[0], mins[0],
+                    maxs[0], logBases[0], vars[0], binIds, values));
+        } else {
+            hists.push_back(std::make_shared<Hist2D>(nBins[0], nBins[1],
+                    mins, maxs, logBases, vars, binIds, values));
+        }
+    }
+    return hists;
+}
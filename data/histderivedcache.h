@@ -0,0 +1,106 @@
+#ifndef HISTDERIVEDCACHE_H
+#define HISTDERIVEDCACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Histogram.h"
+#include "fileio.h"
+
+/**
+ * The derived products of a dataset, such as the volume statistics, the
+ * frequency ranges, the marginals and the selection masks, kept under
+ * <dataset>/.histcache/v<version> with one file per step, config and product:
+ *
+ *   header:  int magic, version; int64 source size, source mtime, nbytes
+ *   payload: nbytes of the product
+ *
+ * The source is the step directory the product was derived from. An entry
+ * whose source size or modification time has changed since is stale and the
+ * next put() replaces it. Entries are memory-mapped on reuse.
+ */
+class HistDerivedCache {
+public:
+    typedef FileStamp Source;
+    /// Total size and latest modification time of the files in dir, other
+    /// than the sidecar indices written next to them.
+    static Source sourceOf(const std::string& dir);
+    static std::string dirname(const std::string& datasetDir);
+    /// Name of the product of a step and config, with the dims it is of.
+    static std::string key(const std::string& step, const std::string& config,
+            const std::string& product, const std::vector<int>& dims = {});
+    /// A stable hash for products keyed by longer descriptions.
+    static uint64_t hash(const std::string& description);
+
+public:
+    /**
+     * @brief The Entry class is a read-only mapping of the payload of a file.
+     */
+    class Entry {
+    public:
+        Entry(void* mapping, int64_t mappingSize, int64_t payloadOffset)
+          : _mapping(mapping), _mappingSize(mappingSize)
+          , _payloadOffset(payloadOffset) {}
+        ~Entry();
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+    public:
+        const char* data() const {
+            return static_cast<const char*>(_mapping) + _payloadOffset;
+        }
+        int64_t size() const { return _mappingSize - _payloadOffset; }
+        template <typename T>
+        std::vector<T> values() const {
+            const T* begin = reinterpret_cast<const T*>(data());
+            return std::vector<T>(begin, begin + size() / sizeof(T));
+        }
+
+    private:
+        void* _mapping;
+        int64_t _mappingSize, _payloadOffset;
+    };
+
+public:
+    explicit HistDerivedCache(const std::string& datasetDir);
+
+public:
+    const std::string& dir() const { return _dir; }
+    /// The entry of key, nullptr when it is missing or stale.
+    std::shared_ptr<const Entry> get(
+            const std::string& key, const Source& source) const;
+    bool put(const std::string& key, const Source& source,
+            const char* data, int64_t nBytes) const;
+    template <typename T>
+    bool get(const std::string& key, const Source& source,
+            std::vector<T>& values) const {
+        auto entry = get(key, source);
+        if (!entry)
+            return false;
+        values = entry->values<T>();
+        return true;
+    }
+    template <typename T>
+    bool put(const std::string& key, const Source& source,
+            const std::vector<T>& values) const {
+        return put(key, source, reinterpret_cast<const char*>(values.data()),
+                int64_t(sizeof(T) * values.size()));
+    }
+    /// Histograms of up to 2 dimensions, stored as their non-empty bins, so
+    /// the marginals of a volume come back without reading the volume.
+    /// Null histograms stay null.
+    bool putHists(const std::string& key, const Source& source,
+            const std::vector<std::shared_ptr<const Hist>>& hists) const;
+    std::vector<std::shared_ptr<const Hist>> getHists(const std::string& key,
+            const Source& source, const std::vector<std::string>& vars) const;
+
+private:
+    std::string filename(const std::string& key) const {
+        return _dir + "/" + key + ".bin";
+    }
+
+private:
+    std::string _dir;
+};
+
+#endif // HISTDERIVEDCACHE_H
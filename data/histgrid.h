@@ -29,11 +29,11 @@ public:
     virtual std::shared_ptr<const T> hist(int flatId) const = 0;
     virtual std::shared_ptr<const T> hist(
             const std::vector<int>& ids) const {
-        return this->hist(dimHists().idstoflat(ids));
+        return this->hist(int(dimHists().idstoflat(ids)));
     }
     template<typename... Targs> std::shared_ptr<const T> hist(
             Targs... ids) const {
-        return this->hist(dimHists().idstoflat(ids...));
+        return this->hist(int(dimHists().idstoflat(ids...)));
     }
 };
 
@@ -49,10 +49,10 @@ public:
     virtual Extent dimHists() const override { return helper().dimHists(); }
     virtual std::shared_ptr<T> hist(int flatId) = 0;
     virtual std::shared_ptr<T> hist(const std::vector<int>& ids) {
-        return this->hist(dimHists().idstoflat(ids));
+        return this->hist(int(dimHists().idstoflat(ids)));
     }
     template<typename... Targs> std::shared_ptr<T> hist(Targs... ids) {
-        return this->hist(dimHists().idstoflat(ids...));
+        return this->hist(int(dimHists().idstoflat(ids...)));
     }
     using IConstHGrid<T>::hist;
 };
@@ -150,10 +150,10 @@ public:
 public:
     std::shared_ptr<HistDomain> domain(int flatId) { return m_domains[flatId]; }
     std::shared_ptr<const HistDomain> domain(int flatId) const { return m_domains[flatId]; }
-    virtual std::shared_ptr<HistDomain> domain(const std::vector<int>& ids) { return this->domain(Extent(m_dimDomains).idstoflat(ids)); }
-    virtual std::shared_ptr<const HistDomain> domain(const std::vector<int>& ids) const { return this->domain(Extent(m_dimDomains).idstoflat(ids)); }
-    template<typename... Targs> std::shared_ptr<HistDomain> domain(Targs... ids) { return this->domain(Extent(m_dimDomains).idstoflat(ids...)); }
-    template<typename... Targs> std::shared_ptr<const HistDomain> domain(Targs... ids) const { return this->domain(Extent(m_dimDomains).idstoflat(ids...)); }
+    virtual std::shared_ptr<HistDomain> domain(const std::vector<int>& ids) { return this->domain(int(Extent(m_dimDomains).idstoflat(ids))); }
+    virtual std::shared_ptr<const HistDomain> domain(const std::vector<int>& ids) const { return this->domain(int(Extent(m_dimDomains).idstoflat(ids))); }
+    template<typename... Targs> std::shared_ptr<HistDomain> domain(Targs... ids) { return this->domain(int(Extent(m_dimDomains).idstoflat(ids...))); }
+    template<typename... Targs> std::shared_ptr<const HistDomain> domain(Targs... ids) const { return this->domain(int(Extent(m_dimDomains).idstoflat(ids...))); }
     const std::vector<int> & dimDomains() const { return m_dimDomains; }
     int nDomains() const;
 
@@ -0,0 +1,127 @@
+#include "histintegralvolume.h"
+#include <cassert>
+#include <algorithm>
+
+namespace {
+
+bool isSameBinning(const Hist& a, const Hist& b) {
+    if (a.nDim() != b.nDim() || a.vars() != b.vars())
+        return false;
+    for (int iDim = 0; iDim < a.nDim(); ++iDim) {
+        if (a.dim()[iDim] != b.dim()[iDim]
+                || a.dimMin(iDim) != b.dimMin(iDim)
+                || a.dimMax(iDim) != b.dimMax(iDim)
+                || a.logBase(iDim) != b.logBase(iDim))
+            return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+/**
+ * @brief HistIntegralVolume::create
+ * @param dimHists the number of histograms in each spatial dimension
+ * @param getHist returns the histogram at a flat id, empty ones are skipped
+ * @return
+ */
+std::shared_ptr<HistIntegralVolume> HistIntegralVolume::create(
+        const Extent& dimHists, HistGetter getHist) {
+    assert(3 == dimHists.nDim());
+    std::shared_ptr<HistIntegralVolume> volume(new HistIntegralVolume());
+    volume->_dimHists = dimHists;
+    std::shared_ptr<const Hist> first;
+    int nx = dimHists[0], ny = dimHists[1], nz = dimHists[2];
+    for (int z = 0; z < nz; ++z)
+    for (int y = 0; y < ny; ++y)
+    for (int x = 0; x < nx; ++x) {
+        auto hist = getHist(dimHists.idstoflat(x, y, z));
+        if (!hist || 0 == hist->nDim())
+            continue;
+        if (!first) {
+            first = hist;
+            volume->_nBins = std::vector<int>(hist->dim().begin(),
+                    hist->dim().end());
+            volume->_nBin = hist->nBins();
+            for (int iDim = 0; iDim < hist->nDim(); ++iDim) {
+                volume->_mins.push_back(hist->dimMin(iDim));
+                volume->_maxs.push_back(hist->dimMax(iDim));
+                volume->_logBases.push_back(hist->logBase(iDim));
+            }
+            volume->_vars = hist->vars();
+            volume->_prefixSums.assign(
+                    volume->prefixOffset(0, 0, nz + 1), 0.0);
+        }
+        if (!isSameBinning(*first, *hist))
+            return nullptr;
+        double* sums = &volume->_prefixSums[volume->prefixOffset(
+                x + 1, y + 1, z + 1)];
+        for (int iBin = 0; iBin < volume->_nBin; ++iBin)
+            sums[iBin] = hist->binFreq(iBin);
+    }
+    if (!first)
+        return nullptr;
+    // accumulate along x, y, and z in turn; the bins being the fastest
+    // dimension, every inner loop runs over contiguous memory.
+    int nBin = volume->_nBin;
+    double* prefix = volume->_prefixSums.data();
+    for (int z = 1; z <= nz; ++z)
+    for (int y = 1; y <= ny; ++y)
+    for (int x = 1; x <= nx; ++x) {
+        double* curr = prefix + volume->prefixOffset(x, y, z);
+        const double* prevX = prefix + volume->prefixOffset(x - 1, y, z);
+        for (int iBin = 0; iBin < nBin; ++iBin)
+            curr[iBin] += prevX[iBin];
+    }
+    for (int z = 1; z <= nz; ++z)
+    for (int y = 1; y <= ny; ++y)
+    for (int x = 1; x <= nx; ++x) {
+        double* curr = prefix + volume->prefixOffset(x, y, z);
+        const double* prevY = prefix + volume->prefixOffset(x, y - 1, z);
+        for (int iBin = 0; iBin < nBin; ++iBin)
+            curr[iBin] += prevY[iBin];
+    }
+    for (int z = 1; z <= nz; ++z)
+    for (int y = 1; y <= ny; ++y)
+    for (int x = 1; x <= nx; ++x) {
+        double* curr = prefix + volume->prefixOffset(x, y, z);
+        const double* prevZ = prefix + volume->prefixOffset(x, y, z - 1);
+        for (int iBin = 0; iBin < nBin; ++iBin)
+            curr[iBin] += prevZ[iBin];
+    }
+    return volume;
+}
+
+/**
+ * @brief HistIntegralVolume::boxHist
+ * @param lower the first histogram ids of the box
+ * @param upper one past the last histogram ids of the box
+ * @return
+ */
+std::shared_ptr<Hist> HistIntegralVolume::boxHist(
+        const std::vector<int>& lower, const std::vector<int>& upper) const {
+    assert(3 == lower.size() && 3 == upper.size());
+    int x0 = std::max(0, lower[0]), x1 = std::min(_dimHists[0], upper[0]);
+    int y0 = std::max(0, lower[1]), y1 = std::min(_dimHists[1], upper[1]);
+    int z0 = std::max(0, lower[2]), z1 = std::min(_dimHists[2], upper[2]);
+    std::vector<float> values(_nBin, 0.f);
+    if (x0 < x1 && y0 < y1 && z0 < z1) {
+        const double* prefix = _prefixSums.data();
+        const double* p111 = prefix + prefixOffset(x1, y1, z1);
+        const double* p011 = prefix + prefixOffset(x0, y1, z1);
+        const double* p101 = prefix + prefixOffset(x1, y0, z1);
+        const double* p110 = prefix + prefixOffset(x1, y1, z0);
+        const double* p001 = prefix + prefixOffset(x0, y0, z1);
+        const double* p010 = prefix + prefixOffset(x0, y1, z0);
+        const double* p100 = prefix + prefixOffset(x1, y0, z0);
+        const double* p000 = prefix + prefixOffset(x0, y0, z0);
+        for (int iBin = 0; iBin < _nBin; ++iBin) {
+            double sum = p111[iBin] - p011[iBin] - p101[iBin] - p110[iBin]
+                    + p001[iBin] + p010[iBin] + p100[iBin] - p000[iBin];
+            // cancellation can leave tiny negative residues
+            values[iBin] = std::max(0.0, sum);
+        }
+    }
+    return std::shared_ptr<Hist>(Hist::fromDenseValues(
+            _nBins.size(), _nBins, _mins, _maxs, _logBases, _vars, values));
+}
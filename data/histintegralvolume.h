@@ -0,0 +1,46 @@
+#ifndef HISTINTEGRALVOLUME_H
+#define HISTINTEGRALVOLUME_H
+
+#include <functional>
+#include <memory>
+#include "Histogram.h"
+
+/**
+ * @brief The HistIntegralVolume class keeps the 3D prefix sums over space of
+ * same-binned histograms, so that the aggregated histogram of any axis-aligned
+ * box of sampling regions takes 8 lookups per bin, no matter how large the box
+ * is.
+ */
+class HistIntegralVolume {
+public:
+    typedef std::function<std::shared_ptr<const Hist>(int flatId)> HistGetter;
+    /// Returns nullptr when the histograms are not binned the same way.
+    static std::shared_ptr<HistIntegralVolume> create(
+            const Extent& dimHists, HistGetter getHist);
+
+public:
+    /// The merged histogram of the box [lower, upper) in histogram ids.
+    std::shared_ptr<Hist> boxHist(const std::vector<int>& lower,
+            const std::vector<int>& upper) const;
+    const Extent& dimHists() const { return _dimHists; }
+    const std::vector<int>& nBins() const { return _nBins; }
+
+private:
+    HistIntegralVolume() = default;
+    int64_t prefixOffset(int x, int y, int z) const {
+        return ((int64_t(z) * (_dimHists[1] + 1) + y) * (_dimHists[0] + 1) + x)
+                * _nBin;
+    }
+
+private:
+    Extent _dimHists;
+    std::vector<int> _nBins;
+    int _nBin;
+    std::vector<double> _mins, _maxs, _logBases;
+    std::vector<std::string> _vars;
+    /// (nx+1)*(ny+1)*(nz+1) prefix sums with the bins as the fastest dimension,
+    /// the first row/column/slice being zeros.
+    std::vector<double> _prefixSums;
+};
+
+#endif // HISTINTEGRALVOLUME_H
@@ -6,8 +6,10 @@
 #include <map>
 #include <tuple>
 #include <numeric>
+#include <thread>
 #include <yy/functional.h>
 #include "histbinwidthcalculator.h"
+#include "parallel.h"
 
 namespace {
 
@@ -168,6 +170,139 @@ std::vector<std::vector<int>> makeIdsArray(
     return crossProduct(idsCols);
 }
 
+/// Histograms per worker below which spawning another thread does not pay off.
+const int minHistsPerThread = 64;
+
+int calcThreadCount(int nItems) {
+    int nThreads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1, std::min(nThreads, nItems / minHistsPerThread));
+}
+
+double sumBinFreqs(const std::vector<std::shared_ptr<const Hist>>& hists) {
+    int nHists = int(hists.size());
+    return parallelReduce(nHists, calcThreadCount(nHists), 0.0,
+            [&hists](double& sum, int iHist) {
+        sum += hists[iHist]->binSum().value();
+    }, [](double& a, const double& b) {
+        a += b;
+    });
+}
+
+/// whether every histogram already has the bins of the merged histogram
+bool isSameBinning(const std::vector<std::shared_ptr<const Hist>>& hists,
+        const std::vector<int>& nBins) {
+    const auto& first = hists[0];
+    for (const auto& hist : hists) {
+        for (int iDim = 0; iDim < hist->nDim(); ++iDim) {
+            if (hist->dim()[iDim] != nBins[iDim]
+                    || hist->dimMin(iDim) != first->dimMin(iDim)
+                    || hist->dimMax(iDim) != first->dimMax(iDim)
+                    || hist->logBase(iDim) != first->logBase(iDim))
+                return false;
+        }
+    }
+    return true;
+}
+
+/// Bin centers accumulated over the 1D marginals of the histograms.
+struct Marginal {
+    Marginal()
+      : totalMin(std::numeric_limits<double>::max()),
+        totalMax(std::numeric_limits<double>::lowest()) {}
+    std::map<double, double> accumulated;
+    double totalMin, totalMax;
+};
+
+/// A new bin overlapped by an old bin, and the portion of the old bin in it.
+struct BinOverlap {
+    int binId;
+    double ratio;
+};
+
+/// Overlaps along one dimension. Since bins are boxes, the overlapping ratio of
+/// an old bin and a new bin is the product of the per dimension ratios. The
+/// overlaps of old bin i are overlaps[offsets[i]] to overlaps[offsets[i+1]].
+struct DimOverlaps {
+    DimOverlaps() {}
+    DimOverlaps(const Range& histRange, int histNBin, const Range& range,
+            double singleBinRange, int nBin) : offsets(histNBin + 1, 0) {
+        double singleHistBinRange = histRange.range() / histNBin;
+        for (int histBinId = 0; histBinId < histNBin; ++histBinId) {
+            Range histBinRange(
+                    histRange.lower() + histBinId * singleHistBinRange,
+                    histRange.lower() + (histBinId + 1) * singleHistBinRange);
+            int begBinId =
+                    (histBinRange.lower() - range.lower()) / singleBinRange;
+            int endBinId =
+                    calcEndBinId(histBinRange, range, singleBinRange, nBin);
+            for (int binId = begBinId; binId <= endBinId; ++binId) {
+                double lower = std::max(histBinRange.lower(),
+                        range.lower() + binId * singleBinRange);
+                double upper = std::min(histBinRange.upper(),
+                        range.lower() + (binId + 1) * singleBinRange);
+                double ratio =
+                        std::max(0.0, upper - lower) / histBinRange.range();
+                assert(ratio >= 0.0);
+                overlaps.push_back({binId, ratio});
+            }
+            offsets[histBinId + 1] = overlaps.size();
+        }
+    }
+    std::vector<int> offsets;
+    std::vector<BinOverlap> overlaps;
+};
+
+/// put the old values of hist into the new bins by overlapping areas
+void accumulateHist(const std::shared_ptr<const Hist>& hist,
+        const std::vector<Range>& ranges,
+        const std::vector<double>& singleBinRanges,
+        const std::vector<int>& nBins, std::vector<float>& values) {
+    int nDim = hist->nDim();
+    std::vector<DimOverlaps> overlaps(nDim);
+    std::vector<int> strides(nDim, 1);
+    for (int iDim = 0; iDim < nDim; ++iDim) {
+        overlaps[iDim] = DimOverlaps(
+                Range(hist->dimMin(iDim), hist->dimMax(iDim)),
+                hist->dim()[iDim], ranges[iDim], singleBinRanges[iDim],
+                nBins[iDim]);
+        if (iDim > 0)
+            strides[iDim] = strides[iDim - 1] * nBins[iDim - 1];
+    }
+    std::vector<int> histBinIds(nDim, 0);
+    std::vector<int> overlapIds(nDim);
+    for (int histFlatId = 0; histFlatId < hist->nBins(); ++histFlatId) {
+        float value = hist->binFreq(histFlatId);
+        if (value > 0.f) {
+            // walk through the cross product of the per dimension overlaps
+            for (int iDim = 0; iDim < nDim; ++iDim)
+                overlapIds[iDim] = overlaps[iDim].offsets[histBinIds[iDim]];
+            int iDim = 0;
+            while (iDim < nDim) {
+                double ratio = 1.0;
+                int iBin = 0;
+                for (int jDim = 0; jDim < nDim; ++jDim) {
+                    const auto& overlap =
+                            overlaps[jDim].overlaps[overlapIds[jDim]];
+                    ratio *= overlap.ratio;
+                    iBin += overlap.binId * strides[jDim];
+                }
+                values[iBin] += ratio * value;
+                for (iDim = 0; iDim < nDim; ++iDim) {
+                    const auto& offsets = overlaps[iDim].offsets;
+                    if (++overlapIds[iDim] < offsets[histBinIds[iDim] + 1])
+                        break;
+                    overlapIds[iDim] = offsets[histBinIds[iDim]];
+                }
+            }
+        }
+        for (int iDim = 0; iDim < nDim; ++iDim) {
+            if (++histBinIds[iDim] < hist->dim()[iDim])
+                break;
+            histBinIds[iDim] = 0;
+        }
+    }
+}
+
 } // anonymous namespace
 
 int HistMerger::calcBinCount(
@@ -179,39 +314,38 @@ int HistMerger::calcBinCount(
     /// TODO: extract these into HistBinWidthCalculator?
     if (int(_binCounts.size()) <= iDim
             || "sturges" == _binCounts[iDim]._methodName) {
-        float totalValue = 0.0;
-        for (auto hist : hists) {
-            totalValue += hist->binSum().value();
-        }
+        float totalValue = sumBinFreqs(hists);
         // apply sturge's formula
         return std::min(
                 maxBinCount, HistBinWidthCalculatorSturges::nBins(totalValue));
     }
     if ("freedman" == _binCounts[iDim]._methodName) {
-        double totalValue = 0.0;
-        for (auto hist : hists) {
-            totalValue += hist->binSum().value();
-        }
+        double totalValue = sumBinFreqs(hists);
         double firstValue = 0.25 * totalValue;
         double thirdValue = 0.75 * totalValue;
-        std::map<double, double> accumulated;
-        double totalMin = std::numeric_limits<double>::max();
-        double totalMax = std::numeric_limits<double>::lowest();
-        for (auto hist : hists) {
+        int nHists = int(hists.size());
+        Marginal marginal = parallelReduce(nHists, calcThreadCount(nHists),
+                Marginal(),
+                [&hists, iDim](Marginal& marginal, int iHist) {
             std::shared_ptr<const Hist> hist1d =
-                    HistCollapser(hist).collapseTo({iDim});
+                    HistCollapser(hists[iHist]).collapseTo({iDim});
             double histRange = hist1d->dimMax(0) - hist1d->dimMin(0);
             double binRange = histRange / hist1d->dim()[0];
             for (int iBin = 0; iBin < hist1d->dim()[0]; ++iBin) {
                 double key = iBin * binRange + 0.5 * binRange;
-                double value = hist1d->binFreq(iBin);
-                if (0 == accumulated.count(key))
-                    accumulated[key] = 0.0;
-                accumulated[key] += value;
+                marginal.accumulated[key] += hist1d->binFreq(iBin);
             }
-            totalMin = std::min(hist1d->dimMin(0), totalMin);
-            totalMax = std::max(hist1d->dimMax(0), totalMax);
-        }
+            marginal.totalMin = std::min(hist1d->dimMin(0), marginal.totalMin);
+            marginal.totalMax = std::max(hist1d->dimMax(0), marginal.totalMax);
+        }, [](Marginal& a, const Marginal& b) {
+            for (const auto& keyValue : b.accumulated)
+                a.accumulated[keyValue.first] += keyValue.second;
+            a.totalMin = std::min(a.totalMin, b.totalMin);
+            a.totalMax = std::max(a.totalMax, b.totalMax);
+        });
+        const auto& accumulated = marginal.accumulated;
+        double totalMin = marginal.totalMin;
+        double totalMax = marginal.totalMax;
         double value = 0.0;
         double firstKey, thirdKey;
         auto itr = accumulated.begin();
@@ -258,7 +392,31 @@ std::shared_ptr<Hist> HistMerger::merge(
         assert(nDim == hist->nDim());
         assert(vars == hist->vars());
     }
+    std::vector<int> nBins = calcBinCounts(hists);
+    int nBin = multiplyEach(nBins);
+
     // if same range and same bin widths, then merge the numbers only.
+    if (isSameBinning(hists, nBins)) {
+        int nHists = int(hists.size());
+        std::vector<float> values = parallelReduce(nHists,
+                calcThreadCount(nHists), std::vector<float>(nBin, 0.f),
+                [&hists](std::vector<float>& partial, int iHist) {
+            for (int iBin = 0; iBin < int(partial.size()); ++iBin)
+                partial[iBin] += hists[iHist]->binFreq(iBin);
+        }, [](std::vector<float>& a, const std::vector<float>& b) {
+            for (unsigned int iBin = 0; iBin < a.size(); ++iBin)
+                a[iBin] += b[iBin];
+        });
+        std::vector<double> mins(nDim), maxs(nDim), logBases(nDim);
+        for (int iDim = 0; iDim < nDim; ++iDim) {
+            mins[iDim] = hists[0]->dimMin(iDim);
+            maxs[iDim] = hists[0]->dimMax(iDim);
+            logBases[iDim] = hists[0]->logBase(iDim);
+        }
+        return std::shared_ptr<Hist>(
+                Hist::fromDenseValues(
+                    nDim, nBins, mins, maxs, logBases, vars, values));
+    }
 
     // if different range or different bin widths, first calculate the new range
     // as the min and max, then calculates the new optimal bin widths according
@@ -266,8 +424,6 @@ std::shared_ptr<Hist> HistMerger::merge(
     // overlapping areas.
     std::vector<int> dims(nDim);
     std::iota(dims.begin(), dims.end(), 0);
-    std::vector<int> nBins = calcBinCounts(hists);
-    int nBin = multiplyEach(nBins);
 
     // std::cout << "nBin = " << nBin << std::endl;
 
@@ -283,122 +439,17 @@ std::shared_ptr<Hist> HistMerger::merge(
             [](const std::tuple<Range, int>& rangeNBin) {
         return std::get<0>(rangeNBin).range() / double(std::get<1>(rangeNBin));
     }, zip(ranges, nBins));
-    // put old values into new bins
-    std::vector<float> values(nBin, 0.0);
-    for (auto hist : hists) {
-        std::vector<Range> histRanges = map<int, Range>([hist](int iDim) {
-            return Range(hist->dimMin(iDim), hist->dimMax(iDim));
-        }, dims);
-
-        // std::cout << "xHist" << histRanges[0] << std::endl;
-        // std::cout << "yHist" << histRanges[1] << std::endl;
-
-        std::vector<std::vector<int>> histBinIdsCols(nDim);
-        for (int iDim = 0; iDim < nDim; ++iDim) {
-            auto& col = histBinIdsCols[iDim];
-            col.resize(hist->dim()[iDim]);
-            std::iota(col.begin(), col.end(), 0);
-        }
-        std::vector<std::vector<int>> histBinIdsArray =
-                crossProduct(histBinIdsCols);
-
-        for (std::vector<int> histBinIds : histBinIdsArray) {
-            std::vector<int> histNBins = map<int, int>([hist](int iDim) {
-                return hist->dim()[iDim];
-            }, dims);
-            std::vector<double> singleHistBinRanges =
-                    map<std::tuple<Range, int>, double>(
-                        [](const std::tuple<Range,int>& tuple) {
-                return std::get<0>(tuple).range() / std::get<1>(tuple);
-            }, zip(histRanges, histNBins));
-
-            // std::cout << "singleHistBinRanges[0] = "
-            //         << singleHistBinRanges[0] << std::endl;
-            // std::cout << "singleHistBinRanges[1] = "
-            //         << singleHistBinRanges[1] << std::endl;
-
-            std::vector<Range> histBinRanges =
-                    map<std::tuple<Range, int, double>, Range>(
-                        [](const std::tuple<Range, int, double>& tuple) {
-                double lower = std::get<0>(tuple).lower();
-                int binDimId = std::get<1>(tuple);
-                double singleBinDimRange = std::get<2>(tuple);
-                return Range(lower + binDimId * singleBinDimRange,
-                        lower + (binDimId + 1) * singleBinDimRange);
-            }, zip(histRanges, histBinIds, singleHistBinRanges));
-            float value = hist->binFreq(histBinIds);
-
-            // std::cout << "histBinIds[0]" << histBinRanges[0] << std::endl;
-            // std::cout << "histBinIds[1]" << histBinRanges[1] << std::endl;
-
-            std::vector<int> begBinIds =
-                    map<std::tuple<Range, Range, double>, int>(
-                        [](const std::tuple<Range, Range, double>& tuple) {
-                const auto& histBinRange = std::get<0>(tuple);
-                const auto& range = std::get<1>(tuple);
-                double singleBinRange = std::get<2>(tuple);
-                return (histBinRange.lower() - range.lower()) / singleBinRange;
-            }, zip(histBinRanges, ranges, singleBinRanges));
-            std::vector<int> endBinIds =
-                    map<std::tuple<Range, Range, double, int>, int>(
-                        [](const std::tuple<Range, Range, double, int>& tuple) {
-                const auto& histBinRange = std::get<0>(tuple);
-                const auto& range = std::get<1>(tuple);
-                double singleBinRange = std::get<2>(tuple);
-                int nBin = std::get<3>(tuple);
-                return calcEndBinId(histBinRange, range, singleBinRange, nBin);
-            }, zip(histBinRanges, ranges, singleBinRanges, nBins));
-
-            // std::cout << "begBinIds[0] = " << begBinIds[0]
-            //         << " | endBinIds[0] = " << endBinIds[0] << std::endl;
-            // std::cout << "begBinIds[1] = " << begBinIds[1]
-            //         << " | endBinIds[1] = " << endBinIds[1] << std::endl;
-
-            std::vector<std::vector<int>> binIdsCols(nDim);
-            for (int iDim = 0; iDim < nDim; ++iDim) {
-                auto& col = binIdsCols[iDim];
-                col.resize(endBinIds[iDim] - begBinIds[iDim] + 1);
-                std::iota(col.begin(), col.end(), begBinIds[iDim]);
-            }
-            std::vector<std::vector<int>> binIdsArray =
-                    crossProduct(binIdsCols);
-            for (std::vector<int> binIds : binIdsArray) {
-                std::vector<Range> binRanges =
-                        map<std::tuple<Range, int, double>, Range>(
-                            [](const std::tuple<Range, int, double>& tuple) {
-                    const Range& range = std::get<0>(tuple);
-                    int binDimId = std::get<1>(tuple);
-                    double singleBinRange = std::get<2>(tuple);
-                    return Range(
-                            range.lower() + binDimId * singleBinRange,
-                            range.lower() + (binDimId + 1) * singleBinRange);
-                }, zip(ranges, binIds, singleBinRanges));
-                std::vector<double> portions =
-                        map<std::tuple<Range, Range>, double>(
-                            [](const std::tuple<Range, Range>& tuple) {
-                    double range = Range::intersectRanges(
-                            { std::get<0>(tuple), std::get<1>(tuple) }).range();
-//                    double epsilon = std::numeric_limits<double>::epsilon();
-//                    assert(range > -10.0 * epsilon);
-                    return std::max(0.0, range);
-                }, zip(binRanges, histBinRanges));
-                double portionProduct = multiplyEach(portions);
-                assert(portionProduct >= 0.0);
-                double histBinRangeProduct = std::accumulate(
-                        histBinRanges.begin(), histBinRanges.end(), 1.0,
-                        [](double product, const Range& b) {
-                    return product * b.range();
-                });
-                double ratio = portionProduct / histBinRangeProduct;
-                assert(ratio >= 0.0);
-                int iBin = Extent(nBins).idstoflat(binIds);
-
-                // std::cout << "iBin = " << iBin << std::endl;
-
-                values[iBin] += ratio * value;
-            }
-        }
-    }
+    // put old values into new bins, each worker into its own copy of the
+    // bins, which are then summed up pairwise.
+    int nHists = int(hists.size());
+    std::vector<float> values = parallelReduce(nHists,
+            calcThreadCount(nHists), std::vector<float>(nBin, 0.f),
+            [&](std::vector<float>& partial, int iHist) {
+        accumulateHist(hists[iHist], ranges, singleBinRanges, nBins, partial);
+    }, [](std::vector<float>& a, const std::vector<float>& b) {
+        for (unsigned int iBin = 0; iBin < a.size(); ++iBin)
+            a[iBin] += b[iBin];
+    });
     // construct the new histogram
     std::vector<double> mins = map<Range, double>([](const Range& range) {
         return range.lower();
@@ -0,0 +1,55 @@
+#include "histpyramid.h"
+#include <cassert>
+#include "histmerger.h"
+
+/**
+ * @brief HistPyramid::HistPyramid
+ * @param dimHists the number of histograms in each spatial dimension
+ * @param getHist returns the histogram at a flat id of level 0
+ */
+HistPyramid::HistPyramid(const Extent& dimHists, HistGetter getHist) {
+    assert(3 == dimHists.nDim());
+    _dimHists.push_back(dimHists);
+    _levels.emplace_back(dimHists.nElement());
+    for (int iHist = 0; iHist < dimHists.nElement(); ++iHist) {
+        _levels[0][iHist] = getHist(iHist);
+    }
+    while (_dimHists.back().nElement() > 1) {
+        buildNextLevel();
+    }
+}
+
+void HistPyramid::buildNextLevel() {
+    const Extent& fine = _dimHists.back();
+    const auto& fineHists = _levels.back();
+    Extent coarse((fine[0] + 1) / 2, (fine[1] + 1) / 2, (fine[2] + 1) / 2);
+    std::vector<std::shared_ptr<const Hist>> coarseHists(coarse.nElement());
+    std::vector<std::shared_ptr<const Hist>> children;
+    for (int z = 0; z < coarse[2]; ++z)
+    for (int y = 0; y < coarse[1]; ++y)
+    for (int x = 0; x < coarse[0]; ++x) {
+        children.clear();
+        for (int fz = 2 * z; fz < std::min(2 * z + 2, fine[2]); ++fz)
+        for (int fy = 2 * y; fy < std::min(2 * y + 2, fine[1]); ++fy)
+        for (int fx = 2 * x; fx < std::min(2 * x + 2, fine[0]); ++fx) {
+            auto hist = fineHists[fine.idstoflat(fx, fy, fz)];
+            if (hist && 0 < hist->nDim())
+                children.push_back(hist);
+        }
+        std::shared_ptr<const Hist> merged;
+        if (children.empty()) {
+            merged = std::make_shared<HistNull>();
+        } else if (1 == children.size()) {
+            merged = children[0];
+        } else {
+            // keeping the bin counts of the children lets HistMerger sum the
+            // bins directly whenever the children share their ranges.
+            std::vector<BinCount> binCounts(
+                    children[0]->dim().begin(), children[0]->dim().end());
+            merged = HistMerger(binCounts).merge(children);
+        }
+        coarseHists[coarse.idstoflat(x, y, z)] = merged;
+    }
+    _dimHists.push_back(coarse);
+    _levels.push_back(std::move(coarseHists));
+}
@@ -0,0 +1,36 @@
+#ifndef HISTPYRAMID_H
+#define HISTPYRAMID_H
+
+#include <functional>
+#include <memory>
+#include "Histogram.h"
+
+/**
+ * @brief The HistPyramid class is a spatial multi-resolution pyramid of merged
+ * histograms. Level 0 holds the given histograms and every next level merges
+ * 2x2x2 blocks of the previous one, until a single histogram is left.
+ */
+class HistPyramid {
+public:
+    typedef std::function<std::shared_ptr<const Hist>(int flatId)> HistGetter;
+    HistPyramid(const Extent& dimHists, HistGetter getHist);
+
+public:
+    int nLevels() const { return _levels.size(); }
+    const Extent& dimHists(int level) const { return _dimHists[level]; }
+    std::shared_ptr<const Hist> hist(int level, int flatId) const {
+        return _levels[level][flatId];
+    }
+    std::shared_ptr<const Hist> hist(int level, int x, int y, int z) const {
+        return hist(level, _dimHists[level].idstoflat(x, y, z));
+    }
+
+private:
+    void buildNextLevel();
+
+private:
+    std::vector<Extent> _dimHists;
+    std::vector<std::vector<std::shared_ptr<const Hist>>> _levels;
+};
+
+#endif // HISTPYRAMID_H
@@ -1,7 +1,7 @@
 #include "histreader.h"
 #include <fstream>
+#include "histcolumnindex.h"
 #include "histgrid.h"
-#include "histfacadegrid.h"
 
 namespace {
     const std::string pdfhelper_pre = "pdfhelper.";
@@ -62,7 +62,7 @@ std::vector<int> HistDomainReaderManyFiles::readOffsets()
     std::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
     assert(fin);
     fin.seekg(0, fin.end);
-    int nBytes = fin.tellg();
+    int64_t nBytes = fin.tellg();
     fin.seekg(0, fin.beg);
     std::vector<int> offsets(nBytes / sizeof(int));
     fin.read(reinterpret_cast<char*>(offsets.data()), nBytes);
@@ -75,7 +75,7 @@ std::vector<int> HistDomainReaderManyFiles::readBinIds()
     std::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
     assert(fin);
     fin.seekg(0, fin.end);
-    int nBytes = fin.tellg();
+    int64_t nBytes = fin.tellg();
     fin.seekg(0, fin.beg);
     std::vector<int> ids(nBytes / sizeof(int));
     fin.read(reinterpret_cast<char*>(ids.data()), nBytes);
@@ -88,7 +88,7 @@ std::vector<double> HistDomainReaderManyFiles::readValues()
     std::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
     assert(fin);
     fin.seekg(0, fin.end);
-    int nBytes = fin.tellg();
+    int64_t nBytes = fin.tellg();
     fin.seekg(0, fin.beg);
     std::vector<double> values(nBytes / sizeof(double));
     fin.read(reinterpret_cast<char*>(values.data()), nBytes);
@@ -112,6 +112,18 @@ bool HistMetaReader::readFrom(std::istream& fin) {
     return true;
 }
 
+HistHelper HistMetaReader::helper() const {
+    HistHelper histHelper;
+    histHelper.n_vx = ngridx;
+    histHelper.n_vy = ngridy;
+    histHelper.n_vz = ngridz;
+    histHelper.nh_x = nhistx;
+    histHelper.nh_y = nhisty;
+    histHelper.nh_z = nhistz;
+    histHelper.N_HIST = nhistx * nhisty * nhistz;
+    return histHelper;
+}
+
 void HistReaderPacked::readFrom(std::istream& fin, int ndim,
         std::vector<double> logbases, std::vector<std::string> vars) {
     int issparse, nnonemptybins;
@@ -125,7 +137,7 @@ void HistReaderPacked::readFrom(std::istream& fin, int ndim,
     fin.read(reinterpret_cast<char*>(nbins.data()), sizeof(int) * ndim);
     fin.read(reinterpret_cast<char*>(&percentinrange), sizeof(double));
     fin.read(reinterpret_cast<char*>(&nnonemptybins), sizeof(int));
-    int bufferSize = -1;
+    int64_t bufferSize = -1;
     if (issparse == 1) {
         bufferSize = 2 * nnonemptybins;
     } else {
@@ -140,6 +152,24 @@ void HistReaderPacked::readFrom(std::istream& fin, int ndim,
     hist = std::shared_ptr<Hist>(
             Hist::fromBuffer(issparse == 1, ndim, nbins, mins, maxs, logbases,
                 vars, buffer));
+    hist->setPercentInRange(percentinrange);
+}
+
+void HistReaderPacked::skipFrom(std::istream& fin, int ndim) {
+    int issparse, nnonemptybins;
+    std::vector<int> nbins(ndim);
+    fin.read(reinterpret_cast<char*>(&issparse), sizeof(int));
+    fin.seekg(2 * sizeof(double) * ndim, std::ios::cur);
+    fin.read(reinterpret_cast<char*>(nbins.data()), sizeof(int) * ndim);
+    fin.seekg(sizeof(double), std::ios::cur);
+    fin.read(reinterpret_cast<char*>(&nnonemptybins), sizeof(int));
+    int64_t bufferSize = 2 * nnonemptybins;
+    if (issparse != 1) {
+        bufferSize = 1;
+        for (auto i = 0; i < ndim; ++i)
+            bufferSize *= nbins[i];
+    }
+    fin.seekg(bufferSize * sizeof(int), std::ios::cur);
 }
 
 /**
@@ -155,13 +185,7 @@ void HistDomainReaderPacked::read(
 
     HistMetaReader meta;
     meta.readFrom(fin);
-    histHelper.n_vx = meta.ngridx;
-    histHelper.n_vy = meta.ngridy;
-    histHelper.n_vz = meta.ngridz;
-    histHelper.nh_x = meta.nhistx;
-    histHelper.nh_y = meta.nhisty;
-    histHelper.nh_z = meta.nhistz;
-    histHelper.N_HIST = meta.nhistx * meta.nhisty * meta.nhistz;
+    histHelper = meta.helper();
 
     /// TODO: take care the last newline in the histogram.in file.
     hists.resize(histHelper.N_HIST);
@@ -179,21 +203,11 @@ void HistDomainReaderPacked::read(
 std::vector<std::shared_ptr<HistDomain>> HistYColumnReader::read() const
 {
     std::vector<std::shared_ptr<HistDomain>> histDomains;
-    auto filename = m_dir + "/pdfs-ycolumn-" + m_name + "." + m_iYColumnStr;
-    std::ifstream fin(filename, std::ios::binary);
+    std::ifstream fin(filename(), std::ios::binary);
     assert(fin);
-    while (fin) {
-        // domain meta
-        HistMetaReader meta;
-        meta.readFrom(fin);
-        HistHelper histHelper;
-        histHelper.n_vx = meta.ngridx;
-        histHelper.n_vy = meta.ngridy;
-        histHelper.n_vz = meta.ngridz;
-        histHelper.nh_x = meta.nhistx;
-        histHelper.nh_y = meta.nhisty;
-        histHelper.nh_z = meta.nhistz;
-        histHelper.N_HIST = meta.nhistx * meta.nhisty * meta.nhistz;
+    HistMetaReader meta;
+    while (meta.readFrom(fin)) {
+        HistHelper histHelper = meta.helper();
         // loop to read each histograms
         std::vector<std::shared_ptr<Hist>> hists(histHelper.N_HIST);
         for (int iHist = 0; iHist < histHelper.N_HIST; ++iHist) {
@@ -208,36 +222,36 @@ std::vector<std::shared_ptr<HistDomain>> HistYColumnReader::read() const
     return histDomains;
 }
 
-/**
- * @brief HistFacadeYColumnReader::read
- * @return
- */
-std::vector<std::shared_ptr<HistFacadeDomain>>
-        HistFacadeYColumnReader::read() const {
-    std::vector<std::shared_ptr<HistFacadeDomain>> histDomains;
-    auto filename = m_dir + "/pdfs-ycolumn-" + m_name + "." + m_iYColumnStr;
+std::shared_ptr<const HistColumnIndex> HistYColumnReader::index() const {
+    if (!m_index)
+        m_index = HistColumnIndex::open(filename());
+    return m_index;
+}
+
+std::shared_ptr<HistDomain> HistYColumnReader::readDomain(int iDomain) const {
+    assert(index() && iDomain < index()->nDomains());
+    std::ifstream fin(filename(), std::ios::binary);
+    fin.seekg(index()->domainOffset(iDomain));
     HistMetaReader meta;
-    std::ifstream fin(filename, std::ios::binary);
-    assert(fin);
-    while (meta.readFrom(fin)) {
-        HistHelper histHelper;
-        histHelper.n_vx = meta.ngridx;
-        histHelper.n_vy = meta.ngridy;
-        histHelper.n_vz = meta.ngridz;
-        histHelper.nh_x = meta.nhistx;
-        histHelper.nh_y = meta.nhisty;
-        histHelper.nh_z = meta.nhistz;
-        histHelper.N_HIST = meta.nhistx * meta.nhisty * meta.nhistz;
-        // loop to read each histograms
-        std::vector<std::shared_ptr<HistFacade>> hists(histHelper.N_HIST);
-        for (int iHist = 0; iHist < histHelper.N_HIST; ++iHist) {
-            HistReaderPacked histReader;
-            histReader.readFrom(fin, meta.ndim, meta.logbases, m_vars);
-            hists[iHist] = HistFacade::create(histReader.hist, m_vars);
-        }
-        // construct the hist domain
-        auto histDomain = std::make_shared<HistFacadeDomain>(histHelper, hists);
-        histDomains.push_back(histDomain);
+    meta.readFrom(fin);
+    HistHelper histHelper = meta.helper();
+    std::vector<std::shared_ptr<Hist>> hists(histHelper.N_HIST);
+    for (int iHist = 0; iHist < histHelper.N_HIST; ++iHist) {
+        HistReaderPacked histReader;
+        histReader.readFrom(fin, meta.ndim, meta.logbases, m_vars);
+        hists[iHist] = histReader.hist;
     }
-    return histDomains;
+    return std::make_shared<HistDomain>(histHelper, hists);
+}
+
+std::shared_ptr<Hist> HistYColumnReader::readHist(int iDomain, int iHist) const {
+    assert(index() && iDomain < index()->nDomains());
+    std::ifstream fin(filename(), std::ios::binary);
+    fin.seekg(index()->domainOffset(iDomain));
+    HistMetaReader meta;
+    meta.readFrom(fin);
+    fin.seekg(index()->histOffset(iDomain, iHist));
+    HistReaderPacked histReader;
+    histReader.readFrom(fin, meta.ndim, meta.logbases, m_vars);
+    return histReader.hist;
 }
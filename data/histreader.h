@@ -9,10 +9,12 @@ struct HistHelper;
 class Hist;
 class HistDomain;
 class HistFacadeDomain;
+class HistColumnIndex;
 
 class HistMetaReader {
 public:
     bool readFrom(std::istream& fin);
+    HistHelper helper() const;
 
 public:
     int ndim = -1, ngridx, ngridy, ngridz, nhistx, nhisty, nhistz;
@@ -23,6 +25,8 @@ class HistReaderPacked {
 public:
     void readFrom(std::istream& fin, int ndim, std::vector<double> logbases,
             std::vector<std::string> vars);
+    /// Moves fin past a record without decoding its bins.
+    static void skipFrom(std::istream& fin, int ndim);
 
 public:
     std::shared_ptr<Hist> hist;
@@ -77,6 +81,9 @@ private:
 
 /**
  * @brief The HistYColumnReader class
+ * read() parses the whole file, while readDomain() and readHist() seek
+ * straight to their data through the sidecar index, which is built on the
+ * first of them.
  */
 class HistYColumnReader {
 public:
@@ -88,11 +95,18 @@ public:
     virtual ~HistYColumnReader() {}
 
 public:
+    std::string filename() const {
+        return m_dir + "/pdfs-ycolumn-" + m_name + "." + m_iYColumnStr;
+    }
     std::vector<std::shared_ptr<HistDomain>> read() const;
+    std::shared_ptr<const HistColumnIndex> index() const;
+    std::shared_ptr<HistDomain> readDomain(int iDomain) const;
+    std::shared_ptr<Hist> readHist(int iDomain, int iHist) const;
 
 private:
     std::string m_dir, m_name, m_iYColumnStr;
     std::vector<std::string> m_vars;
+    mutable std::shared_ptr<const HistColumnIndex> m_index;
 };
 
 /**
@@ -106,11 +120,17 @@ public:
       : m_dir(dir), m_name(name), m_iYColumnStr(iYColumnStr), m_vars(vars) {}
 
 public:
+    std::string filename() const {
+        return m_dir + "/pdfs-ycolumn-" + m_name + "." + m_iYColumnStr;
+    }
     std::vector<std::shared_ptr<HistFacadeDomain>> read() const;
+    std::shared_ptr<const HistColumnIndex> index() const;
+    std::shared_ptr<HistFacadeDomain> readDomain(int iDomain) const;
 
 private:
     std::string m_dir, m_name, m_iYColumnStr;
     std::vector<std::string> m_vars;
+    mutable std::shared_ptr<const HistColumnIndex> m_index;
 };
 
 #endif // HISTREADER_H
@@ -0,0 +1,187 @@
+#include "histvolumestats.h"
+#include <algorithm>
+#include <limits>
+#include <unistd.h>
+#include "directory.h"
+#include "histcontainer.h"
+#include "histreader.h"
+
+namespace {
+
+const int statsLogMagic = 0x54534c54; // "TLST"
+const int statsLogVersion = 2;
+
+template <typename T>
+void writeRaw(std::ostream& out, const T* data, int64_t count) {
+    out.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+bool startsWith(const std::string& str, const std::string& prefix) {
+    return 0 == str.compare(0, prefix.size(), prefix);
+}
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size()
+            && 0 == str.compare(str.size() - suffix.size(), suffix.size(),
+                suffix);
+}
+
+// every domain in a packed file, one histogram after the other
+void scanPackedFile(const std::string& path,
+        const std::vector<std::string>& vars, HistVolumeStats* stats) {
+    std::ifstream fin(path, std::ios::binary);
+    HistMetaReader meta;
+    while (meta.readFrom(fin)) {
+        int nHist = meta.nhistx * meta.nhisty * meta.nhistz;
+        for (int iHist = 0; iHist < nHist; ++iHist) {
+            HistReaderPacked histReader;
+            histReader.readFrom(fin, meta.ndim, meta.logbases, vars);
+            stats->add(histReader.hist->means());
+        }
+    }
+}
+
+} // anonymous namespace
+
+HistVolumeStats::HistVolumeStats(int nVars)
+  : _sums(nVars, 0.0)
+  , _mins(nVars, std::numeric_limits<float>::max())
+  , _maxs(nVars, std::numeric_limits<float>::lowest())
+  , _nNonEmptyHists(0) {}
+
+bool HistVolumeStats::scan(const std::string& dir, const std::string& name,
+        const std::vector<std::string>& vars, HistVolumeStats* stats) {
+    *stats = HistVolumeStats(vars.size());
+    std::string containerPath = HistContainerReader::filename(dir, name);
+    if (std::ifstream(containerPath).good()) {
+        HistContainerReader container(containerPath, vars);
+        if (container.good()) {
+            for (const auto& summary : container.summaries())
+                stats->add(summary.means);
+            return true;
+        }
+    }
+    // the y columns and the multiblock blocks share a prefix, the domain
+    // files have another one, and their order does not matter to the stats
+    std::vector<std::string> paths;
+    for (const auto& entry : entryNamesInDirectory(dir)) {
+        if (endsWith(entry, ".idx"))
+            continue;
+        if (startsWith(entry, "pdfs-ycolumn-" + name + ".")
+                || startsWith(entry, "pdfs-" + name + ".")) {
+            paths.push_back(dir + "/" + entry);
+        }
+    }
+    for (const auto& path : paths)
+        scanPackedFile(path, vars, stats);
+    return !paths.empty();
+}
+
+void HistVolumeStats::add(const std::vector<float>& histMeans) {
+    if (histMeans.empty())
+        return;
+    ++_nNonEmptyHists;
+    for (int iVar = 0; iVar < nVars(); ++iVar) {
+        _sums[iVar] += histMeans[iVar];
+        _mins[iVar] = std::min(_mins[iVar], histMeans[iVar]);
+        _maxs[iVar] = std::max(_maxs[iVar], histMeans[iVar]);
+    }
+}
+
+void HistVolumeStats::merge(const HistVolumeStats& other) {
+    _nNonEmptyHists += other._nNonEmptyHists;
+    for (int iVar = 0; iVar < nVars(); ++iVar) {
+        _sums[iVar] += other._sums[iVar];
+        _mins[iVar] = std::min(_mins[iVar], other._mins[iVar]);
+        _maxs[iVar] = std::max(_maxs[iVar], other._maxs[iVar]);
+    }
+}
+
+std::vector<float> HistVolumeStats::means() const {
+    std::vector<float> means(nVars());
+    for (int iVar = 0; iVar < nVars(); ++iVar)
+        means[iVar] = float(_sums[iVar] / _nNonEmptyHists);
+    return means;
+}
+
+/**
+ * @brief HistStatsLog::HistStatsLog reads the records of path and opens it
+ * for appending, starting the file over when it is not a stats log.
+ * @param path
+ */
+HistStatsLog::HistStatsLog(const std::string& path) {
+    int64_t validSize = 0;
+    {
+        std::ifstream fin(path, std::ios::binary | std::ios::ate);
+        int64_t fileSize = fin ? int64_t(fin.tellg()) : 0;
+        fin.seekg(0);
+        int header[2] = { 0, 0 };
+        readRaw(fin, header, 2);
+        if (fin && statsLogMagic == header[0]
+                && statsLogVersion == header[1]) {
+            validSize = fin.tellg();
+            Record record;
+            int nameLength, nVars;
+            // the lengths are bounded by what is left of the file, so a
+            // corrupt one cannot allocate more than that
+            auto remaining = [&]() { return fileSize - int64_t(fin.tellg()); };
+            for (;;) {
+                readRaw(fin, &record.step, 1);
+                readRaw(fin, &nameLength, 1);
+                if (!fin || nameLength < 0 || remaining() < nameLength)
+                    break;
+                record.name.resize(nameLength);
+                readRaw(fin, &record.name[0], nameLength);
+                readRaw(fin, &record.source.size, 1);
+                readRaw(fin, &record.source.mtime, 1);
+                readRaw(fin, &nVars, 1);
+                if (!fin || nVars < 0
+                        || remaining() < 3 * int64_t(sizeof(float)) * nVars)
+                    break;
+                record.means.resize(nVars);
+                record.mins.resize(nVars);
+                record.maxs.resize(nVars);
+                readRaw(fin, record.means.data(), nVars);
+                readRaw(fin, record.mins.data(), nVars);
+                readRaw(fin, record.maxs.data(), nVars);
+                if (!fin)
+                    break;
+                _records.push_back(record);
+                validSize = fin.tellg();
+            }
+        }
+    }
+    if (0 == validSize) {
+        _fout.open(path, std::ios::binary | std::ios::trunc);
+        int header[2] = { statsLogMagic, statsLogVersion };
+        writeRaw(_fout, header, 2);
+        _fout.flush();
+        return;
+    }
+    // drop what an interrupted append left behind
+    if (0 != truncate(path.c_str(), validSize))
+        return;
+    _fout.open(path, std::ios::binary | std::ios::app);
+}
+
+bool HistStatsLog::append(const Record& record) {
+    int nameLength = record.name.size();
+    int nVars = record.means.size();
+    writeRaw(_fout, &record.step, 1);
+    writeRaw(_fout, &nameLength, 1);
+    writeRaw(_fout, record.name.data(), nameLength);
+    writeRaw(_fout, &record.source.size, 1);
+    writeRaw(_fout, &record.source.mtime, 1);
+    writeRaw(_fout, &nVars, 1);
+    writeRaw(_fout, record.means.data(), nVars);
+    writeRaw(_fout, record.mins.data(), nVars);
+    writeRaw(_fout, record.maxs.data(), nVars);
+    _fout.flush();
+    _records.push_back(record);
+    return bool(_fout);
+}
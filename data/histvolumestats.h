@@ -0,0 +1,75 @@
+#ifndef HISTVOLUMESTATS_H
+#define HISTVOLUMESTATS_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "fileio.h"
+
+/**
+ * @brief The HistVolumeStats class accumulates the means of the histograms of
+ * a volume into their average and range per variable, as the timeline shows
+ * them. Partial stats of parts of a volume merge into those of the whole.
+ */
+class HistVolumeStats {
+public:
+    explicit HistVolumeStats(int nVars = 0);
+    /// Stats of the volume name in dir parsed in one pass over its files,
+    /// the footer of the indexed container or the packed domain, y-column
+    /// and multiblock files, without keeping any histogram. False when the
+    /// volume is in none of these layouts.
+    static bool scan(const std::string& dir, const std::string& name,
+            const std::vector<std::string>& vars, HistVolumeStats* stats);
+
+public:
+    /// The means of one histogram, empty for an empty histogram.
+    void add(const std::vector<float>& histMeans);
+    void merge(const HistVolumeStats& other);
+    int nVars() const { return int(_mins.size()); }
+    int nNonEmptyHists() const { return _nNonEmptyHists; }
+    std::vector<float> means() const;
+    const std::vector<float>& mins() const { return _mins; }
+    const std::vector<float>& maxs() const { return _maxs; }
+
+private:
+    std::vector<double> _sums;
+    std::vector<float> _mins, _maxs;
+    int _nNonEmptyHists;
+};
+
+/**
+ * @brief The HistStatsLog class is the append-only file of the stats of the
+ * volumes of a dataset, one record per step and config:
+ *
+ *   header:  int magic, version
+ *   records: int step, int namelength, char name[namelength],
+ *            int64 source size, source mtime, int nvars,
+ *            float means[nvars], mins[nvars], maxs[nvars]
+ *
+ * Every record is flushed as it is appended, so an interrupted computation
+ * resumes from the records on disk. A torn last record is dropped on open,
+ * and so is everything from a record whose lengths run past the end of the
+ * file. The source is the step directory the stats were computed from, and
+ * a record whose source has changed since is stale.
+ */
+class HistStatsLog {
+public:
+    struct Record {
+        int step;
+        std::string name;
+        FileStamp source;
+        std::vector<float> means, mins, maxs;
+    };
+    explicit HistStatsLog(const std::string& path);
+
+public:
+    bool good() const { return bool(_fout); }
+    const std::vector<Record>& records() const { return _records; }
+    bool append(const Record& record);
+
+private:
+    std::vector<Record> _records;
+    std::ofstream _fout;
+};
+
+#endif // HISTVOLUMESTATS_H
@@ -0,0 +1,72 @@
+#include "mortonorder.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+void MortonOrder::bounds(const std::vector<float> &xyzs, float lower[3],
+        float upper[3]) {
+    for (int iDim = 0; iDim < 3; ++iDim) {
+        lower[iDim] = std::numeric_limits<float>::max();
+        upper[iDim] = std::numeric_limits<float>::lowest();
+    }
+    for (size_t i = 0; i + 2 < xyzs.size(); i += 3) {
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            lower[iDim] = std::min(xyzs[i + iDim], lower[iDim]);
+            upper[iDim] = std::max(xyzs[i + iDim], upper[iDim]);
+        }
+    }
+}
+
+std::vector<uint64_t> MortonOrder::codes(const std::vector<float> &xyzs,
+        const float lower[3], const float upper[3]) {
+    const double maxCell = double((1u << bitsPerDim) - 1);
+    double scales[3];
+    for (int iDim = 0; iDim < 3; ++iDim) {
+        double extent = double(upper[iDim]) - double(lower[iDim]);
+        scales[iDim] = 0.0 < extent ? maxCell / extent : 0.0;
+    }
+    std::vector<uint64_t> codes(xyzs.size() / 3);
+    for (size_t i = 0; i < codes.size(); ++i) {
+        uint32_t cells[3];
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            double cell = (xyzs[3 * i + iDim] - lower[iDim]) * scales[iDim];
+            cells[iDim] = uint32_t(std::min(std::max(cell, 0.0), maxCell));
+        }
+        codes[i] = encode(cells[0], cells[1], cells[2]);
+    }
+    return codes;
+}
+
+std::vector<int64_t> MortonOrder::sorted(const std::vector<float> &xyzs) {
+    float lower[3], upper[3];
+    bounds(xyzs, lower, upper);
+    auto keys = codes(xyzs, lower, upper);
+    std::vector<std::pair<uint64_t, int64_t>> pairs(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        pairs[i] = std::make_pair(keys[i], int64_t(i));
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<int64_t> order(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i)
+        order[i] = pairs[i].second;
+    return order;
+}
+
+std::vector<int64_t> MortonOrder::stratified(const std::vector<float> &xyzs) {
+    auto order = sorted(xyzs);
+    int64_t n = order.size();
+    int nBits = 0;
+    while ((int64_t(1) << nBits) < n)
+        ++nBits;
+    std::vector<int64_t> strata;
+    strata.reserve(n);
+    for (int64_t rank = 0; rank < (int64_t(1) << nBits); ++rank) {
+        int64_t reversed = 0;
+        for (int iBit = 0; iBit < nBits; ++iBit) {
+            if (rank & (int64_t(1) << iBit))
+                reversed |= int64_t(1) << (nBits - 1 - iBit);
+        }
+        if (reversed < n)
+            strata.push_back(order[reversed]);
+    }
+    return strata;
+}
@@ -0,0 +1,58 @@
+#ifndef MORTONORDER_H
+#define MORTONORDER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The MortonOrder class orders locations along the Morton (z-order)
+ * curve, which interleaves the bits of the quantized coordinates, so
+ * locations close along the curve are close in space. The locations are
+ * interleaved xyz.
+ */
+class MortonOrder {
+public:
+    static const int bitsPerDim = 21;
+    /// Interleaves the lower 21 bits of x, y and z, x lowest.
+    static uint64_t encode(uint32_t x, uint32_t y, uint32_t z) {
+        return spread(x) | spread(y) << 1 | spread(z) << 2;
+    }
+    static void decode(uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z) {
+        x = compact(code);
+        y = compact(code >> 1);
+        z = compact(code >> 2);
+    }
+    /// The bounding box of the locations.
+    static void bounds(const std::vector<float>& xyzs, float lower[3],
+            float upper[3]);
+    /// The codes of the locations quantized within [lower, upper].
+    static std::vector<uint64_t> codes(const std::vector<float>& xyzs,
+            const float lower[3], const float upper[3]);
+    /// The indices of the locations along the curve in their bounding box.
+    static std::vector<int64_t> sorted(const std::vector<float>& xyzs);
+    /// The sorted indices visited in bit-reversed rank: any prefix of them is
+    /// spread evenly over the curve, hence over space.
+    static std::vector<int64_t> stratified(const std::vector<float>& xyzs);
+
+private:
+    static uint64_t spread(uint32_t v) {
+        uint64_t x = v & 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffull;
+        x = (x | x << 16) & 0x1f0000ff0000ffull;
+        x = (x | x << 8) & 0x100f00f00f00f00full;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+        x = (x | x << 2) & 0x1249249249249249ull;
+        return x;
+    }
+    static uint32_t compact(uint64_t x) {
+        x &= 0x1249249249249249ull;
+        x = (x | x >> 2) & 0x10c30c30c30c30c3ull;
+        x = (x | x >> 4) & 0x100f00f00f00f00full;
+        x = (x | x >> 8) & 0x1f0000ff0000ffull;
+        x = (x | x >> 16) & 0x1f00000000ffffull;
+        x = (x | x >> 32) & 0x1fffff;
+        return uint32_t(x);
+    }
+};
+
+#endif // MORTONORDER_H
@@ -50,7 +50,7 @@ public:
 public:
     Extent nDomains() const { return _nDomains; }
     int totalDomainCount() const { return _nDomains.nElement(); }
-    int totalGridPtCount() const { return _nGridPts.nElement(); }
+    int64_t totalGridPtCount() const { return _nGridPts.nElement(); }
     const Extent& nGridPts() const { return _nGridPts; }
     yy::ivec3 lowerCorner() const { return _lowerCorner; }
     BoundingBox<float> physicalBoundingBox() const {
@@ -100,7 +100,7 @@ public:
         assert(false);
         return -1;
     }
-    int blockGridPtCount(int iBlock) const {
+    int64_t blockGridPtCount(int iBlock) const {
         return _blockSpecs[iBlock].totalGridPtCount();
     }
     yy::ivec3 blockDimensions(int iBlock) const {
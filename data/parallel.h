@@ -0,0 +1,77 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// The threads to run on for nThreads, one per core when it is 0 or less.
+inline int threadCount(int nThreads) {
+    return 0 < nThreads
+            ? nThreads : int(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+/// Runs work(i) for every i in [0, n) on at most nThreads threads, one per
+/// core for 0, the calling one among them. The items are handed out one at a
+/// time, so items of uneven cost balance over the threads.
+template <typename Work>
+void parallelFor(int64_t n, int nThreads, Work work) {
+    nThreads = int(std::max<int64_t>(1,
+            std::min<int64_t>(n, threadCount(nThreads))));
+    std::atomic<int64_t> next(0);
+    auto run = [&]() {
+        for (int64_t i = next++; i < n; i = next++)
+            work(i);
+    };
+    std::vector<std::thread> threads;
+    for (int iThread = 1; iThread < nThreads; ++iThread)
+        threads.emplace_back(run);
+    run();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/// Splits [0, nItems) into contiguous chunks, one per thread of at most
+/// nThreads, folds each chunk into its own copy of init, and then combines
+/// the partial results pairwise in a tree so no accumulator is ever shared
+/// between threads.
+template <typename T, typename Fold, typename Combine>
+T parallelReduce(int64_t nItems, int nThreads, const T& init, Fold fold,
+        Combine combine) {
+    nThreads = int(std::max<int64_t>(1,
+            std::min<int64_t>(nItems, threadCount(nThreads))));
+    std::vector<T> partials(nThreads, init);
+    if (1 == nThreads) {
+        for (int64_t iItem = 0; iItem < nItems; ++iItem)
+            fold(partials[0], iItem);
+        return partials[0];
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads);
+    for (int iThread = 0; iThread < nThreads; ++iThread) {
+        int64_t beg = nItems * iThread / nThreads;
+        int64_t end = nItems * (iThread + 1) / nThreads;
+        threads.emplace_back([&partials, &fold, iThread, beg, end]() {
+            for (int64_t iItem = beg; iItem < end; ++iItem)
+                fold(partials[iThread], iItem);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (int stride = 1; stride < nThreads; stride *= 2) {
+        threads.clear();
+        for (int iThread = 0; iThread + stride < nThreads;
+                iThread += 2 * stride) {
+            threads.emplace_back([&partials, &combine, iThread, stride]() {
+                combine(partials[iThread], partials[iThread + stride]);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+    return partials[0];
+}
+
+#endif // PARALLEL_H
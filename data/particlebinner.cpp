@@ -0,0 +1,140 @@
+#include "particlebinner.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include "parallel.h"
+
+namespace {
+
+// the particles binned at once, small enough for the bin ids of a chunk to
+// stay in the cache.
+const int64_t chunkSize = 4096;
+
+} // anonymous namespace
+
+std::string ParticleBinner::name(Variable var) {
+    static const char* names[] = {
+        "x", "y", "z", "T", "u", "v", "w", "mixfrac"
+    };
+    return names[var];
+}
+
+const float* ParticleBinner::values(const ParticleColumns &particles,
+        Variable var, int *stride) {
+    if (TEMP == var || MIXFRAC == var) {
+        const auto& column =
+                TEMP == var ? particles.temps() : particles.mixfracs();
+        *stride = 1;
+        return column.empty() ? nullptr : column.data();
+    }
+    if (U <= var) {
+        *stride = 3;
+        return particles.vels().empty()
+                ? nullptr : particles.vels().data() + int(var - U);
+    }
+    const auto& xyzs = particles.has(ParticleColumns::XLOC)
+            ? particles.xlocs() : particles.locs();
+    *stride = 3;
+    return xyzs.empty() ? nullptr : xyzs.data() + int(var);
+}
+
+ParticleBinner::Axis ParticleBinner::fit(const ParticleColumns &particles,
+        Variable var, int nBins) {
+    int stride = 1;
+    const float* column = values(particles, var, &stride);
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    for (int64_t i = 0; column && i < particles.size(); ++i) {
+        min = std::min(column[stride * i], min);
+        max = std::max(column[stride * i], max);
+    }
+    if (max < min)
+        min = max = 0.f;
+    return { var, nBins, min, max };
+}
+
+ParticleBinner::ParticleBinner(const std::vector<Axis> &axes, int nThreads)
+  : _axes(axes)
+  , _nThreads(threadCount(nThreads)) {
+    assert(1 <= _axes.size() && _axes.size() <= 3);
+}
+
+std::vector<float> ParticleBinner::counts(
+        const ParticleColumns &particles) const {
+    int64_t nBins = 1;
+    for (const auto& axis : _axes)
+        nBins *= axis.nBins;
+    // the last bin is the spare one of the particles out of range.
+    const int32_t spare = int32_t(nBins);
+    std::vector<const float*> columns;
+    std::vector<int> strides(_axes.size());
+    for (size_t iAxis = 0; iAxis < _axes.size(); ++iAxis) {
+        columns.push_back(
+                values(particles, _axes[iAxis].var, &strides[iAxis]));
+    }
+    int64_t nChunks = (particles.size() + chunkSize - 1) / chunkSize;
+    // the counts of the chunks of a thread, with the bins of the current one
+    struct Partial {
+        std::vector<int64_t> counts;
+        std::vector<int32_t> flats, outs;
+    };
+    Partial init;
+    init.counts.assign(nBins + 1, 0);
+    auto total = parallelReduce(nChunks, _nThreads, init,
+            [&](Partial& partial, int64_t iChunk) {
+        auto& flats = partial.flats;
+        auto& outs = partial.outs;
+        int64_t begin = iChunk * chunkSize;
+        int n = int(std::min(chunkSize, particles.size() - begin));
+        flats.assign(n, 0);
+        outs.assign(n, 0);
+        int32_t binStride = 1;
+        for (size_t iAxis = 0; iAxis < _axes.size(); ++iAxis) {
+            const Axis& axis = _axes[iAxis];
+            if (!columns[iAxis]) {
+                std::fill(outs.begin(), outs.end(), 1);
+                break;
+            }
+            const int stride = strides[iAxis];
+            const float* column = columns[iAxis] + stride * begin;
+            const float lo = float(axis.min), hi = float(axis.max);
+            const float scale = axis.max > axis.min
+                    ? float(axis.nBins / (axis.max - axis.min)) : 0.f;
+            const float last = float(axis.nBins - 1);
+            // no branches, so the loop vectorizes. The comparisons are
+            // false for NaN, which leaves it out of range.
+            for (int i = 0; i < n; ++i) {
+                float value = column[stride * i];
+                float t = std::min(last, std::max(0.f, (value - lo) * scale));
+                flats[i] += int32_t(t) * binStride;
+                outs[i] |= int32_t(!(value >= lo)) | int32_t(!(value <= hi));
+            }
+            binStride *= axis.nBins;
+        }
+        for (int i = 0; i < n; ++i)
+            ++partial.counts[outs[i] ? spare : flats[i]];
+    }, [](Partial& a, const Partial& b) {
+        for (size_t iBin = 0; iBin < a.counts.size(); ++iBin)
+            a.counts[iBin] += b.counts[iBin];
+    });
+    std::vector<float> values(nBins);
+    for (int64_t iBin = 0; iBin < nBins; ++iBin)
+        values[iBin] = float(total.counts[iBin]);
+    return values;
+}
+
+std::shared_ptr<Hist> ParticleBinner::bin(
+        const ParticleColumns &particles) const {
+    int nDim = int(_axes.size());
+    std::vector<int> nBins;
+    std::vector<double> mins, maxs, logBases(nDim, 0.0);
+    std::vector<std::string> vars;
+    for (const auto& axis : _axes) {
+        nBins.push_back(axis.nBins);
+        mins.push_back(axis.min);
+        maxs.push_back(axis.max);
+        vars.push_back(name(axis.var));
+    }
+    return std::shared_ptr<Hist>(Hist::fromDenseValues(nDim, nBins, mins,
+            maxs, logBases, vars, counts(particles)));
+}
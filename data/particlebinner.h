@@ -0,0 +1,60 @@
+#ifndef PARTICLEBINNER_H
+#define PARTICLEBINNER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Histogram.h"
+#include "particlecolumns.h"
+
+/**
+ * @brief The ParticleBinner class recomputes the PDF of particles over one,
+ * two or three of their attributes, at any resolution and range, so a PDF
+ * is not limited to the ones the simulation wrote. The particles can be any
+ * selection or region, such as the ones of ParticleCache::particles() or
+ * ParticleBlockIndex::read(), or a whole step a batch at a time as the
+ * particlebin tool does.
+ *
+ * The particles are split in chunks binned on a pool of threads, each thread
+ * counting into its own partial histogram, and the partial histograms are
+ * summed pairwise at the end. Within a chunk the bin of every particle is
+ * computed axis by axis in branch-free loops the compiler vectorizes, the
+ * particles out of range falling into a spare bin, before the counts are
+ * scattered.
+ */
+class ParticleBinner {
+public:
+    /// The locations are the ones of xloc when held, of loc otherwise, and
+    /// U, V and W the velocity components.
+    enum Variable { X, Y, Z, TEMP, U, V, W, MIXFRAC };
+    /// The values in [min, max] are counted in nBins equal bins, the others
+    /// are left out.
+    struct Axis {
+        Variable var;
+        int nBins;
+        double min, max;
+    };
+    static std::string name(Variable var);
+    /// The values of var in particles, stride floats apart, or nullptr when
+    /// the particles do not hold them.
+    static const float* values(const ParticleColumns& particles,
+            Variable var, int* stride);
+    /// The axis of nBins bins over the whole range of var in particles.
+    static Axis fit(const ParticleColumns& particles, Variable var, int nBins);
+
+public:
+    explicit ParticleBinner(const std::vector<Axis>& axes, int nThreads = 0);
+
+public:
+    const std::vector<Axis>& axes() const { return _axes; }
+    /// The number of particles in every bin, the first axis fastest.
+    std::vector<float> counts(const ParticleColumns& particles) const;
+    /// The dense histogram of the particles, named like the loaded ones.
+    std::shared_ptr<Hist> bin(const ParticleColumns& particles) const;
+
+private:
+    std::vector<Axis> _axes;
+    int _nThreads;
+};
+
+#endif // PARTICLEBINNER_H
@@ -0,0 +1,479 @@
+#include "particleblockindex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mortonorder.h"
+
+namespace {
+
+const int blockIndexMagic = 0x4b4c4250; // "PBLK"
+const int blockIndexVersion = 2;
+// the particles apart by at most as many are read at once by readAt()
+const int64_t maxGap = 256;
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+int64_t headerBytes() {
+    return 4 * sizeof(int) + 4 * sizeof(int64_t) + 6 * sizeof(float);
+}
+
+int64_t blockBytes() {
+    return sizeof(uint64_t) + 2 * sizeof(int64_t);
+}
+
+/// The block of a location along every dimension.
+void blockOf(const float* loc, const float lower[3], const float upper[3],
+        int level, uint32_t cells[3]) {
+    const int nCells = 1 << level;
+    for (int iDim = 0; iDim < 3; ++iDim) {
+        double extent = double(upper[iDim]) - double(lower[iDim]);
+        double cell = 0.0 < extent
+                ? std::floor((loc[iDim] - lower[iDim]) / extent * nCells) : 0.0;
+        cells[iDim] = uint32_t(std::min(std::max(cell, 0.0), nCells - 1.0));
+    }
+}
+
+/// Reads count particles from first of the column starting at start.
+template <typename T>
+bool readColumn(int fd, int64_t start, int nComponents, int64_t first,
+        int64_t count, std::vector<T>& out) {
+    out.resize(nComponents * count);
+    return readAt(fd, out.data(), sizeof(T) * out.size(),
+            start + sizeof(T) * nComponents * first);
+}
+
+/// Writes the n particles of sorted from i on at the position at of the file
+/// with the columns at starts.
+bool writeRun(int fd, const ParticleColumns& sorted, int64_t i, int64_t n,
+        int64_t at, const int64_t starts[4]) {
+    bool ok = true;
+    if (sorted.has(ParticleColumns::SSN))
+        ok = ok && writeAt(fd, &sorted.ssns()[i], sizeof(int64_t) * n,
+                starts[0] + sizeof(int64_t) * at);
+    if (sorted.has(ParticleColumns::LOC))
+        ok = ok && writeAt(fd, &sorted.locs()[3 * i], 3 * sizeof(float) * n,
+                starts[1] + 3 * sizeof(float) * at);
+    if (sorted.has(ParticleColumns::XLOC))
+        ok = ok && writeAt(fd, &sorted.xlocs()[3 * i], 3 * sizeof(float) * n,
+                starts[2] + 3 * sizeof(float) * at);
+    if (sorted.has(ParticleColumns::TEMP))
+        ok = ok && writeAt(fd, &sorted.temps()[i], sizeof(float) * n,
+                starts[3] + sizeof(float) * at);
+    return ok;
+}
+
+bool isTracerFile(const std::string& name) {
+    const char* prefixes[] = { "tracer.", "pdfsortedtracer.", "sorted" };
+    for (auto prefix : prefixes) {
+        if (0 == name.compare(0, strlen(prefix), prefix))
+            return name.size() < 4 || ".tmp" != name.substr(name.size() - 4);
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+ParticleBlockIndex::Source ParticleBlockIndex::sourceOf(
+        const std::string &dir) {
+    return FileStamp::of(dir, isTracerFile);
+}
+
+bool ParticleBlockIndex::write(const std::string &path,
+        const ParticleColumns &particles, const Source &source, int level) {
+    return write(path, [&particles](const BatchCallback& take) {
+        return take(particles);
+    }, source, level);
+}
+
+bool ParticleBlockIndex::write(const std::string &path, const Scan &scan,
+        const Source &source, int level) {
+    if (level < 0 || level > MortonOrder::bitsPerDim)
+        return false;
+    // first pass: the bounds of the physical locations and the attributes.
+    int attributes = -1;
+    int64_t nParticles = 0;
+    float lower[3] = { 0.f, 0.f, 0.f }, upper[3] = { 0.f, 0.f, 0.f };
+    bool scanned = scan([&](const ParticleColumns& batch) {
+        if (attributes < 0)
+            attributes = batch.attributes() & indexedAttributes;
+        if ((batch.attributes() & indexedAttributes) != attributes
+                || !batch.has(ParticleColumns::XLOC))
+            return false;
+        if (batch.empty())
+            return true;
+        float batchLower[3], batchUpper[3];
+        MortonOrder::bounds(batch.xlocs(), batchLower, batchUpper);
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            lower[iDim] = 0 == nParticles
+                    ? batchLower[iDim] : std::min(lower[iDim], batchLower[iDim]);
+            upper[iDim] = 0 == nParticles
+                    ? batchUpper[iDim] : std::max(upper[iDim], batchUpper[iDim]);
+        }
+        nParticles += batch.size();
+        return true;
+    });
+    if (!scanned)
+        return false;
+    // a scan without any batch is an empty step
+    if (attributes < 0)
+        attributes = ParticleColumns::XLOC;
+    auto codesOf = [&](const ParticleColumns& batch) {
+        std::vector<uint64_t> codes(batch.size());
+        for (int64_t i = 0; i < batch.size(); ++i) {
+            uint32_t cells[3];
+            blockOf(&batch.xlocs()[3 * i], lower, upper, level, cells);
+            codes[i] = MortonOrder::encode(cells[0], cells[1], cells[2]);
+        }
+        return codes;
+    };
+
+    // second pass: the particles of every non-empty block, in Morton order.
+    std::map<uint64_t, int64_t> blockCounts;
+    scanned = scan([&](const ParticleColumns& batch) {
+        if ((batch.attributes() & indexedAttributes) != attributes)
+            return false;
+        for (auto code : codesOf(batch))
+            ++blockCounts[code];
+        return true;
+    });
+    if (!scanned)
+        return false;
+    std::vector<int64_t> header(3 * blockCounts.size());
+    std::map<uint64_t, int64_t> cursors;
+    int64_t first = 0;
+    for (const auto& block : blockCounts) {
+        int64_t iBlock = cursors.size();
+        header[3 * iBlock + 0] = int64_t(block.first);
+        header[3 * iBlock + 1] = first;
+        header[3 * iBlock + 2] = block.second;
+        cursors[block.first] = first;
+        first += block.second;
+    }
+    if (first != nParticles)
+        return false;
+    ParticleBlockIndex layout;
+    layout._attributes = attributes;
+    layout._nParticles = nParticles;
+    layout._codes.resize(blockCounts.size());
+    int64_t starts[4];
+    layout.columnStarts(starts);
+    int64_t end = starts[3] + (attributes & ParticleColumns::TEMP
+            ? sizeof(float) * nParticles : 0);
+
+    // third pass: every batch sorted by block and written run by run to
+    // the end of its blocks. Written aside, so an index being read is never
+    // cut short, even as threads index the same step at once.
+    return writeAside(path, [&](const std::string& asidePath) {
+        int fd = ::open(asidePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        int fileHeader[4] = { blockIndexMagic, blockIndexVersion, level,
+                attributes };
+        int64_t fileCounts[4] = { nParticles, int64_t(blockCounts.size()),
+                source.size, source.mtime };
+        float bounds[6] = { lower[0], lower[1], lower[2],
+                upper[0], upper[1], upper[2] };
+        bool ok = writeAt(fd, fileHeader, sizeof(fileHeader), 0)
+                && writeAt(fd, fileCounts, sizeof(fileCounts),
+                    sizeof(fileHeader))
+                && writeAt(fd, bounds, sizeof(bounds),
+                    sizeof(fileHeader) + sizeof(fileCounts))
+                && writeAt(fd, header.data(), header.size() * sizeof(int64_t),
+                    headerBytes())
+                && 0 == ftruncate(fd, end);
+        std::vector<int64_t> order;
+        ok = ok && scan([&](const ParticleColumns& batch) {
+            if ((batch.attributes() & indexedAttributes) != attributes)
+                return false;
+            auto codes = codesOf(batch);
+            order.resize(batch.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                    [&codes](int64_t a, int64_t b) {
+                return codes[a] < codes[b];
+            });
+            ParticleColumns sorted = batch;
+            sorted.permute(order);
+            for (size_t i = 0; i < order.size();) {
+                uint64_t code = codes[order[i]];
+                size_t j = i + 1;
+                while (j < order.size() && code == codes[order[j]])
+                    ++j;
+                auto cursor = cursors.find(code);
+                if (cursors.end() == cursor)
+                    return false;
+                int64_t at = cursor->second, n = j - i;
+                if (!writeRun(fd, sorted, i, n, at, starts))
+                    return false;
+                cursor->second += n;
+                i = j;
+            }
+            return true;
+        });
+        // every block has to be filled by the scan, as counted
+        for (size_t iBlock = 0; iBlock < blockCounts.size() && ok; ++iBlock) {
+            ok = cursors[uint64_t(header[3 * iBlock])]
+                    == header[3 * iBlock + 1] + header[3 * iBlock + 2];
+        }
+        if (0 != close(fd))
+            ok = false;
+        return ok;
+    });
+}
+
+std::shared_ptr<const ParticleBlockIndex> ParticleBlockIndex::open(
+        const std::string &path, const Source &source) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return nullptr;
+    int header[4];
+    int64_t counts[4];
+    readRaw(fin, header, 4);
+    readRaw(fin, counts, 4);
+    if (!fin || blockIndexMagic != header[0]
+            || blockIndexVersion != header[1]
+            || source.size != counts[2] || source.mtime != counts[3]
+            || counts[0] < 0 || counts[1] < 0)
+        return nullptr;
+    auto index = std::make_shared<ParticleBlockIndex>();
+    index->_path = path;
+    index->_level = header[2];
+    index->_attributes = header[3];
+    index->_nParticles = counts[0];
+    index->_source = source;
+    readRaw(fin, index->_lower, 3);
+    readRaw(fin, index->_upper, 3);
+    index->_codes.resize(counts[1]);
+    index->_firsts.resize(counts[1]);
+    index->_counts.resize(counts[1]);
+    for (int64_t iBlock = 0; iBlock < counts[1]; ++iBlock) {
+        readRaw(fin, &index->_codes[iBlock], 1);
+        readRaw(fin, &index->_firsts[iBlock], 1);
+        readRaw(fin, &index->_counts[iBlock], 1);
+    }
+    if (!fin)
+        return nullptr;
+    // the file ends right after the last column
+    int64_t starts[4];
+    index->columnStarts(starts);
+    int64_t end = starts[3] + (index->_attributes & ParticleColumns::TEMP
+            ? sizeof(float) * index->_nParticles : 0);
+    fin.seekg(0, std::ios::end);
+    if (end != int64_t(fin.tellg()))
+        return nullptr;
+    return index;
+}
+
+/**
+ * @brief ParticleBlockIndex::blockBounds
+ * The bounds are widened by a small margin so that rounding never leaves a
+ * particle outside of its block.
+ */
+void ParticleBlockIndex::blockBounds(int iBlock, float lower[3],
+        float upper[3]) const {
+    uint32_t cells[3];
+    MortonOrder::decode(_codes[iBlock], cells[0], cells[1], cells[2]);
+    const int nCells = 1 << _level;
+    for (int iDim = 0; iDim < 3; ++iDim) {
+        double size = (double(_upper[iDim]) - double(_lower[iDim])) / nCells;
+        double margin = 1e-4 * size;
+        lower[iDim] = float(_lower[iDim] + cells[iDim] * size - margin);
+        upper[iDim] = float(_lower[iDim] + (cells[iDim] + 1) * size + margin);
+    }
+}
+
+std::vector<int> ParticleBlockIndex::blocks(
+        const BlockFilter &intersects) const {
+    std::vector<int> ids;
+    for (int iBlock = 0; iBlock < nBlocks(); ++iBlock) {
+        float lower[3], upper[3];
+        blockBounds(iBlock, lower, upper);
+        if (intersects(lower, upper))
+            ids.push_back(iBlock);
+    }
+    return ids;
+}
+
+ParticleColumns ParticleBlockIndex::read(const float lower[3],
+        const float upper[3], int attributes) const {
+    float boxLower[3] = { lower[0], lower[1], lower[2] };
+    float boxUpper[3] = { upper[0], upper[1], upper[2] };
+    return read([&](const float* blockLower, const float* blockUpper) {
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            if (blockUpper[iDim] < boxLower[iDim]
+                    || boxUpper[iDim] < blockLower[iDim])
+                return false;
+        }
+        return true;
+    }, [&](const float* xloc) {
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            if (xloc[iDim] < boxLower[iDim] || boxUpper[iDim] < xloc[iDim])
+                return false;
+        }
+        return true;
+    }, attributes);
+}
+
+ParticleColumns ParticleBlockIndex::read(const BlockFilter &intersects,
+        const ParticleFilter &contains, int attributes) const {
+    return readBlocks(blocks(intersects), contains, attributes);
+}
+
+ParticleColumns ParticleBlockIndex::readBlocks(const std::vector<int> &ids,
+        const ParticleFilter &contains, int attributes) const {
+    ParticleColumns parts(attributes & _attributes);
+    if (ids.empty())
+        return parts;
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return parts;
+    int64_t starts[4];
+    columnStarts(starts);
+    std::vector<int64_t> ssns;
+    std::vector<float> locs, xlocs, temps;
+    bool ok = true;
+    for (size_t i = 0; i < ids.size() && ok;) {
+        // the neighboring blocks follow each other in the file
+        int64_t first = _firsts[ids[i]];
+        int64_t count = _counts[ids[i]];
+        size_t j = i + 1;
+        for (; j < ids.size() && ids[j] == ids[j - 1] + 1; ++j)
+            count += _counts[ids[j]];
+        i = j;
+        ok = readColumn(fd, starts[2], 3, first, count, xlocs);
+        if (ok && parts.has(ParticleColumns::SSN))
+            ok = readColumn(fd, starts[0], 1, first, count, ssns);
+        if (ok && parts.has(ParticleColumns::LOC))
+            ok = readColumn(fd, starts[1], 3, first, count, locs);
+        if (ok && parts.has(ParticleColumns::TEMP))
+            ok = readColumn(fd, starts[3], 1, first, count, temps);
+        for (int64_t iPart = 0; iPart < count && ok; ++iPart) {
+            const float* xloc = &xlocs[3 * iPart];
+            if (!contains(xloc))
+                continue;
+            double dXloc[3] = { xloc[0], xloc[1], xloc[2] };
+            double dLoc[3] = { 0.0, 0.0, 0.0 };
+            if (!locs.empty()) {
+                for (int iDim = 0; iDim < 3; ++iDim)
+                    dLoc[iDim] = locs[3 * iPart + iDim];
+            }
+            parts.push_back(ssns.empty() ? 0 : ssns[iPart], dLoc, dXloc,
+                    temps.empty() ? 0.0 : temps[iPart]);
+        }
+    }
+    close(fd);
+    return parts;
+}
+
+ParticleColumns ParticleBlockIndex::readAt(
+        const std::vector<int64_t> &positions, int attributes) const {
+    ParticleColumns parts(attributes & _attributes);
+    int64_t n = positions.size();
+    if (0 == n)
+        return parts;
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return parts;
+    int64_t starts[4];
+    columnStarts(starts);
+    // read in file order, the close particles together
+    std::vector<int64_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&positions](int64_t a, int64_t b) {
+        return positions[a] < positions[b];
+    });
+    bool hasSsn = parts.has(ParticleColumns::SSN);
+    bool hasLoc = parts.has(ParticleColumns::LOC);
+    bool hasXloc = parts.has(ParticleColumns::XLOC);
+    bool hasTemp = parts.has(ParticleColumns::TEMP);
+    std::vector<int64_t> ssns(hasSsn ? n : 0), rangeSsns;
+    std::vector<float> locs(hasLoc ? 3 * n : 0), rangeLocs;
+    std::vector<float> xlocs(hasXloc ? 3 * n : 0), rangeXlocs;
+    std::vector<float> temps(hasTemp ? n : 0), rangeTemps;
+    bool ok = true;
+    for (int64_t i = 0; i < n && ok;) {
+        int64_t first = positions[order[i]];
+        int64_t j = i + 1;
+        while (j < n && positions[order[j]] - positions[order[j - 1]] <= maxGap)
+            ++j;
+        int64_t count = positions[order[j - 1]] - first + 1;
+        if (hasSsn)
+            ok = ok && readColumn(fd, starts[0], 1, first, count, rangeSsns);
+        if (hasLoc)
+            ok = ok && readColumn(fd, starts[1], 3, first, count, rangeLocs);
+        if (hasXloc)
+            ok = ok && readColumn(fd, starts[2], 3, first, count, rangeXlocs);
+        if (hasTemp)
+            ok = ok && readColumn(fd, starts[3], 1, first, count, rangeTemps);
+        for (; i < j && ok; ++i) {
+            int64_t iOut = order[i];
+            int64_t iRange = positions[iOut] - first;
+            if (hasSsn)
+                ssns[iOut] = rangeSsns[iRange];
+            for (int iDim = 0; iDim < 3; ++iDim) {
+                if (hasLoc)
+                    locs[3 * iOut + iDim] = rangeLocs[3 * iRange + iDim];
+                if (hasXloc)
+                    xlocs[3 * iOut + iDim] = rangeXlocs[3 * iRange + iDim];
+            }
+            if (hasTemp)
+                temps[iOut] = rangeTemps[iRange];
+        }
+    }
+    close(fd);
+    if (!ok)
+        return parts;
+    parts.reserve(n);
+    for (int64_t i = 0; i < n; ++i) {
+        double loc[3] = { 0.0, 0.0, 0.0 }, xloc[3] = { 0.0, 0.0, 0.0 };
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            if (hasLoc)
+                loc[iDim] = locs[3 * i + iDim];
+            if (hasXloc)
+                xloc[iDim] = xlocs[3 * i + iDim];
+        }
+        parts.push_back(hasSsn ? ssns[i] : 0, loc, xloc,
+                hasTemp ? temps[i] : 0.0);
+    }
+    return parts;
+}
+
+std::vector<int64_t> ParticleBlockIndex::ssns() const {
+    std::vector<int64_t> ssns;
+    if (0 == (_attributes & ParticleColumns::SSN))
+        return ssns;
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return ssns;
+    int64_t starts[4];
+    columnStarts(starts);
+    if (!readColumn(fd, starts[0], 1, 0, _nParticles, ssns))
+        ssns.clear();
+    close(fd);
+    return ssns;
+}
+
+/// Where the columns of the held attributes start in the file.
+void ParticleBlockIndex::columnStarts(int64_t starts[4]) const {
+    const ParticleColumns::Attribute columns[4] = {
+        ParticleColumns::SSN, ParticleColumns::LOC, ParticleColumns::XLOC,
+        ParticleColumns::TEMP
+    };
+    const int64_t bytesPerParticle[4] = { sizeof(int64_t), 3 * sizeof(float),
+            3 * sizeof(float), sizeof(float) };
+    int64_t start = headerBytes() + nBlocks() * blockBytes();
+    for (int iColumn = 0; iColumn < 4; ++iColumn) {
+        starts[iColumn] = start;
+        if (_attributes & columns[iColumn])
+            start += bytesPerParticle[iColumn] * _nParticles;
+    }
+}
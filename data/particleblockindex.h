@@ -0,0 +1,125 @@
+#ifndef PARTICLEBLOCKINDEX_H
+#define PARTICLEBLOCKINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fileio.h"
+#include "particlecolumns.h"
+
+/**
+ * The spatial index of the particles of a step, particleblocks.bin in its
+ * tracer directory. The bounding box of the physical locations (xloc), which
+ * every tracer format holds, is cut into the blocks of a 2^level grid.
+ * The particles are stored block after block in Morton order of the blocks,
+ * and only the non-empty blocks are listed:
+ *
+ *   header: int magic, version, level, attributes;
+ *           int64 nparticles, nblocks, source size, source mtime;
+ *           float lower[3], upper[3]
+ *   blocks: per block uint64 morton code, int64 first particle, count
+ *   int64  ssn[nparticles]
+ *   float  loc[3 * nparticles]
+ *   float  xloc[3 * nparticles]
+ *   float  temperature[nparticles]
+ *
+ * with the columns of the attributes not held left out. A query reads the
+ * header and the block table once, then only the blocks its region
+ * intersects, the neighboring ones in a single read per column, so the I/O
+ * follows the size of the result rather than of the step.
+ *
+ * The source is the tracer files the index was written from. An index whose
+ * source size or modification time has changed since is stale.
+ */
+class ParticleBlockIndex {
+public:
+    /// Whether the region intersects the block within lower and upper.
+    typedef std::function<bool(const float* lower, const float* upper)>
+            BlockFilter;
+    /// Whether the region holds the physical location.
+    typedef std::function<bool(const float* xloc)> ParticleFilter;
+
+    /// Takes a batch of particles, false to stop.
+    typedef std::function<bool(const ParticleColumns&)> BatchCallback;
+    /// Hands all the particles of a step to take batch by batch, every
+    /// batch with the same attributes, the same particles on every call.
+    /// False when they cannot all be read or take stops.
+    typedef std::function<bool(const BatchCallback& take)> Scan;
+
+    /// The attributes an index holds at most. The velocities and mixture
+    /// fractions of the particles written are left out of it.
+    static const int indexedAttributes = ParticleColumns::SSN
+            | ParticleColumns::LOC | ParticleColumns::XLOC
+            | ParticleColumns::TEMP;
+
+    typedef FileStamp Source;
+    static std::string filename(const std::string& dir) {
+        return dir + "particleblocks.bin";
+    }
+    /// Total size and latest modification time of the tracer files in dir,
+    /// of any of the tracer formats.
+    static Source sourceOf(const std::string& dir);
+    /// Writes the index of the particles, which have to hold the physical
+    /// locations, aside and renames it to path once complete.
+    static bool write(const std::string& path,
+            const ParticleColumns& particles, const Source& source,
+            int level = 5);
+    /// Writes the index of the particles scan hands out, out of core: scan
+    /// is run once for the bounds, once to count the particles of every
+    /// block and once to scatter every batch to its blocks in the file, so
+    /// the memory taken follows the size of a batch and the number of
+    /// non-empty blocks rather than the size of the step.
+    static bool write(const std::string& path, const Scan& scan,
+            const Source& source, int level = 5);
+    /// The index in path, nullptr when it is missing, not an index, cut
+    /// short or written from another source.
+    static std::shared_ptr<const ParticleBlockIndex> open(
+            const std::string& path, const Source& source);
+
+public:
+    const Source& source() const { return _source; }
+    int level() const { return _level; }
+    int attributes() const { return _attributes; }
+    int64_t nParticles() const { return _nParticles; }
+    int nBlocks() const { return int(_codes.size()); }
+    int64_t blockCount(int iBlock) const { return _counts[iBlock]; }
+    void blockBounds(int iBlock, float lower[3], float upper[3]) const;
+    /// The blocks for which intersects holds, in file order.
+    std::vector<int> blocks(const BlockFilter& intersects) const;
+    /// The particles within [lower, upper] in physical space.
+    ParticleColumns read(const float lower[3], const float upper[3],
+            int attributes = ParticleColumns::ALL) const;
+    /// The particles of the blocks for which intersects holds for which
+    /// contains holds as well.
+    ParticleColumns read(const BlockFilter& intersects,
+            const ParticleFilter& contains,
+            int attributes = ParticleColumns::ALL) const;
+    /// The particles of the blocks ids, in increasing order, for which
+    /// contains holds, so a query can be read a few blocks at a time.
+    ParticleColumns readBlocks(const std::vector<int>& ids,
+            const ParticleFilter& contains,
+            int attributes = ParticleColumns::ALL) const;
+    /// The particles at the positions in the file, in the order of the
+    /// positions.
+    ParticleColumns readAt(const std::vector<int64_t>& positions,
+            int attributes = ParticleColumns::ALL) const;
+    /// The ssn of every particle in file order, empty when not held.
+    std::vector<int64_t> ssns() const;
+
+private:
+    void columnStarts(int64_t starts[4]) const;
+
+private:
+    std::string _path;
+    int _level = 0;
+    int _attributes = 0;
+    int64_t _nParticles = 0;
+    Source _source = { 0, 0 };
+    float _lower[3], _upper[3];
+    std::vector<uint64_t> _codes;
+    std::vector<int64_t> _firsts, _counts;
+};
+
+#endif // PARTICLEBLOCKINDEX_H
@@ -0,0 +1,58 @@
+#include "particlebrush.h"
+#include <algorithm>
+#include <cstring>
+#include "parallel.h"
+
+namespace {
+
+// the particles tested at once, small enough for their masks to stay in the
+// cache from one range to the next.
+const int64_t chunkSize = 1 << 14;
+
+} // anonymous namespace
+
+ParticleBrush::ParticleBrush(const std::vector<Range> &ranges, int nThreads)
+  : _ranges(ranges)
+  , _nThreads(threadCount(nThreads)) {}
+
+void ParticleBrush::mask(const ParticleColumns &particles,
+        uint8_t *masks) const {
+    std::vector<const Range*> ranges;
+    std::vector<const float*> columns;
+    std::vector<int> strides;
+    for (const auto& range : _ranges) {
+        int stride = 1;
+        const float* column =
+                ParticleBinner::values(particles, range.var, &stride);
+        if (!column)
+            continue;
+        ranges.push_back(&range);
+        columns.push_back(column);
+        strides.push_back(stride);
+    }
+    int64_t nChunks = (particles.size() + chunkSize - 1) / chunkSize;
+    parallelFor(nChunks, _nThreads, [&](int64_t iChunk) {
+        int64_t begin = iChunk * chunkSize;
+        int n = int(std::min(chunkSize, particles.size() - begin));
+        uint8_t* chunk = masks + begin;
+        std::memset(chunk, 0xff, n);
+        for (size_t iColumn = 0; iColumn < columns.size(); ++iColumn) {
+            const int stride = strides[iColumn];
+            const float* column = columns[iColumn] + stride * begin;
+            const float lo = ranges[iColumn]->min;
+            const float hi = ranges[iColumn]->max;
+            // no branches, so the loop vectorizes. NaN is out of range.
+            for (int i = 0; i < n; ++i) {
+                float value = column[stride * i];
+                chunk[i] &= uint8_t(-int(value >= lo) & -int(value <= hi));
+            }
+        }
+    });
+}
+
+std::vector<uint8_t> ParticleBrush::mask(
+        const ParticleColumns &particles) const {
+    std::vector<uint8_t> masks(particles.size());
+    mask(particles, masks.data());
+    return masks;
+}
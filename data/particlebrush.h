@@ -0,0 +1,42 @@
+#ifndef PARTICLEBRUSH_H
+#define PARTICLEBRUSH_H
+
+#include <cstdint>
+#include <vector>
+#include "particlebinner.h"
+
+/**
+ * @brief The ParticleBrush class picks the particles whose attributes fall
+ * in all of its ranges, as a mask of one byte per particle, 0xff for the
+ * picked ones and 0 for the others, which uploads to the GPU as it is.
+ *
+ * The particles are split in chunks tested on a pool of threads. Within a
+ * chunk every range is a branch-free loop the compiler vectorizes, and-ing
+ * its test into the mask, so brushing millions of particles takes a few
+ * milliseconds.
+ */
+class ParticleBrush {
+public:
+    /// A range on an attribute the particles do not hold picks them all.
+    struct Range {
+        ParticleBinner::Variable var;
+        float min, max;
+    };
+
+public:
+    explicit ParticleBrush(const std::vector<Range>& ranges = {},
+            int nThreads = 0);
+
+public:
+    const std::vector<Range>& ranges() const { return _ranges; }
+    bool empty() const { return _ranges.empty(); }
+    /// Writes the mask of the particles to masks, particles.size() bytes.
+    void mask(const ParticleColumns& particles, uint8_t* masks) const;
+    std::vector<uint8_t> mask(const ParticleColumns& particles) const;
+
+private:
+    std::vector<Range> _ranges;
+    int _nThreads;
+};
+
+#endif // PARTICLEBRUSH_H
@@ -0,0 +1,361 @@
+#include "particlecache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <unordered_set>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
+#include "mortonorder.h"
+#include "parallel.h"
+
+namespace {
+
+// the first batch of a stream is a single histogram so the first particles
+// show quickly, the later ones double up to this many.
+const int maxHistsPerBatch = 64;
+
+// the memory the batches of an export are read in.
+const int64_t exportBudget = 256 << 20;
+
+// the memory the spatial indices of the steps of a trace are built in, and
+// how many of them are built at once within it.
+const int64_t indexBudget = 512 << 20;
+const int maxIndexBuilds = 4;
+
+// the histograms grouped by the file of reader they are read from, in the
+// order of their first histograms.
+std::vector<std::vector<int>> groupByFile(const TracerReader& reader,
+        const std::vector<int>& histFlatIds) {
+    std::vector<std::vector<int>> files;
+    std::unordered_map<int, size_t> fileIndices;
+    for (auto histFlatId : histFlatIds) {
+        auto inserted = fileIndices.emplace(
+                reader.fileId(histFlatId), files.size());
+        if (inserted.second)
+            files.emplace_back();
+        files[inserted.first->second].push_back(histFlatId);
+    }
+    return files;
+}
+
+/// Hands the attributes of the particles of the histograms of a step to
+/// take a bounded batch at a time: the tracer and pdfsortedtracer files in
+/// chunks through TracerSorter, and the files of the other layout, which
+/// hold a domain each, one file at a time.
+bool scanStep(const TracerConfig& config, const std::vector<int>& histFlatIds,
+        int attributes, int64_t memoryBudget,
+        const TracerSorter::BatchCallback& take) {
+    auto reader = TracerReader::create(config);
+    if (!std::dynamic_pointer_cast<ManyFilesTracerReader>(reader)) {
+        return TracerSorter(config, memoryBudget).scan(
+                config.dir(), histFlatIds, take, attributes);
+    }
+    // these files have no grid location either
+    reader->setAttributes(attributes & ~TracerReader::LOC);
+    for (const auto& file : groupByFile(*reader, histFlatIds)) {
+        if (!take(reader->read(file)))
+            return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+ParticleCache::ParticleCache(int attributes)
+  : _attributes(attributes)
+  , _generation(0)
+  , _clears(0) {}
+
+ParticleCache::~ParticleCache() {
+    clear();
+}
+
+ParticleColumns ParticleCache::particles(int step, const TracerConfig &config,
+        const std::vector<int> &selectedHistFlatIds) {
+    waitForPrefetch(step);
+    evict(step, selectedHistFlatIds);
+    read(step, config, missing(step, selectedHistFlatIds));
+    return collect(step, selectedHistFlatIds);
+}
+
+void ParticleCache::prefetch(int step, const TracerConfig &config,
+        const std::vector<int> &selectedHistFlatIds) {
+    auto prefetch = _prefetches.find(step);
+    if (_prefetches.end() != prefetch && prefetch->second.isRunning())
+        return;
+    auto histFlatIds = missing(step, selectedHistFlatIds);
+    if (histFlatIds.empty())
+        return;
+    _prefetches[step] = QtConcurrent::run([this, step, config, histFlatIds]() {
+        read(step, config, histFlatIds);
+    });
+}
+
+void ParticleCache::stream(int step, const TracerConfig &config,
+        const std::vector<int> &selectedHistFlatIds, QObject *context,
+        BatchCallback callback) {
+    int generation = ++_generation;
+    evict(step, selectedHistFlatIds);
+    // the prefetch of step is waited for on the pool rather than here.
+    QFuture<void> prefetch;
+    auto iter = _prefetches.find(step);
+    if (_prefetches.end() != iter) {
+        prefetch = iter->second;
+        _prefetches.erase(iter);
+    }
+    // the canceled streams stop after their current batch.
+    _streams.erase(std::remove_if(_streams.begin(), _streams.end(),
+            [](const QFuture<void>& stream) { return stream.isFinished(); }),
+            _streams.end());
+    _streams.push_back(QtConcurrent::run([=]() mutable {
+        auto post = [&](ParticleColumns batch) {
+            if (batch.empty())
+                return;
+            // any prefix of a batch is an even subsample of it.
+            const auto& xyzs = batch.has(ParticleColumns::XLOC)
+                    ? batch.xlocs() : batch.locs();
+            if (!xyzs.empty())
+                batch.permute(MortonOrder::stratified(xyzs));
+            auto shared = std::make_shared<ParticleColumns>(std::move(batch));
+            QTimer::singleShot(0, context,
+                    [this, generation, callback, shared]() {
+                if (generation == _generation)
+                    callback(*shared);
+            });
+        };
+        prefetch.waitForFinished();
+        if (generation != _generation)
+            return;
+        auto histFlatIds = missing(step, selectedHistFlatIds);
+        std::unordered_set<int> pending(histFlatIds.begin(), histFlatIds.end());
+        std::vector<int> cached;
+        for (auto histFlatId : selectedHistFlatIds) {
+            if (0 == pending.count(histFlatId))
+                cached.push_back(histFlatId);
+        }
+        post(collect(step, cached));
+        // a read takes whole files, at least as many histograms as the next
+        // batch, since reading any histogram of a tracer.<y column> reads
+        // all of it. The histograms read are then posted batch by batch.
+        auto files = groupByFile(*TracerReader::create(config), histFlatIds);
+        int nHists = 1;
+        for (size_t iFile = 0; iFile < files.size()
+                && generation == _generation;) {
+            std::vector<int> batch;
+            while (iFile < files.size() && int(batch.size()) < nHists) {
+                batch.insert(batch.end(),
+                        files[iFile].begin(), files[iFile].end());
+                ++iFile;
+            }
+            read(step, config, batch);
+            for (auto begin = batch.begin(); begin != batch.end()
+                    && generation == _generation;) {
+                auto end = begin + std::min<int64_t>(
+                        nHists, std::distance(begin, batch.end()));
+                post(collect(step, std::vector<int>(begin, end)));
+                begin = end;
+                nHists = std::min(2 * nHists, maxHistsPerBatch);
+            }
+        }
+    }));
+}
+
+std::shared_ptr<const ParticleBlockIndex> ParticleCache::blockIndex(
+        int step, const TracerConfig &config, int64_t memoryBudget) {
+    {
+        QMutexLocker locker(&_mutex);
+        auto index = _blockIndices.find(step);
+        if (_blockIndices.end() != index)
+            return index->second;
+    }
+    // an index older than the tracer files is rewritten
+    auto path = ParticleBlockIndex::filename(config.dir());
+    auto source = ParticleBlockIndex::sourceOf(config.dir());
+    auto index = ParticleBlockIndex::open(path, source);
+    if (!index) {
+        std::vector<int> histFlatIds(config.dimHists().nElement());
+        std::iota(histFlatIds.begin(), histFlatIds.end(), 0);
+        auto scan = [&](const ParticleBlockIndex::BatchCallback& take) {
+            return scanStep(config, histFlatIds,
+                    ParticleBlockIndex::indexedAttributes,
+                    memoryBudget, take);
+        };
+        if (ParticleBlockIndex::write(path, scan, source))
+            index = ParticleBlockIndex::open(path, source);
+    }
+    QMutexLocker locker(&_mutex);
+    if (index)
+        _blockIndices[step] = index;
+    return index;
+}
+
+void ParticleCache::tracePathlines(const std::string &runDir,
+        const std::vector<TracerConfig> &configs, int step,
+        const std::vector<int> &selectedHistFlatIds, int maxPathlines,
+        QObject *context, PathlinesCallback callback) {
+    _traces.erase(std::remove_if(_traces.begin(), _traces.end(),
+            [](const QFuture<void>& trace) { return trace.isFinished(); }),
+            _traces.end());
+    int clears = _clears;
+    _traces.push_back(QtConcurrent::run([=]() {
+        auto reader = TracerReader::create(configs[step]);
+        reader->setAttributes(TracerReader::SSN);
+        auto ssns = reader->read(selectedHistFlatIds).ssns();
+        if (int(ssns.size()) > maxPathlines) {
+            std::vector<int64_t> picked;
+            for (int i = 0; i < maxPathlines; ++i)
+                picked.push_back(ssns[int64_t(i) * ssns.size() / maxPathlines]);
+            ssns.swap(picked);
+        }
+        // indexing the steps is the long part, a few steps at once that
+        // share the budget. clear() stops it in between.
+        int nSteps = int(configs.size());
+        int nBuilds = std::min(maxIndexBuilds, threadCount(0));
+        SsnJoinIndex::BlockIndices steps(nSteps);
+        parallelFor(nSteps, nBuilds, [&](int iStep) {
+            if (clears == _clears) {
+                steps[iStep] = blockIndex(
+                        iStep, configs[iStep], indexBudget / nBuilds);
+            }
+        });
+        if (clears != _clears)
+            return;
+        // an index of other block indices is rebuilt
+        auto path = SsnJoinIndex::filename(runDir);
+        auto index = SsnJoinIndex::open(path, steps);
+        if (!index && clears == _clears && SsnJoinIndex::build(path, steps))
+            index = SsnJoinIndex::open(path, steps);
+        if (clears != _clears)
+            return;
+        auto pathlines = std::make_shared<Pathlines>();
+        if (index)
+            *pathlines = index->trace(steps, ssns);
+        QTimer::singleShot(0, context, [callback, pathlines]() {
+            callback(*pathlines);
+        });
+    }));
+}
+
+void ParticleCache::exportParticles(const TracerConfig &config,
+        const std::vector<int> &selectedHistFlatIds, const std::string &path,
+        QObject *context, ExportCallback callback) {
+    _exports.erase(std::remove_if(_exports.begin(), _exports.end(),
+            [](const QFuture<void>& future) { return future.isFinished(); }),
+            _exports.end());
+    int clears = _clears;
+    _exports.push_back(QtConcurrent::run([=]() {
+        // scanned apart from the cache, which keeps the histograms shown
+        // with fewer attributes than an export has.
+        ParticleExporter exporter(path, ParticleExporter::format(path),
+                ParticleExporter::histAttributes);
+        bool scanned = scanStep(config, selectedHistFlatIds,
+                ParticleExporter::histAttributes, exportBudget,
+                [&](const ParticleColumns& batch) {
+            return clears == _clears && exporter.write(batch);
+        });
+        // a failed or canceled export leaves no partial file behind
+        bool ok = exporter.close() && scanned && clears == _clears;
+        if (!ok)
+            std::remove(path.c_str());
+        int64_t nParticles = exporter.nParticles();
+        QTimer::singleShot(0, context, [callback, ok, nParticles]() {
+            callback(ok, nParticles);
+        });
+    }));
+}
+
+void ParticleCache::clear() {
+    ++_generation;
+    ++_clears;
+    for (auto& stream : _streams)
+        stream.waitForFinished();
+    _streams.clear();
+    for (auto& trace : _traces)
+        trace.waitForFinished();
+    _traces.clear();
+    for (auto& future : _exports)
+        future.waitForFinished();
+    _exports.clear();
+    for (auto& prefetch : _prefetches)
+        prefetch.second.waitForFinished();
+    _prefetches.clear();
+    QMutexLocker locker(&_mutex);
+    _steps.clear();
+    _blockIndices.clear();
+}
+
+void ParticleCache::evict(
+        int step, const std::vector<int> &selectedHistFlatIds) {
+    QMutexLocker locker(&_mutex);
+    for (auto iter = _steps.begin(); iter != _steps.end();) {
+        if (std::abs(iter->first - step) > 1)
+            iter = _steps.erase(iter);
+        else
+            ++iter;
+    }
+    // drop the deselected histograms.
+    std::unordered_set<int> selected(
+            selectedHistFlatIds.begin(), selectedHistFlatIds.end());
+    auto& hists = _steps[step];
+    for (auto iter = hists.begin(); iter != hists.end();) {
+        if (0 == selected.count(iter->first))
+            iter = hists.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+ParticleColumns ParticleCache::collect(
+        int step, const std::vector<int> &histFlatIds) {
+    QMutexLocker locker(&_mutex);
+    const auto& hists = _steps[step];
+    int64_t nParts = 0;
+    for (auto histFlatId : histFlatIds) {
+        auto hist = hists.find(histFlatId);
+        if (hists.end() != hist)
+            nParts += hist->second.size();
+    }
+    ParticleColumns parts(_attributes);
+    parts.reserve(nParts);
+    for (auto histFlatId : histFlatIds) {
+        auto hist = hists.find(histFlatId);
+        if (hists.end() != hist)
+            parts.append(hist->second);
+    }
+    return parts;
+}
+
+std::vector<int> ParticleCache::missing(
+        int step, const std::vector<int> &selectedHistFlatIds) {
+    QMutexLocker locker(&_mutex);
+    const auto& hists = _steps[step];
+    std::vector<int> histFlatIds;
+    for (auto histFlatId : selectedHistFlatIds) {
+        if (0 == hists.count(histFlatId))
+            histFlatIds.push_back(histFlatId);
+    }
+    return histFlatIds;
+}
+
+void ParticleCache::read(int step, const TracerConfig &config,
+        const std::vector<int> &histFlatIds) {
+    if (histFlatIds.empty())
+        return;
+    auto reader = TracerReader::create(config);
+    reader->setAttributes(_attributes);
+    auto hists = reader->readHists(histFlatIds);
+    QMutexLocker locker(&_mutex);
+    auto& cached = _steps[step];
+    for (auto& hist : hists)
+        cached[hist.first] = std::move(hist.second);
+}
+
+void ParticleCache::waitForPrefetch(int step) {
+    auto prefetch = _prefetches.find(step);
+    if (_prefetches.end() == prefetch)
+        return;
+    prefetch->second.waitForFinished();
+    _prefetches.erase(prefetch);
+}
@@ -0,0 +1,112 @@
+#ifndef PARTICLECACHE_H
+#define PARTICLECACHE_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <QFuture>
+#include <QMutex>
+#include "particleblockindex.h"
+#include "particleexporter.h"
+#include "ssnjoinindex.h"
+#include "tracerreader.h"
+#include "tracersorter.h"
+
+class QObject;
+
+/**
+ * @brief The ParticleCache class keeps the particles of the selected
+ * histograms of the steps around the current one, by histogram. Changing the
+ * selection reads only the newly selected histograms and drops the
+ * deselected ones, and the neighboring steps are read in the background
+ * while the particles are shown. The particles can also be streamed batch
+ * by batch so they can be shown as they are read, traced through the steps
+ * with a spatial index of every step, or exported.
+ */
+class ParticleCache {
+public:
+    typedef std::function<void(const ParticleColumns&)> BatchCallback;
+    typedef std::function<void(const Pathlines&)> PathlinesCallback;
+    typedef std::function<void(bool ok, int64_t nParticles)> ExportCallback;
+
+public:
+    explicit ParticleCache(int attributes = TracerReader::ALL);
+    ~ParticleCache();
+
+public:
+    /// The particles of the selected histograms of step in the order of the
+    /// ids. The steps other than step and its neighbors are dropped.
+    ParticleColumns particles(int step, const TracerConfig& config,
+            const std::vector<int>& selectedHistFlatIds);
+    /// Reads the histograms of step not cached yet on the global thread pool.
+    void prefetch(int step, const TracerConfig& config,
+            const std::vector<int>& selectedHistFlatIds);
+    /// Streams the particles of the selected histograms of step to callback
+    /// on the thread of context, the cached ones at once, then the missing
+    /// ones in growing batches as they are read on the global thread pool.
+    /// The files of the reader are read whole, each once.
+    /// The particles of a batch are in stratified Morton order, so any
+    /// prefix of a batch is spread evenly over the space it covers.
+    /// A later stream or clear() cancels the current one.
+    void stream(int step, const TracerConfig& config,
+            const std::vector<int>& selectedHistFlatIds, QObject* context,
+            BatchCallback callback);
+    /// The spatial index of step, written next to the tracer files from all
+    /// of its particles the first time and whenever the tracer files have
+    /// changed since, scanned a batch at a time within about memoryBudget.
+    /// nullptr when it cannot be written.
+    std::shared_ptr<const ParticleBlockIndex> blockIndex(
+            int step, const TracerConfig& config,
+            int64_t memoryBudget = 256 << 20);
+    /// Traces the particles of the selected histograms of step through all
+    /// the steps on the global thread pool, and hands the pathlines to
+    /// callback on the thread of context. The join index of the run is
+    /// built in runDir the first time, from the spatial indices of the
+    /// steps, and again once any of those changes. The missing spatial
+    /// indices are built a few at once within a shared memory budget. At
+    /// most maxPathlines particles are traced, evenly picked.
+    /// clear() cancels the trace without calling callback.
+    void tracePathlines(const std::string& runDir,
+            const std::vector<TracerConfig>& configs, int step,
+            const std::vector<int>& selectedHistFlatIds, int maxPathlines,
+            QObject* context, PathlinesCallback callback);
+    /// Streams the ParticleExporter::histAttributes of the particles of the
+    /// selected histograms to path on the global thread pool, as CSV for a
+    /// .csv path and in the binary format of ParticleExporter otherwise, and
+    /// hands the outcome to callback on the thread of context. The files are
+    /// scanned in chunks within a memory budget, so the particles are never
+    /// all in memory, even those of a single file, and every file is read
+    /// once. A failed export removes the partial file, and so does clear(),
+    /// which cancels the export.
+    void exportParticles(const TracerConfig& config,
+            const std::vector<int>& selectedHistFlatIds,
+            const std::string& path, QObject* context,
+            ExportCallback callback);
+    void clear();
+
+private:
+    void evict(int step, const std::vector<int>& selectedHistFlatIds);
+    ParticleColumns collect(int step, const std::vector<int>& histFlatIds);
+    std::vector<int> missing(
+            int step, const std::vector<int>& selectedHistFlatIds);
+    void read(int step, const TracerConfig& config,
+            const std::vector<int>& histFlatIds);
+    void waitForPrefetch(int step);
+
+private:
+    int _attributes;
+    std::map<int, TracerReader::HistParticles> _steps;
+    std::map<int, QFuture<void>> _prefetches;
+    std::map<int, std::shared_ptr<const ParticleBlockIndex>> _blockIndices;
+    std::vector<QFuture<void>> _streams, _traces, _exports;
+    /// Bumped by every stream and clear(), which cancel the current stream.
+    std::atomic<int> _generation;
+    /// Bumped by clear() only, which cancels the traces and exports that
+    /// streams leave running.
+    std::atomic<int> _clears;
+    QMutex _mutex;
+};
+
+#endif // PARTICLECACHE_H
@@ -0,0 +1,186 @@
+#ifndef PARTICLECOLUMNS_H
+#define PARTICLECOLUMNS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The ParticleColumns class keeps particles as one array per
+ * attribute, holding only the attributes it was made with. The locations
+ * and velocities are interleaved xyz and, like the values, kept in single
+ * precision, so the position and value columns upload to the GPU as they
+ * are.
+ */
+class ParticleColumns {
+public:
+    enum Attribute {
+        SSN = 1, LOC = 2, XLOC = 4, TEMP = 8, VEL = 16, MIXFRAC = 32,
+        ALL = SSN | LOC | XLOC | TEMP | VEL | MIXFRAC
+    };
+    explicit ParticleColumns(int attributes = ALL)
+      : _attributes(attributes), _size(0) {}
+    ParticleColumns(const ParticleColumns&) = default;
+    ParticleColumns& operator=(const ParticleColumns&) = default;
+    /// Leaves other empty, with its attributes, rather than with its size
+    /// over moved-out columns.
+    ParticleColumns(ParticleColumns&& other)
+      : _attributes(other._attributes), _size(other._size)
+      , _ssns(std::move(other._ssns)), _locs(std::move(other._locs))
+      , _xlocs(std::move(other._xlocs)), _temps(std::move(other._temps))
+      , _vels(std::move(other._vels))
+      , _mixfracs(std::move(other._mixfracs)) {
+        other.clear();
+    }
+    ParticleColumns& operator=(ParticleColumns&& other) {
+        if (this == &other)
+            return *this;
+        _attributes = other._attributes;
+        _size = other._size;
+        _ssns = std::move(other._ssns);
+        _locs = std::move(other._locs);
+        _xlocs = std::move(other._xlocs);
+        _temps = std::move(other._temps);
+        _vels = std::move(other._vels);
+        _mixfracs = std::move(other._mixfracs);
+        other.clear();
+        return *this;
+    }
+
+public:
+    int attributes() const { return _attributes; }
+    bool has(Attribute attribute) const {
+        return 0 != (_attributes & attribute);
+    }
+    int64_t size() const { return _size; }
+    bool empty() const { return 0 == _size; }
+    void reserve(int64_t n) {
+        if (has(SSN)) _ssns.reserve(n);
+        if (has(LOC)) _locs.reserve(3 * n);
+        if (has(XLOC)) _xlocs.reserve(3 * n);
+        if (has(TEMP)) _temps.reserve(n);
+        if (has(VEL)) _vels.reserve(3 * n);
+        if (has(MIXFRAC)) _mixfracs.reserve(n);
+    }
+    /// Makes n particles, the new ones zero, to be filled in through the
+    /// columns.
+    void resize(int64_t n) {
+        if (has(SSN)) _ssns.resize(n);
+        if (has(LOC)) _locs.resize(3 * n);
+        if (has(XLOC)) _xlocs.resize(3 * n);
+        if (has(TEMP)) _temps.resize(n);
+        if (has(VEL)) _vels.resize(3 * n);
+        if (has(MIXFRAC)) _mixfracs.resize(n);
+        _size = n;
+    }
+    void clear() {
+        _ssns.clear();
+        _locs.clear();
+        _xlocs.clear();
+        _temps.clear();
+        _vels.clear();
+        _mixfracs.clear();
+        _size = 0;
+    }
+    /// Appends a particle without velocity and mixture fraction, those zero
+    /// when held.
+    void push_back(int64_t ssn, const double loc[3], const double xloc[3],
+            double temp) {
+        const double vel[3] = { 0.0, 0.0, 0.0 };
+        push_back(ssn, loc, xloc, temp, vel, 0.0);
+    }
+    /// Appends a particle, dropping the attributes not held.
+    void push_back(int64_t ssn, const double loc[3], const double xloc[3],
+            double temp, const double vel[3], double mixfrac) {
+        if (has(SSN))
+            _ssns.push_back(ssn);
+        if (has(LOC))
+            _locs.insert(_locs.end(), { float(loc[0]), float(loc[1]),
+                    float(loc[2]) });
+        if (has(XLOC))
+            _xlocs.insert(_xlocs.end(), { float(xloc[0]), float(xloc[1]),
+                    float(xloc[2]) });
+        if (has(TEMP))
+            _temps.push_back(float(temp));
+        if (has(VEL))
+            _vels.insert(_vels.end(), { float(vel[0]), float(vel[1]),
+                    float(vel[2]) });
+        if (has(MIXFRAC))
+            _mixfracs.push_back(float(mixfrac));
+        ++_size;
+    }
+    /// Appends the particles of other, which holds the same attributes.
+    void append(const ParticleColumns& other) {
+        _ssns.insert(_ssns.end(), other._ssns.begin(), other._ssns.end());
+        _locs.insert(_locs.end(), other._locs.begin(), other._locs.end());
+        _xlocs.insert(_xlocs.end(), other._xlocs.begin(), other._xlocs.end());
+        _temps.insert(_temps.end(), other._temps.begin(), other._temps.end());
+        _vels.insert(_vels.end(), other._vels.begin(), other._vels.end());
+        _mixfracs.insert(_mixfracs.end(), other._mixfracs.begin(),
+                other._mixfracs.end());
+        _size += other._size;
+    }
+    /// Reorders the particles so that particle order[i] comes i-th, order
+    /// holding every index once.
+    void permute(const std::vector<int64_t>& order) {
+        permute(_ssns, 1, order);
+        permute(_locs, 3, order);
+        permute(_xlocs, 3, order);
+        permute(_temps, 1, order);
+        permute(_vels, 3, order);
+        permute(_mixfracs, 1, order);
+    }
+    /// The particles of parts one after the other.
+    static ParticleColumns concat(const std::vector<ParticleColumns>& parts,
+            int attributes) {
+        ParticleColumns all(attributes);
+        int64_t n = 0;
+        for (const auto& part : parts)
+            n += part.size();
+        all.reserve(n);
+        for (const auto& part : parts)
+            all.append(part);
+        return all;
+    }
+
+public:
+    const std::vector<int64_t>& ssns() const { return _ssns; }
+    const std::vector<float>& locs() const { return _locs; }
+    const std::vector<float>& xlocs() const { return _xlocs; }
+    const std::vector<float>& temps() const { return _temps; }
+    const std::vector<float>& vels() const { return _vels; }
+    const std::vector<float>& mixfracs() const { return _mixfracs; }
+    std::vector<float>& xlocs() { return _xlocs; }
+    std::vector<float>& temps() { return _temps; }
+    std::vector<float>& vels() { return _vels; }
+    std::vector<float>& mixfracs() { return _mixfracs; }
+    /// The bytes the columns take, without the unused capacity.
+    int64_t nBytes() const {
+        return sizeof(int64_t) * _ssns.size()
+                + sizeof(float) * (_locs.size() + _xlocs.size()
+                    + _temps.size() + _vels.size() + _mixfracs.size());
+    }
+
+private:
+    template <typename T>
+    static void permute(std::vector<T>& column, int nComponents,
+            const std::vector<int64_t>& order) {
+        if (column.empty())
+            return;
+        std::vector<T> permuted(column.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (int iComp = 0; iComp < nComponents; ++iComp)
+                permuted[nComponents * i + iComp] =
+                        column[nComponents * order[i] + iComp];
+        }
+        column.swap(permuted);
+    }
+
+private:
+    int _attributes;
+    int64_t _size;
+    std::vector<int64_t> _ssns;
+    std::vector<float> _locs, _xlocs, _temps, _vels, _mixfracs;
+};
+
+#endif // PARTICLECOLUMNS_H
@@ -0,0 +1,261 @@
+#include "particleexporter.h"
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include "parallel.h"
+
+namespace {
+
+const int exportMagic = 0x50584550; // "PEXP"
+const int exportVersion = 1;
+// the formatted batches waiting for the writer
+const size_t maxQueued = 4;
+// the particles a thread formats at least
+const int64_t minSlice = 1 << 12;
+
+template <typename T>
+void appendRaw(std::string& out, const T* data, int64_t count) {
+    out.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+void appendFloat(std::string& out, float value) {
+    char text[32];
+    int n = snprintf(text, sizeof(text), ",%.9g", value);
+    out.append(text, n);
+}
+
+} // anonymous namespace
+
+ParticleExporter::Format ParticleExporter::format(const std::string &path) {
+    const std::string csv = ".csv";
+    if (path.size() >= csv.size()
+            && 0 == path.compare(path.size() - csv.size(), csv.size(), csv))
+        return CSV;
+    return BINARY;
+}
+
+ParticleColumns ParticleExporter::read(const std::string &path) {
+    std::ifstream fin(path, std::ios::binary);
+    int header[3] = { 0, 0, 0 };
+    readRaw(fin, header, 3);
+    if (!fin || exportMagic != header[0] || exportVersion != header[1])
+        return ParticleColumns();
+    ParticleColumns parts(header[2]);
+    std::vector<int64_t> ssns;
+    std::vector<float> locs, xlocs, temps, vels, mixfracs;
+    for (;;) {
+        int64_t n = 0;
+        readRaw(fin, &n, 1);
+        if (!fin || n <= 0)
+            break;
+        ssns.assign(parts.has(ParticleColumns::SSN) ? n : 0, 0);
+        locs.assign(parts.has(ParticleColumns::LOC) ? 3 * n : 0, 0.f);
+        xlocs.assign(parts.has(ParticleColumns::XLOC) ? 3 * n : 0, 0.f);
+        temps.assign(parts.has(ParticleColumns::TEMP) ? n : 0, 0.f);
+        vels.assign(parts.has(ParticleColumns::VEL) ? 3 * n : 0, 0.f);
+        mixfracs.assign(parts.has(ParticleColumns::MIXFRAC) ? n : 0, 0.f);
+        readRaw(fin, ssns.data(), ssns.size());
+        readRaw(fin, locs.data(), locs.size());
+        readRaw(fin, xlocs.data(), xlocs.size());
+        readRaw(fin, temps.data(), temps.size());
+        readRaw(fin, vels.data(), vels.size());
+        readRaw(fin, mixfracs.data(), mixfracs.size());
+        if (!fin)
+            return ParticleColumns(header[2]);
+        for (int64_t i = 0; i < n; ++i) {
+            double loc[3] = { 0.0, 0.0, 0.0 }, xloc[3] = { 0.0, 0.0, 0.0 };
+            double vel[3] = { 0.0, 0.0, 0.0 };
+            for (int iDim = 0; iDim < 3; ++iDim) {
+                if (!locs.empty())
+                    loc[iDim] = locs[3 * i + iDim];
+                if (!xlocs.empty())
+                    xloc[iDim] = xlocs[3 * i + iDim];
+                if (!vels.empty())
+                    vel[iDim] = vels[3 * i + iDim];
+            }
+            parts.push_back(ssns.empty() ? 0 : ssns[i], loc, xloc,
+                    temps.empty() ? 0.0 : temps[i], vel,
+                    mixfracs.empty() ? 0.0 : mixfracs[i]);
+        }
+    }
+    return parts;
+}
+
+ParticleExporter::ParticleExporter(const std::string &path, Format format,
+        int attributes, int nThreads)
+  : _format(format)
+  , _attributes(attributes)
+  , _nThreads(threadCount(nThreads))
+  , _nParticles(0)
+  , _file(fopen(path.c_str(), "wb"))
+  , _ok(nullptr != _file)
+  , _closing(false) {
+    if (!_ok)
+        return;
+    std::string header;
+    if (BINARY == _format) {
+        int ints[3] = { exportMagic, exportVersion, _attributes };
+        appendRaw(header, ints, 3);
+    } else {
+        const char* names[] = {
+            "ssn", "locx,locy,locz", "xlocx,xlocy,xlocz", "T",
+            "velx,vely,velz", "mixfrac"
+        };
+        for (int iAttr = 0; iAttr < 6; ++iAttr) {
+            if (0 == (_attributes & (1 << iAttr)))
+                continue;
+            if (!header.empty())
+                header += ",";
+            header += names[iAttr];
+        }
+        header += "\n";
+    }
+    _queue.push_back(std::move(header));
+    _writer = std::thread(&ParticleExporter::writeQueued, this);
+}
+
+ParticleExporter::~ParticleExporter() {
+    close();
+}
+
+bool ParticleExporter::write(const ParticleColumns &particles) {
+    if (!_ok || _closing || particles.empty())
+        return _ok;
+    if (_attributes != (_attributes & particles.attributes()))
+        return _ok = false;
+    auto formatted = BINARY == _format
+            ? formatBinary(particles) : formatCsv(particles);
+    std::unique_lock<std::mutex> locker(_mutex);
+    _queueChanged.wait(locker, [this]() {
+        return _queue.size() < maxQueued || !_ok;
+    });
+    _queue.push_back(std::move(formatted));
+    _queueChanged.notify_all();
+    _nParticles += particles.size();
+    return _ok;
+}
+
+bool ParticleExporter::close() {
+    if (!_writer.joinable())
+        return _ok;
+    {
+        std::lock_guard<std::mutex> locker(_mutex);
+        if (BINARY == _format) {
+            int64_t end = 0;
+            std::string tail;
+            appendRaw(tail, &end, 1);
+            _queue.push_back(std::move(tail));
+        }
+        _closing = true;
+        _queueChanged.notify_all();
+    }
+    _writer.join();
+    if (0 != fclose(_file))
+        _ok = false;
+    _file = nullptr;
+    return _ok;
+}
+
+std::string ParticleExporter::formatBinary(
+        const ParticleColumns &particles) const {
+    int64_t n = particles.size();
+    std::string out;
+    out.reserve(sizeof(int64_t) + particles.nBytes());
+    appendRaw(out, &n, 1);
+    if (_attributes & ParticleColumns::SSN)
+        appendRaw(out, particles.ssns().data(), n);
+    if (_attributes & ParticleColumns::LOC)
+        appendRaw(out, particles.locs().data(), 3 * n);
+    if (_attributes & ParticleColumns::XLOC)
+        appendRaw(out, particles.xlocs().data(), 3 * n);
+    if (_attributes & ParticleColumns::TEMP)
+        appendRaw(out, particles.temps().data(), n);
+    if (_attributes & ParticleColumns::VEL)
+        appendRaw(out, particles.vels().data(), 3 * n);
+    if (_attributes & ParticleColumns::MIXFRAC)
+        appendRaw(out, particles.mixfracs().data(), n);
+    return out;
+}
+
+std::string ParticleExporter::formatCsv(
+        const ParticleColumns &particles) const {
+    // every thread formats a slice of the particles, put together in order
+    int64_t n = particles.size();
+    int nSlices = int(std::max<int64_t>(1,
+            std::min<int64_t>(_nThreads, n / minSlice)));
+    int nValues = 0;
+    for (int attribute : { ParticleColumns::SSN, ParticleColumns::TEMP,
+            ParticleColumns::MIXFRAC })
+        nValues += 0 != (_attributes & attribute);
+    for (int attribute : { ParticleColumns::LOC, ParticleColumns::XLOC,
+            ParticleColumns::VEL })
+        nValues += 0 != (_attributes & attribute) ? 3 : 0;
+    std::vector<std::string> slices(nSlices);
+    auto work = [&](int iSlice) {
+        int64_t begin = n * iSlice / nSlices;
+        int64_t end = n * (iSlice + 1) / nSlices;
+        std::string& out = slices[iSlice];
+        out.reserve((end - begin) * 16 * nValues);
+        for (int64_t i = begin; i < end; ++i) {
+            // a comma before every value, the first one dropped
+            size_t lineStart = out.size();
+            if (_attributes & ParticleColumns::SSN) {
+                char text[32];
+                int nChars = snprintf(text, sizeof(text), ",%" PRId64,
+                        particles.ssns()[i]);
+                out.append(text, nChars);
+            }
+            if (_attributes & ParticleColumns::LOC) {
+                for (int iDim = 0; iDim < 3; ++iDim)
+                    appendFloat(out, particles.locs()[3 * i + iDim]);
+            }
+            if (_attributes & ParticleColumns::XLOC) {
+                for (int iDim = 0; iDim < 3; ++iDim)
+                    appendFloat(out, particles.xlocs()[3 * i + iDim]);
+            }
+            if (_attributes & ParticleColumns::TEMP)
+                appendFloat(out, particles.temps()[i]);
+            if (_attributes & ParticleColumns::VEL) {
+                for (int iDim = 0; iDim < 3; ++iDim)
+                    appendFloat(out, particles.vels()[3 * i + iDim]);
+            }
+            if (_attributes & ParticleColumns::MIXFRAC)
+                appendFloat(out, particles.mixfracs()[i]);
+            if (lineStart < out.size())
+                out.erase(lineStart, 1);
+            out += '\n';
+        }
+    };
+    parallelFor(nSlices, nSlices, work);
+    for (int iSlice = 1; iSlice < nSlices; ++iSlice)
+        slices[0] += slices[iSlice];
+    return std::move(slices[0]);
+}
+
+void ParticleExporter::writeQueued() {
+    for (;;) {
+        std::string formatted;
+        {
+            std::unique_lock<std::mutex> locker(_mutex);
+            _queueChanged.wait(locker, [this]() {
+                return !_queue.empty() || _closing;
+            });
+            if (_queue.empty())
+                return;
+            formatted = std::move(_queue.front());
+            _queue.pop_front();
+            _queueChanged.notify_all();
+        }
+        if (_ok && formatted.size()
+                != fwrite(formatted.data(), 1, formatted.size(), _file)) {
+            std::lock_guard<std::mutex> locker(_mutex);
+            _ok = false;
+            _queueChanged.notify_all();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef PARTICLEEXPORTER_H
+#define PARTICLEEXPORTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "particlecolumns.h"
+
+/**
+ * @brief The ParticleExporter class writes particles to a file batch by
+ * batch, so they can be streamed out of the readers without holding them
+ * all. Either as CSV, one particle per line under a header naming the
+ * columns, or in a compact binary columnar format:
+ *
+ *   header: int magic, version, attributes
+ *   blocks: int64 nparticles
+ *           int64  ssn[nparticles]
+ *           float  loc[3 * nparticles]
+ *           float  xloc[3 * nparticles]
+ *           float  temperature[nparticles]
+ *           float  vel[3 * nparticles]
+ *           float  mixfrac[nparticles]
+ *   end:    int64 0
+ *
+ * with a block per batch and the columns of the attributes not exported
+ * left out. A batch is formatted in slices on a pool of threads while a
+ * writer thread writes the previous ones in order, at most a few of them
+ * waiting, so the reading, the formatting and the writing overlap within a
+ * bounded memory.
+ */
+class ParticleExporter {
+public:
+    enum Format { BINARY, CSV };
+    /// The attributes exported of the particles of histograms, which every
+    /// tracer layout gives, zero for the velocities and mixture fractions
+    /// of the ones without them. The grid locations are left out, which the
+    /// sorted layouts do not have.
+    static const int histAttributes = ParticleColumns::SSN
+            | ParticleColumns::XLOC | ParticleColumns::TEMP
+            | ParticleColumns::VEL | ParticleColumns::MIXFRAC;
+    /// CSV for a .csv path, BINARY otherwise.
+    static Format format(const std::string& path);
+    /// The particles of a binary export, empty when it is not one.
+    static ParticleColumns read(const std::string& path);
+
+public:
+    /// Exports the attributes to path, which the batches have to hold.
+    ParticleExporter(const std::string& path, Format format, int attributes,
+            int nThreads = 0);
+    ~ParticleExporter();
+
+public:
+    bool good() const { return _ok; }
+    int64_t nParticles() const { return _nParticles; }
+    /// Queues the particles for writing, false when writing failed.
+    bool write(const ParticleColumns& particles);
+    /// Writes the queued particles and the end of the file, false when any
+    /// of the writing failed.
+    bool close();
+
+private:
+    std::string formatBinary(const ParticleColumns& particles) const;
+    std::string formatCsv(const ParticleColumns& particles) const;
+    void writeQueued();
+
+private:
+    Format _format;
+    int _attributes;
+    int _nThreads;
+    int64_t _nParticles;
+    FILE* _file;
+    std::atomic<bool> _ok;
+    bool _closing;
+    std::deque<std::string> _queue;
+    std::mutex _mutex;
+    std::condition_variable _queueChanged;
+    std::thread _writer;
+};
+
+#endif // PARTICLEEXPORTER_H
@@ -0,0 +1,244 @@
+#include "ssnjoinindex.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fileio.h"
+#include "parallel.h"
+
+namespace {
+
+const int joinIndexMagic = 0x4e4a5353; // "SSJN"
+const int joinIndexVersion = 2;
+const int joinIndexPageSize = 1024;
+
+template <typename T>
+void readRaw(std::istream& in, T* data, int64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+// the entries of a step in the steps table
+const int stepEntries = 5;
+
+int64_t nPages(int64_t count) {
+    return (count + joinIndexPageSize - 1) / joinIndexPageSize;
+}
+
+} // anonymous namespace
+
+bool SsnJoinIndex::build(const std::string &path, const BlockIndices &steps,
+        int nThreads) {
+    // the layout follows from the particle counts of the steps
+    int nSteps = int(steps.size());
+    std::vector<int64_t> table(stepEntries * nSteps);
+    int64_t offset = 4 * sizeof(int) + table.size() * sizeof(int64_t);
+    for (int iStep = 0; iStep < nSteps; ++iStep) {
+        int64_t* entry = &table[stepEntries * iStep];
+        entry[0] = steps[iStep] ? steps[iStep]->nParticles() : 0;
+        entry[1] = steps[iStep] ? steps[iStep]->source().size : 0;
+        entry[2] = steps[iStep] ? steps[iStep]->source().mtime : 0;
+        entry[3] = offset;
+        offset += nPages(entry[0]) * sizeof(int64_t);
+    }
+    for (int iStep = 0; iStep < nSteps; ++iStep) {
+        table[stepEntries * iStep + 4] = offset;
+        offset += 2 * table[stepEntries * iStep] * sizeof(int64_t);
+    }
+    // written aside, so an index being read is never cut short, even as
+    // threads index the same run at once
+    return writeAside(path, [&](const std::string& asidePath) {
+        int fd = ::open(asidePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        int header[4] = { joinIndexMagic, joinIndexVersion, nSteps,
+                joinIndexPageSize };
+        std::atomic<bool> ok(writeAt(fd, header, sizeof(header), 0)
+                && writeAt(fd, table.data(), table.size() * sizeof(int64_t),
+                    sizeof(header))
+                && 0 == ftruncate(fd, offset));
+        // every step sorts its own particles by ssn
+        parallelFor(nSteps, nThreads, [&](int iStep) {
+            const int64_t* entry = &table[stepEntries * iStep];
+            int64_t count = entry[0];
+            if (!ok || 0 == count)
+                return;
+            auto ssns = steps[iStep]->ssns();
+            if (int64_t(ssns.size()) != count) {
+                ok = false;
+                return;
+            }
+            std::vector<std::pair<int64_t, int64_t>> pairs(count);
+            for (int64_t i = 0; i < count; ++i)
+                pairs[i] = std::make_pair(ssns[i], i);
+            std::sort(pairs.begin(), pairs.end());
+            std::vector<int64_t> fences, entries(2 * count);
+            for (int64_t i = 0; i < count; ++i) {
+                if (0 == i % joinIndexPageSize)
+                    fences.push_back(pairs[i].first);
+                entries[2 * i] = pairs[i].first;
+                entries[2 * i + 1] = pairs[i].second;
+            }
+            if (!writeAt(fd, fences.data(), fences.size() * sizeof(int64_t),
+                        entry[3])
+                    || !writeAt(fd, entries.data(),
+                        entries.size() * sizeof(int64_t), entry[4]))
+                ok = false;
+        });
+        if (0 != close(fd))
+            ok = false;
+        return bool(ok);
+    });
+}
+
+std::shared_ptr<const SsnJoinIndex> SsnJoinIndex::open(
+        const std::string &path, const BlockIndices &steps) {
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return nullptr;
+    int header[4];
+    readRaw(fin, header, 4);
+    if (!fin || joinIndexMagic != header[0] || joinIndexVersion != header[1]
+            || int(steps.size()) != header[2] || header[3] <= 0)
+        return nullptr;
+    int nSteps = header[2];
+    std::vector<int64_t> table(stepEntries * nSteps);
+    readRaw(fin, table.data(), table.size());
+    if (!fin)
+        return nullptr;
+    // the steps have to be the block indices the index was built from
+    int64_t end = 4 * sizeof(int) + table.size() * sizeof(int64_t);
+    for (int iStep = 0; iStep < nSteps; ++iStep) {
+        const int64_t* entry = &table[stepEntries * iStep];
+        const auto& step = steps[iStep];
+        if (entry[0] != (step ? step->nParticles() : 0)
+                || entry[1] != (step ? step->source().size : 0)
+                || entry[2] != (step ? step->source().mtime : 0))
+            return nullptr;
+        end = std::max<int64_t>(end,
+                entry[4] + 2 * entry[0] * sizeof(int64_t));
+    }
+    fin.seekg(0, std::ios::end);
+    if (end != int64_t(fin.tellg()))
+        return nullptr;
+    auto index = std::make_shared<SsnJoinIndex>();
+    index->_path = path;
+    index->_pageSize = header[3];
+    index->_fences.resize(nSteps);
+    for (int iStep = 0; iStep < nSteps && fin; ++iStep) {
+        const int64_t* entry = &table[stepEntries * iStep];
+        auto& fences = index->_fences[iStep];
+        fences.resize((entry[0] + index->_pageSize - 1) / index->_pageSize);
+        fin.seekg(entry[3]);
+        readRaw(fin, fences.data(), fences.size());
+        index->_counts.push_back(entry[0]);
+        index->_entryOffsets.push_back(entry[4]);
+    }
+    if (!fin)
+        return nullptr;
+    return index;
+}
+
+std::vector<int64_t> SsnJoinIndex::positions(int step,
+        const std::vector<int64_t> &sortedSsns) const {
+    std::vector<int64_t> found(sortedSsns.size(), -1);
+    if (step < 0 || step >= nSteps() || 0 == _counts[step])
+        return found;
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return found;
+    const auto& fences = _fences[step];
+    int64_t loadedPage = -1;
+    std::vector<int64_t> page;
+    for (size_t i = 0; i < sortedSsns.size(); ++i) {
+        int64_t ssn = sortedSsns[i];
+        auto fence = std::upper_bound(fences.begin(), fences.end(), ssn);
+        if (fences.begin() == fence)
+            continue;
+        int64_t iPage = fence - fences.begin() - 1;
+        if (iPage != loadedPage) {
+            int64_t first = iPage * _pageSize;
+            int64_t n = std::min<int64_t>(_pageSize, _counts[step] - first);
+            page.resize(2 * n);
+            if (!readAt(fd, page.data(), page.size() * sizeof(int64_t),
+                    _entryOffsets[step] + 2 * first * sizeof(int64_t)))
+                break;
+            loadedPage = iPage;
+        }
+        // the pairs of the page are sorted by ssn
+        int64_t lower = 0, upper = page.size() / 2;
+        while (lower < upper) {
+            int64_t middle = (lower + upper) / 2;
+            if (page[2 * middle] < ssn)
+                lower = middle + 1;
+            else
+                upper = middle;
+        }
+        if (lower < int64_t(page.size() / 2) && ssn == page[2 * lower])
+            found[i] = page[2 * lower + 1];
+    }
+    close(fd);
+    return found;
+}
+
+Pathlines SsnJoinIndex::trace(const BlockIndices &steps,
+        std::vector<int64_t> ssns, int attributes, int nThreads) const {
+    std::sort(ssns.begin(), ssns.end());
+    ssns.erase(std::unique(ssns.begin(), ssns.end()), ssns.end());
+    int nTraced = std::min(nSteps(), int(steps.size()));
+    for (int iStep = 0; iStep < nTraced; ++iStep) {
+        if (steps[iStep])
+            attributes &= steps[iStep]->attributes();
+    }
+    // the particles of every step, with the ids of their ssns
+    std::vector<ParticleColumns> parts(nTraced, ParticleColumns(attributes));
+    std::vector<std::vector<int64_t>> ssnIds(nTraced);
+    parallelFor(nTraced, nThreads, [&](int iStep) {
+        if (!steps[iStep])
+            return;
+        auto found = positions(iStep, ssns);
+        std::vector<int64_t> stepPositions;
+        for (size_t i = 0; i < found.size(); ++i) {
+            if (0 <= found[i]) {
+                stepPositions.push_back(found[i]);
+                ssnIds[iStep].push_back(i);
+            }
+        }
+        parts[iStep] = steps[iStep]->readAt(stepPositions, attributes);
+        if (parts[iStep].size() != int64_t(stepPositions.size()))
+            ssnIds[iStep].clear();
+    });
+    // the vertices grouped by ssn, in step order within each pathline
+    std::vector<int64_t> nVertices(ssns.size(), 0);
+    for (int iStep = 0; iStep < nTraced; ++iStep) {
+        if (ssnIds[iStep].empty())
+            parts[iStep].clear();
+        for (auto ssnId : ssnIds[iStep])
+            ++nVertices[ssnId];
+    }
+    Pathlines pathlines;
+    std::vector<int64_t> cursors(ssns.size(), 0);
+    int64_t nAll = 0;
+    for (size_t i = 0; i < ssns.size(); ++i) {
+        if (0 == nVertices[i])
+            continue;
+        pathlines.ssns.push_back(ssns[i]);
+        pathlines.firsts.push_back(nAll);
+        cursors[i] = nAll;
+        nAll += nVertices[i];
+    }
+    std::vector<int64_t> order(nAll);
+    pathlines.steps.resize(nAll);
+    int64_t iAll = 0;
+    for (int iStep = 0; iStep < nTraced; ++iStep) {
+        for (auto ssnId : ssnIds[iStep]) {
+            int64_t slot = cursors[ssnId]++;
+            order[slot] = iAll++;
+            pathlines.steps[slot] = iStep;
+        }
+    }
+    pathlines.vertices = ParticleColumns::concat(parts, attributes);
+    pathlines.vertices.permute(order);
+    return pathlines;
+}
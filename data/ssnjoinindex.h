@@ -0,0 +1,85 @@
+#ifndef SSNJOININDEX_H
+#define SSNJOININDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "particleblockindex.h"
+
+/**
+ * @brief The Pathlines struct holds the locations of particles over the
+ * steps, one pathline after the other, each in step order.
+ */
+struct Pathlines {
+    /// the ssn of every pathline and where its vertices begin
+    std::vector<int64_t> ssns, firsts;
+    /// the step of every vertex
+    std::vector<int> steps;
+    ParticleColumns vertices;
+
+    int nPathlines() const { return int(ssns.size()); }
+    int64_t nVertices(int iPathline) const {
+        return (iPathline + 1 < nPathlines()
+                ? firsts[iPathline + 1] : vertices.size()) - firsts[iPathline];
+    }
+};
+
+/**
+ * The join index of the particles of a run by ssn, ssnindex.bin in the run
+ * directory. For every step it maps ssn to the position of the particle in
+ * the block index of the step, as (ssn, position) pairs sorted by ssn and
+ * cut into pages, with the first ssn of every page kept aside:
+ *
+ *   header:  int magic, version, nsteps, page size
+ *   steps:   per step int64 count, source size, source mtime, fence offset,
+ *            entry offset
+ *   fences:  per step the first ssn of every page
+ *   entries: per step count int64 ssn, position pairs
+ *
+ * The fences are loaded at open, so a lookup reads only the pages holding
+ * the ssns asked for, and tracing particles costs in proportion to the
+ * traced particles times the steps rather than to all the particles.
+ *
+ * Every step keeps the source of the block index it was built from, so an
+ * index is stale once the block index of any step is of other tracer files.
+ */
+class SsnJoinIndex {
+public:
+    typedef std::vector<std::shared_ptr<const ParticleBlockIndex>>
+            BlockIndices;
+
+    static std::string filename(const std::string& dir) {
+        return dir + "/ssnindex.bin";
+    }
+    /// Writes the index of the block indices of the steps, the steps on a
+    /// pool of threads, aside and renames it to path once complete. A
+    /// missing block index is an empty step.
+    static bool build(const std::string& path, const BlockIndices& steps,
+            int nThreads = 0);
+    /// The index in path of the block indices of the steps, nullptr when it
+    /// is missing, not an index, cut short or built from other ones.
+    static std::shared_ptr<const SsnJoinIndex> open(
+            const std::string& path, const BlockIndices& steps);
+
+public:
+    int nSteps() const { return int(_counts.size()); }
+    int64_t nParticles(int step) const { return _counts[step]; }
+    /// The positions of the ascending ssns in the block index of step, -1
+    /// for those not in the step.
+    std::vector<int64_t> positions(int step,
+            const std::vector<int64_t>& sortedSsns) const;
+    /// The pathlines of the particles through the steps, from the block
+    /// indices the index was built with, the steps on a pool of threads.
+    Pathlines trace(const BlockIndices& steps, std::vector<int64_t> ssns,
+            int attributes = ParticleColumns::XLOC | ParticleColumns::TEMP,
+            int nThreads = 0) const;
+
+private:
+    std::string _path;
+    int _pageSize = 0;
+    std::vector<int64_t> _counts, _entryOffsets;
+    std::vector<std::vector<int64_t>> _fences;
+};
+
+#endif // SSNJOININDEX_H
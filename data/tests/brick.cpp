@@ -0,0 +1,91 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <histbrick.h>
+
+int main(void)
+{
+	// a 5x4x3 volume of 2D histograms with a hole, bricked by 2
+	HistHelper helper;
+	helper.n_vx = 50; helper.n_vy = 40; helper.n_vz = 30;
+	helper.nh_x = 5; helper.nh_y = 4; helper.nh_z = 3;
+	helper.N_HIST = 5 * 4 * 3;
+	std::vector<std::shared_ptr<const Hist>> hists(helper.N_HIST);
+	for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+		if (7 == iHist) {
+			hists[iHist] = std::make_shared<HistNull>();
+			continue;
+		}
+		std::vector<float> values(4 * 3);
+		for (int iBin = 0; iBin < int(values.size()); ++iBin)
+			values[iBin] = float((iHist * iBin) % 5);
+		auto hist = std::make_shared<Hist2D>(4, 3,
+				std::vector<double>{0.0, -1.0}, std::vector<double>{1.0, 1.0},
+				std::vector<double>{0.0, 0.0},
+				std::vector<std::string>{"x", "y"}, values);
+		hist->setPercentInRange(0.5 + 0.01 * iHist);
+		hists[iHist] = hist;
+	}
+	const std::string path = "pdfs-brick-test";
+	bool written = HistBrickWriter(helper, 2).write(path,
+			[&hists](int flatId) { return hists[flatId]; });
+	assert(written);
+
+	HistBrickReader reader(path, {"x", "y"});
+	assert(reader.good());
+	assert(5 == reader.helper().nh_x && 3 == reader.helper().nh_z);
+	assert(50 == reader.helper().n_vx);
+	assert(3 == reader.dimBricks()[0] && 2 == reader.dimBricks()[1]
+			&& 2 == reader.dimBricks()[2]);
+
+	// the far edge bricks are partial
+	int edgeBrick = reader.brickId(4, 3, 2);
+	assert(1 == reader.dimBrickHists(edgeBrick)[0]
+			&& 2 == reader.dimBrickHists(edgeBrick)[1]
+			&& 1 == reader.dimBrickHists(edgeBrick)[2]);
+
+	// a slice touches only one layer of bricks in any direction
+	assert(4 == reader.sliceBrickIds(HistBrickReader::YZ, 3).size());
+	assert(6 == reader.sliceBrickIds(HistBrickReader::XZ, 1).size());
+	assert(6 == reader.sliceBrickIds(HistBrickReader::XY, 2).size());
+
+	// every histogram round trips through its brick
+	Extent dimHists = helper.dimHists();
+	for (int iBrick = 0; iBrick < reader.dimBricks().nElement(); ++iBrick) {
+		auto brickHists = reader.readBrick(iBrick);
+		auto dimBrick = reader.dimBrickHists(iBrick);
+		auto brickIds = reader.dimBricks().flattoids(iBrick);
+		for (int iLocal = 0; iLocal < int(brickHists.size()); ++iLocal) {
+			auto localIds = dimBrick.flattoids(iLocal);
+			int flatId = dimHists.idstoflat(
+					brickIds[0] * 2 + localIds[0],
+					brickIds[1] * 2 + localIds[1],
+					brickIds[2] * 2 + localIds[2]);
+			auto expected = hists[flatId];
+			auto actual = brickHists[iLocal];
+			assert(expected->nDim() == actual->nDim());
+			assert(expected->nBins() == actual->nBins());
+			for (int iBin = 0; iBin < expected->nBins(); ++iBin)
+				assert(expected->binFreq(iBin) == actual->binFreq(iBin));
+			assert(expected->percentInRange() == actual->percentInRange());
+			if (0 < expected->nDim())
+				assert(-1.0 == actual->dimMin(1) && "y" == actual->var(1));
+		}
+	}
+	std::remove(path.c_str());
+
+	// fractional counts do not fit the records and leave no file behind
+	std::vector<float> fractions = {0.f, 1.5f, 2.f, 0.25f};
+	hists[3] = std::make_shared<Hist2D>(2, 2,
+			std::vector<double>{0.0, 0.0}, std::vector<double>{1.0, 1.0},
+			std::vector<double>{0.0, 0.0},
+			std::vector<std::string>{"x", "y"}, fractions);
+	written = HistBrickWriter(helper, 2).write(path,
+			[&hists](int flatId) { return hists[flatId]; });
+	assert(!written);
+	assert(!std::ifstream(path));
+
+	std::cout << "brick passed" << std::endl;
+	return 0;
+}
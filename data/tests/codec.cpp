@@ -0,0 +1,114 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <histcontainer.h>
+#include <varintcodec.h>
+
+namespace {
+
+long fileSize(const std::string& path) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	return long(fin.tellg());
+}
+
+void assertEqual(const Hist& expected, const Hist& actual) {
+	assert(expected.nDim() == actual.nDim());
+	assert(expected.nBins() == actual.nBins());
+	for (int iBin = 0; iBin < expected.nBins(); ++iBin)
+		assert(expected.binFreq(iBin) == actual.binFreq(iBin));
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// varints of every width round trip
+	std::string bytes;
+	std::vector<uint32_t> values = {0, 1, 127, 128, 16383, 16384, 4294967295u};
+	for (auto value : values)
+		VarintCodec::put(bytes, value);
+	assert(1 + 1 + 1 + 2 + 2 + 3 + 5 == bytes.size());
+	const char* in = bytes.data();
+	for (auto value : values)
+		assert(value == VarintCodec::get(in));
+	assert(bytes.data() + bytes.size() == in);
+
+	// a 16x16x8 volume of sparse 32x32 histograms, every 7th one empty
+	HistHelper helper;
+	helper.n_vx = 160; helper.n_vy = 160; helper.n_vz = 80;
+	helper.nh_x = 16; helper.nh_y = 16; helper.nh_z = 8;
+	helper.N_HIST = 16 * 16 * 8;
+	std::vector<std::string> vars = {"x", "y"};
+	std::vector<std::shared_ptr<const Hist>> hists(helper.N_HIST);
+	for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+		if (0 == iHist % 7) {
+			hists[iHist] = std::make_shared<HistNull>();
+			continue;
+		}
+		std::vector<int> binIds;
+		std::vector<float> freqs;
+		for (int iBin = iHist % 5; iBin < 32 * 32; iBin += 3 + iBin % 11) {
+			binIds.push_back(iBin);
+			freqs.push_back(float(1 + (iBin * iHist) % 300));
+		}
+		hists[iHist] = std::make_shared<Hist2D>(32, 32,
+				std::vector<double>{0.0, -1.0},
+				std::vector<double>{1.0, 1.0},
+				std::vector<double>{0.0, 0.0}, vars, binIds, freqs);
+	}
+	const std::string rawPath = "pdfs-indexed-raw";
+	const std::string compressedPath = "pdfs-indexed-compressed";
+	auto getHist = [&hists](int flatId) { return hists[flatId]; };
+	assert(HistContainerWriter(helper).write(rawPath, getHist));
+	assert(HistContainerWriter(helper, true).write(compressedPath, getHist));
+
+	HistContainerReader raw(rawPath, vars);
+	HistContainerReader compressed(compressedPath, vars);
+	assert(raw.good() && !raw.isCompressed());
+	assert(compressed.good() && compressed.isCompressed());
+	assert(fileSize(compressedPath) < fileSize(rawPath));
+
+	// single histograms decode from the middle of their blocks
+	for (int iHist = helper.N_HIST - 1; iHist >= 0; iHist -= 37)
+		assertEqual(*hists[iHist], *compressed.hist(iHist));
+	assert(compressed.summary(8).total == raw.summary(8).total);
+
+	// the whole volume on one and on all threads
+	for (int nThreads : {1, 0}) {
+		auto beg = std::chrono::steady_clock::now();
+		auto rawHists = raw.hists(nThreads);
+		auto mid = std::chrono::steady_clock::now();
+		auto compressedHists = compressed.hists(nThreads);
+		auto end = std::chrono::steady_clock::now();
+		for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+			assertEqual(*hists[iHist], *rawHists[iHist]);
+			assertEqual(*hists[iHist], *compressedHists[iHist]);
+		}
+		double rawMs = std::chrono::duration<double, std::milli>(
+				mid - beg).count();
+		double compressedMs = std::chrono::duration<double, std::milli>(
+				end - mid).count();
+		std::cout << (1 == nThreads ? "1 thread: " : "all threads: ")
+				<< "raw " << fileSize(rawPath) << " bytes in " << rawMs
+				<< " ms, compressed " << fileSize(compressedPath)
+				<< " bytes in " << compressedMs << " ms" << std::endl;
+	}
+
+	// fractional counts fall back to the raw columns
+	auto fractional = std::make_shared<Hist2D>(32, 32,
+			std::vector<double>{0.0, -1.0}, std::vector<double>{1.0, 1.0},
+			std::vector<double>{0.0, 0.0}, vars,
+			std::vector<int>{3}, std::vector<float>{0.5f});
+	assert(HistContainerWriter(helper, true).write(compressedPath,
+			[&fractional](int) { return fractional; }));
+	HistContainerReader fallback(compressedPath, vars);
+	assert(fallback.good() && !fallback.isCompressed());
+	assert(0.5f == fallback.hist(0)->binFreq(3));
+	std::remove(rawPath.c_str());
+	std::remove(compressedPath.c_str());
+
+	std::cout << "codec passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <histcolumnindex.h>
+#include <histreader.h>
+#include <utime.h>
+
+namespace {
+
+template <typename T>
+void writeRaw(std::ostream& out, const std::vector<T>& values) {
+	out.write(reinterpret_cast<const char*>(values.data()),
+			sizeof(T) * values.size());
+}
+
+// a domain of nHist 4x3 histograms, alternating sparse and dense records
+void writeDomain(std::ostream& out, int iDomain, int nHist) {
+	writeRaw(out, std::vector<int>{2, 10, 5, 5, nHist, 1, 1});
+	writeRaw(out, std::vector<double>{0.0, 0.0});
+	for (int iHist = 0; iHist < nHist; ++iHist) {
+		bool isSparse = 0 == iHist % 2;
+		std::vector<int> buffer;
+		for (int iBin = 0; iBin < 4 * 3; ++iBin) {
+			int freq = (iBin + iHist + iDomain) % 3;
+			if (isSparse && 0 < freq) {
+				buffer.push_back(iBin);
+				buffer.push_back(freq);
+			} else if (!isSparse) {
+				buffer.push_back(freq);
+			}
+		}
+		writeRaw(out, std::vector<int>{isSparse ? 1 : 0});
+		writeRaw(out, std::vector<double>{0.0, -1.0, 1.0, 1.0});
+		writeRaw(out, std::vector<int>{4, 3});
+		writeRaw(out, std::vector<double>{1.0});
+		writeRaw(out, std::vector<int>{int(buffer.size()) / 2});
+		writeRaw(out, buffer);
+	}
+}
+
+void assertEqual(const Hist& expected, const Hist& actual) {
+	assert(expected.nDim() == actual.nDim());
+	assert(expected.nBins() == actual.nBins());
+	for (int iBin = 0; iBin < expected.nBins(); ++iBin)
+		assert(expected.binFreq(iBin) == actual.binFreq(iBin));
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	std::vector<std::string> vars = {"x", "y"};
+	HistYColumnReader reader(".", "tst", "00000", vars);
+	auto path = reader.filename();
+	std::remove(HistColumnIndex::filename(path).c_str());
+	{
+		std::ofstream fout(path, std::ios::binary);
+		for (int iDomain = 0; iDomain < 3; ++iDomain)
+			writeDomain(fout, iDomain, 2 + iDomain);
+	}
+	auto domains = reader.read();
+	assert(3 == domains.size());
+
+	// the first access builds the sidecar
+	auto index = reader.index();
+	assert(index && 3 == index->nDomains());
+	assert(4 == index->domainHelper(2).N_HIST);
+	assert(4 == index->domainHelper(2).nh_x);
+	assert(10 == index->domainHelper(2).n_vx);
+	assert(std::ifstream(HistColumnIndex::filename(path)).good());
+
+	// domains and single histograms read through the index match read()
+	for (int iDomain = 2; iDomain >= 0; --iDomain) {
+		auto domain = reader.readDomain(iDomain);
+		assert(domain->helper().N_HIST == domains[iDomain]->helper().N_HIST);
+		for (int iHist = 0; iHist < domain->helper().N_HIST; ++iHist) {
+			auto expected = domains[iDomain]->hist(iHist);
+			assertEqual(*expected, *domain->hist(iHist));
+			assertEqual(*expected, *reader.readHist(iDomain, iHist));
+		}
+	}
+
+	// a fresh reader takes the sidecar as it is
+	auto reopened = HistColumnIndex::open(path);
+	assert(reopened->fileSize() == index->fileSize());
+	assert(reopened->histOffset(1, 2) == index->histOffset(1, 2));
+
+	// rewriting the file in place, even to the same size, makes it stale
+	struct utimbuf times = { index->fileMtime() + 100,
+			index->fileMtime() + 100 };
+	assert(0 == utime(path.c_str(), &times));
+	auto touched = HistColumnIndex::open(path);
+	assert(touched->fileMtime() == index->fileMtime() + 100);
+	assert(touched->fileMtime() == HistColumnIndex::open(path)->fileMtime());
+
+	// appending a domain makes the sidecar stale
+	{
+		std::ofstream fout(path, std::ios::binary | std::ios::app);
+		writeDomain(fout, 3, 1);
+	}
+	HistYColumnReader appended(".", "tst", "00000", vars);
+	assert(4 == appended.index()->nDomains());
+	assertEqual(*appended.read()[3]->hist(0), *appended.readHist(3, 0));
+	std::remove(path.c_str());
+	std::remove(HistColumnIndex::filename(path).c_str());
+
+	std::cout << "columnindex passed" << std::endl;
+	return 0;
+}
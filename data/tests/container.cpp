@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <histcontainer.h>
+
+int main(void)
+{
+	// a 3x2x2 volume of 3D histograms with a hole
+	HistHelper helper;
+	helper.n_vx = 30; helper.n_vy = 20; helper.n_vz = 20;
+	helper.nh_x = 3; helper.nh_y = 2; helper.nh_z = 2;
+	helper.N_HIST = 3 * 2 * 2;
+	std::vector<std::string> vars = {"x", "y", "z"};
+	std::vector<std::shared_ptr<const Hist>> hists(helper.N_HIST);
+	for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+		if (5 == iHist) {
+			hists[iHist] = std::make_shared<HistNull>();
+			continue;
+		}
+		std::vector<int> binIds;
+		std::vector<float> values;
+		for (int iBin = iHist % 3; iBin < 4 * 3 * 2; iBin += 3) {
+			binIds.push_back(iBin);
+			values.push_back(float(1 + (iBin + iHist) % 4));
+		}
+		auto hist = std::make_shared<Hist3DSparse>(4, 3, 2,
+				std::vector<double>{0.0, -1.0, 2.0},
+				std::vector<double>{1.0, 1.0, 4.0},
+				std::vector<double>{0.0, 0.0, 10.0}, vars, binIds, values);
+		hist->setPercentInRange(1.0 - 0.0625 * iHist);
+		hists[iHist] = hist;
+	}
+	const std::string path = "pdfs-indexed-test";
+	bool written = HistContainerWriter(helper).write(path,
+			[&hists](int flatId) { return hists[flatId]; });
+	assert(written);
+
+	HistContainerReader reader(path, vars);
+	assert(reader.good());
+	assert(3 == reader.helper().nh_x && 12 == reader.helper().N_HIST);
+	assert(30 == reader.helper().n_vx);
+
+	// random access, backwards so nothing relies on reading in order
+	for (int iHist = helper.N_HIST - 1; iHist >= 0; --iHist) {
+		auto expected = hists[iHist];
+		auto actual = reader.hist(iHist);
+		assert(expected->nDim() == actual->nDim());
+		assert(expected->nBins() == actual->nBins());
+		for (int iBin = 0; iBin < expected->nBins(); ++iBin)
+			assert(expected->binFreq(iBin) == actual->binFreq(iBin));
+		if (0 == expected->nDim())
+			continue;
+		assert(2.0 == actual->dimMin(2) && 10.0 == actual->logBase(2));
+		assert("z" == actual->var(2));
+		assert(expected->percentInRange() == actual->percentInRange());
+	}
+
+	// the summaries match the histograms without reading any bins
+	auto summaries = reader.summaries();
+	for (int iHist = 0; iHist < helper.N_HIST; ++iHist) {
+		auto summary = reader.summary(iHist);
+		assert(summary.total == summaries[iHist].total);
+		if (0 == hists[iHist]->nDim()) {
+			assert(summary.total < 0.0 && summary.means.empty());
+			continue;
+		}
+		double total = 0.0;
+		int nNonEmptyBins = 0;
+		for (int iBin = 0; iBin < hists[iHist]->nBins(); ++iBin) {
+			total += hists[iHist]->binFreq(iBin);
+			nNonEmptyBins += 0.f < hists[iHist]->binFreq(iBin) ? 1 : 0;
+		}
+		assert(total == summary.total);
+		assert(nNonEmptyBins == summary.nNonEmptyBins);
+		auto means = hists[iHist]->means();
+		for (int iDim = 0; iDim < 3; ++iDim)
+			assert(std::abs(means[iDim] - summary.means[iDim]) < 1e-6f);
+	}
+	std::remove(path.c_str());
+
+	std::cout << "container passed" << std::endl;
+	return 0;
+}
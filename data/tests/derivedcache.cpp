@@ -0,0 +1,89 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include <histderivedcache.h>
+
+namespace {
+
+void writeSource(const std::string& path, int nBytes) {
+	std::ofstream fout(path, std::ios::binary);
+	fout << std::string(nBytes, 'x');
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	const std::string stepDir = "derivedcache-step";
+	mkdir(stepDir.c_str(), 0755);
+	writeSource(stepDir + "/pdfs-ycolumn-001.00000", 100);
+	writeSource(stepDir + "/pdfs-ycolumn-001.00000.idx", 10);
+	auto source = HistDerivedCache::sourceOf(stepDir);
+	assert(100 == source.size);
+
+	// scalars round trip and are keyed by step, config, product and dims
+	HistDerivedCache cache(".");
+	auto key = HistDerivedCache::key("1.0E-03", "001", "freqrange", {0, 2});
+	assert("1.0E-03-001-freqrange-0-2" == key);
+	std::vector<float> range;
+	std::remove((cache.dir() + "/" + key + ".bin").c_str());
+	assert(!cache.get(key, source, range));
+	assert(cache.put(key, source, std::vector<float>{0.25f, 0.75f}));
+	assert(cache.get(key, source, range));
+	assert(2 == range.size() && 0.25f == range[0] && 0.75f == range[1]);
+	auto entry = cache.get(key, source);
+	assert(entry && 2 * sizeof(float) == entry->size());
+
+	// marginals, with the empty histograms kept in place
+	std::vector<std::string> vars = {"x", "y"};
+	std::vector<std::shared_ptr<const Hist>> hists = {
+		std::make_shared<Hist2D>(3, 2, std::vector<double>{0.0, -1.0},
+				std::vector<double>{1.0, 1.0}, std::vector<double>{1.0, 10.0},
+				vars, std::vector<int>{0, 4}, std::vector<float>{2.f, 6.f}),
+		std::make_shared<HistNull>(),
+		std::make_shared<Hist2D>(3, 2, std::vector<double>{0.0, 0.0},
+				std::vector<double>{2.0, 2.0}, std::vector<double>{1.0, 1.0},
+				vars, std::vector<int>{5}, std::vector<float>{1.f})
+	};
+	auto histsKey = HistDerivedCache::key("1.0E-03", "001", "hists", {0, 1});
+	assert(cache.putHists(histsKey, source, hists));
+	auto cached = cache.getHists(histsKey, source, vars);
+	assert(3 == cached.size());
+	assert(0 == cached[1]->nDim());
+	for (int iHist : {0, 2}) {
+		assert(2 == cached[iHist]->nDim());
+		assert(6 == cached[iHist]->nBins());
+		for (int iDim = 0; iDim < 2; ++iDim) {
+			assert(hists[iHist]->dimMin(iDim) == cached[iHist]->dimMin(iDim));
+			assert(hists[iHist]->dimMax(iDim) == cached[iHist]->dimMax(iDim));
+			assert(hists[iHist]->logBase(iDim)
+					== cached[iHist]->logBase(iDim));
+		}
+		for (int iBin = 0; iBin < 6; ++iBin)
+			assert(hists[iHist]->binFreq(iBin) == cached[iHist]->binFreq(iBin));
+	}
+	assert(0.75f == cached[0]->binPercent(4));
+
+	// changing the source makes every entry stale, rewriting the sidecar not
+	writeSource(stepDir + "/pdfs-ycolumn-001.00000.idx", 20);
+	assert(cache.get(key, HistDerivedCache::sourceOf(stepDir)));
+	writeSource(stepDir + "/pdfs-ycolumn-001.00000", 101);
+	auto changed = HistDerivedCache::sourceOf(stepDir);
+	assert(!cache.get(key, changed));
+	assert(cache.getHists(histsKey, changed, vars).empty());
+	assert(cache.put(key, changed, std::vector<float>{0.f, 1.f}));
+	assert(cache.get(key, changed, range) && 1.f == range[1]);
+
+	std::remove((cache.dir() + "/" + key + ".bin").c_str());
+	std::remove((cache.dir() + "/" + histsKey + ".bin").c_str());
+	std::remove((stepDir + "/pdfs-ycolumn-001.00000").c_str());
+	std::remove((stepDir + "/pdfs-ycolumn-001.00000.idx").c_str());
+	std::remove(stepDir.c_str());
+	std::remove(cache.dir().c_str());
+	std::remove("./.histcache");
+
+	std::cout << "derivedcache passed" << std::endl;
+	return 0;
+}
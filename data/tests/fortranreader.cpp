@@ -0,0 +1,91 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <fortranreader.h>
+
+namespace {
+
+template <typename T>
+void writeRecord(std::ostream& out, std::vector<T> values, bool swap) {
+	int32_t marker = sizeof(T) * values.size();
+	if (swap) {
+		marker = ByteOrder::swap(marker);
+		for (auto& value : values)
+			value = ByteOrder::swap(value);
+	}
+	out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+	out.write(reinterpret_cast<const char*>(values.data()),
+			sizeof(T) * values.size());
+	out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+}
+
+// the bulk swap against swapping one element at a time, over lengths that
+// leave a tail after the 16-byte blocks
+template <typename T>
+void checkSwapArray(int n) {
+	std::vector<T> values(n);
+	for (int i = 0; i < n; ++i) {
+		unsigned char* bytes = reinterpret_cast<unsigned char*>(&values[i]);
+		for (unsigned int iByte = 0; iByte < sizeof(T); ++iByte)
+			bytes[iByte] = (unsigned char)(i * sizeof(T) + iByte);
+	}
+	std::vector<T> swapped = values;
+	ByteOrder::swapArray(swapped.data(), swapped.size());
+	for (int i = 0; i < n; ++i) {
+		T expected = ByteOrder::swap(values[i]);
+		assert(0 == std::memcmp(&expected, &swapped[i], sizeof(T)));
+	}
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	for (int n : {0, 1, 3, 8, 17, 100}) {
+		checkSwapArray<int16_t>(n);
+		checkSwapArray<int32_t>(n);
+		checkSwapArray<int64_t>(n);
+		checkSwapArray<float>(n);
+		checkSwapArray<double>(n);
+	}
+
+	// the same records in both byte orders read the same
+	const std::string path = "fortranreader.bin";
+	for (bool swap : {false, true}) {
+		{
+			std::ofstream fout(path, std::ios::binary);
+			std::vector<char> name = {'t', 'e', 's', 't'};
+			writeRecord(fout, name, swap);
+			writeRecord(fout, std::vector<double>{0.5}, swap);
+			writeRecord(fout, std::vector<float>{1.f, 2.f, 3.f, 4.f, 5.f},
+					swap);
+			writeRecord(fout, std::vector<int64_t>{7, 8, 9}, swap);
+			writeRecord(fout, std::vector<int32_t>{-1}, swap);
+		}
+		FortranReader reader(path);
+		assert(reader.good());
+		assert(swap == reader.swapsBytes());
+		auto name = reader.readCharArray();
+		assert("test" == std::string(name.begin(), name.end()));
+		assert(0.5 == reader.readDouble());
+		int64_t floatsPos = reader.currReadPos();
+		auto floats = reader.readFloatArray();
+		assert(5 == floats.size() && 1.f == floats[0] && 5.f == floats[4]);
+		reader.setReadPosFromBeg(floatsPos);
+		auto sub = reader.readSubArray<float>(1, 3);
+		assert(3 == sub.size() && 2.f == sub[0] && 4.f == sub[2]);
+		std::vector<int64_t> ints(100);
+		reader.readArray(ints);
+		assert(3 == ints.size() && 7 == ints[0] && 9 == ints[2]);
+		reader.ignoreRecord();
+		assert(reader.good());
+		reader.ignoreRecord();
+		assert(!reader.good());
+	}
+
+	std::remove(path.c_str());
+
+	std::cout << "fortranreader passed" << std::endl;
+	return 0;
+}
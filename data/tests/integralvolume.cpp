@@ -0,0 +1,62 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <histintegralvolume.h>
+
+int main(void)
+{
+	const int n = 48;
+	const int nBins = 32;
+	Extent dimHists(n, n, n);
+	std::vector<std::shared_ptr<const Hist>> hists(dimHists.nElement());
+	std::srand(7);
+	for (unsigned int iHist = 0; iHist < hists.size(); ++iHist) {
+		std::vector<float> values(nBins);
+		for (int iBin = 0; iBin < nBins; ++iBin)
+			values[iBin] = float(std::rand() % 100);
+		hists[iHist] = std::make_shared<Hist1D>(
+				nBins, 0.0, 1.0, 0.0, "x", values);
+	}
+	auto getHist = [&hists](int flatId) { return hists[flatId]; };
+	auto integral = HistIntegralVolume::create(dimHists, getHist);
+	assert(integral);
+
+	// the box aggregate matches summing every histogram in the box
+	std::vector<int> lower = {3, 5, 7}, upper = {20, 31, 12};
+	auto boxHist = integral->boxHist(lower, upper);
+	for (int iBin = 0; iBin < nBins; ++iBin) {
+		double sum = 0.0;
+		for (int z = lower[2]; z < upper[2]; ++z)
+		for (int y = lower[1]; y < upper[1]; ++y)
+		for (int x = lower[0]; x < upper[0]; ++x)
+			sum += hists[dimHists.idstoflat(x, y, z)]->binFreq(iBin);
+		assert(std::abs(boxHist->binFreq(iBin) - sum) <= 1e-3 * sum);
+	}
+
+	// differently binned histograms are refused
+	std::vector<std::shared_ptr<const Hist>> mixed = hists;
+	mixed[1] = std::make_shared<Hist1D>(nBins, 0.0, 2.0, 0.0, "x",
+			std::vector<float>(nBins, 1.f));
+	assert(!HistIntegralVolume::create(dimHists,
+			[&mixed](int flatId) { return mixed[flatId]; }));
+
+	// the cost of a box query does not depend on the size of the box
+	const int nQueries = 2000;
+	for (int size = 1; size <= n; size *= 2) {
+		auto beg = std::chrono::steady_clock::now();
+		for (int iQuery = 0; iQuery < nQueries; ++iQuery) {
+			int offset = iQuery % (n - size + 1);
+			integral->boxHist({offset, offset, offset},
+					{offset + size, offset + size, offset + size});
+		}
+		auto end = std::chrono::steady_clock::now();
+		std::cout << "box " << size << "^3: "
+				<< std::chrono::duration<double, std::micro>(
+					end - beg).count() / nQueries
+				<< " us per query" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <Extent.h>
+#include <fortranreader.h>
+
+namespace {
+
+// gfortran's longest subrecord
+const int64_t maxSubrecord = 2147483639;
+
+template <typename T>
+T bigEndian(T value) {
+	return ByteOrder::swap(value);
+}
+
+void writeMarker(std::ostream& out, int64_t position, int32_t marker) {
+	marker = bigEndian(marker);
+	out.seekp(position);
+	out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+}
+
+/**
+ * A record of nBytes at position split into subrecords like gfortran does,
+ * leaving the data as a hole of the sparse file. Returns the position after
+ * the record and fills in where each subrecord's data starts.
+ */
+int64_t writeLargeRecord(std::ostream& out, int64_t position, int64_t nBytes,
+		std::vector<int64_t>& dataStarts) {
+	for (int64_t done = 0; done < nBytes;) {
+		int64_t length = std::min(maxSubrecord, nBytes - done);
+		bool isFirst = 0 == done;
+		bool isLast = done + length == nBytes;
+		writeMarker(out, position, int32_t(isLast ? length : -length));
+		dataStarts.push_back(position + 4);
+		writeMarker(out, position + 4 + length,
+				int32_t(isFirst ? length : -length));
+		position += length + 8;
+		done += length;
+	}
+	return position;
+}
+
+// writes a value at a record position through the subrecord layout
+template <typename T>
+void writeAt(std::ostream& out, const std::vector<int64_t>& dataStarts,
+		int64_t recordPos, T value) {
+	value = bigEndian(value);
+	const char* bytes = reinterpret_cast<const char*>(&value);
+	for (unsigned int iByte = 0; iByte < sizeof(T); ++iByte) {
+		int64_t pos = recordPos + iByte;
+		int64_t iSubrecord = pos / maxSubrecord;
+		out.seekp(dataStarts[iSubrecord] + pos % maxSubrecord);
+		out.write(bytes + iByte, 1);
+	}
+}
+
+template <typename T>
+int64_t writeSmallRecord(std::ostream& out, int64_t position, T value) {
+	writeMarker(out, position, sizeof(T));
+	value = bigEndian(value);
+	out.seekp(position + 4);
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	writeMarker(out, position + 4 + sizeof(T), sizeof(T));
+	return position + 8 + sizeof(T);
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// flat ids past 2^31
+	Extent dim(2048, 2048, 2048);
+	assert(int64_t(1) << 33 == dim.nElement());
+	int64_t lastId = dim.idstoflat(2047, 2047, 2047);
+	assert(dim.nElement() - 1 == lastId);
+	assert(lastId == dim.idstoflat(std::vector<int>{2047, 2047, 2047}));
+	auto ids = dim.flattoids(lastId - 1);
+	assert(2046 == ids[0] && 2047 == ids[1] && 2047 == ids[2]);
+	int x, y, z;
+	dim.flattoids(int64_t(3) << 31, &x, &y, &z);
+	assert(0 == x && 0 == y && 1536 == z);
+
+	// an int32 record, an int64 record of 4.5 GB in three subrecords and
+	// another int32 record behind it, in a sparse file
+	const std::string path = "largefile.dat";
+	const int64_t nElements = 600000000;
+	std::vector<int64_t> dataStarts;
+	int64_t end;
+	{
+		std::ofstream fout(path, std::ios::binary);
+		int64_t position = writeSmallRecord<int32_t>(fout, 0, 7);
+		position = writeLargeRecord(fout, position,
+				nElements * sizeof(int64_t), dataStarts);
+		end = writeSmallRecord<int32_t>(fout, position, 42);
+		// one element across the first subrecord boundary and the last one
+		int64_t straddling = maxSubrecord / sizeof(int64_t);
+		writeAt<int64_t>(fout, dataStarts, straddling * sizeof(int64_t),
+				int64_t(0x0102030405060708));
+		writeAt<int64_t>(fout, dataStarts, (nElements - 1) * sizeof(int64_t),
+				-5);
+		assert(fout);
+	}
+	assert(3 == dataStarts.size());
+	assert(end > (int64_t(1) << 32));
+
+	FortranReader reader(path);
+	assert(7 == reader.readInt32());
+	int64_t largeRecordPos = reader.currReadPos();
+	auto straddling = reader.readSubArray<int64_t>(
+			maxSubrecord / sizeof(int64_t) - 1, 3);
+	assert(0 == straddling[0]);
+	assert(int64_t(0x0102030405060708) == straddling[1]);
+	assert(0 == straddling[2]);
+	assert(42 == reader.readInt32());
+	assert(end == reader.currReadPos());
+	reader.setReadPosFromBeg(largeRecordPos);
+	assert(-5 == reader.readSubArray<int64_t>(nElements - 1, 1)[0]);
+	reader.setReadPosFromBeg(largeRecordPos);
+	reader.ignoreRecord();
+	assert(42 == reader.readInt32());
+	std::remove(path.c_str());
+
+	std::cout << "largefile passed" << std::endl;
+	return 0;
+}
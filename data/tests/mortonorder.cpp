@@ -0,0 +1,61 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <mortonorder.h>
+
+int main(void)
+{
+	// the bits interleave x lowest
+	assert(1 == MortonOrder::encode(1, 0, 0));
+	assert(2 == MortonOrder::encode(0, 1, 0));
+	assert(4 == MortonOrder::encode(0, 0, 1));
+	assert(0x3f == MortonOrder::encode(3, 3, 3));
+	assert(uint64_t(1) << 62 == MortonOrder::encode(0, 0, 1 << 20));
+	uint32_t x, y, z;
+	MortonOrder::decode(MortonOrder::encode(123456, 7, 2097151), x, y, z);
+	assert(123456 == x && 7 == y && 2097151 == z);
+
+	// a 4x4x4 grid of locations, listed with z fastest
+	std::vector<float> xyzs;
+	for (int x = 0; x < 4; ++x)
+	for (int y = 0; y < 4; ++y)
+	for (int z = 0; z < 4; ++z)
+		xyzs.insert(xyzs.end(), { float(x), float(y), float(z) });
+
+	// along the curve the first octant comes first
+	auto sorted = MortonOrder::sorted(xyzs);
+	assert(64 == sorted.size());
+	for (int i = 0; i < 8; ++i) {
+		int64_t id = sorted[i];
+		assert(xyzs[3 * id] < 2.f && xyzs[3 * id + 1] < 2.f);
+		assert(xyzs[3 * id + 2] < 2.f);
+	}
+	assert(0 == sorted[0] && 16 == sorted[1] && 4 == sorted[2]);
+
+	// the stratified order visits every location once, and its first eight
+	// fall in the eight octants
+	auto strata = MortonOrder::stratified(xyzs);
+	auto check = strata;
+	std::sort(check.begin(), check.end());
+	for (int i = 0; i < 64; ++i)
+		assert(i == check[i]);
+	int octants = 0;
+	for (int i = 0; i < 8; ++i) {
+		int64_t id = strata[i];
+		int octant = int(xyzs[3 * id] >= 2.f)
+				| int(xyzs[3 * id + 1] >= 2.f) << 1
+				| int(xyzs[3 * id + 2] >= 2.f) << 2;
+		octants |= 1 << octant;
+	}
+	assert(0xff == octants);
+
+	// any count works, not only powers of two
+	xyzs.resize(3 * 37);
+	strata = MortonOrder::stratified(xyzs);
+	std::sort(strata.begin(), strata.end());
+	for (int i = 0; i < 37; ++i)
+		assert(i == strata[i]);
+
+	std::cout << "mortonorder passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <histmerger.h>
+
+int main(void)
+{
+	// many identical 2D histograms merged into the same binning should sum up
+	// bin by bin, regardless of how the work is split across threads.
+	const int nHists = 20000;
+	const int nBinsX = 8, nBinsY = 4;
+	std::vector<float> values(nBinsX * nBinsY);
+	for (unsigned int i = 0; i < values.size(); ++i)
+		values[i] = float(i % 5);
+	std::vector<std::shared_ptr<const Hist>> hists(nHists);
+	for (int iHist = 0; iHist < nHists; ++iHist) {
+		hists[iHist] = std::shared_ptr<const Hist>(Hist::fromDenseValues(
+				2, {nBinsX, nBinsY}, {0.0, -1.0}, {1.0, 1.0}, {0.0, 0.0},
+				{"x", "y"}, values));
+	}
+
+	auto beg = std::chrono::steady_clock::now();
+	std::shared_ptr<Hist> merged =
+			HistMerger({BinCount(nBinsX), BinCount(nBinsY)}).merge(hists);
+	auto end = std::chrono::steady_clock::now();
+	std::cout << "merged " << nHists << " hists in "
+			<< std::chrono::duration<double, std::milli>(end - beg).count()
+			<< " ms" << std::endl;
+
+	assert(merged->nDim() == 2);
+	assert(merged->dim()[0] == nBinsX && merged->dim()[1] == nBinsY);
+	for (int iBin = 0; iBin < merged->nBins(); ++iBin) {
+		float expected = float(nHists) * values[iBin];
+		assert(std::abs(merged->binFreq(iBin) - expected) <= 1e-4 * expected);
+	}
+
+	// automatic bin counts go through the parallel marginal accumulation.
+	std::shared_ptr<Hist> freedman = HistMerger(
+			{BinCount("freedman"), BinCount("freedman")}).merge(hists);
+	double total = 0.0;
+	for (int iBin = 0; iBin < freedman->nBins(); ++iBin)
+		total += freedman->binFreq(iBin);
+	double expected = double(nHists) * hists[0]->binSum().value();
+	assert(std::abs(total - expected) <= 1e-4 * expected);
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <particlebinner.h>
+
+int main(void)
+{
+	// particles spread over [0, 1)^3 with temperatures in [300, 2300)
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	ParticleColumns parts(ParticleColumns::XLOC | ParticleColumns::TEMP);
+	const int n = 100000;
+	for (int i = 0; i < n; ++i) {
+		double xloc[3] = { unit(rng), unit(rng), unit(rng) };
+		parts.push_back(i, xloc, xloc, 300.0 + 2000.0 * unit(rng));
+	}
+
+	// a 3d histogram counts every particle in the bin it falls in, the same
+	// on any number of threads
+	std::vector<ParticleBinner::Axis> axes = {
+		{ ParticleBinner::X, 4, 0.0, 1.0 },
+		{ ParticleBinner::Y, 5, 0.0, 1.0 },
+		{ ParticleBinner::TEMP, 6, 300.0, 2300.0 }
+	};
+	auto counts = ParticleBinner(axes, 4).counts(parts);
+	assert(4 * 5 * 6 == counts.size());
+	assert(counts == ParticleBinner(axes, 1).counts(parts));
+	std::vector<float> expected(counts.size(), 0.f);
+	for (int i = 0; i < n; ++i) {
+		int x = int(parts.xlocs()[3 * i] * 4.f);
+		int y = int(parts.xlocs()[3 * i + 1] * 5.f);
+		int t = std::min(5, int((parts.temps()[i] - 300.f) / 2000.f * 6.f));
+		expected[x + 4 * (y + 5 * t)] += 1.f;
+	}
+	float sum = 0.f;
+	for (size_t iBin = 0; iBin < counts.size(); ++iBin) {
+		assert(std::abs(counts[iBin] - expected[iBin]) <= 1.f);
+		sum += counts[iBin];
+	}
+	assert(float(n) == sum);
+
+	// the histograms are the dense ones of the loaded pdfs
+	auto hist3d = ParticleBinner(axes).bin(parts);
+	assert(3 == hist3d->nDim() && 6 == hist3d->dim()[2]);
+	assert("T" == hist3d->var(2) && 300.0 == hist3d->dimMin(2));
+	assert(counts[7] == hist3d->binFreq(7));
+	auto hist2d = ParticleBinner({ axes[0], axes[2] }).bin(parts);
+	assert(2 == hist2d->nDim() && 24 == hist2d->values().size());
+	auto hist1d = ParticleBinner({ axes[2] }).bin(parts);
+	assert(1 == hist1d->nDim() && 6 == hist1d->values().size());
+	assert(std::abs(hist1d->binPercent(0) - 1.f / 6.f) < 0.01f);
+
+	// the particles out of range, NaN among them, are left out, and the
+	// upper bound falls in the last bin
+	ParticleColumns edges(ParticleColumns::XLOC | ParticleColumns::TEMP);
+	double xloc[3] = { 0.0, 0.0, 0.0 };
+	edges.push_back(0, xloc, xloc, 1.0);
+	edges.push_back(1, xloc, xloc, -0.5);
+	edges.push_back(2, xloc, xloc, 2.0);
+	edges.push_back(3, xloc, xloc, std::numeric_limits<double>::quiet_NaN());
+	edges.push_back(4, xloc, xloc, 0.0);
+	counts = ParticleBinner({ { ParticleBinner::TEMP, 2, 0.0, 1.0 } })
+			.counts(edges);
+	assert(1.f == counts[0] && 1.f == counts[1]);
+
+	// fitting spans the values, and an attribute not held counts nothing
+	auto fit = ParticleBinner::fit(parts, ParticleBinner::TEMP, 8);
+	assert(300.0 <= fit.min && fit.max < 2300.0 && 8 == fit.nBins);
+	counts = ParticleBinner({ fit }).counts(parts);
+	assert(float(n) == counts[0] + counts[1] + counts[2] + counts[3]
+			+ counts[4] + counts[5] + counts[6] + counts[7]);
+	ParticleColumns ssns(ParticleColumns::SSN);
+	ssns.push_back(0, xloc, xloc, 0.0);
+	assert(0.f == ParticleBinner({ axes[0] }).counts(ssns)[0]);
+
+	std::cout << "particlebinner passed" << std::endl;
+	return 0;
+}
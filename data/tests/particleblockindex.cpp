@@ -0,0 +1,142 @@
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <particleblockindex.h>
+
+namespace {
+
+std::set<int64_t> ssnsOf(const ParticleColumns& parts) {
+	return std::set<int64_t>(parts.ssns().begin(), parts.ssns().end());
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// particles scattered over a 64x32x16 box
+	std::mt19937 random(7);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	ParticleColumns parts(ParticleColumns::ALL);
+	for (int i = 0; i < 20000; ++i) {
+		double loc[3] = { double(i), 0.0, 0.0 };
+		double xloc[3] = { 64 * unit(random), 32 * unit(random),
+				16 * unit(random) };
+		parts.push_back(i, loc, xloc, 1000.0 + i);
+	}
+	std::string path = ParticleBlockIndex::filename("./");
+	const ParticleBlockIndex::Source source = { 123, 456 };
+	assert(ParticleBlockIndex::write(path, parts, source, 3));
+	auto index = ParticleBlockIndex::open(path, source);
+	assert(index && 3 == index->level());
+	assert(20000 == index->nParticles() && 512 == index->nBlocks());
+	assert(!ParticleBlockIndex::open("./missing.bin", source));
+	// an index of other tracer files is stale
+	assert(!ParticleBlockIndex::open(path, {123, 457}));
+	// as is one cut short
+	{
+		std::ifstream fin(path, std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(fin)),
+				std::istreambuf_iterator<char>());
+		std::ofstream fout("./truncated.bin", std::ios::binary);
+		fout.write(bytes.data(), bytes.size() - 4);
+	}
+	assert(!ParticleBlockIndex::open("./truncated.bin", source));
+	std::remove("./truncated.bin");
+	// the source counts the tracer files only
+	auto before = ParticleBlockIndex::sourceOf("./");
+	std::ofstream("./tracer.99999", std::ios::binary) << "0123456789";
+	assert(before.size + 10 == ParticleBlockIndex::sourceOf("./").size);
+	std::remove("./tracer.99999");
+
+	// a box returns what a full scan finds, from the blocks it touches
+	float lower[3] = { 10.f, 5.f, 2.f }, upper[3] = { 20.f, 9.f, 6.f };
+	std::set<int64_t> expected;
+	for (int64_t i = 0; i < parts.size(); ++i) {
+		const float* xloc = &parts.xlocs()[3 * i];
+		if (lower[0] <= xloc[0] && xloc[0] <= upper[0]
+				&& lower[1] <= xloc[1] && xloc[1] <= upper[1]
+				&& lower[2] <= xloc[2] && xloc[2] <= upper[2])
+			expected.insert(parts.ssns()[i]);
+	}
+	auto box = index->read(lower, upper);
+	assert(!expected.empty() && expected == ssnsOf(box));
+	for (int64_t i = 0; i < box.size(); ++i) {
+		int64_t ssn = box.ssns()[i];
+		assert(float(1000.0 + ssn) == box.temps()[i]);
+		assert(parts.locs()[3 * ssn] == box.locs()[3 * i]);
+		assert(parts.xlocs()[3 * ssn + 2] == box.xlocs()[3 * i + 2]);
+	}
+	int64_t nRead = 0;
+	auto touched = index->blocks([&](const float* lo, const float* hi) {
+		for (int iDim = 0; iDim < 3; ++iDim) {
+			if (hi[iDim] < lower[iDim] || upper[iDim] < lo[iDim])
+				return false;
+		}
+		return true;
+	});
+	for (int iBlock : touched)
+		nRead += index->blockCount(iBlock);
+	assert(nRead < parts.size() / 8);
+
+	// only the attributes asked for, and any region
+	auto sphere = index->read([](const float* lo, const float* hi) {
+		return lo[0] < 40.f && 24.f < hi[0];
+	}, [](const float* xloc) {
+		float dx = xloc[0] - 32.f, dy = xloc[1] - 16.f, dz = xloc[2] - 8.f;
+		return dx * dx + dy * dy + dz * dz < 64.f;
+	}, ParticleColumns::SSN);
+	assert(!sphere.empty() && sphere.temps().empty());
+	for (int64_t ssn : sphere.ssns()) {
+		const float* xloc = &parts.xlocs()[3 * ssn];
+		float dx = xloc[0] - 32.f, dy = xloc[1] - 16.f, dz = xloc[2] - 8.f;
+		assert(dx * dx + dy * dy + dz * dz < 64.f);
+	}
+
+	// the whole box holds every particle
+	float all[2][3] = { { 0.f, 0.f, 0.f }, { 64.f, 32.f, 16.f } };
+	assert(20000 == index->read(all[0], all[1]).size());
+
+	// written out of core from batches, the index is the same file
+	auto scanBatches = [&](const ParticleBlockIndex::BatchCallback& take) {
+		for (int64_t begin = 0; begin < parts.size(); begin += 3000) {
+			ParticleColumns batch(ParticleColumns::ALL);
+			for (int64_t i = begin; i < std::min<int64_t>(begin + 3000,
+					parts.size()); ++i) {
+				double loc[3], xloc[3];
+				for (int iDim = 0; iDim < 3; ++iDim) {
+					loc[iDim] = parts.locs()[3 * i + iDim];
+					xloc[iDim] = parts.xlocs()[3 * i + iDim];
+				}
+				batch.push_back(parts.ssns()[i], loc, xloc, parts.temps()[i]);
+			}
+			if (!take(batch))
+				return false;
+		}
+		return true;
+	};
+	std::string batchedPath = "./batchedblocks.bin";
+	assert(ParticleBlockIndex::write(batchedPath, scanBatches, source, 3));
+	auto bytesOf = [](const std::string& file) {
+		std::ifstream fin(file, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(fin)),
+				std::istreambuf_iterator<char>());
+	};
+	assert(bytesOf(path) == bytesOf(batchedPath));
+	// a scan that fails on the way leaves no index
+	std::remove(batchedPath.c_str());
+	int nScans = 0;
+	assert(!ParticleBlockIndex::write(batchedPath,
+			[&](const ParticleBlockIndex::BatchCallback& take) {
+		return 3 > ++nScans && scanBatches(take);
+	}, source, 3));
+	assert(!std::ifstream(batchedPath));
+
+	std::remove(path.c_str());
+	std::cout << "particleblockindex passed" << std::endl;
+	return 0;
+}
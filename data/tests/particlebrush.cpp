@@ -0,0 +1,63 @@
+#include <iostream>
+#include <cassert>
+#include <limits>
+#include <random>
+#include <particlebrush.h>
+
+int main(void)
+{
+	// particles spread over [0, 1)^3 with temperatures in [300, 2300)
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	ParticleColumns parts(ParticleColumns::XLOC | ParticleColumns::TEMP);
+	const int n = 100003;
+	for (int i = 0; i < n; ++i) {
+		double xloc[3] = { unit(rng), unit(rng), unit(rng) };
+		parts.push_back(i, xloc, xloc, 300.0 + 2000.0 * unit(rng));
+	}
+
+	// no range picks every particle
+	auto masks = ParticleBrush().mask(parts);
+	assert(n == masks.size());
+	for (auto mask : masks)
+		assert(0xff == mask);
+
+	// the particles in every range are picked, the same on any number of
+	// threads
+	std::vector<ParticleBrush::Range> ranges = {
+		{ ParticleBinner::X, 0.25f, 0.75f },
+		{ ParticleBinner::Z, 0.f, 0.5f },
+		{ ParticleBinner::TEMP, 1000.f, 2000.f }
+	};
+	masks = ParticleBrush(ranges, 4).mask(parts);
+	assert(masks == ParticleBrush(ranges, 1).mask(parts));
+	int nPicked = 0;
+	for (int i = 0; i < n; ++i) {
+		float x = parts.xlocs()[3 * i], z = parts.xlocs()[3 * i + 2];
+		float temp = parts.temps()[i];
+		bool picked = 0.25f <= x && x <= 0.75f && z <= 0.5f
+				&& 1000.f <= temp && temp <= 2000.f;
+		assert((picked ? 0xff : 0) == masks[i]);
+		nPicked += picked;
+	}
+	assert(0 < nPicked && nPicked < n);
+
+	// the bounds are inclusive, NaN is never picked, and a range on an
+	// attribute not held is ignored
+	ParticleColumns edges(ParticleColumns::LOC | ParticleColumns::TEMP);
+	double loc[3] = { 0.0, 0.0, 0.0 };
+	edges.push_back(0, loc, loc, 1.0);
+	edges.push_back(1, loc, loc, 2.0);
+	edges.push_back(2, loc, loc, 3.0);
+	edges.push_back(3, loc, loc, std::numeric_limits<double>::quiet_NaN());
+	masks = ParticleBrush({ { ParticleBinner::TEMP, 1.f, 2.f } }).mask(edges);
+	assert(0xff == masks[0] && 0xff == masks[1]);
+	assert(0 == masks[2] && 0 == masks[3]);
+	ParticleColumns ssns(ParticleColumns::SSN);
+	ssns.push_back(0, loc, loc, 0.0);
+	masks = ParticleBrush({ { ParticleBinner::TEMP, 1.f, 2.f } }).mask(ssns);
+	assert(0xff == masks[0]);
+
+	std::cout << "particlebrush passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cassert>
+#include <particlecolumns.h>
+
+int main(void)
+{
+	const double loc[3] = {1.0, 2.0, 3.0};
+	const double xloc[3] = {0.5, 0.25, 0.125};
+
+	// only the attributes asked for are kept
+	ParticleColumns parts(ParticleColumns::XLOC | ParticleColumns::TEMP);
+	assert(parts.empty());
+	parts.push_back(7, loc, xloc, 300.0);
+	parts.push_back(8, loc, xloc, 400.0);
+	assert(2 == parts.size());
+	assert(parts.ssns().empty() && parts.locs().empty());
+	assert(6 == parts.xlocs().size() && 2 == parts.temps().size());
+	assert(0.25f == parts.xlocs()[4] && 400.f == parts.temps()[1]);
+	assert(8 * int64_t(sizeof(float)) == parts.nBytes());
+
+	// the velocities and mixture fractions are zero unless given
+	const double vel[3] = {-1.0, 0.0, 1.0};
+	ParticleColumns flow(ParticleColumns::VEL | ParticleColumns::MIXFRAC);
+	flow.push_back(7, loc, xloc, 300.0);
+	flow.push_back(8, loc, xloc, 400.0, vel, 0.75);
+	assert(6 == flow.vels().size() && 2 == flow.mixfracs().size());
+	assert(0.f == flow.vels()[0] && 1.f == flow.vels()[5]);
+	assert(0.75f == flow.mixfracs()[1] && flow.temps().empty());
+	flow.resize(3);
+	assert(3 == flow.size() && 9 == flow.vels().size());
+	assert(0.f == flow.mixfracs()[2] && flow.xlocs().empty());
+
+	// the parts of several readers concatenate in order
+	ParticleColumns all(ParticleColumns::ALL);
+	all.push_back(1, loc, xloc, 10.0);
+	std::vector<ParticleColumns> pieces(2, all);
+	pieces[1].push_back(2, loc, xloc, 20.0);
+	auto concat = ParticleColumns::concat(pieces, ParticleColumns::ALL);
+	assert(3 == concat.size());
+	assert(3 == concat.ssns().size() && 2 == concat.ssns()[2]);
+	assert(9 == concat.locs().size() && 3.f == concat.locs()[8]);
+	assert(20.f == concat.temps()[2]);
+
+	// every column follows the new order
+	concat.permute({2, 0, 1});
+	assert(9 == concat.vels().size() && 3 == concat.mixfracs().size());
+	assert(2 == concat.ssns()[0] && 1 == concat.ssns()[2]);
+	assert(20.f == concat.temps()[0] && 10.f == concat.temps()[1]);
+	assert(9 == concat.xlocs().size() && 0.5f == concat.xlocs()[3]);
+
+	// a moved-from one is left empty, so appending it again adds nothing
+	ParticleColumns moved = std::move(pieces[1]);
+	assert(2 == moved.size() && 2 == moved.ssns().size());
+	assert(pieces[1].empty() && pieces[1].ssns().empty());
+	assert(ParticleColumns::ALL == pieces[1].attributes());
+	pieces[0] = std::move(moved);
+	assert(moved.empty() && 2 == pieces[0].size());
+	auto twice = ParticleColumns::concat({ pieces[0], moved },
+			ParticleColumns::ALL);
+	assert(2 == twice.size() && 2 == twice.ssns().size());
+
+	concat.clear();
+	assert(concat.empty() && concat.temps().empty());
+
+	std::cout << "particlecolumns passed" << std::endl;
+	return 0;
+}
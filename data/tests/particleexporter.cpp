@@ -0,0 +1,109 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <particleexporter.h>
+
+namespace {
+
+ParticleColumns makeParticles(int64_t first, int64_t n) {
+	ParticleColumns parts(ParticleColumns::ALL);
+	for (int64_t i = first; i < first + n; ++i) {
+		double loc[3] = { i + 0.5, i + 0.25, i + 0.125 };
+		double xloc[3] = { 0.001 * i, 0.002 * i, 0.003 * i };
+		double vel[3] = { -1.0 * i, 0.0, 1.0 * i };
+		parts.push_back(1000000000000LL + i, loc, xloc, 300.0 + 0.1 * i,
+				vel, 0.5);
+	}
+	return parts;
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// batches of several sizes, the large ones formatted in slices
+	std::vector<ParticleColumns> batches = {
+		makeParticles(0, 3), makeParticles(3, 50000), makeParticles(50003, 1)
+	};
+	auto all = ParticleColumns::concat(batches, ParticleColumns::ALL);
+	assert(ParticleExporter::CSV == ParticleExporter::format("./a.csv"));
+	assert(ParticleExporter::BINARY == ParticleExporter::format("./a.bin"));
+
+	// the binary export reads back as the particles were, in order
+	{
+		ParticleExporter exporter("./particles.bin", ParticleExporter::BINARY,
+				ParticleColumns::ALL, 4);
+		assert(exporter.good());
+		for (const auto& batch : batches)
+			assert(exporter.write(batch));
+		assert(exporter.close());
+		assert(all.size() == exporter.nParticles());
+	}
+	auto read = ParticleExporter::read("./particles.bin");
+	assert(ParticleColumns::ALL == read.attributes());
+	assert(all.size() == read.size());
+	assert(all.ssns() == read.ssns() && all.locs() == read.locs());
+	assert(all.xlocs() == read.xlocs() && all.temps() == read.temps());
+	assert(all.vels() == read.vels() && all.mixfracs() == read.mixfracs());
+
+	// only the attributes asked for are exported, which the batches have to
+	// hold
+	{
+		ParticleExporter exporter("./particles.bin", ParticleExporter::BINARY,
+				ParticleColumns::SSN | ParticleColumns::TEMP);
+		assert(exporter.write(batches[1]));
+		ParticleColumns ssnOnly(ParticleColumns::SSN);
+		double loc[3] = { 0.0, 0.0, 0.0 };
+		ssnOnly.push_back(7, loc, loc, 0.0);
+		assert(!exporter.write(ssnOnly));
+		assert(!exporter.close());
+	}
+	{
+		ParticleExporter exporter("./particles.bin", ParticleExporter::BINARY,
+				ParticleColumns::SSN | ParticleColumns::TEMP);
+		assert(exporter.write(batches[1]) && exporter.close());
+	}
+	read = ParticleExporter::read("./particles.bin");
+	assert((ParticleColumns::SSN | ParticleColumns::TEMP) == read.attributes());
+	assert(batches[1].ssns() == read.ssns());
+	assert(batches[1].temps() == read.temps() && read.xlocs().empty());
+
+	// csv has a header and a line per particle in order, on any number of
+	// threads
+	for (int nThreads : { 1, 3 }) {
+		ParticleExporter exporter("./particles.csv", ParticleExporter::CSV,
+				ParticleColumns::SSN | ParticleColumns::XLOC
+					| ParticleColumns::TEMP, nThreads);
+		for (const auto& batch : batches)
+			assert(exporter.write(batch));
+		assert(exporter.close());
+		std::ifstream fin("./particles.csv");
+		std::string line;
+		std::getline(fin, line);
+		assert("ssn,xlocx,xlocy,xlocz,T" == line);
+		int64_t nLines = 0;
+		while (std::getline(fin, line)) {
+			long long ssn = 0;
+			float x, y, z, temp;
+			assert(5 == sscanf(line.c_str(), "%lld,%f,%f,%f,%f",
+					&ssn, &x, &y, &z, &temp));
+			assert(all.ssns()[nLines] == ssn);
+			assert(all.xlocs()[3 * nLines + 2] == z);
+			assert(all.temps()[nLines] == temp);
+			++nLines;
+		}
+		assert(all.size() == nLines);
+	}
+
+	// a file that cannot be written fails
+	ParticleExporter bad("./no/such/dir.bin", ParticleExporter::BINARY,
+			ParticleColumns::ALL);
+	assert(!bad.good() && !bad.write(batches[0]) && !bad.close());
+
+	std::remove("./particles.bin");
+	std::remove("./particles.csv");
+	std::cout << "particleexporter passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <histpyramid.h>
+
+int main(void)
+{
+	// an odd sized volume with a hole, so partial and empty blocks occur
+	Extent dimHists(5, 4, 3);
+	const int nBins = 8;
+	std::vector<std::shared_ptr<const Hist>> hists(dimHists.nElement());
+	double total = 0.0;
+	for (int iHist = 0; iHist < dimHists.nElement(); ++iHist) {
+		if (7 == iHist) {
+			hists[iHist] = std::make_shared<HistNull>();
+			continue;
+		}
+		std::vector<float> values(nBins);
+		for (int iBin = 0; iBin < nBins; ++iBin) {
+			values[iBin] = float((iHist + iBin) % 3);
+			total += values[iBin];
+		}
+		hists[iHist] = std::make_shared<Hist1D>(
+				nBins, -1.0, 1.0, 0.0, "x", values);
+	}
+	HistPyramid pyramid(dimHists,
+			[&hists](int flatId) { return hists[flatId]; });
+
+	// 5x4x3 -> 3x2x2 -> 2x1x1 -> 1x1x1
+	assert(4 == pyramid.nLevels());
+	assert(3 == pyramid.dimHists(1)[0] && 2 == pyramid.dimHists(1)[1]
+			&& 2 == pyramid.dimHists(1)[2]);
+	assert(1 == pyramid.dimHists(3).nElement());
+
+	// same-binned children keep their bins and the counts add up
+	auto top = pyramid.hist(3, 0);
+	assert(nBins == top->nBins());
+	assert(-1.0 == top->dimMin(0) && 1.0 == top->dimMax(0));
+	double sum = 0.0;
+	for (int iBin = 0; iBin < top->nBins(); ++iBin)
+		sum += top->binFreq(iBin);
+	assert(std::abs(sum - total) < 1e-3);
+
+	// every level holds the whole volume
+	for (int level = 0; level < pyramid.nLevels(); ++level) {
+		double levelSum = 0.0;
+		for (int iHist = 0; iHist < pyramid.dimHists(level).nElement();
+				++iHist) {
+			auto hist = pyramid.hist(level, iHist);
+			for (int iBin = 0; iBin < hist->nBins(); ++iBin)
+				levelSum += hist->binFreq(iBin);
+		}
+		std::cout << "level " << level << ": " << levelSum << std::endl;
+		assert(std::abs(levelSum - total) < 1e-3);
+	}
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <Histogram.h>
+
+namespace {
+
+double sumFreqs(const Hist& hist) {
+	double sum = 0.0;
+	for (int iBin = 0; iBin < hist.nBins(); ++iBin)
+		sum += hist.binFreq(iBin);
+	return sum;
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+	// 1D: 32 bins halve with every level and keep the range
+	std::vector<float> values1d(32);
+	for (int iBin = 0; iBin < 32; ++iBin)
+		values1d[iBin] = float(iBin % 5);
+	auto hist1d = std::make_shared<Hist1D>(32, -2.0, 2.0, 0.0, "x", values1d);
+	assert(hist1d == HistRebinner(hist1d).coarsenTo(0));
+	auto level1 = HistRebinner(hist1d).coarsenTo(1);
+	auto level2 = HistRebinner(hist1d).coarsenTo(2);
+	assert(16 == level1->nBins() && 8 == level2->nBins());
+	assert(-2.0 == level2->dimMin(0) && 2.0 == level2->dimMax(0));
+	assert(values1d[0] + values1d[1] == level1->binFreq(0));
+	assert(sumFreqs(*hist1d) == sumFreqs(*level2));
+
+	// 2D: 12 bins can only merge by 4, 8 bins merge by 8
+	std::vector<float> values2d(12 * 8);
+	for (int iBin = 0; iBin < int(values2d.size()); ++iBin)
+		values2d[iBin] = float(iBin % 7);
+	auto hist2d = std::make_shared<Hist2D>(12, 8,
+			std::vector<double>{0.0, 0.0}, std::vector<double>{1.0, 1.0},
+			std::vector<double>{0.0, 0.0},
+			std::vector<std::string>{"x", "y"}, values2d);
+	auto level3 = HistRebinner(hist2d).coarsenTo(3);
+	assert(3 == level3->dim()[0] && 1 == level3->dim()[1]);
+	assert(sumFreqs(*hist2d) == sumFreqs(*level3));
+	double firstBlock = 0.0;
+	for (int y = 0; y < 8; ++y)
+		for (int x = 0; x < 4; ++x)
+			firstBlock += values2d[y * 12 + x];
+	assert(firstBlock == level3->binFreq(0));
+
+	std::cout << "rebin passed" << std::endl;
+	return 0;
+}
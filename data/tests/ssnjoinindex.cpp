@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <ssnjoinindex.h>
+
+namespace {
+
+// where particle ssn is at step, along x with time
+void locationOf(int64_t ssn, int step, double xloc[3]) {
+	xloc[0] = double(ssn % 50) + step;
+	xloc[1] = double(ssn / 50 % 50);
+	xloc[2] = double(ssn / 2500);
+}
+
+std::string stepPath(int step) {
+	return "particleblocks." + std::to_string(step) + ".bin";
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// three steps of shuffled particles, the odd ones gone from step 1
+	const int nSteps = 3;
+	const int64_t nParticles = 5000;
+	std::mt19937 random(11);
+	SsnJoinIndex::BlockIndices steps;
+	for (int iStep = 0; iStep < nSteps; ++iStep) {
+		std::vector<int64_t> ssns;
+		for (int64_t ssn = 0; ssn < nParticles; ++ssn) {
+			if (1 != iStep || 0 == ssn % 2)
+				ssns.push_back(ssn);
+		}
+		std::shuffle(ssns.begin(), ssns.end(), random);
+		ParticleColumns parts(ParticleColumns::ALL);
+		for (auto ssn : ssns) {
+			double loc[3] = { 0.0, 0.0, 0.0 }, xloc[3];
+			locationOf(ssn, iStep, xloc);
+			parts.push_back(ssn, loc, xloc, 10.0 * iStep + ssn);
+		}
+		assert(ParticleBlockIndex::write(stepPath(iStep), parts, {0, 0}, 2));
+		steps.push_back(ParticleBlockIndex::open(stepPath(iStep), {0, 0}));
+		assert(steps.back());
+	}
+	// a missing step is empty
+	steps.push_back(nullptr);
+
+	std::string path = SsnJoinIndex::filename(".");
+	assert(SsnJoinIndex::build(path, steps, 2));
+	auto index = SsnJoinIndex::open(path, steps);
+	assert(index && 4 == index->nSteps());
+	// the index is stale for other steps or block indices of other sources
+	assert(!SsnJoinIndex::open(path, { steps[0], steps[1], steps[2] }));
+	{
+		ParticleColumns empty(ParticleColumns::ALL);
+		assert(ParticleBlockIndex::write("other.bin", empty, {1, 1}, 2));
+		auto others = steps;
+		others[3] = ParticleBlockIndex::open("other.bin", {1, 1});
+		assert(others[3] && 0 == others[3]->nParticles());
+		assert(!SsnJoinIndex::open(path, others));
+		std::remove("other.bin");
+	}
+	assert(nParticles == index->nParticles(0));
+	assert(nParticles / 2 == index->nParticles(1));
+	assert(0 == index->nParticles(3));
+
+	// the positions point back at the particles
+	std::vector<int64_t> query = { -5, 3, 4, 1999, 4998, 4999, 7000 };
+	auto positions = index->positions(1, query);
+	assert(-1 == positions[0] && -1 == positions[1] && -1 == positions[5]);
+	assert(-1 == positions[6]);
+	auto found = steps[1]->readAt({ positions[2], positions[4] });
+	assert(4 == found.ssns()[0] && 4998 == found.ssns()[1]);
+	assert(10.f + 4998.f == found.temps()[1]);
+
+	// the pathlines go through the steps holding the particles
+	auto pathlines = index->trace(steps, { 4999, 7, 2000, 7, 123456 });
+	assert(3 == pathlines.nPathlines());
+	assert(7 == pathlines.ssns[0] && 2000 == pathlines.ssns[1]);
+	assert(4999 == pathlines.ssns[2]);
+	assert(2 == pathlines.nVertices(0) && 3 == pathlines.nVertices(1));
+	assert(2 == pathlines.nVertices(2));
+	assert(7 == pathlines.vertices.size());
+	for (int iLine = 0; iLine < pathlines.nPathlines(); ++iLine) {
+		for (int64_t i = 0; i < pathlines.nVertices(iLine); ++i) {
+			int64_t iVertex = pathlines.firsts[iLine] + i;
+			int step = pathlines.steps[iVertex];
+			assert(0 == i || pathlines.steps[iVertex - 1] < step);
+			double xloc[3];
+			locationOf(pathlines.ssns[iLine], step, xloc);
+			for (int iDim = 0; iDim < 3; ++iDim)
+				assert(float(xloc[iDim])
+						== pathlines.vertices.xlocs()[3 * iVertex + iDim]);
+			assert(float(10.0 * step + pathlines.ssns[iLine])
+					== pathlines.vertices.temps()[iVertex]);
+		}
+	}
+
+	for (int iStep = 0; iStep < nSteps; ++iStep)
+		std::remove(stepPath(iStep).c_str());
+	std::remove(path.c_str());
+	std::cout << "ssnjoinindex passed" << std::endl;
+	return 0;
+}
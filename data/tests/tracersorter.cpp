@@ -0,0 +1,191 @@
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <fortranreader.h>
+#include <tracersorter.h>
+
+namespace {
+
+// a big-endian record, as S3D writes them
+template <typename T>
+void writeRecord(std::ostream& out, std::vector<T> values) {
+	int32_t marker = ByteOrder::swap(int32_t(sizeof(T) * values.size()));
+	for (auto& value : values)
+		value = ByteOrder::swap(value);
+	out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+	out.write(reinterpret_cast<const char*>(values.data()),
+			sizeof(T) * values.size());
+	out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+}
+
+template <typename T>
+void writeArray(std::ostream& out, const std::string& name, double ref,
+		const std::vector<T>& values) {
+	writeRecord(out, std::vector<char>(name.begin(), name.end()));
+	writeRecord(out, std::vector<double>{ref});
+	writeRecord(out, values);
+}
+
+template <typename T>
+std::vector<T> readRaw(std::istream& in, int64_t count) {
+	std::vector<T> values(count);
+	in.read(reinterpret_cast<char*>(values.data()), sizeof(T) * count);
+	return values;
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// 2x2x1 domains of 2x2x2 sampling regions over 8x8x4 voxels, so the y
+	// columns are x = 0 and x = 1, each of two domains along y
+	TracerConfig config("./", {2, 2, 1}, {2, 2, 2}, {8, 8, 4});
+	const int nParticles = 5000;
+	// the expected sampling region, as a global histogram id, of every ssn
+	std::map<int64_t, int> expected;
+	std::map<int64_t, double> expectedTemps, expectedVys;
+	for (int iColumn = 0; iColumn < 2; ++iColumn) {
+		std::vector<int64_t> ssn(nParticles);
+		std::vector<double> locx(nParticles), locy(nParticles),
+				locz(nParticles), temp(nParticles);
+		for (int i = 0; i < nParticles; ++i) {
+			ssn[i] = iColumn * nParticles + i;
+			locx[i] = 4 * iColumn + (i * 7 % 400) / 100.0;
+			locy[i] = (i * 13 % 800) / 100.0;
+			locz[i] = (i * 17 % 400) / 100.0;
+			temp[i] = 0.5 * i;
+			int hx = int(locx[i] / 2), hy = int(locy[i] / 2);
+			int hz = int(locz[i] / 2);
+			expected[ssn[i]] = config.dimHists().idstoflat(hx, hy, hz);
+			expectedTemps[ssn[i]] = 2.0 * temp[i];
+			expectedVys[ssn[i]] = locz[i];
+		}
+		char filename[32];
+		sprintf(filename, "tracer.%05d", iColumn);
+		std::ofstream fout(filename, std::ios::binary);
+		writeRecord(fout, std::vector<double>{0.0});
+		writeRecord(fout, std::vector<int32_t>{nParticles});
+		for (int iRecord = 0; iRecord < 3; ++iRecord)
+			writeRecord(fout, std::vector<int32_t>{0});
+		writeArray(fout, "SSN", 1.0, ssn);
+		writeArray(fout, "loc1", 1.0, locx);
+		writeArray(fout, "xloc1", 1.0, locx);
+		writeArray(fout, "u", 1.0, temp);
+		writeArray(fout, "loc2", 1.0, locy);
+		writeArray(fout, "xloc2", 1.0, locy);
+		writeArray(fout, "loc3", 1.0, locz);
+		writeArray(fout, "xloc3", 1.0, locz);
+		writeArray(fout, "T", 2.0, temp);
+		// of the velocity only the y component, after the others
+		writeArray(fout, "mixfrac", 0.5, temp);
+		writeArray(fout, "u2", 1.0, locz);
+	}
+
+	// a budget small enough to stream in chunks, flush every region often
+	// and scatter the regions a group at a time
+	TracerSorter sorter(config, 4096, 2);
+	assert(sorter.sort("./"));
+
+	// scanning some histograms gives their particles, every one once, from
+	// the sorted files as from the tracer files
+	const std::vector<int> histFlatIds = {0, 5, 13, 31};
+	int64_t nExpected = 0;
+	for (const auto& ssnHist : expected) {
+		nExpected += std::count(histFlatIds.begin(), histFlatIds.end(),
+				ssnHist.second);
+	}
+	auto checkScan = [&]() {
+		std::set<int64_t> scanned;
+		bool ok = sorter.scan("./", histFlatIds,
+				[&](const ParticleColumns& batch) {
+			for (int64_t i = 0; i < batch.size(); ++i) {
+				int64_t ssn = batch.ssns()[i];
+				assert(scanned.insert(ssn).second);
+				assert(std::count(histFlatIds.begin(), histFlatIds.end(),
+						expected.at(ssn)));
+				assert(float(expectedTemps.at(ssn)) == batch.temps()[i]);
+			}
+			return true;
+		});
+		assert(ok);
+		assert(nExpected == int64_t(scanned.size()));
+	};
+	checkScan();
+
+	int64_t nSorted = 0;
+	for (int dId = 0; dId < 4; ++dId) {
+		auto dIds = config.dimDomains().flattoids(dId);
+		std::ifstream fin(TracerSorter::filename("./", dId), std::ios::binary);
+		auto dimHists = readRaw<int32_t>(fin, 3);
+		assert(2 == dimHists[0] && 2 == dimHists[1] && 2 == dimHists[2]);
+		auto offsetCounts = readRaw<int32_t>(fin, 16);
+		int64_t total = offsetCounts[14] + offsetCounts[15];
+		auto ssns = readRaw<int64_t>(fin, total);
+		auto xlocs = readRaw<double>(fin, 3 * total);
+		auto temps = readRaw<double>(fin, total);
+		assert(fin);
+		for (int hId = 0; hId < 8; ++hId) {
+			auto hIds = config.dimHistsPerDomain().flattoids(hId);
+			int histFlatId = config.dimHists().idstoflat(
+					2 * dIds[0] + hIds[0], 2 * dIds[1] + hIds[1],
+					2 * dIds[2] + hIds[2]);
+			int64_t offset = offsetCounts[2 * hId];
+			for (int64_t i = offset; i < offset + offsetCounts[2 * hId + 1];
+					++i) {
+				assert(histFlatId == expected.at(ssns[i]));
+				assert(expectedTemps.at(ssns[i]) == temps[i]);
+				assert(int(xlocs[3 * i] / 2) == 2 * dIds[0] + hIds[0]);
+			}
+		}
+		nSorted += total;
+		std::remove(TracerSorter::filename("./", dId).c_str());
+	}
+	assert(2 * nParticles == nSorted);
+	checkScan();
+
+	// the velocities and mixture fractions are found wherever they are, the
+	// missing components left zero
+	int64_t nWithVels = 0;
+	assert(sorter.scan("./", histFlatIds, [&](const ParticleColumns& batch) {
+		assert(batch.has(ParticleColumns::VEL)
+				&& batch.has(ParticleColumns::MIXFRAC));
+		for (int64_t i = 0; i < batch.size(); ++i) {
+			int64_t ssn = batch.ssns()[i];
+			assert(0.f == batch.vels()[3 * i]);
+			assert(float(expectedVys.at(ssn)) == batch.vels()[3 * i + 1]);
+			assert(0.f == batch.vels()[3 * i + 2]);
+			assert(float(expectedTemps.at(ssn) / 4.0)
+					== batch.mixfracs()[i]);
+		}
+		nWithVels += batch.size();
+		return true;
+	}, ParticleColumns::ALL));
+	assert(nExpected == nWithVels);
+
+	// a y column that fails to sort, here with arrays of different lengths,
+	// leaves no output of any column behind
+	{
+		std::ofstream fout("tracer.00001", std::ios::binary);
+		writeRecord(fout, std::vector<double>{0.0});
+		writeRecord(fout, std::vector<int32_t>{2});
+		for (int iRecord = 0; iRecord < 3; ++iRecord)
+			writeRecord(fout, std::vector<int32_t>{0});
+		writeArray(fout, "SSN", 1.0, std::vector<int64_t>{0, 1});
+		writeArray(fout, "loc1", 1.0, std::vector<double>{0.0});
+	}
+	assert(!sorter.sort("./"));
+	for (int dId = 0; dId < 4; ++dId) {
+		auto path = TracerSorter::filename("./", dId);
+		assert(!std::ifstream(path));
+		assert(!std::ifstream(path + ".tmp"));
+	}
+	std::remove("tracer.00000");
+	std::remove("tracer.00001");
+
+	std::cout << "tracersorter passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <histgrid.h>
+#include <histreader.h>
+#include <histvolumestats.h>
+
+namespace {
+
+template <typename T>
+void writeRaw(std::ostream& out, const std::vector<T>& values) {
+	out.write(reinterpret_cast<const char*>(values.data()),
+			sizeof(T) * values.size());
+}
+
+// a domain of nHist 4x3 histograms, the first of them empty
+void writeDomain(std::ostream& out, int iDomain, int nHist) {
+	writeRaw(out, std::vector<int>{2, 10, 5, 5, nHist, 1, 1});
+	writeRaw(out, std::vector<double>{0.0, 0.0});
+	for (int iHist = 0; iHist < nHist; ++iHist) {
+		std::vector<int> buffer;
+		for (int iBin = 0; 0 < iHist && iBin < 4 * 3; ++iBin) {
+			int freq = (iBin * iHist + iDomain) % 5;
+			if (0 < freq) {
+				buffer.push_back(iBin);
+				buffer.push_back(freq);
+			}
+		}
+		writeRaw(out, std::vector<int>{1});
+		writeRaw(out, std::vector<double>{0.0, -1.0, 1.0, 1.0});
+		writeRaw(out, std::vector<int>{4, 3});
+		writeRaw(out, std::vector<double>{1.0});
+		writeRaw(out, std::vector<int>{int(buffer.size()) / 2});
+		writeRaw(out, buffer);
+	}
+}
+
+bool nearlyEqual(float a, float b) {
+	return std::abs(a - b) <= 1e-5f * std::max(1.f, std::abs(a));
+}
+
+} // anonymous namespace
+
+int main(void)
+{
+	// two y columns and the sidecar of one of them, which is skipped
+	std::vector<std::string> vars = {"x", "y"};
+	std::vector<std::string> paths;
+	for (auto iColumnStr : {"00000", "00001"}) {
+		HistYColumnReader reader(".", "tst", iColumnStr, vars);
+		paths.push_back(reader.filename());
+		std::ofstream fout(reader.filename(), std::ios::binary);
+		for (int iDomain = 0; iDomain < 2; ++iDomain)
+			writeDomain(fout, iDomain + int(paths.size()), 3 + iDomain);
+	}
+	HistYColumnReader(".", "tst", "00000", vars).index();
+	paths.push_back(paths[0] + ".idx");
+
+	// the stats from the histograms as the volume reads them
+	HistVolumeStats expected(2);
+	for (int iColumn = 0; iColumn < 2; ++iColumn) {
+		auto iColumnStr = 0 == iColumn ? "00000" : "00001";
+		for (auto domain : HistYColumnReader(".", "tst", iColumnStr, vars)
+				.read()) {
+			for (int iHist = 0; iHist < domain->helper().N_HIST; ++iHist)
+				expected.add(domain->hist(iHist)->means());
+		}
+	}
+	HistVolumeStats scanned;
+	assert(HistVolumeStats::scan(".", "tst", vars, &scanned));
+	assert(expected.nNonEmptyHists() == scanned.nNonEmptyHists());
+	for (int iVar = 0; iVar < 2; ++iVar) {
+		assert(nearlyEqual(expected.means()[iVar], scanned.means()[iVar]));
+		assert(expected.mins()[iVar] == scanned.mins()[iVar]);
+		assert(expected.maxs()[iVar] == scanned.maxs()[iVar]);
+	}
+	HistVolumeStats missing;
+	assert(!HistVolumeStats::scan(".", "none", vars, &missing));
+
+	// partial stats merge into those of the whole
+	HistVolumeStats first(2), second(2), whole(2);
+	first.add({1.f, 2.f});
+	first.add({});
+	second.add({3.f, -2.f});
+	whole.merge(first);
+	whole.merge(second);
+	assert(2 == whole.nNonEmptyHists());
+	assert(2.f == whole.means()[0] && 0.f == whole.means()[1]);
+	assert(1.f == whole.mins()[0] && 3.f == whole.maxs()[0]);
+
+	// the log resumes from its records and drops a torn one
+	const std::string logPath = "volumestats.bin";
+	std::remove(logPath.c_str());
+	{
+		HistStatsLog log(logPath);
+		assert(log.good() && log.records().empty());
+		assert(log.append({ 0, "T", { 10, 20 }, scanned.means(),
+				scanned.mins(), scanned.maxs() }));
+		assert(log.append({ 3, "Z", { 30, 40 }, {1.f}, {0.f}, {2.f} }));
+	}
+	{
+		std::ofstream fout(logPath, std::ios::binary | std::ios::app);
+		writeRaw(fout, std::vector<int>{1, 1});
+	}
+	{
+		HistStatsLog log(logPath);
+		assert(2 == log.records().size());
+		assert(0 == log.records()[0].step && "T" == log.records()[0].name);
+		assert(scanned.maxs() == log.records()[0].maxs);
+		assert(3 == log.records()[1].step && "Z" == log.records()[1].name);
+		assert((FileStamp{ 30, 40 }) == log.records()[1].source);
+		assert(log.append({ 1, "T", { 50, 60 }, {5.f, 6.f}, {4.f, 5.f},
+				{6.f, 7.f} }));
+	}
+	{
+		HistStatsLog resumed(logPath);
+		assert(3 == resumed.records().size());
+		assert(6.f == resumed.records()[2].means[1]);
+	}
+
+	// a corrupt length, here of a billion variables, drops the record
+	// rather than allocating for it
+	{
+		std::ofstream fout(logPath, std::ios::binary | std::ios::app);
+		writeRaw(fout, std::vector<int>{2, 1});
+		writeRaw(fout, std::vector<char>{'T'});
+		writeRaw(fout, std::vector<int64_t>{70, 80});
+		writeRaw(fout, std::vector<int>{1 << 30});
+		writeRaw(fout, std::vector<float>(6, 1.f));
+	}
+	HistStatsLog corrupt(logPath);
+	assert(3 == corrupt.records().size());
+	assert(corrupt.good());
+
+	std::remove(logPath.c_str());
+	for (const auto& path : paths)
+		std::remove(path.c_str());
+
+	std::cout << "volumestats passed" << std::endl;
+	return 0;
+}
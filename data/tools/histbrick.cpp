@@ -0,0 +1,42 @@
+#include <iostream>
+#include <cstdlib>
+#include <histgrid.h>
+#include <histbrick.h>
+
+/**
+ * Converts the histogram volume <name> in <dir>, written by nDomainX *
+ * nDomainY * nDomainZ processes, into <dir>/pdfs-brick-<name> with bricks of
+ * brickSize^3 histograms.
+ */
+int main(int argc, char* argv[])
+{
+	if (argc < 8) {
+		std::cout << "usage: histbrick <dir> <name> <nDomainX> <nDomainY> "
+				<< "<nDomainZ> <brickSize> <var> [<var> ...]" << std::endl;
+		return 1;
+	}
+	std::string dir = argv[1];
+	std::string name = argv[2];
+	std::vector<int> dimDomains = {
+			std::atoi(argv[3]), std::atoi(argv[4]), std::atoi(argv[5]) };
+	int brickSize = std::atoi(argv[6]);
+	std::vector<std::string> vars(argv + 7, argv + argc);
+	if (brickSize <= 0) {
+		std::cout << "brickSize must be positive" << std::endl;
+		return 1;
+	}
+
+	HistVolume volume(dir, name, dimDomains, vars);
+	HistBrickWriter writer(volume.helper(), brickSize);
+	auto path = HistBrickReader::filename(dir, name);
+	bool success = writer.write(path, [&volume](int flatId) {
+		return volume.hist(flatId);
+	});
+	if (!success) {
+		std::cout << "failed to write " << path << std::endl;
+		return 1;
+	}
+	std::cout << "wrote " << volume.nHist() << " histograms to " << path
+			<< std::endl;
+	return 0;
+}
@@ -0,0 +1,25 @@
+#include <iostream>
+#include <histcolumnindex.h>
+
+/**
+ * Writes the sidecar index <file>.idx of each y-column or multiblock file,
+ * pdfs-ycolumn-<name>.<id>, so that the first open does not scan it.
+ */
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: histcolumnindex <file> [<file> ...]" << std::endl;
+		return 1;
+	}
+	for (int iArg = 1; iArg < argc; ++iArg) {
+		std::string path = argv[iArg];
+		auto index = HistColumnIndex::scan(path);
+		if (!index || !index->write(HistColumnIndex::filename(path))) {
+			std::cout << "failed to index " << path << std::endl;
+			return 1;
+		}
+		std::cout << "indexed " << index->nDomains() << " domains of "
+				<< path << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <histgrid.h>
+#include <histcontainer.h>
+
+/**
+ * Converts the histogram volume <name> in <dir>, written by nDomainX *
+ * nDomainY * nDomainZ processes, into the indexed container
+ * <dir>/pdfs-indexed-<name>, with delta-varint encoded bins when given
+ * --compress.
+ */
+int main(int argc, char* argv[])
+{
+	bool compress = 1 < argc && 0 == std::strcmp("--compress", argv[1]);
+	int iArg = compress ? 2 : 1;
+	if (argc < iArg + 6) {
+		std::cout << "usage: histconvert [--compress] <dir> <name> "
+				<< "<nDomainX> <nDomainY> <nDomainZ> <var> [<var> ...]"
+				<< std::endl;
+		return 1;
+	}
+	std::string dir = argv[iArg];
+	std::string name = argv[iArg + 1];
+	std::vector<int> dimDomains = { std::atoi(argv[iArg + 2]),
+			std::atoi(argv[iArg + 3]), std::atoi(argv[iArg + 4]) };
+	std::vector<std::string> vars(argv + iArg + 5, argv + argc);
+
+	HistVolume volume(dir, name, dimDomains, vars);
+	HistContainerWriter writer(volume.helper(), compress);
+	auto path = HistContainerReader::filename(dir, name);
+	bool success = writer.write(path, [&volume](int flatId) {
+		return volume.hist(flatId);
+	});
+	if (!success) {
+		std::cout << "failed to write " << path << std::endl;
+		return 1;
+	}
+	std::cout << "wrote " << volume.nHist() << " histograms to " << path
+			<< std::endl;
+	return 0;
+}
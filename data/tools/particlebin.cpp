@@ -0,0 +1,122 @@
+#include <iostream>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <particlebinner.h>
+#include <tracersorter.h>
+
+namespace {
+
+bool parseVariable(const std::string& name, ParticleBinner::Variable* var) {
+	for (int iVar = ParticleBinner::X; iVar <= ParticleBinner::MIXFRAC; ++iVar) {
+		if (ParticleBinner::name(ParticleBinner::Variable(iVar)) == name) {
+			*var = ParticleBinner::Variable(iVar);
+			return true;
+		}
+	}
+	return false;
+}
+
+} // anonymous namespace
+
+/**
+ * Bins all the particles of a step into a histogram of nBins bins over the
+ * whole range of each of one to three variables, x, y, z, T, the velocity
+ * components u, v, w or mixfrac, and writes its non-empty bins to a CSV
+ * file, the bin centers and then the count on every line. The particles are
+ * streamed a batch at a time from the pdfsortedtracer or else the tracer
+ * files, once to find the ranges and once to count them.
+ */
+int main(int argc, char* argv[])
+{
+	if (argc < 14 || argc > 16) {
+		std::cout << "usage: particlebin <dir> <output .csv> "
+				<< "<domains x y z> <hists per domain x y z> <voxels x y z> "
+				<< "<nBins> <var> [<var> [<var>]]" << std::endl;
+		return 1;
+	}
+	std::string dir = argv[1];
+	if ('/' != dir.back())
+		dir += "/";
+	std::string out = argv[2];
+	std::vector<int> dims(9);
+	for (int i = 0; i < 9; ++i)
+		dims[i] = std::atoi(argv[3 + i]);
+	int nBins = std::atoi(argv[12]);
+	std::vector<ParticleBinner::Axis> axes;
+	for (int i = 13; i < argc; ++i) {
+		ParticleBinner::Variable var;
+		if (!parseVariable(argv[i], &var)) {
+			std::cout << "no variable " << argv[i] << std::endl;
+			return 1;
+		}
+		axes.push_back({ var, nBins, 0.0, 0.0 });
+	}
+	if (nBins <= 0) {
+		std::cout << "nBins must be positive" << std::endl;
+		return 1;
+	}
+	TracerConfig config(dir, {dims[0], dims[1], dims[2]},
+			{dims[3], dims[4], dims[5]}, {dims[6], dims[7], dims[8]});
+	std::vector<int> histFlatIds(config.dimHists().nElement());
+	std::iota(histFlatIds.begin(), histFlatIds.end(), 0);
+	TracerSorter scanner(config);
+	const int attributes = ParticleColumns::XLOC | ParticleColumns::TEMP
+			| ParticleColumns::VEL | ParticleColumns::MIXFRAC;
+
+	// the ranges of the variables over all the batches
+	int64_t nParticles = 0;
+	bool scanned = scanner.scan(config.dir(), histFlatIds,
+			[&](const ParticleColumns& batch) {
+		for (auto& axis : axes) {
+			auto fitted = ParticleBinner::fit(batch, axis.var, nBins);
+			axis.min = 0 == nParticles
+					? fitted.min : std::min(axis.min, fitted.min);
+			axis.max = 0 == nParticles
+					? fitted.max : std::max(axis.max, fitted.max);
+		}
+		nParticles += batch.size();
+		return true;
+	}, attributes);
+	// the counts of the batches summed up
+	ParticleBinner binner(axes);
+	std::vector<double> counts;
+	scanned = scanned && scanner.scan(config.dir(), histFlatIds,
+			[&](const ParticleColumns& batch) {
+		auto batchCounts = binner.counts(batch);
+		counts.resize(batchCounts.size(), 0.0);
+		for (size_t iBin = 0; iBin < counts.size(); ++iBin)
+			counts[iBin] += batchCounts[iBin];
+		return true;
+	}, attributes);
+	if (!scanned) {
+		std::cout << "failed to read the tracers of " << config.dir()
+				<< std::endl;
+		return 1;
+	}
+
+	std::ofstream fout(out);
+	for (size_t iAxis = 0; iAxis < axes.size(); ++iAxis)
+		fout << ParticleBinner::name(axes[iAxis].var) << ",";
+	fout << "count" << std::endl;
+	for (size_t iBin = 0; iBin < counts.size(); ++iBin) {
+		if (0.0 == counts[iBin])
+			continue;
+		// the first axis varies fastest
+		int64_t rest = iBin;
+		for (const auto& axis : axes) {
+			double width = (axis.max - axis.min) / axis.nBins;
+			fout << axis.min + (rest % axis.nBins + 0.5) * width << ",";
+			rest /= axis.nBins;
+		}
+		fout << int64_t(counts[iBin]) << "\n";
+	}
+	fout.close();
+	if (!fout) {
+		std::cout << "failed to write " << out << std::endl;
+		return 1;
+	}
+	std::cout << "binned " << nParticles << " particles into " << out
+			<< std::endl;
+	return 0;
+}
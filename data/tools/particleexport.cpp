@@ -0,0 +1,136 @@
+#include <iostream>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <particleblockindex.h>
+#include <particleexporter.h>
+#include <tracersorter.h>
+
+namespace {
+
+// about a million particles read at once
+const int64_t batchSize = 1 << 20;
+
+int finish(ParticleExporter& exporter, const std::string& out) {
+	if (!exporter.close()) {
+		std::cout << "failed to export to " << out << std::endl;
+		return 1;
+	}
+	std::cout << "exported " << exporter.nParticles() << " particles to "
+			<< out << std::endl;
+	return 0;
+}
+
+// the particles within [lower, upper] from the spatial index
+int exportRegion(const std::string& dir, const std::string& out,
+		const float lower[3], const float upper[3]) {
+	auto index = ParticleBlockIndex::open(ParticleBlockIndex::filename(dir),
+			ParticleBlockIndex::sourceOf(dir));
+	if (!index) {
+		std::cout << "no particle index in " << dir << std::endl;
+		return 1;
+	}
+	auto blocks = index->blocks([&](const float* l, const float* u) {
+		for (int iDim = 0; iDim < 3; ++iDim) {
+			if (u[iDim] < lower[iDim] || upper[iDim] < l[iDim])
+				return false;
+		}
+		return true;
+	});
+	auto contains = [&](const float* xloc) {
+		for (int iDim = 0; iDim < 3; ++iDim) {
+			if (xloc[iDim] < lower[iDim] || upper[iDim] < xloc[iDim])
+				return false;
+		}
+		return true;
+	};
+	ParticleExporter exporter(out, ParticleExporter::format(out),
+			index->attributes());
+	std::vector<int> batch;
+	int64_t nBatch = 0;
+	for (size_t i = 0; i < blocks.size() && exporter.good(); ++i) {
+		batch.push_back(blocks[i]);
+		nBatch += index->blockCount(blocks[i]);
+		if (nBatch < batchSize && i + 1 < blocks.size())
+			continue;
+		exporter.write(index->readBlocks(batch, contains));
+		batch.clear();
+		nBatch = 0;
+	}
+	return finish(exporter, out);
+}
+
+// the particles of the histograms from the sorted or the tracer files
+int exportHists(const TracerConfig& config, const std::string& out,
+		std::vector<int> histFlatIds) {
+	int nHists = int(config.dimHists().nElement());
+	if (histFlatIds.empty()) {
+		histFlatIds.resize(nHists);
+		std::iota(histFlatIds.begin(), histFlatIds.end(), 0);
+	}
+	for (auto histFlatId : histFlatIds) {
+		if (histFlatId < 0 || histFlatId >= nHists) {
+			std::cout << "no histogram " << histFlatId << std::endl;
+			return 1;
+		}
+	}
+	ParticleExporter exporter(out, ParticleExporter::format(out),
+			ParticleExporter::histAttributes);
+	TracerSorter scanner(config);
+	bool scanned = scanner.scan(config.dir(), histFlatIds,
+			[&exporter](const ParticleColumns& batch) {
+		return exporter.write(batch);
+	}, ParticleExporter::histAttributes);
+	if (!scanned) {
+		exporter.close();
+		std::cout << "failed to read the tracers of " << config.dir()
+				<< std::endl;
+		return 1;
+	}
+	return finish(exporter, out);
+}
+
+} // anonymous namespace
+
+/**
+ * Exports particles of a step to a binary or, for a .csv output, a CSV file,
+ * streamed a batch at a time. Either the particles of a region of the step,
+ * or all of them, from the spatial index particleblocks.bin in its tracer
+ * directory, or the ParticleExporter::histAttributes of the particles of
+ * histograms, or all of them, read from the pdfsortedtracer or else the
+ * tracer files with the geometry of the histograms of the step.
+ */
+int main(int argc, char* argv[])
+{
+	if (argc != 3 && argc != 9 && argc < 12) {
+		std::cout << "usage: particleexport <dir> <output .bin or .csv> "
+				<< "[<lower x y z> <upper x y z>]" << std::endl
+				<< "       particleexport <dir> <output .bin or .csv> "
+				<< "<domains x y z> <hists per domain x y z> "
+				<< "<voxels x y z> [<hist id> ...]" << std::endl;
+		return 1;
+	}
+	std::string dir = argv[1];
+	if ('/' != dir.back())
+		dir += "/";
+	std::string out = argv[2];
+	if (12 <= argc) {
+		std::vector<int> dims(9);
+		for (int i = 0; i < 9; ++i)
+			dims[i] = std::atoi(argv[3 + i]);
+		TracerConfig config(dir, {dims[0], dims[1], dims[2]},
+				{dims[3], dims[4], dims[5]}, {dims[6], dims[7], dims[8]});
+		std::vector<int> histFlatIds;
+		for (int i = 12; i < argc; ++i)
+			histFlatIds.push_back(std::atoi(argv[i]));
+		return exportHists(config, out, histFlatIds);
+	}
+	float lower[3], upper[3];
+	for (int iDim = 0; iDim < 3; ++iDim) {
+		lower[iDim] = 9 == argc ? float(std::atof(argv[3 + iDim]))
+				: std::numeric_limits<float>::lowest();
+		upper[iDim] = 9 == argc ? float(std::atof(argv[6 + iDim]))
+				: std::numeric_limits<float>::max();
+	}
+	return exportRegion(dir, out, lower, upper);
+}
@@ -0,0 +1,34 @@
+#include <iostream>
+#include <cstdlib>
+#include <tracersorter.h>
+
+/**
+ * Sorts the raw tracer files of a step, tracer.<y column>, by sampling region
+ * into the pdfsortedtracer.<domain> files that the particle view reads
+ * directly. The geometry is that of the histograms of the step.
+ */
+int main(int argc, char* argv[])
+{
+	if (argc < 11) {
+		std::cout << "usage: tracersort <dir> <domains x y z> "
+				<< "<hists per domain x y z> <voxels x y z> [<memory MB>]"
+				<< std::endl;
+		return 1;
+	}
+	std::string dir = argv[1];
+	if ('/' != dir.back())
+		dir += "/";
+	std::vector<int> dims(9);
+	for (int i = 0; i < 9; ++i)
+		dims[i] = std::atoi(argv[2 + i]);
+	int64_t memoryMB = 11 < argc ? std::atoll(argv[11]) : 1024;
+	TracerConfig config(dir, {dims[0], dims[1], dims[2]},
+			{dims[3], dims[4], dims[5]}, {dims[6], dims[7], dims[8]});
+	TracerSorter sorter(config, memoryMB << 20);
+	if (!sorter.sort(dir)) {
+		std::cout << "failed to sort the tracers of " << dir << std::endl;
+		return 1;
+	}
+	std::cout << "sorted the tracers of " << dir << std::endl;
+	return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef TRACERCONFIG_H
+#define TRACERCONFIG_H
+
+#include <string>
+#include <vector>
+#include "Extent.h"
+
+/**
+ * @brief The TracerConfig class is the geometry of the tracer files of a
+ * step: the domain decomposition, the sampling regions of each domain and
+ * the grid the particle locations are in.
+ */
+class TracerConfig {
+public:
+    TracerConfig(std::string dir, const std::vector<int>& dimDomains,
+            const std::vector<int>& dimHistsPerDomain, const std::vector<int>& dimVoxels)
+      : m_dir(dir), m_dimDomains(dimDomains), m_dimHistsPerDomain(dimHistsPerDomain), m_dimVoxels(dimVoxels) {}
+    const std::string& dir() const { return m_dir; }
+    Extent dimDomains() const { return Extent(m_dimDomains); }
+    Extent dimHists() const { return Extent(
+            m_dimDomains[0] * m_dimHistsPerDomain[0],
+            m_dimDomains[1] * m_dimHistsPerDomain[1],
+            m_dimDomains[2] * m_dimHistsPerDomain[2]); }
+    Extent dimHistsPerDomain() const { return Extent(m_dimHistsPerDomain); }
+    Extent dimVoxels() const { return Extent(m_dimVoxels); }
+
+private:
+    std::string m_dir;
+    std::vector<int> m_dimDomains;
+    std::vector<int> m_dimHistsPerDomain;
+    std::vector<int> m_dimVoxels;
+};
+
+#endif // TRACERCONFIG_H
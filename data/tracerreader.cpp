@@ -1,8 +1,11 @@
 #include "tracerreader.h"
+#include <cmath>
 #include <fstream>
+#include <map>
 #include <QFile>
 #include <QElapsedTimer>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrent>
 
 std::ostream &operator<<(std::ostream &os, const Particle &p)
 {
@@ -17,6 +20,34 @@ std::ostream &operator<<(std::ostream &os, const Particle &p)
     return os;
 }
 
+namespace {
+
+// the flat id among all the histograms of the local histogram hId of the
+// domain dId
+int histFlatIdOf(const TracerConfig& config, int dId, int hId) {
+    auto dIds = config.dimDomains().flattoids(dId);
+    auto hIds = config.dimHistsPerDomain().flattoids(hId);
+    for (int iDim = 0; iDim < 3; ++iDim)
+        dIds[iDim] = dIds[iDim] * config.dimHistsPerDomain()[iDim] + hIds[iDim];
+    return config.dimHists().idstoflat(dIds);
+}
+
+// the ids of the domain of the histogram histFlatId
+std::vector<int> domainIdsOf(const TracerConfig& config, int histFlatId) {
+    auto ids = config.dimHists().flattoids(histFlatId);
+    for (int iDim = 0; iDim < 3; ++iDim)
+        ids[iDim] /= config.dimHistsPerDomain()[iDim];
+    return ids;
+}
+
+// the arrays of the velocity components and of the mixture fraction, which
+// not every run writes and which are searched for by name among the data
+// arrays in any order, left out of the particles when missing.
+const char* const velNames[3] = { "u1", "u2", "u3" };
+const char* const mixfracName = "mixfrac";
+
+} // anonymous namespace
+
 std::shared_ptr<TracerReader> TracerReader::create(const TracerConfig &config)
 {
     std::ifstream fin;
@@ -41,9 +72,21 @@ std::shared_ptr<TracerReader> TracerReader::create(const TracerConfig &config)
     return std::make_shared<NullTracerReader>();
 }
 
-std::vector<Particle> OrigTracerReader::read(
+ParticleColumns TracerReader::read(
+        const std::vector<int> &selectedHistFlatIds) const {
+    auto hists = readHists(selectedHistFlatIds);
+    std::vector<ParticleColumns> parts;
+    parts.reserve(selectedHistFlatIds.size());
+    for (auto histFlatId : selectedHistFlatIds) {
+        auto hist = hists.find(histFlatId);
+        if (hists.end() != hist)
+            parts.push_back(std::move(hist->second));
+    }
+    return ParticleColumns::concat(parts, attributes());
+}
+
+TracerReader::HistParticles OrigTracerReader::readHists(
         const std::vector<int> &selectedHistFlatIds) const {
-    std::vector<Particle> parts;
     // get the array of domains from histogram ids.
     std::unordered_map<int, std::vector<std::vector<int>>> dMap;
     for (auto histFlatId : selectedHistFlatIds) {
@@ -61,108 +104,149 @@ std::vector<Particle> OrigTracerReader::read(
     // seperate the domain-histogram ids array into segments according to
     // yColumnIds.
     Extent yColumnsExtent(m_config.dimDomains()[0], m_config.dimDomains()[2]);
-    std::unordered_map<int, DomainMap> yColumns;
+    std::map<int, DomainMap> yColumns;
     for (auto domain : dMap) {
         auto dIds = m_config.dimDomains().flattoids(domain.first);
         std::vector<int> yColumnIds = { dIds[0], dIds[2] };
         auto yColumnFlatId = yColumnsExtent.idstoflat(yColumnIds);
         yColumns[yColumnFlatId][domain.first] = domain.second;
     }
-    // traverse the y columns.
-    for (auto yColumn : yColumns) {
+    // traverse the y columns, each file on a thread of the global pool.
+    std::vector<QFuture<HistParticles>> futures;
+    for (const auto& yColumn : yColumns) {
         int yColumnFlatId = yColumn.first;
-        auto dMap = yColumn.second;
-        auto yColumnParts = readYColumnDomains(yColumnFlatId, dMap);
-        parts.insert(parts.end(), yColumnParts.begin(), yColumnParts.end());
+        const DomainMap* dMap = &yColumn.second;
+        futures.push_back(QtConcurrent::run([this, yColumnFlatId, dMap]() {
+            return readYColumnDomains(yColumnFlatId, *dMap);
+        }));
+    }
+    HistParticles parts;
+    for (auto& future : futures) {
+        for (auto& hist : future.result())
+            parts[hist.first] = std::move(hist.second);
     }
     return parts;
 }
 
-std::vector<Particle> OrigTracerReader::readYColumnDomains(
+int OrigTracerReader::fileId(int histFlatId) const {
+    auto dIds = domainIdsOf(m_config, histFlatId);
+    Extent yColumnsExtent(m_config.dimDomains()[0], m_config.dimDomains()[2]);
+    return int(yColumnsExtent.idstoflat(dIds[0], dIds[2]));
+}
+
+TracerReader::HistParticles OrigTracerReader::readYColumnDomains(
         int yColumnFlatId, const DomainMap &dMap) const
 {
-    std::vector<Particle> parts;
-    // in each y column, binary search for the particles within each
-    // sampling region.
+    HistParticles parts;
     // using the flat y column id to construct the file name of the tracer.
     char filename[20];
     sprintf(filename, "tracer.%05d", yColumnFlatId);
     std::string filepath = m_config.dir() + filename;
     // search within the file for the particles of the selected domains.
     TracerFileReader reader(filepath);
-    /// TODO: when length != endlen, swap endianness and try again.
     /* double time = */ reader.readDouble();
-    int32_t fillsum = reader.readInt32();
-    std::cout << "fillsum: " << fillsum << std::endl;
+    /* int32_t fillsum = */ reader.readInt32();
     reader.ignoreRecord(); // ssn_g
     reader.ignoreRecord(); // fill_g
     reader.ignoreRecord(); // seed_g
+    int64_t dataArraysReadPos = reader.currReadPos();
     /// TODO: currently assuming the order of the arrays, but the not needed
-    /// arrays in the middle are ignored.
+    /// arrays in the middle are ignored, as are the attributes not asked
+    /// for. The locations are always read to tell the sampling regions.
     std::vector<int64_t> ssn;
     std::vector<double> locx, locy, locz, xlocx, xlocy, xlocz, temp;
-    while (!reader.readArrayIfNameIs<int64_t>("SSN", ssn)) {}
+    if (wants(SSN))
+        while (!reader.readArrayIfNameIs<int64_t>("SSN", ssn)) {}
     while (!reader.readArrayIfNameIs<double>("loc1", locx)) {}
-    while (!reader.readArrayIfNameIs<double>("xloc1", xlocx)) {}
+    if (wants(XLOC))
+        while (!reader.readArrayIfNameIs<double>("xloc1", xlocx)) {}
     while (!reader.readArrayIfNameIs<double>("loc2", locy)) {}
-    while (!reader.readArrayIfNameIs<double>("xloc2", xlocy)) {}
+    if (wants(XLOC))
+        while (!reader.readArrayIfNameIs<double>("xloc2", xlocy)) {}
     while (!reader.readArrayIfNameIs<double>("loc3", locz)) {}
-    while (!reader.readArrayIfNameIs<double>("xloc3", xlocz)) {}
-    while (!reader.readArrayIfNameIs<double>("T", temp)) {}
-    /// TODO: implement binary search instead of linear search.
-    // loop through each particle and only save the ones that are in the
-    // selected histograms.
-    for (unsigned int i = 0; i < locx.size(); ++i) {
-        // for each domain, check if loc is inside.
-        for (auto d : dMap) {
-            auto dIds = m_config.dimDomains().flattoids(d.first);
-            float dx = m_config.dimVoxels()[0] / m_config.dimDomains()[0];
-            float dy = m_config.dimVoxels()[1] / m_config.dimDomains()[1];
-            float dz = m_config.dimVoxels()[2] / m_config.dimDomains()[2];
-            auto dminx = dx * (dIds[0] + 0);
-            auto dminy = dy * (dIds[1] + 0);
-            auto dminz = dz * (dIds[2] + 0);
-            auto dmaxx = dx * (dIds[0] + 1);
-            auto dmaxy = dy * (dIds[1] + 1);
-            auto dmaxz = dz * (dIds[2] + 1);
-            Region dRegion(dminx, dminy, dminz, dmaxx, dmaxy, dmaxz);
-            if (!dRegion.contains(locx[i], locy[i], locz[i])) continue;
-            // for each sampling region, check if loc is inside.
-            for (auto hIds : d.second) {
-                float hx =
-                        (dmaxx - dminx) / m_config.dimHistsPerDomain()[0];
-                float hy =
-                        (dmaxy - dminy) / m_config.dimHistsPerDomain()[1];
-                float hz =
-                        (dmaxz - dminz) / m_config.dimHistsPerDomain()[2];
-                auto hminx = dminx + hx * (hIds[0] + 0);
-                auto hminy = dminy + hy * (hIds[1] + 0);
-                auto hminz = dminz + hz * (hIds[2] + 0);
-                auto hmaxx = dminx + hx * (hIds[0] + 1);
-                auto hmaxy = dminy + hy * (hIds[1] + 1);
-                auto hmaxz = dminz + hz * (hIds[2] + 1);
-                Region hRegion(hminx, hminy, hminz, hmaxx, hmaxy, hmaxz);
-                if (!hRegion.contains(locx[i], locy[i], locz[i])) continue;
-                // add the particles to the return array.
-                Particle part;
-                part.ssn = ssn[i];
-                part.loc[0] = locx[i];
-                part.loc[1] = locy[i];
-                part.loc[2] = locz[i];
-                part.xloc[0] = xlocx[i];
-                part.xloc[1] = xlocy[i];
-                part.xloc[2] = xlocz[i];
-                part.temp = temp[i];
-                parts.push_back(part);
-            }
+    if (wants(XLOC))
+        while (!reader.readArrayIfNameIs<double>("xloc3", xlocz)) {}
+    if (wants(TEMP))
+        while (!reader.readArrayIfNameIs<double>("T", temp)) {}
+    std::vector<double> vels[3], mixfrac;
+    for (int iDim = 0; iDim < 3 && wants(VEL); ++iDim) {
+        reader.setReadPosFromBeg(dataArraysReadPos);
+        if (!reader.findArray<double>(velNames[iDim], vels[iDim])
+                || vels[iDim].size() != locx.size())
+            vels[iDim].clear();
+    }
+    if (wants(MIXFRAC)) {
+        reader.setReadPosFromBeg(dataArraysReadPos);
+        if (!reader.findArray<double>(mixfracName, mixfrac)
+                || mixfrac.size() != locx.size())
+            mixfrac.clear();
+    }
+    // the particles of the selected sampling regions of the y column,
+    // indexed by the domain along y and the local histogram like the sorted
+    // offsets are.
+    Extent dimHistsPerDomain = m_config.dimHistsPerDomain();
+    int nHistsPerDomain = dimHistsPerDomain.nElement();
+    std::vector<ParticleColumns*> selected(
+            m_config.dimDomains()[1] * nHistsPerDomain, nullptr);
+    for (const auto& d : dMap) {
+        auto dIds = m_config.dimDomains().flattoids(d.first);
+        for (const auto& hIds : d.second) {
+            int hId = dimHistsPerDomain.idstoflat(hIds);
+            auto& hist = parts.emplace(histFlatIdOf(m_config, d.first, hId),
+                    ParticleColumns(attributes())).first->second;
+            selected[dIds[1] * nHistsPerDomain + hId] = &hist;
         }
     }
+    Extent yColumnsExtent(m_config.dimDomains()[0], m_config.dimDomains()[2]);
+    auto yColumnIds = yColumnsExtent.flattoids(yColumnFlatId);
+    // the domain and sampling region of a particle follow from its location
+    // with a division per dimension instead of testing every region.
+    double domainSizes[3], histSizes[3];
+    for (int iDim = 0; iDim < 3; ++iDim) {
+        domainSizes[iDim] =
+                m_config.dimVoxels()[iDim] / m_config.dimDomains()[iDim];
+        histSizes[iDim] = domainSizes[iDim] / dimHistsPerDomain[iDim];
+    }
+    auto regionOf = [&](int iDim, double loc, int* dId, int* hId) {
+        *dId = int(std::floor(loc / domainSizes[iDim]));
+        *hId = int(std::floor(
+                (loc - *dId * domainSizes[iDim]) / histSizes[iDim]));
+        *hId = std::min(std::max(*hId, 0), dimHistsPerDomain[iDim] - 1);
+    };
+    for (std::size_t i = 0; i < locx.size(); ++i) {
+        int dIds[3], hIds[3];
+        regionOf(0, locx[i], &dIds[0], &hIds[0]);
+        regionOf(1, locy[i], &dIds[1], &hIds[1]);
+        regionOf(2, locz[i], &dIds[2], &hIds[2]);
+        if (dIds[0] != yColumnIds[0] || dIds[2] != yColumnIds[1]
+                || dIds[1] < 0 || dIds[1] >= m_config.dimDomains()[1])
+            continue;
+        int iHist = dIds[1] * nHistsPerDomain
+                + dimHistsPerDomain.idstoflat(hIds[0], hIds[1], hIds[2]);
+        if (!selected[iHist]) continue;
+        // add the particles to the return array.
+        double loc[3] = { locx[i], locy[i], locz[i] };
+        double xloc[3] = { 0.0, 0.0, 0.0 };
+        if (wants(XLOC)) {
+            xloc[0] = xlocx[i];
+            xloc[1] = xlocy[i];
+            xloc[2] = xlocz[i];
+        }
+        double vel[3] = { 0.0, 0.0, 0.0 };
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            if (!vels[iDim].empty())
+                vel[iDim] = vels[iDim][i];
+        }
+        selected[iHist]->push_back(wants(SSN) ? ssn[i] : 0, loc, xloc,
+                wants(TEMP) ? temp[i] : 0.0, vel,
+                mixfrac.empty() ? 0.0 : mixfrac[i]);
+    }
     return parts;
 }
 
-std::vector<Particle> SortedOrigTracerReader::readYColumnDomains(
+TracerReader::HistParticles SortedOrigTracerReader::readYColumnDomains(
         int yColumnFlatId, const DomainMap &dMap) const {
-    std::vector<Particle> parts;
+    HistParticles parts;
     // index file name
     char indexFileName[100];
     sprintf(indexFileName, "sortedtraceroffsets.%05d", yColumnFlatId);
@@ -170,7 +254,6 @@ std::vector<Particle> SortedOrigTracerReader::readYColumnDomains(
     // read the index file
     FortranReader indexReader(indexFilePath);
     std::vector<int32_t> offsets = indexReader.readInt32Array();
-    parts.reserve(offsets[offsets.size() - 2] + offsets[offsets.size() - 1]);
     // tracer file name
     char tracerFileName[20];
     sprintf(tracerFileName, "tracer.%05d", yColumnFlatId);
@@ -182,7 +265,7 @@ std::vector<Particle> SortedOrigTracerReader::readYColumnDomains(
     tracerReader.ignoreRecord(); // ssn_g
     tracerReader.ignoreRecord(); // fill_g
     tracerReader.ignoreRecord(); // seed_g
-    int dataArraysReadPos = tracerReader.currReadPos();
+    int64_t dataArraysReadPos = tracerReader.currReadPos();
     /// TODO: currently assuming the order of the arrays, but the not needed
     /// arrays in the middle are ignored.
     for (auto d : dMap) {
@@ -195,51 +278,86 @@ std::vector<Particle> SortedOrigTracerReader::readYColumnDomains(
             int flatLocalHistId =
                     m_config.dimHistsPerDomain().idstoflat(localHistIds);
             int flatYColumnHistId = histOffset + flatLocalHistId;
-            int offset = offsets[2 * flatYColumnHistId + 0];
-            int nParts = offsets[2 * flatYColumnHistId + 1];
+            int64_t offset = offsets[2 * flatYColumnHistId + 0];
+            int64_t nParts = offsets[2 * flatYColumnHistId + 1];
             std::vector<int64_t> ssn;
             std::vector<double> locx, locy, locz, xlocx, xlocy, xlocz;
             std::vector<float> temp;
+            auto& hist = parts.emplace(
+                    histFlatIdOf(m_config, d.first, flatLocalHistId),
+                    ParticleColumns(attributes())).first->second;
+            hist.reserve(nParts);
             tracerReader.setReadPosFromBeg(dataArraysReadPos);
-            while (!tracerReader.readSubArrayIfNameIs<int64_t>(
-                    "SSN", offset, nParts, ssn)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "loc1", offset, nParts, locx)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "xloc1", offset, nParts, xlocx)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "loc2", offset, nParts, locy)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "xloc2", offset, nParts, xlocy)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "loc3", offset, nParts, locz)) {}
-            while (!tracerReader.readSubArrayIfNameIs<double>(
-                    "xloc3", offset, nParts, xlocz)) {}
-            while (!tracerReader.readSubArrayIfNameIs<float>(
-                    "T", offset, nParts, temp)) {}
-            for (auto iPart = 0; iPart < nParts; ++iPart) {
-                Particle part;
-                part.ssn = ssn[iPart];
-                part.loc[0] = locx[iPart];
-                part.loc[1] = locy[iPart];
-                part.loc[2] = locz[iPart];
-                part.xloc[0] = xlocx[iPart];
-                part.xloc[1] = xlocy[iPart];
-                part.xloc[2] = xlocz[iPart];
-                part.temp = temp[iPart];
-                parts.push_back(part);
+            if (wants(SSN))
+                while (!tracerReader.readSubArrayIfNameIs<int64_t>(
+                        "SSN", offset, nParts, ssn)) {}
+            if (wants(LOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "loc1", offset, nParts, locx)) {}
+            if (wants(XLOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "xloc1", offset, nParts, xlocx)) {}
+            if (wants(LOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "loc2", offset, nParts, locy)) {}
+            if (wants(XLOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "xloc2", offset, nParts, xlocy)) {}
+            if (wants(LOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "loc3", offset, nParts, locz)) {}
+            if (wants(XLOC))
+                while (!tracerReader.readSubArrayIfNameIs<double>(
+                        "xloc3", offset, nParts, xlocz)) {}
+            if (wants(TEMP))
+                while (!tracerReader.readSubArrayIfNameIs<float>(
+                        "T", offset, nParts, temp)) {}
+            std::vector<double> vels[3], mixfrac;
+            for (int iDim = 0; iDim < 3 && wants(VEL); ++iDim) {
+                tracerReader.setReadPosFromBeg(dataArraysReadPos);
+                tracerReader.findSubArray<double>(
+                        velNames[iDim], offset, nParts, vels[iDim]);
+            }
+            if (wants(MIXFRAC)) {
+                tracerReader.setReadPosFromBeg(dataArraysReadPos);
+                tracerReader.findSubArray<double>(
+                        mixfracName, offset, nParts, mixfrac);
+            }
+            for (int64_t iPart = 0; iPart < nParts; ++iPart) {
+                double loc[3] = { 0.0, 0.0, 0.0 };
+                double xloc[3] = { 0.0, 0.0, 0.0 };
+                if (wants(LOC)) {
+                    loc[0] = locx[iPart];
+                    loc[1] = locy[iPart];
+                    loc[2] = locz[iPart];
+                }
+                if (wants(XLOC)) {
+                    xloc[0] = xlocx[iPart];
+                    xloc[1] = xlocy[iPart];
+                    xloc[2] = xlocz[iPart];
+                }
+                double vel[3] = { 0.0, 0.0, 0.0 };
+                for (int iDim = 0; iDim < 3; ++iDim) {
+                    if (!vels[iDim].empty())
+                        vel[iDim] = vels[iDim][iPart];
+                }
+                hist.push_back(wants(SSN) ? ssn[iPart] : 0, loc, xloc,
+                        wants(TEMP) ? temp[iPart] : 0.0, vel,
+                        mixfrac.empty() ? 0.0 : mixfrac[iPart]);
             }
         }
     }
     return parts;
 }
 
-std::vector<Particle> DomainTracerReader::read(
+TracerReader::HistParticles DomainTracerReader::readHists(
         const std::vector<int> &selectedHistFlatIds) const
 {
-    std::vector<Particle> parts;
     QElapsedTimer timer;
     timer.start();
+    // group the selected histograms by domain so that every domain's files
+    // are opened once.
+    std::map<int, std::vector<int>> domains, domainHistFlatIds;
     for (unsigned int iSelect = 0;
             iSelect < selectedHistFlatIds.size();
             ++iSelect) {
@@ -253,16 +371,88 @@ std::vector<Particle> DomainTracerReader::read(
         }
         int dId = m_config.dimDomains().idstoflat(dIds);
         int hId = m_config.dimHistsPerDomain().idstoflat(hIds);
-        auto local = readLocal(m_config.dir(), dId, hId);
-        parts.insert(parts.end(), local.begin(), local.end());
-        qDebug() << "loaded" << parts.size() << "in" << timer.elapsed() <<"ms.";
+        domains[dId].push_back(hId);
+        domainHistFlatIds[dId].push_back(selectedHistFlatIds[iSelect]);
+    }
+    // read the domains on the global thread pool.
+    std::vector<QFuture<std::vector<ParticleColumns>>> futures;
+    for (const auto& domain : domains) {
+        int dId = domain.first;
+        const std::vector<int>* hIds = &domain.second;
+        futures.push_back(QtConcurrent::run([this, dId, hIds]() {
+            return readDomain(m_config.dir(), dId, *hIds);
+        }));
+    }
+    HistParticles parts;
+    int64_t nParts = 0;
+    auto histFlatIds = domainHistFlatIds.begin();
+    for (auto& future : futures) {
+        auto domainParts = future.result();
+        for (unsigned int iHist = 0; iHist < domainParts.size(); ++iHist) {
+            nParts += domainParts[iHist].size();
+            parts[histFlatIds->second[iHist]] = std::move(domainParts[iHist]);
+        }
+        ++histFlatIds;
     }
+    qDebug() << "loaded" << nParts << "particles of" << domains.size()
+             << "domains in" << timer.elapsed() << "ms.";
     return parts;
 }
 
-std::vector<Particle> ManyFilesTracerReader::readLocal(
-        const std::string &dir, int dId, int hId) const {
-    std::vector<Particle> parts;
+int DomainTracerReader::fileId(int histFlatId) const {
+    return int(m_config.dimDomains().idstoflat(
+            domainIdsOf(m_config, histFlatId)));
+}
+
+/**
+ * @brief DomainTracerReader::coalesce sorts the particle ranges of the
+ * selected histograms of a domain and merges the ones that touch or
+ * overlap, so that each merged range is one contiguous read.
+ */
+std::vector<DomainTracerReader::Range> DomainTracerReader::coalesce(
+        std::vector<Range> ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+            [](const Range& a, const Range& b) { return a.offset < b.offset; });
+    std::vector<Range> merged;
+    for (const auto& range : ranges) {
+        if (0 == range.count)
+            continue;
+        if (!merged.empty()
+                && range.offset <= merged.back().offset + merged.back().count) {
+            merged.back().count = std::max(merged.back().count,
+                    range.offset + range.count - merged.back().offset);
+            continue;
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+/**
+ * @brief DomainTracerReader::split hands the particles of a merged range,
+ * read into ids, xlocs and values, to the histograms whose ranges it covers.
+ */
+void DomainTracerReader::split(const Range& merged,
+        const std::vector<Range>& ranges, const int64_t* ids,
+        const double* xlocs, const double* values,
+        std::vector<ParticleColumns>& parts) {
+    const double loc[3] = { 0.0, 0.0, 0.0 };
+    for (unsigned int iHist = 0; iHist < ranges.size(); ++iHist) {
+        const Range& range = ranges[iHist];
+        if (0 == range.count || range.offset < merged.offset
+                || range.offset >= merged.offset + merged.count)
+            continue;
+        parts[iHist].reserve(range.count);
+        for (int64_t i = range.offset - merged.offset;
+                i < range.offset - merged.offset + range.count; ++i)
+            parts[iHist].push_back(ids[i], loc, &xlocs[3 * i], values[i]);
+    }
+}
+
+std::vector<ParticleColumns> ManyFilesTracerReader::readDomain(
+        const std::string &dir, int dId, const std::vector<int>& hIds) const {
+    std::vector<ParticleColumns> parts(hIds.size(),
+            ParticleColumns(attributes()));
     // file names
     QString data_path = QString::fromStdString(dir);
     QString helper_filename =
@@ -274,20 +464,23 @@ std::vector<Particle> ManyFilesTracerReader::readLocal(
     QString data_filename = data_path +
             QString("/sortedtracer.%1").arg(dId, 5, 10, QChar('0'));
 
-    int read;
-    int count;
-
-    // open helper, go to hId, get start read and count
+    // open helper, get the start read and count of every histogram
     QFile helper_file(helper_filename);
     if (!helper_file.open(QIODevice::ReadOnly)) {
         qDebug() << "Can't find or open" << helper_file.fileName();
         return parts;
     }
-
-    helper_file.seek(hId * 2 * sizeof(int));
-    helper_file.read((char*)&read, sizeof(int));
-    helper_file.read((char*)&count, sizeof(int));
+    std::vector<int> helper(helper_file.size() / sizeof(int));
+    helper_file.read(reinterpret_cast<char*>(helper.data()),
+            helper.size() * sizeof(int));
     helper_file.close();
+    std::vector<Range> ranges;
+    for (int hId : hIds) {
+        if (2 * hId + 1 < int64_t(helper.size()))
+            ranges.push_back({ helper[2 * hId + 0], helper[2 * hId + 1] });
+        else
+            ranges.push_back({ 0, 0 });
+    }
 
     // open rest of the particle files
     QFile id_file(id_filename);
@@ -306,27 +499,24 @@ std::vector<Particle> ManyFilesTracerReader::readLocal(
         return parts;
     }
 
-    // grab the corresponding particles
-    if (0 != count) {
-        id_file.seek(read * sizeof(long long int));
-        pos_file.seek(read * 3 * sizeof(double));
-        data_file.seek(read * sizeof(double));
-        for (int i = 0; i < count; ++i) {
-            Particle part;
-            long int id;
-            double x, y, z, v;
-            id_file.read((char*)&id, sizeof(long long int));
-            pos_file.read((char*)&x, sizeof(double));
-            pos_file.read((char*)&y, sizeof(double));
-            pos_file.read((char*)&z, sizeof(double));
-            data_file.read((char*)&v, sizeof(double));
-            part.ssn = id;
-            part.xloc[0] = x;
-            part.xloc[1] = y;
-            part.xloc[2] = z;
-            part.temp = v;
-            parts.push_back(part);
-        }
+    // grab the corresponding particles, one read per file and range
+    std::vector<int64_t> ids;
+    std::vector<double> positions, values;
+    for (const auto& range : coalesce(ranges)) {
+        ids.resize(range.count);
+        positions.resize(3 * range.count);
+        values.resize(range.count);
+        id_file.seek(range.offset * sizeof(int64_t));
+        pos_file.seek(range.offset * 3 * sizeof(double));
+        data_file.seek(range.offset * sizeof(double));
+        id_file.read(reinterpret_cast<char*>(ids.data()),
+                range.count * sizeof(int64_t));
+        pos_file.read(reinterpret_cast<char*>(positions.data()),
+                range.count * 3 * sizeof(double));
+        data_file.read(reinterpret_cast<char*>(values.data()),
+                range.count * sizeof(double));
+        split(range, ranges, ids.data(), positions.data(), values.data(),
+                parts);
     }
 
     // close the files
@@ -337,10 +527,11 @@ std::vector<Particle> ManyFilesTracerReader::readLocal(
     return parts;
 }
 
-std::vector<Particle> DomainSortedTracerReader::readLocal(
-        const std::string &dir, int dId, int hId) const
+std::vector<ParticleColumns> DomainSortedTracerReader::readDomain(
+        const std::string &dir, int dId, const std::vector<int>& hIds) const
 {
-    std::vector<Particle> parts;
+    std::vector<ParticleColumns> parts(hIds.size(),
+            ParticleColumns(attributes()));
     std::string filename =
             QString("pdfsortedtracer.%1")
                 .arg(dId, 5, 10, QChar('0')).toStdString();
@@ -349,43 +540,51 @@ std::vector<Particle> DomainSortedTracerReader::readLocal(
     // read the number of histograms per domain decomposition
     std::vector<int32_t> dimHists(3);
     fin.read(reinterpret_cast<char*>(dimHists.data()), 3 * sizeof(int));
-    int nHists = dimHists[0] * dimHists[1] * dimHists[2];
-    int startOfPart = 3 * sizeof(int32_t) + 2 * nHists * sizeof(int32_t);
-    // seek to the corresponding histogram offset and count
-    fin.seekg(3 * sizeof(int32_t) + hId * 2 * sizeof(int32_t), fin.beg);
-    // read the offset and count
-    int32_t offset, count;
-    fin.read(reinterpret_cast<char*>(&offset), sizeof(int32_t));
-    fin.read(reinterpret_cast<char*>(&count), sizeof(int32_t));
-    int32_t lastOffset, lastCount;
-    fin.seekg(startOfPart - 2 * sizeof(int32_t), fin.beg);
-    fin.read(reinterpret_cast<char*>(&lastOffset), sizeof(int32_t));
-    fin.read(reinterpret_cast<char*>(&lastCount), sizeof(int32_t));
-    int32_t totalCount = lastOffset + lastCount;
-    // return if there is no histogram in the sampling region
-    if (0 == count) return std::vector<Particle>();
-    // read the corresponding particles
-    // read the particle id
-    fin.seekg(startOfPart + offset * sizeof(int64_t), fin.beg);
-    std::vector<int64_t> partIds(count);
-    fin.read(reinterpret_cast<char*>(partIds.data()), count * sizeof(int64_t));
-    // read the particle physical positions
-    fin.seekg(startOfPart + totalCount * sizeof(int64_t) + offset * 3 * sizeof(double), fin.beg);
-    std::vector<double> xlocs(3 * count);
-    fin.read(reinterpret_cast<char*>(xlocs.data()), count * 3 * sizeof(double));
-    // read the particle scalar values
-    fin.seekg(startOfPart + totalCount * (sizeof(int64_t) + 3 * sizeof(double)) + offset * sizeof(double));
-    std::vector<double> scalars(count);
-    fin.read(reinterpret_cast<char*>(scalars.data()), count * sizeof(double));
-    // put the loaded arrays into the return array
-    parts.resize(count);
-    for (int iPart = 0; iPart < count; ++iPart) {
-        auto& part = parts[iPart];
-        part.ssn = partIds[iPart];
-        part.xloc[0] = xlocs[3 * iPart + 0];
-        part.xloc[1] = xlocs[3 * iPart + 1];
-        part.xloc[2] = xlocs[3 * iPart + 2];
-        part.temp = scalars[iPart];
+    int64_t nHists = Extent(dimHists).nElement();
+    int64_t startOfPart = 3 * sizeof(int32_t) + 2 * nHists * sizeof(int32_t);
+    // read the offsets and counts of all the histograms at once
+    std::vector<int32_t> offsetCounts(2 * nHists);
+    fin.read(reinterpret_cast<char*>(offsetCounts.data()),
+            2 * nHists * sizeof(int32_t));
+    if (!fin || 0 == nHists)
+        return parts;
+    int64_t totalCount =
+            int64_t(offsetCounts[2 * nHists - 2]) + offsetCounts[2 * nHists - 1];
+    std::vector<Range> ranges;
+    for (int hId : hIds) {
+        if (hId < nHists) {
+            ranges.push_back(
+                    { offsetCounts[2 * hId + 0], offsetCounts[2 * hId + 1] });
+        } else {
+            ranges.push_back({ 0, 0 });
+        }
+    }
+    // read the corresponding particles, one read per array and range
+    std::vector<int64_t> partIds;
+    std::vector<double> xlocs, scalars;
+    for (const auto& range : coalesce(ranges)) {
+        int64_t offset = range.offset, count = range.count;
+        // read the particle id
+        partIds.resize(count);
+        fin.seekg(startOfPart + offset * sizeof(int64_t), fin.beg);
+        fin.read(reinterpret_cast<char*>(partIds.data()),
+                count * sizeof(int64_t));
+        // read the particle physical positions
+        xlocs.resize(3 * count);
+        fin.seekg(startOfPart + totalCount * sizeof(int64_t)
+                + offset * 3 * sizeof(double), fin.beg);
+        fin.read(reinterpret_cast<char*>(xlocs.data()),
+                count * 3 * sizeof(double));
+        // read the particle scalar values
+        scalars.resize(count);
+        fin.seekg(startOfPart
+                + totalCount * (sizeof(int64_t) + 3 * sizeof(double))
+                + offset * sizeof(double), fin.beg);
+        fin.read(reinterpret_cast<char*>(scalars.data()),
+                count * sizeof(double));
+        // put the loaded arrays into the return arrays
+        split(range, ranges, partIds.data(), xlocs.data(), scalars.data(),
+                parts);
     }
     return parts;
 }
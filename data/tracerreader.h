@@ -7,33 +7,12 @@
 #include <cstdio>
 #include <fstream>
 #include "fortranreader.h"
+#include "particlecolumns.h"
+#include "tracerconfig.h"
 #include "Extent.h"
 #include <glm/vec3.hpp>
 
 
-class TracerConfig {
-public:
-    TracerConfig(std::string dir, const std::vector<int>& dimDomains,
-            const std::vector<int>& dimHistsPerDomain, const std::vector<int>& dimVoxels)
-      : m_dir(dir), m_dimDomains(dimDomains), m_dimHistsPerDomain(dimHistsPerDomain), m_dimVoxels(dimVoxels) {}
-    const std::string& dir() const { return m_dir; }
-    Extent dimDomains() const { return Extent(m_dimDomains); }
-    Extent dimHists() const { return Extent(
-            m_dimDomains[0] * m_dimHistsPerDomain[0],
-            m_dimDomains[1] * m_dimHistsPerDomain[1],
-            m_dimDomains[2] * m_dimHistsPerDomain[2]); }
-    Extent dimHistsPerDomain() const { return Extent(m_dimHistsPerDomain); }
-    Extent dimVoxels() const { return Extent(m_dimVoxels); }
-
-private:
-    std::string m_dir;
-    std::vector<int> m_dimDomains;
-    std::vector<int> m_dimHistsPerDomain;
-    std::vector<int> m_dimVoxels;
-};
-
-
-
 struct Region
 {
     Region(double xmin, double ymin, double zmin, double xmax, double ymax, double zmax)
@@ -74,8 +53,12 @@ public:
     ~TracerFileReader() {}
 
 public:
-    int currReadPos() { return reader.currReadPos(); }
-    void setReadPosFromBeg(int readPos) { reader.setReadPosFromBeg(readPos); }
+    /// False once a read went past the end of the file.
+    bool good() const { return reader.good(); }
+    int64_t currReadPos() { return reader.currReadPos(); }
+    void setReadPosFromBeg(int64_t readPos) {
+        reader.setReadPosFromBeg(readPos);
+    }
 
 public:
     void ignoreRecord()  { reader.ignoreRecord(); }
@@ -120,15 +103,15 @@ public:
             return false;
         }
         double ref = reader.readDouble();
-        out = reader.readArray<T>();
+        reader.readArray(out);
         for (auto& ele : out)
             ele *= ref;
         return true;
     }
 
     template <typename T>
-    bool readSubArrayIfNameIs(const std::string& name, int offset,
-            int nElements, std::vector<T>& out) {
+    bool readSubArrayIfNameIs(const std::string& name, int64_t offset,
+            int64_t nElements, std::vector<T>& out) {
         std::vector<char> varfile = reader.readCharArray();
         std::string varStr(varfile.begin(), varfile.end());
 //        std::cout << varStr << std::endl;
@@ -144,6 +127,30 @@ public:
         return true;
     }
 
+    /// Reads the array named name, searching the arrays from the read
+    /// position to the end of the file, false and out empty when there is
+    /// none.
+    template <class T>
+    bool findArray(const std::string& name, std::vector<T>& out) {
+        while (good()) {
+            if (readArrayIfNameIs(name, out))
+                return true;
+        }
+        out.clear();
+        return false;
+    }
+
+    template <typename T>
+    bool findSubArray(const std::string& name, int64_t offset,
+            int64_t nElements, std::vector<T>& out) {
+        while (good()) {
+            if (readSubArrayIfNameIs(name, offset, nElements, out))
+                return true;
+        }
+        out.clear();
+        return false;
+    }
+
 private:
     FortranReader reader;
 };
@@ -153,21 +160,48 @@ private:
 class TracerReader
 {
 public:
+    /// The particle attributes to read, which the readers of the files with
+    /// one array per attribute use to skip the others undecoded. Only the
+    /// tracer files hold velocities and mixture fractions, which the domain
+    /// files leave zero.
+    enum Attribute {
+        SSN = ParticleColumns::SSN, LOC = ParticleColumns::LOC,
+        XLOC = ParticleColumns::XLOC, TEMP = ParticleColumns::TEMP,
+        VEL = ParticleColumns::VEL, MIXFRAC = ParticleColumns::MIXFRAC,
+        ALL = ParticleColumns::ALL
+    };
     static std::shared_ptr<TracerReader> create(const TracerConfig& config);
+    TracerReader() : m_attributes(ALL) {}
     virtual ~TracerReader() {}
 
 public:
-    virtual std::vector<Particle> read(
+    /// The particles of each of the selected histograms by flat id, an empty
+    /// one for a histogram without particles.
+    typedef std::unordered_map<int, ParticleColumns> HistParticles;
+    virtual HistParticles readHists(
             const std::vector<int>& selectedHistFlatIds) const = 0;
+    /// The particles of the selected histograms in the order of the ids.
+    ParticleColumns read(const std::vector<int>& selectedHistFlatIds) const;
+    /// The file the particles of a histogram are read from. The histograms
+    /// of a file are best read together, which reads the file once.
+    virtual int fileId(int /*histFlatId*/) const { return 0; }
+    void setAttributes(int attributes) { m_attributes = attributes; }
+    int attributes() const { return m_attributes; }
+    bool wants(Attribute attribute) const {
+        return 0 != (m_attributes & attribute);
+    }
+
+private:
+    int m_attributes;
 };
 
 
 
 class NullTracerReader : public TracerReader {
 public:
-    virtual std::vector<Particle> read(
+    virtual HistParticles readHists(
             const std::vector<int>& /*selectedHistFlatIds*/) const override {
-        return std::vector<Particle>();
+        return HistParticles();
     }
 };
 
@@ -177,12 +211,14 @@ class OrigTracerReader : public TracerReader
 {
 public:
     OrigTracerReader(const TracerConfig& config) : m_config(config) {}
-    virtual std::vector<Particle> read(
-            const std::vector<int>& selectedHistFlatIds) const;
+    virtual HistParticles readHists(
+            const std::vector<int>& selectedHistFlatIds) const override;
+    /// The y column of the histogram, of the file tracer.<y column>.
+    virtual int fileId(int histFlatId) const override;
 
 protected:
     typedef std::unordered_map<int, std::vector<std::vector<int>>> DomainMap;
-    virtual std::vector<Particle> readYColumnDomains(
+    virtual HistParticles readYColumnDomains(
             int yColumnFlatId, const DomainMap& dMap) const;
 
 protected:
@@ -196,7 +232,7 @@ public:
       : OrigTracerReader(config) {}
 
 protected:
-    virtual std::vector<Particle> readYColumnDomains(
+    virtual HistParticles readYColumnDomains(
             int yColumnFlatId, const DomainMap& dMap) const override;
 };
 
@@ -204,12 +240,23 @@ class DomainTracerReader : public TracerReader
 {
 public:
     DomainTracerReader(const TracerConfig& config) : m_config(config) {}
-    virtual std::vector<Particle> read(
-            const std::vector<int> &selectedHistFlatIds) const;
+    virtual HistParticles readHists(
+            const std::vector<int> &selectedHistFlatIds) const override;
+    /// The domain of the histogram, whose files hold its particles.
+    virtual int fileId(int histFlatId) const override;
 
 protected:
-    virtual std::vector<Particle> readLocal(
-            const std::string& dir, int dId, int hId) const = 0;
+    /// A run of particles in the files of a domain.
+    struct Range {
+        int64_t offset, count;
+    };
+    static std::vector<Range> coalesce(std::vector<Range> ranges);
+    static void split(const Range& merged, const std::vector<Range>& ranges,
+            const int64_t* ids, const double* xlocs, const double* values,
+            std::vector<ParticleColumns>& parts);
+    /// The particles of each of the local histograms hIds of the domain dId.
+    virtual std::vector<ParticleColumns> readDomain(const std::string& dir, int dId,
+            const std::vector<int>& hIds) const = 0;
 
 protected:
     TracerConfig m_config;
@@ -222,8 +269,8 @@ public:
     ManyFilesTracerReader(const TracerConfig& config) : DomainTracerReader(config) {}
 
 protected:
-    virtual std::vector<Particle> readLocal(
-            const std::string& dir, int dId, int hId) const;
+    virtual std::vector<ParticleColumns> readDomain(const std::string& dir,
+            int dId, const std::vector<int>& hIds) const;
 };
 
 class DomainSortedTracerReader : public DomainTracerReader
@@ -232,8 +279,8 @@ public:
     DomainSortedTracerReader(const TracerConfig& config) : DomainTracerReader(config) {}
 
 protected:
-    virtual std::vector<Particle> readLocal(
-            const std::string& dir, int dId, int hId) const;
+    virtual std::vector<ParticleColumns> readDomain(const std::string& dir,
+            int dId, const std::vector<int>& hIds) const;
 };
 
 #endif // TRACERREADER_H
@@ -0,0 +1,537 @@
+#include "tracersorter.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fileio.h"
+#include "fortranreader.h"
+#include "parallel.h"
+
+namespace {
+
+// the arrays a tracer file has, in the order S3D writes them
+enum { SSN, LOC1, XLOC1, LOC2, XLOC2, LOC3, XLOC3, TEMP, N_COLUMNS };
+const char* columnNames[N_COLUMNS] = {
+    "SSN", "loc1", "xloc1", "loc2", "xloc2", "loc3", "xloc3", "T"
+};
+
+// the arrays not every run writes, found anywhere among the others
+enum { VEL1, VEL2, VEL3, MIXFRAC, N_OPTIONAL_COLUMNS };
+const char* optionalColumnNames[N_OPTIONAL_COLUMNS] = {
+    "u1", "u2", "u3", "mixfrac"
+};
+
+// where the data record of an array begins and the scale of its values
+struct Column {
+    double ref;
+    int64_t pos;
+};
+
+// moves past the header of a tracer file to its first array
+void skipHeader(FortranReader& reader) {
+    /* double time = */ reader.readDouble();
+    /* int32_t fillsum = */ reader.readInt32();
+    reader.ignoreRecord(); // ssn_g
+    reader.ignoreRecord(); // fill_g
+    reader.ignoreRecord(); // seed_g
+}
+
+// finds the array named name from the read position on, false at the end of
+// the file
+bool findColumn(FortranReader& reader, const std::string& name,
+        Column* column) {
+    for (;;) {
+        std::vector<char> varfile = reader.readCharArray();
+        if (!reader.good())
+            return false;
+        std::string varStr(varfile.begin(), varfile.end());
+        if (0 == varStr.compare(0, name.size(), name))
+            break;
+        reader.ignoreRecord();
+        reader.ignoreRecord();
+    }
+    column->ref = reader.readDouble();
+    column->pos = reader.currReadPos();
+    return reader.good();
+}
+
+/**
+ * Finds the arrays of the particles after the header of a tracer file,
+ * skipping the ones in between, and how many particles there are. Every
+ * array holds 8 bytes per particle.
+ */
+bool locateColumns(FortranReader& reader, Column* columns,
+        int64_t* nParticles) {
+    skipHeader(reader);
+    for (int iColumn = 0; iColumn < N_COLUMNS; ++iColumn) {
+        if (!findColumn(reader, columnNames[iColumn], &columns[iColumn]))
+            return false;
+        int64_t n = reader.recordLength() / 8;
+        if (0 == iColumn)
+            *nParticles = n;
+        else if (n != *nParticles)
+            return false;
+        reader.ignoreRecord();
+    }
+    return reader.good();
+}
+
+/**
+ * Finds the optional arrays of a tracer file of nParticles, searching from
+ * its first array for each. A missing one, or one of another length, is
+ * left at pos -1.
+ */
+void locateOptionalColumns(FortranReader& reader, int64_t nParticles,
+        Column* columns) {
+    for (int iColumn = 0; iColumn < N_OPTIONAL_COLUMNS; ++iColumn) {
+        reader.setReadPosFromBeg(0);
+        skipHeader(reader);
+        if (!findColumn(reader, optionalColumnNames[iColumn],
+                    &columns[iColumn])
+                || reader.recordLength() / 8 != nParticles)
+            columns[iColumn].pos = -1;
+    }
+}
+
+template <typename T>
+void readChunk(FortranReader& reader, const Column& column, int64_t begin,
+        int64_t n, std::vector<T>& out) {
+    reader.setReadPosFromBeg(column.pos);
+    out = reader.readSubArray<T>(begin, n);
+    for (auto& value : out)
+        value *= column.ref;
+}
+
+/**
+ * The sampling regions of a y column, by the domain along y and then the
+ * local histogram. The region of a location follows from a division per
+ * dimension.
+ */
+class YColumnRegions {
+public:
+    YColumnRegions(const TracerConfig& config, int yColumnFlatId)
+      : _dimDomains(config.dimDomains())
+      , _dimHistsPerDomain(config.dimHistsPerDomain())
+      , _yColumnIds(Extent(_dimDomains[0], _dimDomains[2])
+            .flattoids(yColumnFlatId)) {
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            _domainSizes[iDim] = config.dimVoxels()[iDim] / _dimDomains[iDim];
+            _histSizes[iDim] = _domainSizes[iDim] / _dimHistsPerDomain[iDim];
+        }
+    }
+
+public:
+    int nRegions() const {
+        return int(_dimDomains[1] * _dimHistsPerDomain.nElement());
+    }
+    /// The region of a location, -1 when it is outside of the y column.
+    int of(double x, double y, double z) const {
+        double loc[3] = { x, y, z };
+        int dIds[3], hIds[3];
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            dIds[iDim] = int(std::floor(loc[iDim] / _domainSizes[iDim]));
+            hIds[iDim] = int(std::floor(
+                    (loc[iDim] - dIds[iDim] * _domainSizes[iDim])
+                        / _histSizes[iDim]));
+            hIds[iDim] = std::min(std::max(hIds[iDim], 0),
+                    _dimHistsPerDomain[iDim] - 1);
+        }
+        if (dIds[0] != _yColumnIds[0] || dIds[2] != _yColumnIds[1]
+                || dIds[1] < 0 || dIds[1] >= _dimDomains[1])
+            return -1;
+        return int(dIds[1] * _dimHistsPerDomain.nElement()
+                + _dimHistsPerDomain.idstoflat(hIds[0], hIds[1], hIds[2]));
+    }
+    /// The region of a histogram of the y column among all histograms.
+    int of(const Extent& dimHists, int histFlatId) const {
+        auto ids = dimHists.flattoids(histFlatId);
+        int dIdY = ids[1] / _dimHistsPerDomain[1];
+        return int(dIdY * _dimHistsPerDomain.nElement()
+                + _dimHistsPerDomain.idstoflat(ids[0] % _dimHistsPerDomain[0],
+                    ids[1] % _dimHistsPerDomain[1],
+                    ids[2] % _dimHistsPerDomain[2]));
+    }
+
+private:
+    Extent _dimDomains, _dimHistsPerDomain;
+    std::vector<int> _yColumnIds;
+    double _domainSizes[3], _histSizes[3];
+};
+
+// an output file, one per domain of the y column
+struct DomainFile {
+    std::string path;
+    int fd = -1;
+    int64_t ssnStart, xlocStart, tempStart;
+};
+
+// the particles of a sampling region waiting to be written
+struct Bucket {
+    int64_t cursor = 0;
+    std::vector<int64_t> ssns;
+    std::vector<double> xlocs, temps;
+};
+
+bool flush(Bucket& bucket, const DomainFile& file) {
+    int64_t n = bucket.ssns.size();
+    bool ok = writeAt(file.fd, bucket.ssns.data(), n * sizeof(int64_t),
+                file.ssnStart + bucket.cursor * sizeof(int64_t))
+            && writeAt(file.fd, bucket.xlocs.data(), 3 * n * sizeof(double),
+                file.xlocStart + 3 * bucket.cursor * sizeof(double))
+            && writeAt(file.fd, bucket.temps.data(), n * sizeof(double),
+                file.tempStart + bucket.cursor * sizeof(double));
+    bucket.cursor += n;
+    bucket.ssns.clear();
+    bucket.xlocs.clear();
+    bucket.temps.clear();
+    return ok;
+}
+
+} // anonymous namespace
+
+TracerSorter::TracerSorter(const TracerConfig& config, int64_t memoryBudget,
+        int nThreads)
+  : _config(config)
+  , _memoryBudget(memoryBudget)
+  , _nThreads(threadCount(nThreads)) {}
+
+std::string TracerSorter::filename(const std::string& dir, int domainFlatId) {
+    char name[32];
+    sprintf(name, "pdfsortedtracer.%05d", domainFlatId);
+    return dir + name;
+}
+
+bool TracerSorter::sort(const std::string& outDir) const {
+    int nYColumns = _config.dimDomains()[0] * _config.dimDomains()[2];
+    int nThreads = std::max(1, std::min(nYColumns, _nThreads));
+    int64_t budget = _memoryBudget / nThreads;
+    std::atomic<bool> ok(true);
+    parallelFor(nYColumns, nThreads, [&](int i) {
+        if (ok && !sortYColumn(i, outDir, budget))
+            ok = false;
+    });
+    // the files of the columns that did sort would be taken for a sorted
+    // step by TracerReader::create, so none are left.
+    int nDomains = _config.dimDomains().nElement();
+    for (int iDomain = 0; !ok && iDomain < nDomains; ++iDomain)
+        unlink(filename(outDir, iDomain).c_str());
+    return ok;
+}
+
+bool TracerSorter::sortYColumn(int yColumnFlatId, const std::string& outDir,
+        int64_t memoryBudget) const {
+    char tracerName[32];
+    sprintf(tracerName, "tracer.%05d", yColumnFlatId);
+    FortranReader reader(_config.dir() + tracerName);
+    Column columns[N_COLUMNS];
+    int64_t nParticles = 0;
+    if (!reader.good() || !locateColumns(reader, columns, &nParticles))
+        return false;
+
+    Extent dimDomains = _config.dimDomains();
+    Extent dimHistsPerDomain = _config.dimHistsPerDomain();
+    int nHistsPerDomain = dimHistsPerDomain.nElement();
+    YColumnRegions regions(_config, yColumnFlatId);
+    int nBuckets = regions.nRegions();
+    auto yColumnIds = Extent(dimDomains[0], dimDomains[2])
+            .flattoids(yColumnFlatId);
+    // half of the budget streams the arrays, the other half buffers the
+    // sampling regions. When it cannot hold the smallest buffer of every
+    // region, the regions are scattered a group at a time, the arrays
+    // streamed again for every group.
+    const int64_t bytesPerParticle = N_COLUMNS * 8;
+    const int64_t bytesPerBuffered = 5 * 8;
+    const int64_t minBucketSize = 16;
+    int64_t chunkSize = std::max<int64_t>(1024,
+            memoryBudget / 2 / bytesPerParticle);
+    int groupSize = int(std::max<int64_t>(1, std::min<int64_t>(nBuckets,
+            memoryBudget / 2 / (minBucketSize * bytesPerBuffered))));
+    int64_t bucketSize = std::max<int64_t>(minBucketSize,
+            memoryBudget / 2 / groupSize / bytesPerBuffered);
+
+    // first pass: count the particles of every sampling region.
+    std::vector<int64_t> counts(nBuckets, 0);
+    std::vector<double> locx, locy, locz;
+    for (int64_t begin = 0; begin < nParticles; begin += chunkSize) {
+        int64_t n = std::min(chunkSize, nParticles - begin);
+        readChunk(reader, columns[LOC1], begin, n, locx);
+        readChunk(reader, columns[LOC2], begin, n, locy);
+        readChunk(reader, columns[LOC3], begin, n, locz);
+        for (int64_t i = 0; i < n; ++i) {
+            int iBucket = regions.of(locx[i], locy[i], locz[i]);
+            if (0 <= iBucket)
+                ++counts[iBucket];
+        }
+    }
+
+    // the output files with their offset tables, sized up front.
+    std::vector<DomainFile> files(dimDomains[1]);
+    std::vector<Bucket> buckets(nBuckets);
+    bool ok = true;
+    for (int iDomainY = 0; iDomainY < dimDomains[1] && ok; ++iDomainY) {
+        std::vector<int32_t> header = {
+            dimHistsPerDomain[0], dimHistsPerDomain[1], dimHistsPerDomain[2]
+        };
+        int64_t total = 0;
+        for (int iHist = 0; iHist < nHistsPerDomain; ++iHist) {
+            int iBucket = iDomainY * nHistsPerDomain + iHist;
+            buckets[iBucket].cursor = total;
+            header.push_back(int32_t(total));
+            header.push_back(int32_t(counts[iBucket]));
+            total += counts[iBucket];
+        }
+        if (total > INT_MAX) {
+            ok = false;
+            break;
+        }
+        int dId = dimDomains.idstoflat(yColumnIds[0], iDomainY, yColumnIds[1]);
+        DomainFile& file = files[iDomainY];
+        file.path = filename(outDir, dId);
+        file.fd = open((file.path + ".tmp").c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        file.ssnStart = header.size() * sizeof(int32_t);
+        file.xlocStart = file.ssnStart + total * sizeof(int64_t);
+        file.tempStart = file.xlocStart + 3 * total * sizeof(double);
+        ok = 0 <= file.fd
+                && writeAt(file.fd, header.data(),
+                    header.size() * sizeof(int32_t), 0)
+                && 0 == ftruncate(file.fd,
+                    file.tempStart + total * sizeof(double));
+    }
+
+    // second pass: scatter every particle to the end of its region, the
+    // regions of one group at a time.
+    std::vector<int64_t> ssns;
+    std::vector<double> xlocx, xlocy, xlocz, temps;
+    for (int groupBegin = 0; groupBegin < nBuckets && ok;
+            groupBegin += groupSize) {
+        int groupEnd = std::min(nBuckets, groupBegin + groupSize);
+        for (int64_t begin = 0; begin < nParticles && ok;
+                begin += chunkSize) {
+            int64_t n = std::min(chunkSize, nParticles - begin);
+            readChunk(reader, columns[SSN], begin, n, ssns);
+            readChunk(reader, columns[LOC1], begin, n, locx);
+            readChunk(reader, columns[LOC2], begin, n, locy);
+            readChunk(reader, columns[LOC3], begin, n, locz);
+            readChunk(reader, columns[XLOC1], begin, n, xlocx);
+            readChunk(reader, columns[XLOC2], begin, n, xlocy);
+            readChunk(reader, columns[XLOC3], begin, n, xlocz);
+            readChunk(reader, columns[TEMP], begin, n, temps);
+            for (int64_t i = 0; i < n && ok; ++i) {
+                int iBucket = regions.of(locx[i], locy[i], locz[i]);
+                if (iBucket < groupBegin || iBucket >= groupEnd)
+                    continue;
+                Bucket& bucket = buckets[iBucket];
+                bucket.ssns.push_back(ssns[i]);
+                bucket.xlocs.insert(bucket.xlocs.end(),
+                        { xlocx[i], xlocy[i], xlocz[i] });
+                bucket.temps.push_back(temps[i]);
+                if (int64_t(bucket.ssns.size()) >= bucketSize)
+                    ok = flush(bucket, files[iBucket / nHistsPerDomain]);
+            }
+        }
+        // the buffers of the group are released for the next one
+        for (int iBucket = groupBegin; iBucket < groupEnd; ++iBucket) {
+            Bucket& bucket = buckets[iBucket];
+            if (ok)
+                ok = flush(bucket, files[iBucket / nHistsPerDomain]);
+            std::vector<int64_t>().swap(bucket.ssns);
+            std::vector<double>().swap(bucket.xlocs);
+            std::vector<double>().swap(bucket.temps);
+        }
+    }
+    // written aside and renamed once complete, so a failed sort leaves no
+    // output files behind.
+    for (const auto& file : files) {
+        if (0 <= file.fd && 0 != close(file.fd))
+            ok = false;
+    }
+    for (const auto& file : files) {
+        if (file.fd < 0)
+            continue;
+        std::string tmpPath = file.path + ".tmp";
+        if (!ok || 0 != std::rename(tmpPath.c_str(), file.path.c_str())) {
+            unlink(tmpPath.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool TracerSorter::scan(const std::string& sortedDir,
+        const std::vector<int>& histFlatIds,
+        const BatchCallback& callback, int attributes) const {
+    if (std::ifstream(filename(sortedDir, 0)))
+        return scanSorted(sortedDir, histFlatIds, callback, attributes);
+    // the selected sampling regions of every y column
+    Extent dimHistsPerDomain = _config.dimHistsPerDomain();
+    Extent yColumns(_config.dimDomains()[0], _config.dimDomains()[2]);
+    std::map<int, std::vector<bool>> selected;
+    for (auto histFlatId : histFlatIds) {
+        auto ids = _config.dimHists().flattoids(histFlatId);
+        int yColumnFlatId = int(yColumns.idstoflat(
+                ids[0] / dimHistsPerDomain[0], ids[2] / dimHistsPerDomain[2]));
+        YColumnRegions regions(_config, yColumnFlatId);
+        auto& regionSelected = selected[yColumnFlatId];
+        regionSelected.resize(regions.nRegions(), false);
+        regionSelected[regions.of(_config.dimHists(), histFlatId)] = true;
+    }
+    for (const auto& yColumn : selected) {
+        if (!scanYColumn(yColumn.first, yColumn.second, callback,
+                attributes))
+            return false;
+    }
+    return true;
+}
+
+bool TracerSorter::scanSorted(const std::string& sortedDir,
+        const std::vector<int>& histFlatIds,
+        const BatchCallback& callback, int attributes) const {
+    // the local histograms of every domain
+    Extent dimHistsPerDomain = _config.dimHistsPerDomain();
+    std::map<int, std::vector<int>> domains;
+    for (auto histFlatId : histFlatIds) {
+        auto ids = _config.dimHists().flattoids(histFlatId);
+        std::vector<int> dIds(3), hIds(3);
+        for (int iDim = 0; iDim < 3; ++iDim) {
+            dIds[iDim] = ids[iDim] / dimHistsPerDomain[iDim];
+            hIds[iDim] = ids[iDim] % dimHistsPerDomain[iDim];
+        }
+        domains[int(_config.dimDomains().idstoflat(dIds))].push_back(
+                int(dimHistsPerDomain.idstoflat(hIds)));
+    }
+    const int64_t batchSize = std::max<int64_t>(1024,
+            _memoryBudget / 2 / (5 * 8));
+    ParticleColumns batch(attributes & ~ParticleColumns::LOC);
+    std::vector<int64_t> ssns;
+    std::vector<double> xlocs, temps;
+    const double loc[3] = { 0.0, 0.0, 0.0 };
+    for (auto& domain : domains) {
+        std::ifstream fin(filename(sortedDir, domain.first), std::ios::binary);
+        std::vector<int32_t> dimHists(3);
+        fin.read(reinterpret_cast<char*>(dimHists.data()), 3 * sizeof(int32_t));
+        int64_t nHists = fin ? Extent(dimHists).nElement() : 0;
+        std::vector<int32_t> offsetCounts(2 * nHists);
+        fin.read(reinterpret_cast<char*>(offsetCounts.data()),
+                offsetCounts.size() * sizeof(int32_t));
+        if (!fin)
+            return false;
+        int64_t total = 0 < nHists ? int64_t(offsetCounts[2 * nHists - 2])
+                + offsetCounts[2 * nHists - 1] : 0;
+        int64_t ssnStart = (3 + 2 * nHists) * sizeof(int32_t);
+        int64_t xlocStart = ssnStart + total * sizeof(int64_t);
+        int64_t tempStart = xlocStart + 3 * total * sizeof(double);
+        // the histograms in file order, each in chunks within the budget
+        auto& hIds = domain.second;
+        std::sort(hIds.begin(), hIds.end());
+        hIds.erase(std::unique(hIds.begin(), hIds.end()), hIds.end());
+        for (int hId : hIds) {
+            if (hId >= nHists)
+                continue;
+            int64_t offset = offsetCounts[2 * hId];
+            int64_t count = offsetCounts[2 * hId + 1];
+            for (int64_t begin = 0; begin < count; begin += batchSize) {
+                int64_t n = std::min(batchSize, count - begin);
+                ssns.resize(n);
+                xlocs.resize(3 * n);
+                temps.resize(n);
+                fin.seekg(ssnStart + (offset + begin) * sizeof(int64_t));
+                fin.read(reinterpret_cast<char*>(ssns.data()),
+                        n * sizeof(int64_t));
+                fin.seekg(xlocStart + 3 * (offset + begin) * sizeof(double));
+                fin.read(reinterpret_cast<char*>(xlocs.data()),
+                        3 * n * sizeof(double));
+                fin.seekg(tempStart + (offset + begin) * sizeof(double));
+                fin.read(reinterpret_cast<char*>(temps.data()),
+                        n * sizeof(double));
+                if (!fin)
+                    return false;
+                for (int64_t i = 0; i < n; ++i)
+                    batch.push_back(ssns[i], loc, &xlocs[3 * i], temps[i]);
+                if (batch.size() < batchSize)
+                    continue;
+                if (!callback(batch))
+                    return false;
+                batch.clear();
+            }
+        }
+    }
+    return batch.empty() || callback(batch);
+}
+
+bool TracerSorter::scanYColumn(int yColumnFlatId,
+        const std::vector<bool>& selected,
+        const BatchCallback& callback, int attributes) const {
+    char tracerName[32];
+    sprintf(tracerName, "tracer.%05d", yColumnFlatId);
+    FortranReader reader(_config.dir() + tracerName);
+    Column columns[N_COLUMNS];
+    int64_t nParticles = 0;
+    if (!reader.good() || !locateColumns(reader, columns, &nParticles))
+        return false;
+    Column optional[N_OPTIONAL_COLUMNS];
+    locateOptionalColumns(reader, nParticles, optional);
+    YColumnRegions regions(_config, yColumnFlatId);
+    // the locations are streamed in chunks, the other arrays read only for
+    // the chunks holding selected particles
+    const int64_t chunkSize = std::max<int64_t>(1024,
+            _memoryBudget / 2 / ((N_COLUMNS + N_OPTIONAL_COLUMNS) * 8));
+    ParticleColumns batch(attributes);
+    bool wantsOptional[N_OPTIONAL_COLUMNS];
+    for (int iColumn = 0; iColumn < N_OPTIONAL_COLUMNS; ++iColumn) {
+        wantsOptional[iColumn] = 0 <= optional[iColumn].pos
+                && batch.has(MIXFRAC == iColumn
+                    ? ParticleColumns::MIXFRAC : ParticleColumns::VEL);
+    }
+    std::vector<int64_t> ssns, picked;
+    std::vector<double> locx, locy, locz, xlocx, xlocy, xlocz, temps;
+    std::vector<double> optionals[N_OPTIONAL_COLUMNS];
+    for (int64_t begin = 0; begin < nParticles; begin += chunkSize) {
+        int64_t n = std::min(chunkSize, nParticles - begin);
+        readChunk(reader, columns[LOC1], begin, n, locx);
+        readChunk(reader, columns[LOC2], begin, n, locy);
+        readChunk(reader, columns[LOC3], begin, n, locz);
+        picked.clear();
+        for (int64_t i = 0; i < n; ++i) {
+            int region = regions.of(locx[i], locy[i], locz[i]);
+            if (0 <= region && selected[region])
+                picked.push_back(i);
+        }
+        if (picked.empty())
+            continue;
+        readChunk(reader, columns[SSN], begin, n, ssns);
+        readChunk(reader, columns[XLOC1], begin, n, xlocx);
+        readChunk(reader, columns[XLOC2], begin, n, xlocy);
+        readChunk(reader, columns[XLOC3], begin, n, xlocz);
+        readChunk(reader, columns[TEMP], begin, n, temps);
+        for (int iColumn = 0; iColumn < N_OPTIONAL_COLUMNS; ++iColumn) {
+            if (wantsOptional[iColumn]) {
+                readChunk(reader, optional[iColumn], begin, n,
+                        optionals[iColumn]);
+            }
+        }
+        // the optional arrays missing from the file are left zero
+        auto optionalAt = [&](int iColumn, int64_t i) {
+            return wantsOptional[iColumn] ? optionals[iColumn][i] : 0.0;
+        };
+        for (auto i : picked) {
+            double loc[3] = { locx[i], locy[i], locz[i] };
+            double xloc[3] = { xlocx[i], xlocy[i], xlocz[i] };
+            double vel[3] = { optionalAt(VEL1, i), optionalAt(VEL2, i),
+                    optionalAt(VEL3, i) };
+            batch.push_back(ssns[i], loc, xloc, temps[i], vel,
+                    optionalAt(MIXFRAC, i));
+        }
+        if (batch.size() < chunkSize)
+            continue;
+        if (!callback(batch))
+            return false;
+        batch.clear();
+    }
+    return batch.empty() || callback(batch);
+}
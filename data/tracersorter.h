@@ -0,0 +1,79 @@
+#ifndef TRACERSORTER_H
+#define TRACERSORTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "particlecolumns.h"
+#include "tracerconfig.h"
+
+/**
+ * @brief The TracerSorter class reorganizes the raw tracer files of a step,
+ * one tracer.<y column> per column of domains along y, into the
+ * histogram-sorted pdfsortedtracer.<domain> files of DomainSortedTracerReader:
+ *
+ *   int32  hists per domain[3]
+ *   int32  offset, count[nhists]
+ *   int64  ssn[nparticles]
+ *   double xloc[3 * nparticles]
+ *   double temperature[nparticles]
+ *
+ * The particles of a y column only land in the domains of that column, so
+ * the columns are sorted independently on a pool of threads. Each column is
+ * a two-pass bucket sort: the locations are streamed once to count the
+ * particles of every sampling region, then all the arrays are streamed again
+ * and scattered through small per-region buffers to their final place in
+ * the output files. The memory a column takes is bounded by the budget
+ * whatever the number of particles: when there are too many regions for a
+ * buffer each, the regions are scattered a group at a time, at the cost of
+ * streaming the arrays once more per group.
+ *
+ * The particles of any histograms can be scanned in the same bounded memory
+ * from either layout, without the readers of the application.
+ */
+class TracerSorter {
+public:
+    /// Takes a batch of particles, false to stop the scan.
+    typedef std::function<bool(const ParticleColumns&)> BatchCallback;
+
+public:
+    TracerSorter(const TracerConfig& config, int64_t memoryBudget = 256 << 20,
+            int nThreads = 0);
+    static std::string filename(const std::string& dir, int domainFlatId);
+
+public:
+    /// Sorts every y column into outDir, false when any of them fails, in
+    /// which case no output file is left.
+    bool sort(const std::string& outDir) const;
+    /// Writes the files of the y column under temporary names and renames
+    /// them only once all of them are complete.
+    bool sortYColumn(int yColumnFlatId, const std::string& outDir,
+            int64_t memoryBudget) const;
+    /// Hands the attributes of the particles of the histograms to callback
+    /// batch by batch, from the sorted files in sortedDir when they are
+    /// there and from the tracer files otherwise, every file read once. The
+    /// sorted files have no grid location, which their batches leave out,
+    /// and their velocities and mixture fractions are zero, as are the ones
+    /// a tracer file lacks. False when a file cannot be read or callback
+    /// stops the scan.
+    bool scan(const std::string& sortedDir,
+            const std::vector<int>& histFlatIds,
+            const BatchCallback& callback,
+            int attributes = ParticleColumns::SSN | ParticleColumns::XLOC
+                | ParticleColumns::TEMP) const;
+
+private:
+    bool scanSorted(const std::string& sortedDir,
+            const std::vector<int>& histFlatIds,
+            const BatchCallback& callback, int attributes) const;
+    bool scanYColumn(int yColumnFlatId, const std::vector<bool>& selected,
+            const BatchCallback& callback, int attributes) const;
+
+private:
+    TracerConfig _config;
+    int64_t _memoryBudget;
+    int _nThreads;
+};
+
+#endif // TRACERSORTER_H
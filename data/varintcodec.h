@@ -0,0 +1,61 @@
+#ifndef VARINTCODEC_H
+#define VARINTCODEC_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The VarintCodec class packs the sparse bins of a histogram as
+ * LEB128 varints: the sorted bin ids as deltas from the previous id and the
+ * counts as they are, so the common small values take a single byte.
+ */
+class VarintCodec {
+public:
+    static void put(std::string& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(char(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+    static uint32_t get(const char*& in) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+        uint32_t value = p[0] & 0x7f;
+        int shift = 7;
+        while (*p++ & 0x80) {
+            value |= uint32_t(*p & 0x7f) << shift;
+            shift += 7;
+        }
+        in = reinterpret_cast<const char*>(p);
+        return value;
+    }
+
+public:
+    /// Appends count ascending bin ids and their integral counts.
+    static void encode(std::string& out,
+            const int* binIds, const float* counts, int count) {
+        int prevId = 0;
+        for (int i = 0; i < count; ++i) {
+            put(out, uint32_t(binIds[i] - prevId));
+            prevId = binIds[i];
+        }
+        for (int i = 0; i < count; ++i) {
+            put(out, uint32_t(counts[i]));
+        }
+    }
+    /// Decodes what encode() wrote and returns the end of it.
+    static const char* decode(const char* in,
+            int* binIds, float* counts, int count) {
+        int prevId = 0;
+        for (int i = 0; i < count; ++i) {
+            prevId += int(get(in));
+            binIds[i] = prevId;
+        }
+        for (int i = 0; i < count; ++i) {
+            counts[i] = float(get(in));
+        }
+        return in;
+    }
+};
+
+#endif // VARINTCODEC_H
@@ -211,6 +211,7 @@ void Hist2DFacadeCharter::chart(QPaintDevice *paintDevice) {
                 _viewport.width() * _width, _viewport.height() * _height));
     // if there isn't enough space for labels
     if (histWidth() / chartWidth() < thresholdRatioToDrawLabels) {
+        setLodLevel(calcLodLevel(chartWidth(), chartHeight()));
         painter.beginNativePainting();
         drawHist(chartLeft() / width(), chartBottom() / height(),
                 chartWidth() / width(), chartHeight() / height());
@@ -218,6 +219,7 @@ void Hist2DFacadeCharter::chart(QPaintDevice *paintDevice) {
         return;
     }
     // histogram
+    setLodLevel(0);
     painter.beginNativePainting();
     drawHist(histLeft() / width(), histBottom() / height(),
             histWidth() / width(), histHeight() / height());
@@ -450,6 +452,30 @@ std::vector<std::array<double, 2>> Hist2DFacadeCharter::binRangesToVarRanges(
     return varRanges;
 }
 
+// coarsen while the merged bins would still be at most a pixel wide
+int Hist2DFacadeCharter::calcLodLevel(float width, float height) const {
+    auto box = normalizedBox();
+    auto dims = hist()->dim();
+    float binSize = std::min(width / (dims[0] * box[2]),
+            height / (dims[1] * box[3]));
+    if (!(binSize > 0.f))
+        return 0;
+    int level = 0;
+    while (binSize * (2 << level) <= 1.f
+            && (2 << level) <= std::max(dims[0], dims[1])) {
+        ++level;
+    }
+    return level;
+}
+
+void Hist2DFacadeCharter::setLodLevel(int level) {
+    if (level == _lodLevel)
+        return;
+    _lodLevel = level;
+    _histPainter->setTexture(_histFacade->texture(
+            std::vector<int>{{ _displayDims[0], _displayDims[1] }}, level));
+}
+
 bool Hist2DFacadeCharter::isVarRangesSelected() const {
     return 2 == _selectedVarRanges.size()
             && !std::isnan(_selectedVarRanges[0][0])
@@ -643,6 +669,27 @@ std::array<double, 2> Hist1DFacadeCharter::binRangeToVarRange(
     };
 }
 
+// coarsen while the merged bins would still be at most a pixel wide
+int Hist1DFacadeCharter::calcLodLevel(float width) const {
+    auto box = normalizedBox();
+    auto nBins = _histFacade->hist(_displayDim)->dim()[0];
+    float binSize = width / (nBins * box[2]);
+    if (!(binSize > 0.f))
+        return 0;
+    int level = 0;
+    while (binSize * (2 << level) <= 1.f && (2 << level) <= nBins)
+        ++level;
+    return level;
+}
+
+void Hist1DFacadeCharter::setLodLevel(int level) {
+    if (level == _lodLevel)
+        return;
+    _lodLevel = level;
+    _histPainter->setVBO(
+            _histFacade->vbo(std::vector<int>{ _displayDim }, level));
+}
+
 bool Hist1DFacadeCharter::isVarRangeSelected() const {
     return !std::isnan(_selectedVarRange[0])
             && !std::isnan(_selectedVarRange[1]);
@@ -668,12 +715,14 @@ void Hist1DFacadeCharter::chart(QPaintDevice *paintDevice)
     painter.restore();
     // if there isn't enough space for labels
     if (histWidth() / chartWidth() < thresholdRatioToDrawLabels) {
+        setLodLevel(calcLodLevel(chartWidth()));
         painter.beginNativePainting();
         drawHist(chartLeft() / width(), chartBottom() / height(),
                 chartWidth() / width(), chartHeight() / height());
         painter.endNativePainting();
         return;
     }
+    setLodLevel(0);
     // draw all the labels
     // ticks under the histogram
     painter.save();
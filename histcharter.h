@@ -231,6 +231,8 @@ private:
             const std::array<int, 2>& binBeg,
             const std::array<int, 2>& binEnd) const;
     bool isVarRangesSelected() const;
+    int calcLodLevel(float width, float height) const;
+    void setLodLevel(int level);
 
 private:
     const float thresholdBinSizeToDrawGrid = 2.5f;
@@ -241,6 +243,7 @@ private:
     std::shared_ptr<const HistFacade> _histFacade;
     std::array<int, 2> _displayDims;
     std::shared_ptr<Hist2DTexturePainter> _histPainter;
+    int _lodLevel = 0;
     std::function<void(float, float, const std::string&)> _showLabel;
     std::array<int, 2> _hoveredBin = {{ -1, -1 }};
     std::array<float, 2> _freqRange = {{ 0.f, 1.f }};
@@ -297,6 +300,8 @@ private:
     std::array<double, 2> binRangeToVarRange(
             const std::array<int, 2>& binRange);
     bool isVarRangeSelected() const;
+    int calcLodLevel(float width) const;
+    void setLodLevel(int level);
 
 private:
     const float thresholdRatioToDrawLabels = 0.5f;
@@ -308,6 +313,7 @@ private:
     int _displayDim;
     QPaintDevice* _paintDevice = nullptr;
     std::shared_ptr<Hist1DVBOPainter> _histPainter;
+    int _lodLevel = 0;
     std::function<void(float, float, const std::string&)> _showLabel;
     int _hoveredBin = -1;
     bool _isMousePressed = false;
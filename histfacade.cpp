@@ -4,6 +4,40 @@
 #include <yygl/gltexture.h>
 #include <yygl/glvector.h>
 
+namespace {
+
+/// TODO: remove the for loops after switching to float from double for the
+/// histograms.
+std::shared_ptr<yy::gl::texture> createPercentTexture(
+        const Hist& hist, float scale) {
+    std::vector<float> freqs(hist.nBins());
+    for (auto iBin = 0; iBin < hist.nBins(); ++iBin) {
+        freqs[iBin] = scale * hist.binPercent(iBin);
+    }
+    auto texture = std::make_shared<yy::gl::texture>();
+    texture->setWrapMode(
+            yy::gl::texture::TEXTURE_2D, yy::gl::texture::CLAMP_TO_EDGE);
+    texture->setTextureMinMagFilter(yy::gl::texture::TEXTURE_2D,
+            yy::gl::texture::MIN_NEAREST, yy::gl::texture::MAG_NEAREST);
+    texture->texImage2D(
+            yy::gl::texture::TEXTURE_2D, yy::gl::texture::INTERNAL_R32F,
+            hist.dim()[0], hist.dim()[1], yy::gl::texture::FORMAT_RED,
+            yy::gl::texture::FLOAT, freqs.data());
+    return texture;
+}
+
+std::shared_ptr<yy::gl::vector<float>> createPercentVBO(
+        const Hist& hist, float scale) {
+    auto freqsPtr = std::make_shared<yy::gl::vector<float>>(hist.nBins());
+    auto& freqs = *freqsPtr;
+    for (auto iBin = 0; iBin < hist.nBins(); ++iBin) {
+        freqs[iBin] = scale * hist.binPercent(iBin);
+    }
+    return freqsPtr;
+}
+
+} // unnamed namespace
+
 /**
  * @brief HistFacade::create
  * @param hist
@@ -70,22 +104,7 @@ std::shared_ptr<yy::gl::texture> HistFacade::texture(
     }
     /// TODO: right now only supports 2d histograms.
     assert(dims.size() == 2);
-    auto hist = this->hist(dims);
-    /// TODO: remove this for loop after switching to float from double for the
-    /// histograms.
-    std::vector<float> freqs(hist->nBins());
-    for (auto iBin = 0; iBin < hist->nBins(); ++iBin) {
-        freqs[iBin] = hist->binPercent(iBin);
-    }
-    auto texture = std::make_shared<yy::gl::texture>();
-    texture->setWrapMode(
-            yy::gl::texture::TEXTURE_2D, yy::gl::texture::CLAMP_TO_EDGE);
-    texture->setTextureMinMagFilter(yy::gl::texture::TEXTURE_2D,
-            yy::gl::texture::MIN_NEAREST, yy::gl::texture::MAG_NEAREST);
-    texture->texImage2D(
-            yy::gl::texture::TEXTURE_2D, yy::gl::texture::INTERNAL_R32F,
-            hist->dim()[0], hist->dim()[1], yy::gl::texture::FORMAT_RED,
-            yy::gl::texture::FLOAT, freqs.data());
+    auto texture = createPercentTexture(*this->hist(dims), 1.f);
     _cachedTextures[dims] = texture;
     return texture;
 }
@@ -107,13 +126,7 @@ std::shared_ptr<yy::gl::vector<float>> HistFacade::vbo(
     } catch (...) {
         std::cout << "HistFacade::vbo" << std::endl;
     }
-    auto hist = this->hist(dims);
-    auto freqsPtr = std::make_shared<yy::gl::vector<float>>(hist->nBins());
-    auto& freqs = *freqsPtr;
-    for (auto iBin = 0; iBin < hist->nBins(); ++iBin) {
-        freqs[iBin] = hist->binPercent(iBin);
-//        freqs[iBin] = hist->values()[iBin];
-    }
+    auto freqsPtr = createPercentVBO(*this->hist(dims), 1.f);
     _cachedVBOs[dims] = freqsPtr;
     return freqsPtr;
 }
@@ -123,6 +136,55 @@ std::shared_ptr<yy::gl::vector<float>> HistFacade::vbo(
     return vbo(varsToDims(vars));
 }
 
+std::shared_ptr<const Hist> HistFacade::hist(
+        const std::vector<int>& dims, int level) const {
+    if (0 == level) {
+        return hist(dims);
+    }
+    auto key = std::make_pair(dims, level);
+    if (0 < _cachedLodHists.count(key)) {
+        return _cachedLodHists.at(key);
+    }
+    auto hist = HistRebinner(this->hist(dims)).coarsenTo(level);
+    _cachedLodHists[key] = hist;
+    return hist;
+}
+
+// the coarse bins hold the average percentage of the bins merged into them, so
+// the same frequency range applies at every level.
+std::shared_ptr<yy::gl::texture> HistFacade::texture(
+        const std::vector<int>& dims, int level) const {
+    if (0 == level) {
+        return texture(dims);
+    }
+    auto key = std::make_pair(dims, level);
+    if (0 < _cachedLodTextures.count(key)) {
+        return _cachedLodTextures.at(key);
+    }
+    assert(dims.size() == 2);
+    auto coarse = hist(dims, level);
+    float scale = float(coarse->nBins()) / hist(dims)->nBins();
+    auto texture = createPercentTexture(*coarse, scale);
+    _cachedLodTextures[key] = texture;
+    return texture;
+}
+
+std::shared_ptr<yy::gl::vector<float>> HistFacade::vbo(
+        const std::vector<int>& dims, int level) const {
+    if (0 == level) {
+        return vbo(dims);
+    }
+    auto key = std::make_pair(dims, level);
+    if (0 < _cachedLodVBOs.count(key)) {
+        return _cachedLodVBOs.at(key);
+    }
+    auto coarse = hist(dims, level);
+    float scale = float(coarse->nBins()) / hist(dims)->nBins();
+    auto freqsPtr = createPercentVBO(*coarse, scale);
+    _cachedLodVBOs[key] = freqsPtr;
+    return freqsPtr;
+}
+
 std::vector<int> HistFacade::varsToDims(
         const std::vector<std::string> &vars) const {
     std::vector<int> dims(vars.size());
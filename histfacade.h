@@ -47,6 +47,9 @@ public:
     }
     virtual std::shared_ptr<const Hist> hist(
             const std::vector<std::string>& vars) const;
+    /// The dims marginal with 2^level bins merged along each axis.
+    virtual std::shared_ptr<const Hist> hist(
+            const std::vector<int>& dims, int level) const;
 
 public:
     virtual std::shared_ptr<yy::gl::texture> texture(
@@ -57,6 +60,8 @@ public:
     }
     virtual std::shared_ptr<yy::gl::texture> texture(
             const std::vector<std::string>& vars) const;
+    virtual std::shared_ptr<yy::gl::texture> texture(
+            const std::vector<int>& dims, int level) const;
 
 public:
     virtual std::shared_ptr<yy::gl::vector<float>> vbo(
@@ -66,6 +71,8 @@ public:
     }
     virtual std::shared_ptr<yy::gl::vector<float>> vbo(
             const std::vector<std::string>& vars) const;
+    virtual std::shared_ptr<yy::gl::vector<float>> vbo(
+            const std::vector<int>& dims, int level) const;
 
 public:
     virtual std::array<double, 2> dimRange(int iDim) const {
@@ -82,6 +89,11 @@ private:
     mutable FacadeMap<std::shared_ptr<const Hist>> _cachedHists;
     mutable FacadeMap<std::shared_ptr<yy::gl::texture>> _cachedTextures;
     mutable FacadeMap<std::shared_ptr<yy::gl::vector<float>>> _cachedVBOs;
+    template <typename T>
+    using LodMap = std::map<std::pair<std::vector<int>, int>, T>;
+    mutable LodMap<std::shared_ptr<const Hist>> _cachedLodHists;
+    mutable LodMap<std::shared_ptr<yy::gl::texture>> _cachedLodTextures;
+    mutable LodMap<std::shared_ptr<yy::gl::vector<float>>> _cachedLodVBOs;
 };
 
 /**
@@ -2,8 +2,11 @@
 #include <cmath>
 #include <fstream>
 #include <set>
+#include <data/histcolumnindex.h>
 #include <data/histreader.h>
 #include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 #include <util.h>
 #include <data/directory.h>
 
@@ -239,8 +242,76 @@ yy::ivec3 getMultiBlockDomainHistCounts(
     return yy::ivec3(1, 1, 1);
 }
 
+// maps contiguous chunks of [0, n) on the global thread pool, one per core,
+// and combines the partial results on the calling thread.
+template <typename T, typename Accumulate, typename Combine>
+T concurrentReduce(
+        int n, const T& init, Accumulate accumulate, Combine combine) {
+    int nChunks = std::max(1, std::min(n, QThread::idealThreadCount()));
+    std::vector<QFuture<T>> futures;
+    for (int iChunk = 0; iChunk < nChunks; ++iChunk) {
+        int begin = int(int64_t(n) * iChunk / nChunks);
+        int end = int(int64_t(n) * (iChunk + 1) / nChunks);
+        futures.push_back(QtConcurrent::run([=]() {
+            T partial = init;
+            for (int i = begin; i < end; ++i)
+                accumulate(partial, i);
+            return partial;
+        }));
+    }
+    T result = init;
+    for (auto& future : futures)
+        combine(result, future.result());
+    return result;
+}
+
+// the histograms of the domain behind meta
+std::shared_ptr<HistFacadeDomain> readFacadeDomain(std::istream& fin,
+        const HistMetaReader& meta, const std::vector<std::string>& vars) {
+    HistHelper histHelper = meta.helper();
+    std::vector<std::shared_ptr<HistFacade>> hists(histHelper.N_HIST);
+    for (int iHist = 0; iHist < histHelper.N_HIST; ++iHist) {
+        HistReaderPacked histReader;
+        histReader.readFrom(fin, meta.ndim, meta.logbases, vars);
+        hists[iHist] = HistFacade::create(histReader.hist, vars);
+    }
+    return std::make_shared<HistFacadeDomain>(histHelper, hists);
+}
+
 } // namespace
 
+/**
+ * @brief HistFacadeYColumnReader::read
+ * @return
+ */
+std::vector<std::shared_ptr<HistFacadeDomain>>
+        HistFacadeYColumnReader::read() const {
+    std::vector<std::shared_ptr<HistFacadeDomain>> histDomains;
+    HistMetaReader meta;
+    std::ifstream fin(filename(), std::ios::binary);
+    assert(fin);
+    while (meta.readFrom(fin)) {
+        histDomains.push_back(readFacadeDomain(fin, meta, m_vars));
+    }
+    return histDomains;
+}
+
+std::shared_ptr<const HistColumnIndex> HistFacadeYColumnReader::index() const {
+    if (!m_index)
+        m_index = HistColumnIndex::open(filename());
+    return m_index;
+}
+
+std::shared_ptr<HistFacadeDomain> HistFacadeYColumnReader::readDomain(
+        int iDomain) const {
+    assert(index() && iDomain < index()->nDomains());
+    std::ifstream fin(filename(), std::ios::binary);
+    fin.seekg(index()->domainOffset(iDomain));
+    HistMetaReader meta;
+    meta.readFrom(fin);
+    return readFacadeDomain(fin, meta, m_vars);
+}
+
 /**
  * @brief HistFacadeDomain::HistFacadeDomain
  * @param dir
@@ -280,25 +351,48 @@ HistFacadeVolume::HistFacadeVolume(
   : _dimDomains(dims), _dir(dir), _name(name), _vars(vars), _helperCached(false)
 {
     _domains.resize(nDomains());
+    if (openLazyLayout())
+        return;
     if (isFileExist(dir + "/pdfs-ycolumn-001.00000")) {
         auto entries = entryNamesInDirectory(dir);
+        // the sidecar indices share the names of their y columns
         auto yColumns =
                 yy::fp::filter(entries, [name](const std::string& entry) {
-            return entry.size() >= 16 && name == entry.substr(13, 3);
+            return entry.size() >= 16 && name == entry.substr(13, 3)
+                    && ".idx" != entry.substr(entry.size() - 4);
         });
+        // the domains are only located here and read in columnDomain()
+        _columnDomains.resize(nDomains());
         if (yColumns.size() != dims[0] * dims[2]) {
             // everything in one file, other than "." and ".."
 //            assert(3 == entries.size());
-            _domains = HistFacadeYColumnReader(dir, name, "00000", vars).read();
+            auto reader = std::make_shared<HistFacadeYColumnReader>(
+                    dir, name, "00000", vars);
+            auto index = reader->index();
+            int nFileDomains =
+                    index ? std::min(nDomains(), index->nDomains()) : 0;
+            for (int iDomain = 0; iDomain < nFileDomains; ++iDomain)
+                _columnDomains[iDomain] = { reader, iDomain };
+            // the domains a short file lacks stay empty, shaped like its
+            // first one
+            HistHelper helper = 0 < nFileDomains
+                    ? index->domainHelper(0) : HistHelper();
+            yy::ivec3 nVoxels(std::max(1, helper.n_vx),
+                    std::max(1, helper.n_vy), std::max(1, helper.n_vz));
+            yy::ivec3 nHists(std::max(1, helper.nh_x),
+                    std::max(1, helper.nh_y), std::max(1, helper.nh_z));
+            for (int iDomain = nFileDomains; iDomain < nDomains(); ++iDomain)
+                _domains[iDomain] = getNullHistDomain(nVoxels, nHists);
         } else {
             // actual y columns
             int nYColumns = dims[0] * dims[2];
             for (int iYColumn = 0; iYColumn < nYColumns; ++iYColumn) {
                 char iYColumnStr[6];
                 sprintf(iYColumnStr, "%05d", iYColumn);
-                auto histDomains =
-                        HistFacadeYColumnReader(
-                            dir, name, iYColumnStr, vars).read();
+                auto reader = std::make_shared<HistFacadeYColumnReader>(
+                        dir, name, iYColumnStr, vars);
+                // opened here, so later lazy reads share it across threads
+                reader->index();
                 int nYDomains = dims[1];
                 for (int iYDomain = 0; iYDomain < nYDomains; ++iYDomain) {
                     auto yColumnIds =
@@ -306,7 +400,7 @@ HistFacadeVolume::HistFacadeVolume(
                     int iDomain =
                             Extent(dims).idstoflat(
                                 yColumnIds[0], iYDomain, yColumnIds[1]);
-                    _domains[iDomain] = histDomains[iYDomain];
+                    _columnDomains[iDomain] = { reader, iYDomain };
                 }
             }
         }
@@ -328,6 +422,8 @@ HistFacadeVolume::HistFacadeVolume(std::string dir, std::string name,
       : _dir(dir), _name(name), _vars(vars), _helperCached(false) {
     _dimDomains = getMultiBlockDomainCounts(topo);
     _domains.resize(nDomains());
+    if (openLazyLayout())
+        return;
     for (auto z = 0; z < _dimDomains[2]; ++z)
     for (auto y = 0; y < _dimDomains[1]; ++y)
     for (auto x = 0; x < _dimDomains[0]; ++x) {
@@ -336,30 +432,45 @@ HistFacadeVolume::HistFacadeVolume(std::string dir, std::string name,
                     getMultiBlockDomainVoxelCounts(topo, yy::ivec3(x, y, z)),
                     getMultiBlockDomainHistCounts(topo, yy::ivec3(x, y, z)));
     }
+    // the domains of the blocks are only located here and read in
+    // columnDomain(), the others stay null domains
+    _columnDomains.resize(nDomains());
     for (auto iBlock = 0; iBlock < topo.blockCount(); ++iBlock) {
         auto iBlockStr = yy::sprintf("%05d", iBlock);
-        auto histDomains =
-                HistFacadeYColumnReader(dir, name, iBlockStr, vars).read();
+        auto reader = std::make_shared<HistFacadeYColumnReader>(
+                dir, name, iBlockStr, vars);
         yy::ivec3 domainIdOffsets = getMultiBlockDomainIdOffsets(topo, iBlock);
         Extent blockDomainExtent = topo.blockSpec(iBlock).nDomains();
-        for (auto iBlockDomain = 0; iBlockDomain < histDomains.size();
-                ++iBlockDomain) {
+        for (auto iBlockDomain = 0;
+                iBlockDomain < reader->index()->nDomains(); ++iBlockDomain) {
             yy::ivec3 blockDomainIds =
                     blockDomainExtent.flattoids(iBlockDomain);
             yy::ivec3 domainIds = domainIdOffsets + blockDomainIds;
             int domainFlatId = _dimDomains.idstoflat(domainIds);
-            _domains[domainFlatId] = std::move(histDomains[iBlockDomain]);
+            _domains[domainFlatId] = nullptr;
+            _columnDomains[domainFlatId] = { reader, iBlockDomain };
         }
     }
 }
 
+HistFacadeVolume::~HistFacadeVolume() {
+    std::vector<QFuture<void>> builds;
+    {
+        QMutexLocker locker(&_integralMutex);
+        for (const auto& build : _integralBuilds)
+            builds.push_back(build.second);
+    }
+    for (auto& build : builds)
+        build.waitForFinished();
+}
+
 HistHelper HistFacadeVolume::helper() const {
     if (_helperCached)
         return _helper;
     // gather helpers
     std::vector<HistHelper> oldHelpers(_domains.size());
     for (unsigned int iDomain = 0; iDomain < _domains.size(); ++iDomain)
-        oldHelpers[iDomain] = _domains[iDomain]->helper();
+        oldHelpers[iDomain] = domainHelper(iDomain);
     auto oldDim = _dimDomains;
     // collapse per each dimension
     for (int iDim = 0; iDim < _dimDomains.nDim(); ++iDim)
@@ -395,6 +506,8 @@ HistHelper HistFacadeVolume::helper() const {
 
 std::shared_ptr<HistFacade> HistFacadeVolume::hist(int flatId)
 {
+    if (_container || _bricks)
+        return lazyHist(flatId);
     auto dimHists = helper().dimHists();
     auto histIds = dimHists.flattoids(flatId);
     std::vector<int> domainIds(histIds.size());
@@ -411,6 +524,8 @@ std::shared_ptr<HistFacade> HistFacadeVolume::hist(int flatId)
 
 std::shared_ptr<const HistFacade> HistFacadeVolume::hist(int flatId) const
 {
+    if (_container || _bricks)
+        return lazyHist(flatId);
     auto dimHists = helper().dimHists();
     auto histIds = dimHists.flattoids(flatId);
     std::vector<int> domainIds(histIds.size());
@@ -426,57 +541,82 @@ std::shared_ptr<const HistFacade> HistFacadeVolume::hist(int flatId) const
 }
 
 std::shared_ptr<HistFacadeDomain> HistFacadeVolume::domain(int flatId) {
+    if (!_columnDomains.empty())
+        return columnDomain(flatId);
     return _domains[flatId];
 }
 
 std::shared_ptr<const HistFacadeDomain> HistFacadeVolume::domain(
         int flatId) const {
+    if (!_columnDomains.empty())
+        return columnDomain(flatId);
     return _domains[flatId];
 }
 
 std::shared_ptr<HistFacadeDomain> HistFacadeVolume::domain(
         const std::vector<int> &ids) {
-    return domain(_dimDomains.idstoflat(ids));
+    return domain(int(_dimDomains.idstoflat(ids)));
 }
 
 std::shared_ptr<const HistFacadeDomain> HistFacadeVolume::domain(
         const std::vector<int> &ids) const {
-    return domain(_dimDomains.idstoflat(ids));
+    return domain(int(_dimDomains.idstoflat(ids)));
 }
 
 int HistFacadeVolume::nDomains() const {
     return _dimDomains.nElement();
 }
 
+HistFacadeVolume::Stats HistFacadeVolume::Stats::create(
+        const std::vector<std::string>& vars, const std::vector<float>& means,
+        const std::vector<float>& mins, const std::vector<float>& maxs) {
+    Stats stats;
+    for (int iVar = 0; iVar < int(vars.size()); ++iVar) {
+        stats.means[vars[iVar]] = means[iVar];
+        stats.meanRanges[vars[iVar]] = {mins[iVar], maxs[iVar]};
+    }
+    return stats;
+}
+
 HistFacadeVolume::Stats HistFacadeVolume::stats() const {
     if (_statsCached)
         return _stats;
-    std::vector<float> sums(_vars.size(), 0.f);
-    std::vector<float> mins(_vars.size(), std::numeric_limits<float>::max());
-    std::vector<float> maxs(_vars.size(), std::numeric_limits<float>::lowest());
-    int nonEmptyHistCount = 0;
-    for (int iHist = 0; iHist < nHist(); ++iHist) {
-        auto histAverages = hist(iHist)->hist()->means();
-        if (histAverages.empty()) continue;
-        ++nonEmptyHistCount;
-        for (int iVar = 0; iVar < _vars.size(); ++iVar) {
-            auto average = histAverages[iVar];
-            sums[iVar] += average;
-            mins[iVar] = std::min(average, mins[iVar]);
-            maxs[iVar] = std::max(average, maxs[iVar]);
-        }
+    // the means, then the mins, then the maxs of the means of the variables
+    int nVars = _vars.size();
+    std::vector<float> cached;
+    if (_derivedCache
+            && _derivedCache->get(derivedKey("stats"), _derivedSource, cached)
+            && int(cached.size()) == 3 * nVars) {
+        auto mins = cached.begin() + nVars, maxs = cached.begin() + 2 * nVars;
+        _stats = Stats::create(_vars,
+                std::vector<float>(cached.begin(), mins),
+                std::vector<float>(mins, maxs),
+                std::vector<float>(maxs, cached.end()));
+        _statsCached = true;
+        return _stats;
     }
-    std::vector<float> averages = yy::fp::map(sums, [&](float sum) {
-        return sum / nonEmptyHistCount;
-    });
-    Stats stats;
-    for (int iVar = 0; iVar < _vars.size(); ++iVar) {
-        stats.means[_vars[iVar]] = averages[iVar];
-        stats.meanRanges[_vars[iVar]] = {mins[iVar], maxs[iVar]};
+    HistVolumeStats volumeStats(nVars);
+    // the indexed container has the means in its footer
+    if (_container) {
+        for (const auto& summary : _container->summaries())
+            volumeStats.add(summary.means);
+    } else {
+        for (int iHist = 0; iHist < nHist(); ++iHist)
+            volumeStats.add(hist(iHist)->hist()->means());
+    }
+    auto means = volumeStats.means();
+    if (_derivedCache) {
+        cached = means;
+        cached.insert(cached.end(),
+                volumeStats.mins().begin(), volumeStats.mins().end());
+        cached.insert(cached.end(),
+                volumeStats.maxs().begin(), volumeStats.maxs().end());
+        _derivedCache->put(derivedKey("stats"), _derivedSource, cached);
     }
-    _stats = stats;
+    _stats = Stats::create(
+            _vars, means, volumeStats.mins(), volumeStats.maxs());
     _statsCached = true;
-    return stats;
+    return _stats;
 }
 
 std::shared_ptr<HistFacadeRect> HistFacadeVolume::xySlice(int z) const {
@@ -542,6 +682,408 @@ std::shared_ptr<HistFacadeRect> HistFacadeVolume::yzSlice(int x) const {
     return slice;
 }
 
+std::shared_ptr<const HistIntegralVolume> HistFacadeVolume::integralVolume(
+        const std::vector<int>& dims) const {
+    QMutexLocker locker(&_integralMutex);
+    if (0 < _cachedIntegralVolumes.count(dims)) {
+        return _cachedIntegralVolumes.at(dims);
+    }
+    if (0 == _integralBuilds.count(dims)) {
+        // cached here, so the build only reads it
+        helper();
+        _integralBuilds[dims] = QtConcurrent::run([this, dims]() {
+            auto volume = buildIntegralVolume(dims);
+            QMutexLocker locker(&_integralMutex);
+            _cachedIntegralVolumes[dims] = volume;
+        });
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const HistIntegralVolume>
+        HistFacadeVolume::buildIntegralVolume(
+            const std::vector<int>& dims) const {
+    const int64_t maxBytes = int64_t(1) << 30;
+    auto dimHists = this->dimHists();
+    int nBins = 0;
+    for (const auto& hist : nonEmptyHists()) {
+        nBins = HistCollapser(hist).collapseTo(dims)->nBins();
+        if (0 < nBins)
+            break;
+    }
+    int64_t nBytes = int64_t(dimHists[0] + 1) * (dimHists[1] + 1)
+            * (dimHists[2] + 1) * nBins * sizeof(double);
+    if (0 == nBins || maxBytes < nBytes)
+        return nullptr;
+    auto marginals = this->marginals(dims);
+    return HistIntegralVolume::create(dimHists, [&](int flatId) {
+        return marginals[flatId];
+    });
+}
+
+std::array<float, 2> HistFacadeVolume::freqRange(
+        const std::vector<int>& dims) const {
+    {
+        QMutexLocker locker(&_rangesMutex);
+        if (0 < _cachedFreqRanges.count(dims)) {
+            return _cachedFreqRanges.at(dims);
+        }
+    }
+    std::vector<float> cached;
+    if (_derivedCache && _derivedCache->get(derivedKey("freqrange", dims),
+                _derivedSource, cached) && 2 == cached.size()) {
+        std::array<float, 2> range = {{ cached[0], cached[1] }};
+        QMutexLocker locker(&_rangesMutex);
+        _cachedFreqRanges[dims] = range;
+        return range;
+    }
+    // collapse outside of the facades so their caches are left untouched
+    // and the histograms can be visited concurrently.
+    auto hists = nonEmptyHists();
+    std::array<float, 2> init = {{ std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::lowest() }};
+    auto range = concurrentReduce(int(hists.size()), init,
+            [&](std::array<float, 2>& range, int iHist) {
+        auto collapsedHist = HistCollapser(hists[iHist]).collapseTo(dims);
+        for (auto iBin = 0; iBin < collapsedHist->nBins(); ++iBin) {
+            float percent = collapsedHist->binPercent(iBin);
+            if (percent < 0.f)
+                continue;
+            range[0] = std::min(range[0], percent);
+            range[1] = std::max(range[1], percent);
+        }
+    }, [](std::array<float, 2>& range, const std::array<float, 2>& partial) {
+        range[0] = std::min(range[0], partial[0]);
+        range[1] = std::max(range[1], partial[1]);
+    });
+    if (_derivedCache) {
+        _derivedCache->put(derivedKey("freqrange", dims), _derivedSource,
+                std::vector<float>{ range[0], range[1] });
+    }
+    QMutexLocker locker(&_rangesMutex);
+    _cachedFreqRanges[dims] = range;
+    return range;
+}
+
+std::vector<std::array<double, 2>> HistFacadeVolume::varRanges(
+        const std::vector<int>& dims) const {
+    QMutexLocker locker(&_rangesMutex);
+    if (_cachedVarRanges.empty()) {
+        locker.unlock();
+        std::vector<double> cached;
+        std::vector<std::array<double, 2>> ranges;
+        if (_derivedCache && _derivedCache->get(derivedKey("varranges"),
+                    _derivedSource, cached)
+                && cached.size() == 2 * _vars.size()) {
+            for (int iVar = 0; iVar < int(_vars.size()); ++iVar)
+                ranges.push_back({{ cached[2 * iVar], cached[2 * iVar + 1] }});
+        } else {
+            ranges = computeVarRanges();
+            cached.clear();
+            for (const auto& range : ranges)
+                cached.insert(cached.end(), { range[0], range[1] });
+            if (_derivedCache) {
+                _derivedCache->put(
+                        derivedKey("varranges"), _derivedSource, cached);
+            }
+        }
+        locker.relock();
+        _cachedVarRanges = ranges;
+    }
+    std::vector<std::array<double, 2>> ranges(dims.size());
+    for (int i = 0; i < int(dims.size()); ++i) {
+        ranges[i] = _cachedVarRanges[dims[i]];
+    }
+    return ranges;
+}
+
+std::vector<std::array<double, 2>> HistFacadeVolume::computeVarRanges() const {
+    std::vector<std::array<double, 2>> init(_vars.size(),
+            {{ std::numeric_limits<double>::max(),
+               std::numeric_limits<double>::lowest() }});
+    auto hists = nonEmptyHists();
+    return concurrentReduce(int(hists.size()), init,
+            [&](std::vector<std::array<double, 2>>& ranges, int iHist) {
+        const auto& hist = hists[iHist];
+        for (int iVar = 0; iVar < int(ranges.size()); ++iVar) {
+            ranges[iVar][0] = std::min(ranges[iVar][0], hist->dimMin(iVar));
+            ranges[iVar][1] = std::max(ranges[iVar][1], hist->dimMax(iVar));
+        }
+    }, [](std::vector<std::array<double, 2>>& ranges,
+            const std::vector<std::array<double, 2>>& partial) {
+        for (int iVar = 0; iVar < int(ranges.size()); ++iVar) {
+            ranges[iVar][0] = std::min(ranges[iVar][0], partial[iVar][0]);
+            ranges[iVar][1] = std::max(ranges[iVar][1], partial[iVar][1]);
+        }
+    });
+}
+
+void HistFacadeVolume::prefetchRanges() const {
+    // reading every histogram up front would defeat the lazy layouts
+    if (_container || _bricks)
+        return;
+    varRanges({});
+    for (int i = 0; i < int(_vars.size()); ++i) {
+        freqRange({i});
+    }
+    for (int i = 0; i < int(_vars.size()); ++i)
+    for (int j = i + 1; j < int(_vars.size()); ++j) {
+        freqRange({i, j});
+    }
+}
+
+int HistFacadeVolume::pyramidLevelCount(const std::vector<int>& dims) const {
+    return pyramid(dims).hists->nLevels();
+}
+
+std::shared_ptr<HistFacadeRect> HistFacadeVolume::pyramidSlice(
+        const std::vector<int>& dims, int level, SliceDirection direction,
+        int sliceId) const {
+    assert(0 < level);
+    Pyramid& pyramid = this->pyramid(dims);
+    level = std::min(level, pyramid.hists->nLevels() - 1);
+    Extent dimHists = pyramid.hists->dimHists(level);
+    auto& facades = pyramid.facades[level];
+    auto facade = [&](int x, int y, int z) {
+        int flatId = dimHists.idstoflat(x, y, z);
+        if (!facades[flatId]) {
+            auto hist = pyramid.hists->hist(level, flatId);
+            facades[flatId] = HistFacade::create(hist, hist->vars());
+        }
+        return facades[flatId];
+    };
+    int levelSliceId = sliceId >> level;
+    int nx = dimHists[0], ny = dimHists[1], nz = dimHists[2];
+    std::vector<std::shared_ptr<const HistFacade>> hists;
+    if (YZ == direction) {
+        hists.resize(ny * nz);
+        for (auto y = 0; y < ny; ++y)
+        for (auto z = 0; z < nz; ++z)
+            hists[y + ny * z] = facade(levelSliceId, y, z);
+        return std::make_shared<HistFacadeRect>(ny, nz, hists);
+    }
+    if (XZ == direction) {
+        hists.resize(nx * nz);
+        for (auto x = 0; x < nx; ++x)
+        for (auto z = 0; z < nz; ++z)
+            hists[x + nx * z] = facade(x, levelSliceId, z);
+        return std::make_shared<HistFacadeRect>(nx, nz, hists);
+    }
+    hists.resize(nx * ny);
+    for (auto x = 0; x < nx; ++x)
+    for (auto y = 0; y < ny; ++y)
+        hists[x + nx * y] = facade(x, y, levelSliceId);
+    return std::make_shared<HistFacadeRect>(nx, ny, hists);
+}
+
+HistFacadeVolume::Pyramid& HistFacadeVolume::pyramid(
+        const std::vector<int>& dims) const {
+    if (0 < _cachedPyramids.count(dims)) {
+        return _cachedPyramids.at(dims);
+    }
+    Pyramid& pyramid = _cachedPyramids[dims];
+    auto marginals = this->marginals(dims);
+    pyramid.hists = std::make_shared<HistPyramid>(dimHists(), [&](int flatId) {
+        return marginals[flatId];
+    });
+    pyramid.facades.resize(pyramid.hists->nLevels());
+    for (int level = 0; level < pyramid.hists->nLevels(); ++level) {
+        pyramid.facades[level].resize(
+                pyramid.hists->dimHists(level).nElement());
+    }
+    return pyramid;
+}
+
+std::vector<std::shared_ptr<const Hist>> HistFacadeVolume::marginals(
+        const std::vector<int>& dims) const {
+    // only the 1D and 2D marginals are small enough to keep
+    bool isCacheable = _derivedCache && dims.size() <= 2;
+    std::string key = derivedKey("marginals", dims);
+    if (isCacheable) {
+        std::vector<std::string> vars;
+        for (auto dim : dims)
+            vars.push_back(_vars[dim]);
+        auto hists = _derivedCache->getHists(key, _derivedSource, vars);
+        if (int(hists.size()) == nHist())
+            return hists;
+    }
+    // collapsed outside of the facades, as in freqRange(), empty ones kept
+    auto hists = allHists();
+    for (auto& hist : hists) {
+        if (0 < hist->nDim())
+            hist = HistCollapser(hist).collapseTo(dims);
+    }
+    if (isCacheable)
+        _derivedCache->putHists(key, _derivedSource, hists);
+    return hists;
+}
+
+std::string HistFacadeVolume::derivedKey(
+        const std::string& product, const std::vector<int>& dims) const {
+    return HistDerivedCache::key(_step, _name, product, dims);
+}
+
+// gathered through the domains, which unlike hist(flatId) touch no lazily
+// cached state other than the mutex guarded column domains, or through the
+// mutex guarded lazy layouts, so that it can be called from any thread.
+std::vector<std::shared_ptr<const Hist>>
+        HistFacadeVolume::nonEmptyHists() const {
+    std::vector<std::shared_ptr<const Hist>> hists;
+    if (_container || _bricks) {
+        for (int iHist = 0; iHist < _helper.N_HIST; ++iHist) {
+            auto hist = lazyHist(iHist)->hist();
+            if (0 < hist->nDim())
+                hists.push_back(hist);
+        }
+        return hists;
+    }
+    for (int iDomain = 0; iDomain < nDomains(); ++iDomain) {
+        auto domain = this->domain(iDomain);
+        for (int iHist = 0; iHist < domain->nHist(); ++iHist) {
+            auto hist = domain->hist(iHist)->hist();
+            if (0 < hist->nDim())
+                hists.push_back(hist);
+        }
+    }
+    return hists;
+}
+
+// every histogram by its flat id, gathered as in nonEmptyHists(), and safe
+// to call from any thread as long as helper() is cached.
+std::vector<std::shared_ptr<const Hist>> HistFacadeVolume::allHists() const {
+    std::vector<std::shared_ptr<const Hist>> hists(helper().N_HIST);
+    if (_container || _bricks) {
+        for (int iHist = 0; iHist < int(hists.size()); ++iHist) {
+            hists[iHist] = lazyHist(iHist)->hist();
+        }
+        return hists;
+    }
+    for (int iDomain = 0; iDomain < nDomains(); ++iDomain) {
+        auto domain = this->domain(iDomain);
+        for (int iHist = 0; iHist < domain->nHist(); ++iHist) {
+            hists[dhtoflat(iDomain, iHist)] = domain->hist(iHist)->hist();
+        }
+    }
+    return hists;
+}
+
+bool HistFacadeVolume::writeIndexed(bool compress) const {
+    HistContainerWriter writer(helper(), compress);
+    return writer.write(HistContainerReader::filename(_dir, _name),
+            [this](int flatId) {
+        return hist(flatId)->hist();
+    });
+}
+
+void HistFacadeVolume::setDerivedCache(
+        std::shared_ptr<const HistDerivedCache> cache, std::string step) {
+    _derivedCache = cache;
+    _step = step;
+    _derivedSource = HistDerivedCache::sourceOf(_dir);
+}
+
+std::vector<bool> HistFacadeVolume::selectionMask(const std::string& query,
+        std::function<bool(int flatId)> isSelected) const {
+    std::string key = derivedKey(
+            "selection-" + std::to_string(HistDerivedCache::hash(query)));
+    std::vector<char> mask;
+    if (!_derivedCache || !_derivedCache->get(key, _derivedSource, mask)
+            || int(mask.size()) != nHist()) {
+        mask.resize(nHist());
+        for (int iHist = 0; iHist < nHist(); ++iHist) {
+            mask[iHist] = isSelected(iHist);
+        }
+        if (_derivedCache)
+            _derivedCache->put(key, _derivedSource, mask);
+    }
+    return std::vector<bool>(mask.begin(), mask.end());
+}
+
+// without reading the domains of the column backed volumes
+HistHelper HistFacadeVolume::domainHelper(int flatId) const {
+    if (!_columnDomains.empty() && _columnDomains[flatId].reader) {
+        const auto& column = _columnDomains[flatId];
+        return column.reader->index()->domainHelper(column.iDomain);
+    }
+    if (!_columnDomains.empty())
+        return columnDomain(flatId)->helper();
+    return _domains[flatId]->helper();
+}
+
+std::shared_ptr<HistFacadeDomain> HistFacadeVolume::columnDomain(
+        int flatId) const {
+    QMutexLocker locker(&_lazyMutex);
+    auto& domain = _domains[flatId];
+    if (!domain) {
+        const auto& column = _columnDomains[flatId];
+        domain = column.reader ? column.reader->readDomain(column.iDomain)
+                : getNullHistDomain(yy::ivec3(1, 1, 1), yy::ivec3(1, 1, 1));
+    }
+    return domain;
+}
+
+// the indexed container is preferred, as it reads single histograms. A
+// compressed one is decoded whole on all cores instead, as a single histogram
+// costs the decoding of its block anyway.
+bool HistFacadeVolume::openLazyLayout() {
+    if (isFileExist(HistContainerReader::filename(_dir, _name))) {
+        auto container = std::make_shared<HistContainerReader>(
+                HistContainerReader::filename(_dir, _name), _vars);
+        if (container->good()) {
+            _container = container;
+            _helper = container->helper();
+            _helperCached = true;
+            _cachedContainerHists.resize(_helper.N_HIST);
+            if (container->isCompressed()) {
+                auto hists = container->hists();
+                for (int iHist = 0; iHist < _helper.N_HIST; ++iHist) {
+                    _cachedContainerHists[iHist] = HistFacade::create(
+                            hists[iHist], hists[iHist]->vars());
+                }
+            }
+            return true;
+        }
+    }
+    if (isFileExist(HistBrickReader::filename(_dir, _name))) {
+        auto bricks = std::make_shared<HistBrickReader>(
+                HistBrickReader::filename(_dir, _name), _vars);
+        if (bricks->good()) {
+            _bricks = bricks;
+            _helper = bricks->helper();
+            _helperCached = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<HistFacade> HistFacadeVolume::lazyHist(int flatId) const {
+    QMutexLocker locker(&_lazyMutex);
+    if (_container) {
+        auto& facade = _cachedContainerHists[flatId];
+        if (!facade) {
+            auto hist = _container->hist(flatId);
+            facade = HistFacade::create(hist, hist->vars());
+        }
+        return facade;
+    }
+    auto ids = _helper.dimHists().flattoids(flatId);
+    int brickSize = _bricks->brickSize();
+    int brickId = _bricks->brickId(ids[0], ids[1], ids[2]);
+    int localId = _bricks->dimBrickHists(brickId).idstoflat(
+            ids[0] % brickSize, ids[1] % brickSize, ids[2] % brickSize);
+    if (0 == _cachedBricks.count(brickId)) {
+        auto hists = _bricks->readBrick(brickId);
+        auto& facades = _cachedBricks[brickId];
+        facades.resize(hists.size());
+        for (unsigned int iHist = 0; iHist < hists.size(); ++iHist) {
+            facades[iHist] =
+                    HistFacade::create(hists[iHist], hists[iHist]->vars());
+        }
+    }
+    return _cachedBricks.at(brickId)[localId];
+}
+
 std::vector<int> HistFacadeVolume::dhtoids(
         const std::vector<int> &dIds, const std::vector<int> &hIds) const
 {
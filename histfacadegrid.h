@@ -3,7 +3,16 @@
 
 #include <data/histgrid.h>
 #include <data/dataconfigreader.h>
+#include <data/histbrick.h>
+#include <data/histcontainer.h>
+#include <data/histderivedcache.h>
+#include <data/histintegralvolume.h>
+#include <data/histpyramid.h>
+#include <data/histvolumestats.h>
+#include <data/histreader.h>
 #include <histfacade.h>
+#include <QFuture>
+#include <QMutex>
 
 typedef IConstHGrid<HistFacade> IConstHistFacadeGrid;
 typedef IHGrid<HistFacade> IHistFacadeGrid;
@@ -80,6 +89,10 @@ public:
 
 /**
  * @brief The HistFacadeVolume class
+ * When the volume is stored in the indexed container or the bricked layout,
+ * the histograms are read one at a time or a brick at a time as they are first
+ * accessed and there are no domains. The domains of y-column and multiblock
+ * files are read through the sidecar index as they are first accessed.
  */
 class HistFacadeVolume : public IHistFacadeGrid {
 public:
@@ -87,6 +100,8 @@ public:
             std::vector<int> dims, const std::vector<std::string>& vars);
     HistFacadeVolume(std::string dir, std::string name,
             const MultiBlockTopology &topo, std::vector<std::string> vars);
+    /// Waits for the integral volumes still being built.
+    ~HistFacadeVolume();
 
 public:
     virtual HistHelper helper() const override;
@@ -102,28 +117,73 @@ public:
             const std::vector<int>& ids) const;
     template <typename... Args>
     std::shared_ptr<HistFacadeDomain> domain(Args... ids) {
-        return domain(_dimDomains.idstoflat(ids...));
+        return domain(int(_dimDomains.idstoflat(ids...)));
     }
     template <typename... Args>
     std::shared_ptr<const HistFacadeDomain> domain(Args... ids) const {
-        return domain(_dimDomains.idstoflat(ids...));
+        return domain(int(_dimDomains.idstoflat(ids...)));
     }
     const Extent& dimDomains() const { return _dimDomains; }
     int nDomains() const;
 
 public:
     struct Stats {
+        static Stats create(const std::vector<std::string>& vars,
+                const std::vector<float>& means,
+                const std::vector<float>& mins,
+                const std::vector<float>& maxs);
         std::map<std::string, float> means;
         std::map<std::string, std::array<float, 2>> meanRanges;
     };
     Stats stats() const;
 
+public:
+    /// Range of the bin percentages of the dims marginals over the volume,
+    /// ignoring empty bins.
+    std::array<float, 2> freqRange(const std::vector<int>& dims) const;
+    /// Union of the variable ranges of each of the dims over the volume.
+    std::vector<std::array<double, 2>> varRanges(
+            const std::vector<int>& dims) const;
+    /// Computes the ranges of every 1D and 2D marginal, so switching the
+    /// normalization later finds them cached. Safe to call from any thread.
+    void prefetchRanges() const;
+    bool isBricked() const { return bool(_bricks); }
+    bool isIndexed() const { return bool(_container); }
+    /// Writes the volume into the indexed container next to its files,
+    /// delta-varint encoded when compress.
+    bool writeIndexed(bool compress = false) const;
+
+public:
+    /// Keeps the statistics, ranges, marginals and selections of the volume
+    /// in cache under step, so they are computed once per dataset.
+    void setDerivedCache(
+            std::shared_ptr<const HistDerivedCache> cache, std::string step);
+    /// Whether each histogram is selected, by isSelected or by the cached
+    /// selection of the same query.
+    std::vector<bool> selectionMask(const std::string& query,
+            std::function<bool(int flatId)> isSelected) const;
+
 public:
     enum SliceDirection : int {YZ = 0, XZ = 1, XY = 2};
     std::shared_ptr<HistFacadeRect> xySlice(int z) const;
     std::shared_ptr<HistFacadeRect> xzSlice(int y) const;
     std::shared_ptr<HistFacadeRect> yzSlice(int x) const;
 
+public:
+    /// Prefix sums of the dims marginals, nullptr while they are being built
+    /// on the global thread pool, which the first call starts, and when the
+    /// histograms are binned differently or the sums would not fit the
+    /// memory budget.
+    std::shared_ptr<const HistIntegralVolume> integralVolume(
+            const std::vector<int>& dims) const;
+    /// Levels of the spatial pyramid of the dims marginals.
+    int pyramidLevelCount(const std::vector<int>& dims) const;
+    /// The slice of the pyramid at level > 0 that contains the full resolution
+    /// slice sliceId. Its histograms are the dims marginals merged 2^level
+    /// times in each direction.
+    std::shared_ptr<HistFacadeRect> pyramidSlice(const std::vector<int>& dims,
+            int level, SliceDirection direction, int sliceId) const;
+
 public:
     const std::string& dir() const { return _dir; }
     const std::vector<std::string>& vars() const { return _vars; }
@@ -136,13 +196,58 @@ public:
     int dhtoflat(int dId, int hId) const;
 
 private:
-    std::vector<std::shared_ptr<HistFacadeDomain>> _domains;
+    struct Pyramid {
+        std::shared_ptr<const HistPyramid> hists;
+        std::vector<std::vector<std::shared_ptr<const HistFacade>>> facades;
+    };
+    Pyramid& pyramid(const std::vector<int>& dims) const;
+    /// The dims marginals of every histogram, through the derived cache.
+    /// Safe to call from any thread once helper() is cached.
+    std::vector<std::shared_ptr<const Hist>> marginals(
+            const std::vector<int>& dims) const;
+    std::shared_ptr<const HistIntegralVolume> buildIntegralVolume(
+            const std::vector<int>& dims) const;
+    std::string derivedKey(const std::string& product,
+            const std::vector<int>& dims = {}) const;
+    std::vector<std::shared_ptr<const Hist>> allHists() const;
+    std::vector<std::shared_ptr<const Hist>> nonEmptyHists() const;
+    std::vector<std::array<double, 2>> computeVarRanges() const;
+    HistHelper domainHelper(int flatId) const;
+    std::shared_ptr<HistFacadeDomain> columnDomain(int flatId) const;
+    bool openLazyLayout();
+    std::shared_ptr<HistFacade> lazyHist(int flatId) const;
+
+private:
+    struct ColumnDomain {
+        std::shared_ptr<const HistFacadeYColumnReader> reader;
+        int iDomain;
+    };
+    /// Filled in by columnDomain() when the domains are column backed.
+    mutable std::vector<std::shared_ptr<HistFacadeDomain>> _domains;
+    std::vector<ColumnDomain> _columnDomains;
     Extent _dimDomains;
     std::string _dir, _name;
     std::vector<std::string> _vars;
     mutable std::map<int, std::shared_ptr<HistFacadeRect>> _cachedXYSlices;
     mutable std::map<int, std::shared_ptr<HistFacadeRect>> _cachedXZSlices;
     mutable std::map<int, std::shared_ptr<HistFacadeRect>> _cachedYZSlices;
+    mutable QMutex _integralMutex;
+    mutable std::map<std::vector<int>,
+            std::shared_ptr<const HistIntegralVolume>> _cachedIntegralVolumes;
+    mutable std::map<std::vector<int>, QFuture<void>> _integralBuilds;
+    mutable std::map<std::vector<int>, Pyramid> _cachedPyramids;
+    std::shared_ptr<const HistContainerReader> _container;
+    std::shared_ptr<const HistBrickReader> _bricks;
+    mutable QMutex _lazyMutex;
+    mutable std::vector<std::shared_ptr<HistFacade>> _cachedContainerHists;
+    mutable std::map<int, std::vector<std::shared_ptr<HistFacade>>>
+            _cachedBricks;
+    mutable QMutex _rangesMutex;
+    mutable std::map<std::vector<int>, std::array<float, 2>> _cachedFreqRanges;
+    mutable std::vector<std::array<double, 2>> _cachedVarRanges;
+    std::shared_ptr<const HistDerivedCache> _derivedCache;
+    HistDerivedCache::Source _derivedSource;
+    std::string _step;
 
 private:
     mutable bool _helperCached = false;
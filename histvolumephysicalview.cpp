@@ -12,6 +12,7 @@
 #include <histfacadepainter.h>
 #include <histcharter.h>
 #include <painter.h>
+#include <numeric>
 
 namespace {
 
@@ -546,7 +547,7 @@ void HistVolumePhysicalOpenGLView::resizeGL(int w, int h) {
         return;
     }
     boundSliceTransform();
-    updateHistPainterRects();
+    updatePaintedSliceOrRects();
     static QTimer* timer = [this]() {
         QTimer* timer = new QTimer(this);
         timer->setSingleShot(true);
@@ -982,6 +983,35 @@ void HistVolumePhysicalOpenGLView::updateCurrSlice() {
     } else {
         assert(false);
     }
+    updatePaintedSlice();
+}
+
+// when there are fewer pixels than _minPixelsPerPaintedHist per histogram, the
+// merged histograms of a coarser pyramid level are charted instead, so the
+// cost of a frame follows the number of pixels rather than histograms.
+int HistVolumePhysicalOpenGLView::calcPyramidLevel() const {
+    QRectF rect = calcSliceRect();
+    int nHistX = _currSlice->nHistX();
+    int nHistY = _currSlice->nHistY();
+    float histSize = std::min(rect.width() / nHistX, rect.height() / nHistY);
+    int level = 0;
+    while (histSize * (1 << level) < _minPixelsPerPaintedHist
+            && (1 << level) < std::max(nHistX, nHistY)) {
+        ++level;
+    }
+    return level;
+}
+
+void HistVolumePhysicalOpenGLView::updatePaintedSlice() {
+    _currLevel = calcPyramidLevel();
+    if (0 == _currLevel) {
+        _paintedSlice = _currSlice;
+    } else {
+        auto direction = static_cast<HistFacadeVolume::SliceDirection>(
+                int(_currOrien));
+        _paintedSlice = _histVolume->pyramidSlice(
+                _currDims, _currLevel, direction, _currSliceId);
+    }
     delayForInit([this]() {
         createHistPainters();
         setHistsToHistPainters();
@@ -991,21 +1021,50 @@ void HistVolumePhysicalOpenGLView::updateCurrSlice() {
     });
 }
 
+void HistVolumePhysicalOpenGLView::updatePaintedSliceOrRects() {
+    if (calcPyramidLevel() != _currLevel) {
+        updatePaintedSlice();
+    } else {
+        updateHistPainterRects();
+    }
+}
+
+// the pyramid histograms are the marginals already
+std::vector<int> HistVolumePhysicalOpenGLView::paintedDims() const {
+    if (0 == _currLevel) {
+        return _currDims;
+    }
+    std::vector<int> dims(_currDims.size());
+    std::iota(dims.begin(), dims.end(), 0);
+    return dims;
+}
+
+QRectF HistVolumePhysicalOpenGLView::calcPaintedHistRect(
+        std::array<int, 2> paintedSliceIds) {
+    int span = 1 << _currLevel;
+    std::array<int, 2> lower = {{
+            paintedSliceIds[0] * span, paintedSliceIds[1] * span }};
+    std::array<int, 2> upper = {{
+            std::min(lower[0] + span, _currSlice->nHistX()) - 1,
+            std::min(lower[1] + span, _currSlice->nHistY()) - 1 }};
+    return calcHistRect(lower).united(calcHistRect(upper));
+}
+
 void HistVolumePhysicalOpenGLView::createHistPainters() {
-    _histPainters.resize(_currSlice->nHist());
-    for (int iHist = 0; iHist < _currSlice->nHist(); ++iHist) {
+    _histPainters.resize(_paintedSlice->nHist());
+    for (int iHist = 0; iHist < _paintedSlice->nHist(); ++iHist) {
         _histPainters[iHist] = std::make_shared<HistFacadeCharter>();
         _histPainters[iHist]->setDrawColormap(false);
     }
 }
 
 void HistVolumePhysicalOpenGLView::setHistsToHistPainters() {
-    int nHistX = _currSlice->nHistX();
-    int nHistY = _currSlice->nHistY();
+    int nHistX = _paintedSlice->nHistX();
+    int nHistY = _paintedSlice->nHistY();
+    auto dims = paintedDims();
     for (auto x = 0; x < nHistX; ++x)
     for (auto y = 0; y < nHistY; ++y) {
-        _histPainters[x + nHistX * y]->setHist(
-                _currSlice->hist(x, y), _currDims);
+        _histPainters[x + nHistX * y]->setHist(_paintedSlice->hist(x, y), dims);
     }
 }
 
@@ -1017,7 +1076,7 @@ std::array<float, 2> HistVolumePhysicalOpenGLView::calcFreqRange() const {
         return ::calcFreqRange(_currSlice, _currDims);
     }
     if (NormPer_HistVolume == _currFreqNormPer) {
-        return ::calcFreqRange(_histVolume, _currDims);
+        return _histVolume->freqRange(_currDims);
     }
     if (NormPer_Custom == _currFreqNormPer) {
         return _currFreqRange;
@@ -1028,8 +1087,9 @@ std::array<float, 2> HistVolumePhysicalOpenGLView::calcFreqRange() const {
 
 void HistVolumePhysicalOpenGLView::setFreqRangesToHistPainters(
         const std::array<float, 2>& range) {
-    for (int iHist = 0; iHist < _currSlice->nHist(); ++iHist) {
-        auto hist = _currSlice->hist(iHist)->hist(_currDims);
+    auto dims = paintedDims();
+    for (int iHist = 0; iHist < _paintedSlice->nHist(); ++iHist) {
+        auto hist = _paintedSlice->hist(iHist)->hist(dims);
         auto freqRange = ::calcFreqRange(hist);
         std::array<float, 2> r;
         r[0] = std::isnan(range[0]) ? freqRange[0] : range[0];
@@ -1062,18 +1122,7 @@ std::vector<std::array<double, 2>>
         return minmaxs;
     }
     if (NormPer_HistVolume == _currHistNormPer) {
-        std::vector<std::array<double, 2>> minmaxs(_currDims.size());
-        for (auto& range : minmaxs) {
-            range[0] = std::numeric_limits<double>::max();
-            range[1] = std::numeric_limits<double>::lowest();
-        }
-        for (int iHist = 0; iHist < _histVolume->helper().N_HIST; ++iHist)
-        for (int iDim = 0; iDim < _currDims.size(); ++iDim) {
-            auto range = _histVolume->hist(iHist)->dimRange(_currDims[iDim]);
-            minmaxs[iDim][0] = std::min(range[0], minmaxs[iDim][0]);
-            minmaxs[iDim][1] = std::max(range[1], minmaxs[iDim][1]);
-        }
-        return minmaxs;
+        return _histVolume->varRanges(_currDims);
     }
     if (NormPer_Custom == _currHistNormPer) {
         return _currHistRanges;
@@ -1084,15 +1133,16 @@ std::vector<std::array<double, 2>>
 
 void HistVolumePhysicalOpenGLView::setHistRangesToHistPainters(
         const std::vector<std::array<double, 2> > &ranges) {
-    for (int iHist = 0; iHist < _currSlice->nHist(); ++iHist) {
-        auto hist = _currSlice->hist(iHist);
-        std::vector<std::array<double, 2>> minmaxs(_currDims.size());
-        for (int i = 0; i < _currDims.size(); ++i) {
+    auto dims = paintedDims();
+    for (int iHist = 0; iHist < _paintedSlice->nHist(); ++iHist) {
+        auto hist = _paintedSlice->hist(iHist);
+        std::vector<std::array<double, 2>> minmaxs(dims.size());
+        for (int i = 0; i < dims.size(); ++i) {
             minmaxs[i][0] = std::isnan(ranges[i][0])
-                    ? hist->dimRange(_currDims[i])[0]
+                    ? hist->dimRange(dims[i])[0]
                     : ranges[i][0];
             minmaxs[i][1] = std::isnan(ranges[i][1])
-                    ? hist->dimRange(_currDims[i])[1]
+                    ? hist->dimRange(dims[i])[1]
                     : ranges[i][1];
         }
         _histPainters[iHist]->setRanges(minmaxs);
@@ -1104,11 +1154,11 @@ void HistVolumePhysicalOpenGLView::setHistRangesToHistPainters() {
 }
 
 void HistVolumePhysicalOpenGLView::updateHistPainterRects() {
-    int nHistX = _currSlice->nHistX();
-    int nHistY = _currSlice->nHistY();
+    int nHistX = _paintedSlice->nHistX();
+    int nHistY = _paintedSlice->nHistY();
     for (auto x = 0; x < nHistX; ++x)
     for (auto y = 0; y < nHistY; ++y) {
-        QRectF histRect = calcHistRect({{x, y}});
+        QRectF histRect = calcPaintedHistRect({{x, y}});
         float left = histRect.left() / swf();
         float top = histRect.top() / shf();
         float histWidth = histRect.width() / swf();
@@ -1291,7 +1341,7 @@ void HistVolumePhysicalOpenGLView::zoomEvent(
         return timer;
     }();
     timer->start(10);
-    updateHistPainterRects();
+    updatePaintedSliceOrRects();
 }
 
 std::shared_ptr<QOpenGLFramebufferObject>
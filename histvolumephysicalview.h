@@ -125,6 +125,11 @@ private:
     float calcMaxZoom() const;
     void boundSliceTransform();
     void updateCurrSlice();
+    int calcPyramidLevel() const;
+    void updatePaintedSlice();
+    void updatePaintedSliceOrRects();
+    std::vector<int> paintedDims() const;
+    QRectF calcPaintedHistRect(std::array<int, 2> paintedSliceIds);
     void createHistPainters();
     void setHistsToHistPainters();
     std::array<float, 2> calcFreqRange() const;
@@ -162,6 +167,7 @@ private:
     const float _borderPixel = 10.0f;
     const float _histSpacing = 1.f;
     const float _sizeThresholdToRenderSolidColor = 0.f; // 50.f;
+    const float _minPixelsPerPaintedHist = 16.f;
     const QColor _spacingColor = QColor(255, 100, 100);
     const QVector2D _defaultTranslate = QVector2D(0.5f, 0.5f);
     const std::vector<int> _defaultDims = {0};
@@ -177,6 +183,9 @@ private:
     Orien _currOrien = _defaultOrien;
     int _currSliceId = _defaultSliceId;
     std::shared_ptr<HistFacadeRect> _currSlice;
+    // the slice of the spatial pyramid that is actually charted
+    int _currLevel = 0;
+    std::shared_ptr<HistFacadeRect> _paintedSlice;
     float _currZoom = 1.f;
     QVector2D _currTranslate = _defaultTranslate;
     QPointF _mousePrev, _mousePress;
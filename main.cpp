@@ -21,6 +21,16 @@ void messageHandler(
 
 int main(int argc, char *argv[])
 {
+    // headless conversion of every volume of the dataset into the indexed
+    // container, histconvert converts a single volume without Qt
+    bool compress = 3 == argc && QString("--convert-compressed") == argv[1];
+    if (compress || (3 == argc && QString("--convert") == argv[1])) {
+        QCoreApplication a(argc, argv);
+        DataPool dataPool;
+        if (!dataPool.setDir(argv[2]))
+            return 1;
+        return dataPool.convertToIndexed(compress) ? 0 : 1;
+    }
     Q_INIT_RESOURCE(volren);
     // open the log file
     logFile.open(QIODevice::WriteOnly | QIODevice::Append);
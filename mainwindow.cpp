@@ -23,6 +23,7 @@
 #include <QStackedLayout>
 #include <QFormLayout>
 #include <signupwidget.h>
+#include <set>
 
 namespace {
 
@@ -46,6 +47,46 @@ std::shared_ptr<const Hist> mergeHists(
     return HistMerger(binCounts).merge(hists);
 }
 
+/// When the selection fills an axis-aligned box, its histogram comes from the
+/// integral histogram of the volume, which costs the same for any box size.
+/// Rebinning the box histogram gives the same result as merging every one.
+/// Until the integral histogram is built in the background, the selected
+/// histograms are merged one by one.
+std::shared_ptr<const Hist> mergeSelectedHists(
+        std::shared_ptr<const HistFacadeVolume> volume,
+        const std::vector<int>& flatIds, const std::vector<int>& displayDims) {
+    const unsigned int minBoxHistCount = 64;
+    if (flatIds.size() >= minBoxHistCount) {
+        auto dimHists = volume->dimHists();
+        std::vector<int> lower(3, std::numeric_limits<int>::max());
+        std::vector<int> upper(3, 0);
+        for (auto flatId : flatIds) {
+            auto ids = dimHists.flattoids(flatId);
+            for (int iDim = 0; iDim < 3; ++iDim) {
+                lower[iDim] = std::min(lower[iDim], ids[iDim]);
+                upper[iDim] = std::max(upper[iDim], ids[iDim] + 1);
+            }
+        }
+        int64_t boxHistCount = int64_t(upper[0] - lower[0])
+                * (upper[1] - lower[1]) * (upper[2] - lower[2]);
+        std::set<int> uniqueIds(flatIds.begin(), flatIds.end());
+        auto integral = boxHistCount == int64_t(uniqueIds.size())
+                ? volume->integralVolume(displayDims)
+                : nullptr;
+        if (integral) {
+            std::shared_ptr<const Hist> boxHist =
+                    integral->boxHist(lower, upper);
+            std::vector<BinCount> binCounts(
+                    boxHist->nDim(), BinCount("freedman"));
+            return HistMerger(binCounts).merge({boxHist});
+        }
+    }
+    auto hists = yy::fp::map(flatIds, [&](int flatId) {
+        return volume->hist(flatId)->hist(displayDims);
+    });
+    return mergeHists(hists);
+}
+
 template<class T>
 constexpr const T& clamp(const T& v, const T& lo, const T& hi)
 {
@@ -61,6 +102,9 @@ QStringList getHistConfigNames(const std::vector<HistConfig>& configs) {
     return names;
 }
 
+/// The most particles traced through the steps at once.
+const int maxPathlines = 10000;
+
 } // unnamed namespace
 
 /**
@@ -135,6 +179,8 @@ MainWindow::MainWindow(const std::string &layout, QWidget *parent)
   , _timelineView(new TimelineView(this))
   , _particleView(new ParticleView(this))
   , _currTimeStep(0)
+  , _particleCache(TracerReader::XLOC | TracerReader::TEMP
+        | TracerReader::VEL | TracerReader::MIXFRAC)
   , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
@@ -222,6 +268,12 @@ void MainWindow::createParticleLayout() {
             connect(_particleView, &ParticleView::visibilityChanged,
                     this, &MainWindow::toggleParticleView);
 
+            _pathlinesToggleButton = new QPushButton(ui->centralWidget);
+            _pathlinesToggleButton->setText(tr("Pathlines"));
+            _pathlinesToggleButton->setCheckable(true);
+            connect(_pathlinesToggleButton, &QPushButton::toggled,
+                    this, &MainWindow::togglePathlines);
+
             auto exportParticlesButton = new QPushButton(ui->centralWidget);
             exportParticlesButton->setText(tr("Export Particles"));
             connect(exportParticlesButton, &QPushButton::clicked,
@@ -232,6 +284,7 @@ void MainWindow::createParticleLayout() {
             gridLayout->addWidget(_queryViewToggleButton, 0, gridIndex++);
             gridLayout->addWidget(_timelineViewToggleButton, 0, gridIndex++);
             gridLayout->addWidget(_particleViewToggleButton, 0, gridIndex++);
+            gridLayout->addWidget(_pathlinesToggleButton, 0, gridIndex++);
             gridLayout->addWidget(exportParticlesButton, 0, gridIndex++);
         }
         vLayout->addLayout(gridLayout, 0);
@@ -249,6 +302,7 @@ void MainWindow::createSimpleLayout() {
         _timelineView->setHistConfig(_data.histConfig(name));
         _timelineView->setDisplayDims(displayDims);
         _timelineView->update();
+        _data.prioritizeStats(name);
     });
     connect(physicalView, &HistVolumePhysicalView::selectedHistIdsChanged, this,
             [this](std::string volumeName, std::vector<int> flatIds,
@@ -258,10 +312,7 @@ void MainWindow::createSimpleLayout() {
                 << "flatIds" << QVector<int>::fromStdVector(flatIds)
                 << "displayDims" << QVector<int>::fromStdVector(displayDims);
         auto volume = _data.step(_currTimeStep)->dumbVolume(volumeName);
-        auto hists = yy::fp::map(flatIds, [&](int flatId) {
-            return volume->hist(flatId)->hist(displayDims);
-        });
-        auto merged = mergeHists(hists);
+        auto merged = mergeSelectedHists(volume, flatIds, displayDims);
         auto histFacade = HistFacade::create(merged, merged->vars());
         auto dims = createIncrementVector(0, merged->nDim());
         _histView->setHist(histFacade, dims);
@@ -345,6 +396,7 @@ void MainWindow::createUserStudyLayout() {
         _timelineView->setHistConfig(_data.histConfig(name));
         _timelineView->setDisplayDims(displayDims);
         _timelineView->update();
+        _data.prioritizeStats(name);
     });
     connect(physicalView, &HistVolumePhysicalView::selectedHistIdsChanged, this,
             [this](std::string volumeName, std::vector<int> flatIds,
@@ -354,10 +406,7 @@ void MainWindow::createUserStudyLayout() {
                 << "flatIds" << QVector<int>::fromStdVector(flatIds)
                 << "displayDims" << QVector<int>::fromStdVector(displayDims);
         auto volume = _data.step(_currTimeStep)->dumbVolume(volumeName);
-        auto hists = yy::fp::map(flatIds, [&](int flatId) {
-            return volume->hist(flatId)->hist(displayDims);
-        });
-        auto merged = mergeHists(hists);
+        auto merged = mergeSelectedHists(volume, flatIds, displayDims);
         auto histFacade = HistFacade::create(merged, merged->vars());
         auto dims = createIncrementVector(0, merged->nDim());
         _histView->setHist(histFacade, dims);
@@ -515,6 +564,7 @@ void MainWindow::open(const QString &dir)
     if (!_data.setDir(dir.toStdString()))
         return;
     _currTimeStep = 0;
+    _particleCache.clear();
     _timelineView->setHistConfig(_data.histConfigs()[0]);
     _timelineView->setDisplayDims({0});
     _timelineView->setTimeSteps(_data.timeSteps());
@@ -522,13 +572,14 @@ void MainWindow::open(const QString &dir)
     _data.stats([this](DataPool::Stats dataStats) {
         _timelineView->setStats(dataStats);
         _timelineView->update();
-    });
+    }, _data.histConfigs()[0].name());
     _histVolumeView->setHistConfigs(_data.histConfigs());
     _histVolumeView->setDataStep(_data.step(_currTimeStep));
     _histVolumeView->update();
 
     _queryView->setHistConfigs(_data.histConfigs());
     _particleView->setVisible(false);
+    _particleView->setPathlines(Pathlines());
     glm::vec3 lower(_data.volMin()[0], _data.volMin()[1], _data.volMin()[2]);
     glm::vec3 upper(_data.volMax()[0], _data.volMax()[1], _data.volMax()[2]);
     _particleView->setBoundingBox(lower, upper);
@@ -569,9 +620,8 @@ void MainWindow::toggleParticleView(bool show)
                 pos().y() + size().height() - _particleView->size().height());
     }
     if (show) {
-        _particles = loadTracers(
+        loadTracers(
                 _currTimeStep, _data.step(_currTimeStep)->selectedFlatIds());
-        _particleView->setParticles(&_particles);
     }
     _particleViewToggleButton->blockSignals(true);
     _particleViewToggleButton->setChecked(show);
@@ -581,9 +631,48 @@ void MainWindow::toggleParticleView(bool show)
     _particleView->blockSignals(false);
 }
 
+void MainWindow::togglePathlines(bool show)
+{
+    _particleView->setPathlines(Pathlines());
+    _particleView->update();
+    if (!show)
+        return;
+    if (!_particleView->isVisible())
+        toggleParticleView(true);
+    // the particles of the selection at the current step through all steps
+    std::vector<TracerConfig> configs;
+    for (int iStep = 0; iStep < _data.numSteps(); ++iStep)
+        configs.push_back(_data.tracerConfig(iStep));
+    _particleCache.tracePathlines(_data.dir(), configs, _currTimeStep,
+            _data.step(_currTimeStep)->selectedFlatIds(), maxPathlines, this,
+            [this](const Pathlines& pathlines) {
+        if (!_pathlinesToggleButton->isChecked())
+            return;
+        _particleView->setPathlines(pathlines);
+        _particleView->update();
+    });
+}
+
 void MainWindow::exportParticles()
 {
-    /// TODO: export particles within the selected histograms.
+    if (0 == _data.numSteps())
+        return;
+    QString filter;
+    QString path = QFileDialog::getSaveFileName(this, tr("Export Particles"),
+            QString(), tr("Binary (*.bin);;CSV (*.csv)"), &filter);
+    if (path.isEmpty())
+        return;
+    if (filter.contains("csv") && !path.endsWith(".csv"))
+        path += ".csv";
+    // the particles within the selected histograms of the current step
+    _particleCache.exportParticles(_data.tracerConfig(_currTimeStep),
+            _data.step(_currTimeStep)->selectedFlatIds(), path.toStdString(),
+            this, [path](bool ok, int64_t nParticles) {
+        if (ok)
+            qInfo() << "exported" << nParticles << "particles to" << path;
+        else
+            qInfo() << "failed to export the particles to" << path;
+    });
 }
 
 void MainWindow::setTimeStep(int timeStep)
@@ -593,10 +682,8 @@ void MainWindow::setTimeStep(int timeStep)
     _histVolumeView->setDataStep(_data.step(_currTimeStep));
     _histVolumeView->update();
     if (_particleView->isVisible()) {
-        _particles = loadTracers(
+        loadTracers(
                 _currTimeStep, _data.step(_currTimeStep)->selectedFlatIds());
-        _particleView->setParticles(&_particles);
-        _particleView->update();
     }
 }
 
@@ -604,30 +691,30 @@ void MainWindow::setRules(const std::vector<QueryRule> &rules)
 {
     _data.setQueryRules(rules);
     if (_particleView->isVisible()) {
-        _particles = loadTracers(
+        loadTracers(
                 _currTimeStep, _data.step(_currTimeStep)->selectedFlatIds());
-        _particleView->setParticles(&_particles);
-        _particleView->update();
     }
 }
 
-std::vector<Particle> MainWindow::loadTracers(
+void MainWindow::loadTracers(
         int timeStep, const std::vector<int>& selectedHistFlatIds)
 {
-    // use different tracer reader when different files are present.
-    TracerConfig tracerConfig = _data.tracerConfig(timeStep);
-    std::shared_ptr<TracerReader> reader = TracerReader::create(tracerConfig);
-    std::vector<Particle> parts = reader->read(selectedHistFlatIds);
-    double tMin = std::numeric_limits<double>::max();
-    double tMax = std::numeric_limits<double>::lowest();
-    for (const Particle& part : parts) {
-        tMin = std::min(part.temp, tMin);
-        tMax = std::max(part.temp, tMax);
-    }
-    for (Particle& part : parts) {
-        part.temp = (part.temp - tMin) / (tMax - tMin);
+    // the particles show batch by batch as they are read, only the
+    // histograms newly selected in the step are read.
+    _particleView->clearParticles();
+    _particleView->update();
+    _particleCache.stream(timeStep, _data.tracerConfig(timeStep),
+            selectedHistFlatIds, this, [this](const ParticleColumns& batch) {
+        _particleView->appendParticles(batch);
+        _particleView->update();
+    });
+    // the neighboring steps are likely next, with a similar selection.
+    for (int neighbor : { timeStep + 1, timeStep - 1 }) {
+        if (0 <= neighbor && neighbor < _data.numSteps()) {
+            _particleCache.prefetch(neighbor, _data.tracerConfig(neighbor),
+                    selectedHistFlatIds);
+        }
     }
-    return parts;
 }
 
 void MainWindow::readSettings() {
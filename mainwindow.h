@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <data/DataPool.h>
+#include <data/particlecache.h>
 #include <queryview.h>
 
 class HistView;
@@ -71,10 +72,11 @@ private:
     void toggleQueryView(bool show);
     void toggleTimelineView(bool show);
     void toggleParticleView(bool show);
+    void togglePathlines(bool show);
     void exportParticles();
     void setTimeStep(int timeStep);
     void setRules(const std::vector<QueryRule>& rules);
-    std::vector<Particle> loadTracers(
+    void loadTracers(
             int timeStep, const std::vector<int>& selectedHistFlatIds);
     void readSettings();
 
@@ -97,13 +99,14 @@ private:
 private:
     QPushButton* _queryViewToggleButton;
     QPushButton* _particleViewToggleButton;
+    QPushButton* _pathlinesToggleButton;
     QPushButton* _timelineViewToggleButton;
 
 private:
     DataPool _data;
     DataPool::Stats _dataStats;
     int _currTimeStep;
-    std::vector<Particle> _particles;
+    ParticleCache _particleCache;
 
 private:
     Ui::MainWindow *ui;
@@ -1,16 +1,95 @@
 #include "particleview.h"
 #include <QBoxLayout>
+#include <QComboBox>
+#include <QLabel>
+#include <QLineEdit>
 #include <QMouseEvent>
+#include <QPushButton>
+#include <QTimer>
 #include <yygl/glerror.h>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int64_t minCapacity = 1 << 16;
+// the particles read back from the buffers at once for a brush
+const int64_t brushChunkSize = 1 << 20;
+// tightly packed single precision columns and a byte of mask, 33 bytes per
+// particle
+const size_t positionBytes = 3 * sizeof(float);
+const size_t valueBytes = sizeof(float);
+const size_t maskBytes = sizeof(uint8_t);
+// the particles drawn while the camera moves, and how long it has to stay
+// still for all of them to be drawn
+const int64_t interactivePointBudget = 1 << 20;
+const int refineDelayMs = 200;
+
+/// A larger buffer with the used bytes of the old one.
+std::shared_ptr<yy::gl::buffer> grow(
+        const std::shared_ptr<yy::gl::buffer>& old, size_t nUsedBytes,
+        size_t nBytes) {
+    auto grown = std::make_shared<yy::gl::buffer>(
+            nBytes, yy::gl::buffer::DYNAMIC_DRAW);
+    if (0 < nUsedBytes) {
+        old->bound(yy::gl::buffer::COPY_READ_BUFFER, [&]() {
+            grown->bound(yy::gl::buffer::COPY_WRITE_BUFFER, [&]() {
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        0, 0, nUsedBytes);
+            });
+        });
+    }
+    return grown;
+}
+
+} // anonymous namespace
 
 ParticleView::ParticleView(QWidget *parent)
   : Widget(parent, Qt::Dialog)
   , _openglView(new ParticleOpenGLView(this))
+  , _brushVarCombo(new QComboBox(this))
+  , _brushMinEdit(new QLineEdit(this))
+  , _brushMaxEdit(new QLineEdit(this))
 {
     setMinimumSize(300, 300);
     QVBoxLayout* layout = new QVBoxLayout(this);
     layout->setMargin(0);
     layout->addWidget(_openglView);
+    layout->addLayout([this]() {
+        // a range per attribute, an empty bound leaving that side open
+        auto horizontalLayout = new QHBoxLayout();
+        horizontalLayout->setMargin(0);
+        horizontalLayout->addWidget(new QLabel(tr("Brush"), this));
+        for (auto var : { ParticleBinner::X, ParticleBinner::Y,
+                ParticleBinner::Z, ParticleBinner::TEMP, ParticleBinner::U,
+                ParticleBinner::V, ParticleBinner::W,
+                ParticleBinner::MIXFRAC }) {
+            _brushVarCombo->addItem(
+                    QString::fromStdString(ParticleBinner::name(var)),
+                    int(var));
+        }
+        connect(_brushVarCombo,
+                static_cast<void(QComboBox::*)(int)>(
+                    &QComboBox::currentIndexChanged),
+                this, [this](int) {
+            showBrushRange();
+        });
+        horizontalLayout->addWidget(_brushVarCombo);
+        _brushMinEdit->setPlaceholderText(tr("min"));
+        _brushMaxEdit->setPlaceholderText(tr("max"));
+        connect(_brushMinEdit, &QLineEdit::editingFinished,
+                this, &ParticleView::brush);
+        connect(_brushMaxEdit, &QLineEdit::editingFinished,
+                this, &ParticleView::brush);
+        horizontalLayout->addWidget(_brushMinEdit);
+        horizontalLayout->addWidget(new QLabel(tr(" to "), this));
+        horizontalLayout->addWidget(_brushMaxEdit);
+        auto clearButton = new QPushButton(tr("Clear"), this);
+        connect(clearButton, &QPushButton::clicked,
+                this, &ParticleView::clearBrush);
+        horizontalLayout->addWidget(clearButton);
+        return horizontalLayout;
+    }());
 }
 
 void ParticleView::update()
@@ -24,9 +103,62 @@ void ParticleView::setBoundingBox(glm::vec3 lower, glm::vec3 upper)
     _openglView->setBoundingBox(lower, upper);
 }
 
-void ParticleView::setParticles(const std::vector<Particle> *particles)
+void ParticleView::clearParticles()
+{
+    _openglView->clearParticles();
+}
+
+void ParticleView::appendParticles(const ParticleColumns &particles)
+{
+    _openglView->appendParticles(particles);
+}
+
+void ParticleView::setPathlines(const Pathlines &pathlines)
+{
+    _openglView->setPathlines(pathlines);
+}
+
+void ParticleView::showBrushRange()
+{
+    auto var = ParticleBinner::Variable(
+            _brushVarCombo->currentData().toInt());
+    _brushMinEdit->clear();
+    _brushMaxEdit->clear();
+    for (const auto& range : _brushRanges) {
+        if (range.var != var)
+            continue;
+        if (range.min > std::numeric_limits<float>::lowest())
+            _brushMinEdit->setText(QString::number(range.min));
+        if (range.max < std::numeric_limits<float>::max())
+            _brushMaxEdit->setText(QString::number(range.max));
+    }
+}
+
+void ParticleView::brush()
+{
+    auto var = ParticleBinner::Variable(
+            _brushVarCombo->currentData().toInt());
+    _brushRanges.erase(std::remove_if(_brushRanges.begin(),
+            _brushRanges.end(), [var](const ParticleBrush::Range& range) {
+        return range.var == var;
+    }), _brushRanges.end());
+    bool hasMin = false, hasMax = false;
+    float min = _brushMinEdit->text().toFloat(&hasMin);
+    float max = _brushMaxEdit->text().toFloat(&hasMax);
+    if (hasMin || hasMax) {
+        _brushRanges.push_back({ var,
+                hasMin ? min : std::numeric_limits<float>::lowest(),
+                hasMax ? max : std::numeric_limits<float>::max() });
+    }
+    _openglView->setBrush(ParticleBrush(_brushRanges));
+    showBrushRange();
+}
+
+void ParticleView::clearBrush()
 {
-    _openglView->setParticles(particles);
+    _brushRanges.clear();
+    _openglView->setBrush(ParticleBrush());
+    showBrushRange();
 }
 
 /**
@@ -35,10 +167,24 @@ void ParticleView::setParticles(const std::vector<Particle> *particles)
  */
 ParticleOpenGLView::ParticleOpenGLView(QWidget *parent)
   : OpenGLWidget(parent)
+  , _nParticles(0)
+  , _capacity(0)
+  , _attributes(0)
+  , _interacting(false)
+  , _refineTimer(new QTimer(this))
+  , _valueMin(std::numeric_limits<float>::max())
+  , _valueMax(std::numeric_limits<float>::lowest())
+  , _nPathlineVertices(0)
   , _camera(std::make_shared<Camera>())
   , _boundingBoxLower(-1.f, -1.f, -1.f)
   , _boundingBoxUpper( 1.f,  1.f,  1.f)
 {
+    _refineTimer->setSingleShot(true);
+    _refineTimer->setInterval(refineDelayMs);
+    connect(_refineTimer, &QTimer::timeout, this, [this]() {
+        _interacting = false;
+        update();
+    });
     delayForInit(std::bind(&ParticleOpenGLView::initialize, this));
 }
 
@@ -60,20 +206,109 @@ void ParticleOpenGLView::setBoundingBox(glm::vec3 lower, glm::vec3 upper)
     updateMVP();
 }
 
-void ParticleOpenGLView::setParticles(const std::vector<Particle> *particles)
+void ParticleOpenGLView::clearParticles()
+{
+    // the buffers are kept for the next particles.
+    delayForInit([this]() {
+        _nParticles = 0;
+        _attributes = 0;
+        _batchFirsts.clear();
+        _valueMin = std::numeric_limits<float>::max();
+        _valueMax = std::numeric_limits<float>::lowest();
+        _particlePass.setVertexCount(0);
+    });
+}
+
+void ParticleOpenGLView::appendParticles(const ParticleColumns &particles)
 {
-    delayForInit([this, particles]() {
+    if (particles.empty())
+        return;
+    if (_isInitialized) {
         makeCurrent();
-        *_particles = *particles;
-        _particlePass.setVBO("posAttr", _particles, 3, GL_DOUBLE, 0,
-                sizeof(Particle), sizeof(int64_t) + sizeof(glm::dvec3));
-        _particlePass.setVBO(
-                "valAttr", _particles, 1, GL_DOUBLE, 0, sizeof(Particle),
-                sizeof(int64_t) + 4 * sizeof(glm::dvec3) + sizeof(double));
-        _particlePass.setFirstVertexIndex(0);
-        _particlePass.setVertexCount(particles->size());
+        upload(particles);
         doneCurrent();
+    } else {
+        delayForInit(std::bind(&ParticleOpenGLView::upload, this, particles));
+    }
+}
+
+void ParticleOpenGLView::setPathlines(const Pathlines &pathlines)
+{
+    // a segment between every two steps of a pathline
+    const auto& xlocs = pathlines.vertices.xlocs();
+    const auto& temps = pathlines.vertices.temps();
+    std::vector<float> positions, values;
+    float valueMin = std::numeric_limits<float>::max();
+    float valueMax = std::numeric_limits<float>::lowest();
+    for (int iLine = 0; iLine < pathlines.nPathlines(); ++iLine) {
+        int64_t first = pathlines.firsts[iLine];
+        for (int64_t i = 1; i < pathlines.nVertices(iLine); ++i) {
+            for (int64_t iVertex : { first + i - 1, first + i }) {
+                positions.insert(positions.end(), &xlocs[3 * iVertex],
+                        &xlocs[3 * iVertex] + 3);
+                float value = temps.empty() ? 0.f : temps[iVertex];
+                values.push_back(value);
+                valueMin = std::min(value, valueMin);
+                valueMax = std::max(value, valueMax);
+            }
+        }
+    }
+    delayForInit([this, positions, values, valueMin, valueMax]() {
+        _nPathlineVertices = values.size();
+        if (0 == _nPathlineVertices)
+            return;
+        *_pathlinePositions = positions;
+        *_pathlineValues = values;
+        _pathlinePass.setVBO("posAttr", _pathlinePositions, 3, GL_FLOAT, 0,
+                3 * sizeof(float), 0);
+        _pathlinePass.setVBO("valAttr", _pathlineValues, 1, GL_FLOAT, 0,
+                sizeof(float), 0);
+        _pathlinePass.setVertexCount(_nPathlineVertices);
+        _pathlinePass.setUniform("valMin", valueMin);
+        _pathlinePass.setUniform("valMax", valueMax);
+    });
+}
+
+void ParticleOpenGLView::setBrush(const ParticleBrush &brush)
+{
+    _brush = brush;
+    delayForInit([this]() {
+        // only the brushed columns, read back a chunk at a time
+        int attributes = 0;
+        for (const auto& range : _brush.ranges()) {
+            if (ParticleBinner::TEMP == range.var)
+                attributes |= ParticleColumns::TEMP;
+            else if (ParticleBinner::MIXFRAC == range.var)
+                attributes |= ParticleColumns::MIXFRAC;
+            else if (ParticleBinner::U <= range.var)
+                attributes |= ParticleColumns::VEL;
+            else
+                attributes |= ParticleColumns::XLOC;
+        }
+        ParticleColumns chunk(attributes & _attributes);
+        for (int64_t first = 0; first < _nParticles; first += brushChunkSize) {
+            chunk.resize(std::min(brushChunkSize, _nParticles - first));
+            int64_t n = chunk.size();
+            if (chunk.has(ParticleColumns::XLOC)) {
+                _positions->getBufferData(first * positionBytes,
+                        n * positionBytes, chunk.xlocs().data());
+            }
+            if (chunk.has(ParticleColumns::TEMP)) {
+                _values->getBufferData(first * valueBytes, n * valueBytes,
+                        chunk.temps().data());
+            }
+            if (chunk.has(ParticleColumns::VEL)) {
+                _vels->getBufferData(first * positionBytes,
+                        n * positionBytes, chunk.vels().data());
+            }
+            if (chunk.has(ParticleColumns::MIXFRAC)) {
+                _mixfracs->getBufferData(first * valueBytes, n * valueBytes,
+                        chunk.mixfracs().data());
+            }
+            uploadMasks(first, chunk);
+        }
     });
+    update();
 }
 
 void ParticleOpenGLView::paintGL()
@@ -84,7 +319,25 @@ void ParticleOpenGLView::paintGL()
     glEnable(GL_PROGRAM_POINT_SIZE);
 
     _boundingBoxPass.drawElements();
-    _particlePass.drawArrays();
+    if (_interacting && _nParticles > interactivePointBudget) {
+        // a stratified prefix of every batch, the same share of each
+        double share = double(interactivePointBudget) / _nParticles;
+        for (size_t iBatch = 0; iBatch < _batchFirsts.size(); ++iBatch) {
+            int64_t first = _batchFirsts[iBatch];
+            int64_t count = (iBatch + 1 < _batchFirsts.size()
+                    ? _batchFirsts[iBatch + 1] : _nParticles) - first;
+            _particlePass.setFirstVertexIndex(first);
+            _particlePass.setVertexCount(
+                    std::max<int64_t>(1, int64_t(count * share)));
+            _particlePass.drawArrays();
+        }
+        _particlePass.setFirstVertexIndex(0);
+        _particlePass.setVertexCount(_nParticles);
+    } else {
+        _particlePass.drawArrays();
+    }
+    if (0 < _nPathlineVertices)
+        _pathlinePass.drawArrays();
 
     glDisable(GL_PROGRAM_POINT_SIZE);
     glDisable(GL_POINT_SPRITE);
@@ -123,7 +376,7 @@ void ParticleOpenGLView::mouseMoveEvent(QMouseEvent *event)
     _camera->resetNearFar(qBoundingBoxLower, qBoundingBoxUpper);
     updateMVP();
     _mousePrev = mouseCurr;
-    update();
+    interact();
 }
 
 void ParticleOpenGLView::wheelEvent(QWheelEvent *event)
@@ -131,13 +384,19 @@ void ParticleOpenGLView::wheelEvent(QWheelEvent *event)
     auto numDegrees = float(event->angleDelta().y()) / 8.f;
     _camera->zoom(numDegrees);
     updateMVP();
-    update();
+    interact();
 }
 
 void ParticleOpenGLView::initialize()
 {
     glClearColor(1.f, 1.f, 1.f, 1.f);
-    _particles = std::make_shared<yy::gl::buffer>();
+    _positions = std::make_shared<yy::gl::buffer>();
+    _values = std::make_shared<yy::gl::buffer>();
+    _masks = std::make_shared<yy::gl::buffer>();
+    _vels = std::make_shared<yy::gl::buffer>();
+    _mixfracs = std::make_shared<yy::gl::buffer>();
+    _pathlinePositions = std::make_shared<yy::gl::buffer>();
+    _pathlineValues = std::make_shared<yy::gl::buffer>();
     // bounding box render pass
     _boundingBoxPass.setProgram(
             yy::gl::shader::VERTEX_SHADER,
@@ -194,6 +453,40 @@ void ParticleOpenGLView::initialize()
     _particlePass.setDrawMode(yy::gl::render_pass::POINTS);
     _particlePass.setFirstVertexIndex(0);
     _particlePass.setUniform("ptSize", 10.f);
+    _particlePass.setUniform("valMin", 0.f);
+    _particlePass.setUniform("valMax", 1.f);
+    // pathline pass, from cold to hot as the particles
+    _pathlinePass.setProgram(
+            yy::gl::shader::VERTEX_SHADER,
+            R"GLSL(
+                #version 330
+                uniform mat4 mvp;
+                uniform float valMin;
+                uniform float valMax;
+                in vec3 posAttr;
+                in float valAttr;
+                out float fValue;
+                void main() {
+                    gl_Position = mvp * vec4(posAttr, 1.0);
+                    fValue = (valAttr - valMin)
+                            / max(valMax - valMin, 1e-20);
+                }
+            )GLSL",
+            yy::gl::shader::FRAGMENT_SHADER,
+            R"GLSL(
+                #version 330
+                in float fValue;
+                out vec4 f_color;
+                void main() {
+                    vec3 cold = vec3(0.0, 0.267, 0.60);
+                    vec3 hot = vec3(0.612, 0.157, 0.12);
+                    f_color = vec4(
+                            mix(cold, hot, clamp(fValue, 0.0, 1.0)), 1.0);
+                }
+            )GLSL");
+    _pathlinePass.setDrawMode(yy::gl::render_pass::LINES);
+    _pathlinePass.setFirstVertexIndex(0);
+    _pathlinePass.setVertexCount(0);
 }
 
 void ParticleOpenGLView::updateMVP()
@@ -215,6 +508,75 @@ void ParticleOpenGLView::updateMVP()
                 "matVP", _camera->matProj() * _camera->matView());
         _particlePass.setUniform("matModel", QMatrix4x4());
         _particlePass.setUniform("campos", _camera->eye());
+        _pathlinePass.setUniform(
+                "mvp", _camera->matProj() * _camera->matView());
         doneCurrent();
     });
 }
+
+void ParticleOpenGLView::upload(const ParticleColumns &particles)
+{
+    int64_t nParticles = _nParticles + particles.size();
+    if (nParticles > _capacity) {
+        _capacity = std::max(nParticles, std::max(2 * _capacity, minCapacity));
+        _positions = grow(_positions, _nParticles * positionBytes,
+                _capacity * positionBytes);
+        _values = grow(_values, _nParticles * valueBytes,
+                _capacity * valueBytes);
+        _masks = grow(_masks, _nParticles * maskBytes,
+                _capacity * maskBytes);
+        _vels = grow(_vels, _nParticles * positionBytes,
+                _capacity * positionBytes);
+        _mixfracs = grow(_mixfracs, _nParticles * valueBytes,
+                _capacity * valueBytes);
+        _particlePass.setVBO("posAttr", _positions, 3, GL_FLOAT, 0,
+                positionBytes, 0);
+        _particlePass.setVBO("valAttr", _values, 1, GL_FLOAT, 0,
+                valueBytes, 0);
+        _particlePass.setVBO("maskAttr", _masks, 1, GL_UNSIGNED_BYTE,
+                GL_TRUE, maskBytes, 0);
+    }
+    _batchFirsts.push_back(_nParticles);
+    _positions->bufferSubData(_nParticles * positionBytes,
+            particles.size() * positionBytes, particles.xlocs().data());
+    _values->bufferSubData(_nParticles * valueBytes,
+            particles.size() * valueBytes, particles.temps().data());
+    if (particles.has(ParticleColumns::VEL)) {
+        _vels->bufferSubData(_nParticles * positionBytes,
+                particles.size() * positionBytes, particles.vels().data());
+    }
+    if (particles.has(ParticleColumns::MIXFRAC)) {
+        _mixfracs->bufferSubData(_nParticles * valueBytes,
+                particles.size() * valueBytes, particles.mixfracs().data());
+    }
+    // a brush can only use the columns every batch has
+    _attributes = 0 == _nParticles
+            ? particles.attributes() : _attributes & particles.attributes();
+    uploadMasks(_nParticles, particles);
+    _nParticles = nParticles;
+    for (float value : particles.temps()) {
+        _valueMin = std::min(value, _valueMin);
+        _valueMax = std::max(value, _valueMax);
+    }
+    _particlePass.setFirstVertexIndex(0);
+    _particlePass.setVertexCount(_nParticles);
+    _particlePass.setUniform("valMin", _valueMin);
+    _particlePass.setUniform("valMax", _valueMax);
+}
+
+void ParticleOpenGLView::uploadMasks(
+        int64_t first, const ParticleColumns &particles)
+{
+    if (particles.empty())
+        return;
+    auto masks = _brush.mask(particles);
+    _masks->bufferSubData(first * sizeof(uint8_t),
+            masks.size() * sizeof(uint8_t), masks.data());
+}
+
+void ParticleOpenGLView::interact()
+{
+    _interacting = true;
+    _refineTimer->start();
+    update();
+}
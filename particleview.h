@@ -6,9 +6,14 @@
 #include <openglwidget.h>
 #include <functional>
 #include <data/tracerreader.h>
+#include <data/ssnjoinindex.h>
+#include <data/particlebrush.h>
 #include <camera.h>
 
 class ParticleOpenGLView;
+class QTimer;
+class QComboBox;
+class QLineEdit;
 
 /**
  * @brief The ParticleView class
@@ -24,14 +29,38 @@ signals:
 public:
     void update();
     void setBoundingBox(glm::vec3 lower, glm::vec3 upper);
-    void setParticles(const std::vector<Particle>* particles);
+    void clearParticles();
+    void appendParticles(const ParticleColumns& particles);
+    void setPathlines(const Pathlines& pathlines);
+
+private:
+    void showBrushRange();
+    void brush();
+    void clearBrush();
 
 private:
     ParticleOpenGLView* _openglView;
+    QComboBox* _brushVarCombo;
+    QLineEdit* _brushMinEdit;
+    QLineEdit* _brushMaxEdit;
+    std::vector<ParticleBrush::Range> _brushRanges;
 };
 
 /**
- * @brief The ParticleOpenGLView class
+ * @brief The ParticleOpenGLView class draws the particles from append-only
+ * vertex buffers, so they can be shown batch by batch as they are read. The
+ * buffers grow geometrically and only the new particles are uploaded. The
+ * values are normalized in the shader by their running range.
+ *
+ * Every batch comes in stratified order, so while the camera moves only a
+ * prefix of each batch is drawn, in proportion to a point budget, and the
+ * full set is drawn again once the camera stops. Pathlines are drawn as
+ * line segments colored by their own value range.
+ *
+ * The velocities and mixture fractions are kept in buffers of their own
+ * for brushing, so the particles are held by the GPU only: a brush reads
+ * back the columns it tests a chunk at a time, uploads its mask, one byte
+ * per particle, and the shader drops the particles out of it.
  */
 class ParticleOpenGLView : public OpenGLWidget {
     Q_OBJECT
@@ -42,7 +71,12 @@ signals:
 
 public:
     void setBoundingBox(glm::vec3 lower, glm::vec3 upper);
-    void setParticles(const std::vector<Particle>* particles);
+    void clearParticles();
+    void appendParticles(const ParticleColumns& particles);
+    /// Draws the pathlines over the particles, none when empty.
+    void setPathlines(const Pathlines& pathlines);
+    /// Shows only the particles in the brush, all of them when it is empty.
+    void setBrush(const ParticleBrush& brush);
 
 protected:
     virtual void paintGL() override;
@@ -54,11 +88,25 @@ protected:
 private:
     void initialize();
     void updateMVP();
+    void upload(const ParticleColumns& particles);
+    void uploadMasks(int64_t first, const ParticleColumns& particles);
+    void interact();
 
 private:
     yy::gl::render_pass _boundingBoxPass;
     yy::gl::render_pass _particlePass;
-    std::shared_ptr<yy::gl::buffer> _particles;
+    yy::gl::render_pass _pathlinePass;
+    std::shared_ptr<yy::gl::buffer> _positions, _values, _masks;
+    std::shared_ptr<yy::gl::buffer> _vels, _mixfracs;
+    int64_t _nParticles, _capacity;
+    int _attributes;
+    ParticleBrush _brush;
+    std::vector<int64_t> _batchFirsts;
+    bool _interacting;
+    QTimer* _refineTimer;
+    float _valueMin, _valueMax;
+    std::shared_ptr<yy::gl::buffer> _pathlinePositions, _pathlineValues;
+    int64_t _nPathlineVertices;
     std::shared_ptr<Camera> _camera;
     glm::vec3 _boundingBoxLower, _boundingBoxUpper;
     QPointF _mousePrev;
@@ -4,9 +4,14 @@ uniform mat4 matVP;
 uniform mat4 matModel;
 uniform vec3 campos;
 uniform float ptSize;
+// the running range of the values loaded so far
+uniform float valMin;
+uniform float valMax;
 
 in vec4 posAttr;
 in float valAttr;
+// 0 for the particles out of the brush
+in float maskAttr;
 
 out vec4 fVertex;
 
@@ -20,7 +25,11 @@ void main() {
     }
 
     gl_Position = matVP * matModel * vec4(posAttr.xyz,1.0);
+    // beyond the far plane, so clipped
+    if (maskAttr < 0.5)
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
 
-    fVertex = vec4(posAttr.xyz, valAttr);
+    float valRange = max(valMax - valMin, 1e-20);
+    fVertex = vec4(posAttr.xyz, (valAttr - valMin) / valRange);
 
 }
@@ -36,12 +36,10 @@ void TimelineView::setTimeSteps(const TimeSteps &timeSteps) {
     _timeSteps = timeSteps;
 }
 
+// the stats may come in before all of the steps are done, in which case the
+// steps without the config are left out of the charts.
 void TimelineView::setStats(DataPool::Stats dataStats) {
-    if (!dataStats.empty() && yy::includes(dataStats[0], _histConfig.name())) {
-        _dataStats = dataStats;
-        return;
-    }
-    _dataStats = {};
+    _dataStats = dataStats;
 }
 
 void TimelineView::paintGL() {
@@ -155,6 +153,8 @@ void TimelineView::drawTimelineAsBarChart() {
         float vMin = std::numeric_limits<float>::max();
         float vMax = std::numeric_limits<float>::lowest();
         for (int iStep = 0; iStep < _dataStats.size(); ++iStep) {
+            if (!yy::includes(_dataStats[iStep], _histConfig.name()))
+                continue;
             const auto& volumeStats = _dataStats[iStep][_histConfig.name()];
             float average = volumeStats.means.at(_histConfig.vars[iDim]);
             vMin = std::min(vMin, average);
@@ -162,6 +162,8 @@ void TimelineView::drawTimelineAsBarChart() {
         }
         painter.setPen(QPen(dimToColor[i], plottingLineWidth));
         for (unsigned int iStep = 0; iStep < _dataStats.size(); ++iStep) {
+            if (!yy::includes(_dataStats[iStep], _histConfig.name()))
+                continue;
             const auto& volumeStats = _dataStats[iStep][_histConfig.name()];
             float average = volumeStats.means.at(_histConfig.vars[iDim]);
             float ratio = (average - vMin) / (vMax - vMin);
@@ -263,6 +265,8 @@ void TimelineView::drawTimelineAsLineChart() {
         float vMin = std::numeric_limits<float>::max();
         float vMax = std::numeric_limits<float>::lowest();
         for (int iStep = 0; iStep < _dataStats.size(); ++iStep) {
+            if (!yy::includes(_dataStats[iStep], _histConfig.name()))
+                continue;
             const auto& volumeStats = _dataStats[iStep][_histConfig.name()];
             float average = volumeStats.means.at(_histConfig.vars[iDim]);
             vMin = std::min(vMin, average);
@@ -270,6 +274,8 @@ void TimelineView::drawTimelineAsLineChart() {
         }
         QPolygonF polyline;
         for (unsigned int iStep = 0; iStep < _dataStats.size(); ++iStep) {
+            if (!yy::includes(_dataStats[iStep], _histConfig.name()))
+                continue;
             const auto& volumeStats = _dataStats[iStep][_histConfig.name()];
             float average = volumeStats.means.at(_histConfig.vars[iDim]);
             float ratio = (average - vMin) / (vMax - vMin);